@@ -0,0 +1,1145 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Headless benchmark of the haptic loop. Loads the same campus scene as
+ *    the application, drives the tool from a simulated device and reports
+ *    latency percentiles for each stage of the servo loop.
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include "CAllocationTracker.h"
+#include "CCampusScene.h"
+#include "CCoherentCollisionAABB.h"
+#include "CDistanceField.h"
+#include "CForcePipeline.h"
+#include "CHapticScheduler.h"
+#include "CHeightFieldRenderer.h"
+#include "CLatencyStats.h"
+#include "CMappedFile.h"
+#include "COsmMap.h"
+#include "CProbeTrajectory.h"
+#include "CRealtime.h"
+#include "CRoutePlanner.h"
+#include "CSessionRecorder.h"
+#include "CSimulatedHapticDevice.h"
+#include "CTransformUpdater.h"
+#include "CWorkerPool.h"
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+#if defined(LINUX)
+#include <sys/resource.h>
+#endif
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// BENCHMARK SETTINGS
+//------------------------------------------------------------------------------
+
+// servo thread priority and heap prefaulted with --realtime, as in the
+// application
+static const int C_BENCH_FIFO_PRIORITY = 80;
+static const size_t C_BENCH_HEAP_RESERVE = 64 * 1024 * 1024;
+
+struct cBenchSettings
+{
+    cBenchSettings() :
+        m_shape(cProbeTrajectory::C_RASTER),
+        m_speed(0.1),
+        m_rate(1000.0),
+        m_ticks(20000),
+        m_warmup(1000),
+        m_maxP99(0.0),
+        m_maxP999(0.0),
+        m_maxAllocations(-1),
+        m_incrementalTransforms(true),
+        m_scheduleRate(0.0),
+        m_stations(1),
+        m_realtime(false),
+        m_useMeshCache(true),
+        m_useTextureCache(true),
+        m_coherentCollision(true),
+        m_osmScale(1),
+        m_osmAllTags(false),
+        m_heightField(false),
+        m_heightFieldFallback(false),
+        m_proximity(false),
+        m_guidance(false) {}
+
+    // synthetic trajectory shape, used when no file is given
+    cProbeTrajectory::cShape m_shape;
+
+    // recorded trajectory to replay instead of a synthetic one
+    string m_trajectoryFile;
+
+    // session log to replay instead of a trajectory; the forces are
+    // compared with the logged ones
+    string m_sessionFile;
+
+    // write the synthetic trajectory to this file
+    string m_saveTrajectoryFile;
+
+    // record the measured ticks to this session log
+    string m_recordFile;
+
+    // write raw per-tick samples to this file
+    string m_csvFile;
+
+    // probe speed in world units per second
+    double m_speed;
+
+    // nominal servo rate used to space trajectory samples [Hz]
+    double m_rate;
+
+    // number of measured ticks
+    int m_ticks;
+
+    // number of ticks run before measuring
+    int m_warmup;
+
+    // fail when the p99 / p99.9 tick latency exceeds these values [us] (0 = off)
+    double m_maxP99;
+    double m_maxP999;
+
+    // fail when the measured ticks make more heap allocations than this
+    // (-1 = off); needs a build that tracks allocations
+    int m_maxAllocations;
+
+    // use cTransformUpdater instead of a full computeGlobalPositions() walk
+    bool m_incrementalTransforms;
+
+    // pace the loop with cHapticScheduler at this rate [Hz] (0 = free-running)
+    double m_scheduleRate;
+
+    // simulated devices on the same map. the first one is measured, the
+    // others run their own servo threads at m_rate alongside it.
+    int m_stations;
+
+    // run the servo threads on isolated cores under SCHED_FIFO, with the
+    // memory of the process locked
+    bool m_realtime;
+
+    // load assets through their binary mesh caches
+    bool m_useMeshCache;
+
+    // load the haptic texture maps through their caches
+    bool m_useTextureCache;
+
+    // warm-start the collision queries of the map from the last contact
+    bool m_coherentCollision;
+
+    // build the map from an OSM extract
+    string m_osmFile;
+
+    // only measure how fast this OSM extract is parsed, enlarged
+    // m_osmScale times
+    string m_osmParseFile;
+    int m_osmScale;
+
+    // keep all tags instead of the default tag filter
+    bool m_osmAllTags;
+
+    // render the static map through a height field, optionally falling back
+    // to the meshes near sharp edges
+    bool m_heightField;
+    bool m_heightFieldFallback;
+
+    // bake the distance field of the map and push the tool away from the
+    // buildings while measuring
+    bool m_proximity;
+
+    // guide the tool along the paths of an OSM map while measuring
+    bool m_guidance;
+};
+
+//------------------------------------------------------------------------------
+
+static void printUsage()
+{
+    cout << "usage: hapmap_bench [options]" << endl << endl;
+    cout << "  --trajectory raster|circles|random   synthetic probe path (default raster)" << endl;
+    cout << "  --replay <file>                      replay a recorded trajectory (\"t x y z\" per line)" << endl;
+    cout << "  --replay-session <file>              replay a session log and compare the forces with it" << endl;
+    cout << "  --save-trajectory <file>             write the probe path that was used" << endl;
+    cout << "  --record <file>                      record the measured ticks to a session log" << endl;
+    cout << "  --speed <m/s>                        probe speed in world units (default 0.1)" << endl;
+    cout << "  --rate <Hz>                          servo rate of the trajectory (default 1000)" << endl;
+    cout << "  --ticks <n>                          measured ticks (default 20000)" << endl;
+    cout << "  --warmup <n>                         ticks before measuring (default 1000)" << endl;
+    cout << "  --csv <file>                         dump per-tick samples [us]" << endl;
+    cout << "  --max-p99 <us>                       fail if tick p99 exceeds this" << endl;
+    cout << "  --max-p999 <us>                      fail if tick p99.9 exceeds this" << endl;
+    cout << "  --max-allocations <n>                fail if the measured ticks allocate more often (CONFIG+=track_allocations)" << endl;
+    cout << "  --full-transforms                    walk the whole scene graph every tick" << endl;
+    cout << "  --schedule <Hz>                      pace the loop and report overruns and jitter" << endl;
+    cout << "  --stations <n>                       serve n simulated devices, one servo thread each (default 1)" << endl;
+    cout << "  --realtime                           isolated cores, SCHED_FIFO and locked memory for the servo threads" << endl;
+    cout << "  --no-mesh-cache                      always parse the .obj assets" << endl;
+    cout << "  --no-texture-cache                   always bake the haptic texture maps" << endl;
+    cout << "  --no-coherent-collision              start every collision query from the root of the tree" << endl;
+    cout << "  --osm <file>                         build the map from an OSM extract" << endl;
+    cout << "  --osm-parse <file>                   only measure OSM parse throughput and memory" << endl;
+    cout << "  --osm-scale <n>                      parse a synthetic n-times enlargement (default 1)" << endl;
+    cout << "  --osm-all-tags                       keep all OSM tags while parsing" << endl;
+    cout << "  --heightfield                        render the map through a 2.5D height field" << endl;
+    cout << "  --heightfield-fallback               hand sharp edges back to mesh collision" << endl;
+    cout << "  --proximity                          push the tool away from the buildings (distance field)" << endl;
+    cout << "  --guidance                           guide the tool along the paths of an OSM map" << endl;
+}
+
+//------------------------------------------------------------------------------
+
+static bool parseArguments(int argc, char* argv[], cBenchSettings& a_settings)
+{
+    for (int i=1; i<argc; i++)
+    {
+        string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if ((arg == "--help") || (arg == "-h"))
+        {
+            return (false);
+        }
+        else if ((arg == "--trajectory") && hasValue)
+        {
+            if (!cProbeTrajectory::parseShape(argv[++i], a_settings.m_shape))
+            {
+                cout << "Error - unknown trajectory: " << argv[i] << endl;
+                return (false);
+            }
+        }
+        else if ((arg == "--replay") && hasValue)           { a_settings.m_trajectoryFile = argv[++i]; }
+        else if ((arg == "--replay-session") && hasValue)   { a_settings.m_sessionFile = argv[++i]; }
+        else if ((arg == "--save-trajectory") && hasValue)  { a_settings.m_saveTrajectoryFile = argv[++i]; }
+        else if ((arg == "--record") && hasValue)           { a_settings.m_recordFile = argv[++i]; }
+        else if ((arg == "--speed") && hasValue)            { a_settings.m_speed = atof(argv[++i]); }
+        else if ((arg == "--rate") && hasValue)             { a_settings.m_rate = atof(argv[++i]); }
+        else if ((arg == "--ticks") && hasValue)            { a_settings.m_ticks = atoi(argv[++i]); }
+        else if ((arg == "--warmup") && hasValue)           { a_settings.m_warmup = atoi(argv[++i]); }
+        else if ((arg == "--csv") && hasValue)              { a_settings.m_csvFile = argv[++i]; }
+        else if ((arg == "--max-p99") && hasValue)          { a_settings.m_maxP99 = atof(argv[++i]); }
+        else if ((arg == "--max-p999") && hasValue)         { a_settings.m_maxP999 = atof(argv[++i]); }
+        else if ((arg == "--max-allocations") && hasValue)  { a_settings.m_maxAllocations = atoi(argv[++i]); }
+        else if (arg == "--full-transforms")                { a_settings.m_incrementalTransforms = false; }
+        else if ((arg == "--schedule") && hasValue)         { a_settings.m_scheduleRate = atof(argv[++i]); }
+        else if ((arg == "--stations") && hasValue)         { a_settings.m_stations = atoi(argv[++i]); }
+        else if (arg == "--realtime")                       { a_settings.m_realtime = true; }
+        else if (arg == "--no-mesh-cache")                  { a_settings.m_useMeshCache = false; }
+        else if (arg == "--no-texture-cache")               { a_settings.m_useTextureCache = false; }
+        else if (arg == "--no-coherent-collision")          { a_settings.m_coherentCollision = false; }
+        else if ((arg == "--osm") && hasValue)              { a_settings.m_osmFile = argv[++i]; }
+        else if ((arg == "--osm-parse") && hasValue)        { a_settings.m_osmParseFile = argv[++i]; }
+        else if ((arg == "--osm-scale") && hasValue)        { a_settings.m_osmScale = atoi(argv[++i]); }
+        else if (arg == "--osm-all-tags")                   { a_settings.m_osmAllTags = true; }
+        else if (arg == "--heightfield")                    { a_settings.m_heightField = true; }
+        else if (arg == "--heightfield-fallback")           { a_settings.m_heightField = a_settings.m_heightFieldFallback = true; }
+        else if (arg == "--proximity")                      { a_settings.m_proximity = true; }
+        else if (arg == "--guidance")                       { a_settings.m_guidance = true; }
+        else
+        {
+            cout << "Error - unknown option: " << arg << endl;
+            return (false);
+        }
+    }
+
+    if ((a_settings.m_ticks <= 0) || (a_settings.m_rate <= 0.0) || (a_settings.m_speed <= 0.0) ||
+        (a_settings.m_osmScale <= 0) || (a_settings.m_stations <= 0))
+    {
+        cout << "Error - ticks, rate, speed, scale and stations must be positive" << endl;
+        return (false);
+    }
+    if ((a_settings.m_stations > 1) && (a_settings.m_heightField || !a_settings.m_incrementalTransforms))
+    {
+        cout << "Error - several stations need mesh collision and incremental transforms" << endl;
+        return (false);
+    }
+    if ((a_settings.m_maxAllocations >= 0) && !cAllocationTracker::isAvailable())
+    {
+        cout << "Error - --max-allocations needs a build with CONFIG+=track_allocations" << endl;
+        return (false);
+    }
+
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+static inline double benchTime()
+{
+    return (chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//------------------------------------------------------------------------------
+// STATIONS
+//------------------------------------------------------------------------------
+
+// a simulated device served next to the measured one, with everything its
+// servo thread writes, as a station of the application
+struct cBenchStation
+{
+    cBenchStation() : m_tool(NULL), m_transformUpdater(NULL), m_proximity(NULL), m_core(-1), m_realtime(false) {}
+
+    cSimulatedHapticDevicePtr m_device;
+    cToolCursor* m_tool;
+    cTransformUpdater* m_transformUpdater;
+    cHapticTextureRenderer m_textures;
+    cProximityRenderer* m_proximity;
+    cMapForcePipeline m_forces;
+    cHapticScheduler m_scheduler;
+    int m_core;
+    bool m_realtime;
+    thread m_thread;
+};
+
+//------------------------------------------------------------------------------
+
+// servo loop of an unmeasured station, as updateHaptics() runs it
+static void runStation(cBenchStation* a_station, const cCampusScene* a_scene, double a_reach,
+                       const atomic<bool>* a_running)
+{
+    if ((a_station->m_core >= 0) && !cHapticScheduler::pinCurrentThread(a_station->m_core))
+    {
+        cout << "Warning - station thread could not be pinned to core " << a_station->m_core << endl;
+    }
+    if (a_station->m_realtime)
+    {
+        cRealtime::setFifoPriority(C_BENCH_FIFO_PRIORITY);
+        cRealtime::prefaultStack();
+    }
+
+    cToolCursor* tool = a_station->m_tool;
+    a_station->m_scheduler.start();
+    while (a_running->load(memory_order_acquire))
+    {
+        a_station->m_scheduler.waitForNextTick();
+        a_station->m_transformUpdater->update();
+        tool->updateFromDevice();
+        tool->computeInteractionForces();
+
+        cForceContext context;
+        context.set(tool, a_scene->m_campus, NULL);
+        a_station->m_device->setForce(a_station->m_forces.compute(context));
+
+        if (context.m_inContact)
+        {
+            a_scene->m_features->find(context.m_localProxy, a_reach);
+        }
+        a_station->m_device->step();
+    }
+}
+
+//------------------------------------------------------------------------------
+// OSM PARSING
+//------------------------------------------------------------------------------
+
+// peak resident memory of the process in bytes, or 0 if unknown
+static size_t peakMemory()
+{
+#if defined(LINUX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        return ((size_t)usage.ru_maxrss * 1024);
+    }
+#endif
+    return (0);
+}
+
+//------------------------------------------------------------------------------
+
+// copy a_text, adding a_offset to every id="..." and ref="..." number
+static void offsetIds(const string& a_text, int64_t a_offset, ostream& a_out)
+{
+    size_t pos = 0;
+    while (pos < a_text.size())
+    {
+        size_t id = a_text.find(" id=\"", pos);
+        size_t ref = a_text.find(" ref=\"", pos);
+        size_t next = min(id, ref);
+        if (next == string::npos)
+        {
+            a_out << a_text.substr(pos);
+            break;
+        }
+        size_t number = a_text.find('"', next) + 1;
+        a_out << a_text.substr(pos, number - pos);
+
+        size_t end = a_text.find('"', number);
+        a_out << (strtoll(a_text.c_str() + number, NULL, 10) + a_offset);
+        pos = end;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// write a synthetic extract with a_scale copies of every element of an OSM
+// file. ids are offset per copy, and nodes, ways and relations stay in
+// separate sections as in real extracts.
+static bool enlargeOsmFile(const string& a_source, const string& a_target, int a_scale)
+{
+    ifstream in(a_source.c_str(), ios::binary);
+    if (!in)
+    {
+        return (false);
+    }
+    stringstream buffer;
+    buffer << in.rdbuf();
+    string text = buffer.str();
+
+    size_t nodes = text.find("<node");
+    size_t ways = text.find("<way");
+    size_t relations = text.find("<relation");
+    size_t end = text.rfind("</osm>");
+    if ((nodes == string::npos) || (end == string::npos))
+    {
+        return (false);
+    }
+    if (relations == string::npos) relations = end;
+    if (ways == string::npos) ways = relations;
+
+    ofstream out(a_target.c_str(), ios::binary);
+    out << text.substr(0, nodes);
+    size_t sections[4] = { nodes, ways, relations, end };
+    for (int section=0; section<3; section++)
+    {
+        string part = text.substr(sections[section], sections[section+1] - sections[section]);
+        for (int k=0; k<a_scale; k++)
+        {
+            offsetIds(part, (int64_t)k * 100000000000LL, out);
+        }
+    }
+    out << text.substr(end);
+    return (out.good());
+}
+
+//------------------------------------------------------------------------------
+
+static int runOsmParseBenchmark(const cBenchSettings& a_settings)
+{
+    string file = a_settings.m_osmParseFile;
+    if (a_settings.m_osmScale > 1)
+    {
+        file = a_settings.m_osmParseFile + ".x" + to_string(a_settings.m_osmScale) + ".osm";
+        if (!enlargeOsmFile(a_settings.m_osmParseFile, file, a_settings.m_osmScale))
+        {
+            cout << "Error - cannot enlarge " << a_settings.m_osmParseFile << endl;
+            return (1);
+        }
+    }
+
+    size_t fileSize = 0;
+    int64_t mtime = 0;
+    cMappedFile::getFileInfo(file, fileSize, mtime);
+
+    size_t memoryBefore = peakMemory();
+    double start = benchTime();
+
+    cOsmMap map;
+    if (a_settings.m_osmAllTags)
+    {
+        map.setTagFilter(vector<string>());
+    }
+    bool loaded = map.loadFromFile(file);
+
+    double seconds = benchTime() - start;
+    size_t memoryAfter = peakMemory();
+
+    if (a_settings.m_osmScale > 1)
+    {
+        remove(file.c_str());
+    }
+    if (!loaded)
+    {
+        cout << "Error - cannot parse " << file << endl;
+        return (1);
+    }
+
+    cout << "file:              " << file << " (" << cStr(fileSize / 1048576.0, 1) << " MB)" << endl;
+    cout << "parse time:        " << cStr(1e3 * seconds, 1) << " ms" << endl;
+    cout << "throughput:        " << cStr(fileSize / 1048576.0 / seconds, 1) << " MB/s" << endl;
+    cout << "retained:          " << map.getNodeTable().size() << " node locations, "
+                                  << map.getNodes().size() << " tagged nodes, "
+                                  << map.getWays().size() << " ways, "
+                                  << map.getRelations().size() << " relations" << endl;
+    cout << "map memory:        " << cStr(map.getMemoryUsage() / 1048576.0, 2) << " MB" << endl;
+    if (memoryAfter > 0)
+    {
+        cout << "peak memory delta: " << cStr((memoryAfter - memoryBefore) / 1048576.0, 2) << " MB" << endl;
+    }
+    return (0);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    cBenchSettings settings;
+    if (!parseArguments(argc, argv, settings))
+    {
+        printUsage();
+        return (1);
+    }
+
+    if (!settings.m_osmParseFile.empty())
+    {
+        return (runOsmParseBenchmark(settings));
+    }
+
+
+    //--------------------------------------------------------------------------
+    // WORLD - CAMERA - LIGHTING
+    //--------------------------------------------------------------------------
+
+    // same scene graph as the application, without a display
+    cWorld* world = new cWorld();
+
+    cCamera* camera = new cCamera(world);
+    world->addChild(camera);
+    camera->set(cVector3d(0.7, 0.0, 0.2),
+                cVector3d(0.0, 0.0, 0.0),
+                cVector3d(0.0, 0.0, 1.0));
+
+    cDirectionalLight* light = new cDirectionalLight(world);
+    world->addChild(light);
+    camera->addChild(light);
+    light->setDir(-3.0,-0.5, 0.0);
+
+
+    //--------------------------------------------------------------------------
+    // HAPTIC DEVICES / TOOLS
+    //--------------------------------------------------------------------------
+
+    cProbeTrajectory trajectory;
+    cSimulatedHapticDevicePtr device = cSimulatedHapticDevice::create(&trajectory);
+    cHapticDeviceInfo deviceInfo = device->getSpecifications();
+
+    double toolRadius = 0.005;
+
+    cToolCursor* tool = new cToolCursor(world);
+    world->addChild(tool);
+    tool->setHapticDevice(device);
+    tool->setRadius(toolRadius);
+    tool->setWorkspaceRadius(0.25);
+    tool->setLocalRot(camera->getLocalRot());
+    tool->setWaitForSmallForce(true);
+    tool->start();
+    cReserveToolEvents(tool);
+
+
+    //--------------------------------------------------------------------------
+    // CREATE OBJECTS
+    //--------------------------------------------------------------------------
+
+    cCampusSceneSettings sceneSettings;
+    sceneSettings.m_toolRadius = toolRadius;
+    sceneSettings.m_maxStiffness = deviceInfo.m_maxLinearStiffness;
+    sceneSettings.m_useMeshCache = settings.m_useMeshCache;
+    sceneSettings.m_useTextureCache = settings.m_useTextureCache;
+    sceneSettings.m_coherentCollision = settings.m_coherentCollision;
+    sceneSettings.m_osmFile = settings.m_osmFile;
+
+    double loadStart = benchTime();
+
+    cCampusScene scene;
+    if (!cCreateCampusScene(world, sceneSettings, scene))
+    {
+        return (1);
+    }
+
+    cout << "scene loaded in " << cStr(1e3 * (benchTime() - loadStart), 1) << " ms" << endl;
+
+
+    //--------------------------------------------------------------------------
+    // TRAJECTORY
+    //--------------------------------------------------------------------------
+
+    world->computeGlobalPositions(true);
+
+    vector<cSessionSample> session;
+    if (!settings.m_sessionFile.empty())
+    {
+        if (!cLoadSessionLog(settings.m_sessionFile, settings.m_rate, session) || session.empty())
+        {
+            cout << "Error - failed to load session log " << settings.m_sessionFile << endl;
+            return (1);
+        }
+        vector<cVector3d> positions(session.size());
+        for (size_t i=0; i<session.size(); i++)
+        {
+            const float* p = session[i].m_devicePos;
+            positions[i].set(p[0], p[1], p[2]);
+        }
+        trajectory.assign(positions, settings.m_rate);
+    }
+    else if (!settings.m_trajectoryFile.empty())
+    {
+        if (!trajectory.loadFromFile(settings.m_trajectoryFile, settings.m_rate))
+        {
+            cout << "Error - failed to load trajectory " << settings.m_trajectoryFile << endl;
+            return (1);
+        }
+    }
+    else
+    {
+        // cover the footprint of the map, pressing slightly into the ground so
+        // that the probe slides on the plane and runs into building walls
+        cVector3d offset = scene.m_campus->getGlobalPos();
+        cVector3d min = scene.m_campus->getBoundaryMin() + offset;
+        cVector3d max = scene.m_campus->getBoundaryMax() + offset;
+        min(2) = scene.m_plane->getGlobalPos()(2) - 0.5 * toolRadius;
+
+        int numTicks = settings.m_warmup + settings.m_ticks;
+        trajectory.createSynthetic(settings.m_shape, min, max, settings.m_speed,
+                                   settings.m_rate, (double)numTicks / settings.m_rate, tool);
+    }
+
+    device->setTrajectory(&trajectory);
+
+    // height field of the map, ground and grass
+    cHeightFieldRenderer* heightField = NULL;
+    if (settings.m_heightField)
+    {
+        cHeightFieldSettings heightFieldSettings;
+        heightFieldSettings.m_stiffness = 0.3 * deviceInfo.m_maxLinearStiffness;
+        heightFieldSettings.m_edgeFallback = settings.m_heightFieldFallback;
+
+        vector<cGenericObject*> objects;
+        objects.push_back(scene.m_campus);
+        objects.push_back(scene.m_plane);
+        objects.insert(objects.end(), scene.m_textureZones.begin(), scene.m_textureZones.end());
+
+        double buildStart = benchTime();
+        heightField = new cHeightFieldRenderer(heightFieldSettings);
+        if (!heightField->build(objects, toolRadius, cWorkerPool::getDefault()))
+        {
+            cout << "Error - nothing to rasterize into the height field" << endl;
+            return (1);
+        }
+        heightField->enable(tool);
+
+        const cFloat4Grid& grid = heightField->getGrid();
+        cout << "height field: " << grid.getWidth() << " x " << grid.getHeight() << " cells of "
+             << cStr(1e3 * grid.getCellSize(), 2) << " mm, " << grid.getMemoryUsage() / 1024 << " KiB, built in "
+             << cStr(1e3 * (benchTime() - buildStart), 1) << " ms" << endl;
+    }
+
+    // distance field of the buildings
+    shared_ptr<cDistanceField> distanceField;
+    cProximityRenderer* proximity = NULL;
+    if (settings.m_proximity)
+    {
+        vector<cGenericObject*> objects;
+        objects.push_back(scene.m_campus);
+
+        double buildStart = benchTime();
+        distanceField = make_shared<cDistanceField>();
+        if (!distanceField->build(objects, cWorkerPool::getDefault()))
+        {
+            cout << "Error - no buildings to bake into the distance field" << endl;
+            return (1);
+        }
+        proximity = new cProximityRenderer(distanceField, toolRadius);
+
+        cout << "distance field: " << distanceField->getSizeX() << " x " << distanceField->getSizeY() << " x "
+             << distanceField->getSizeZ() << " voxels of " << cStr(1e3 * distanceField->getVoxelSize(), 2) << " mm, "
+             << distanceField->getMemoryUsage() / 1024 << " KiB, built in "
+             << cStr(1e3 * (benchTime() - buildStart), 1) << " ms" << endl;
+    }
+
+    if (!settings.m_saveTrajectoryFile.empty())
+    {
+        trajectory.saveToFile(settings.m_saveTrajectoryFile);
+    }
+
+    cout << "feature index: " << scene.m_features->getNumFeatures() << " features, "
+         << scene.m_features->getMemoryUsage() / 1024 << " KiB" << endl;
+
+    // coherent collision detectors of the map (none if tiled or disabled)
+    vector<cCoherentCollisionAABB*> coherentDetectors;
+    size_t numNeighbors = 0;
+    size_t neighborMemory = 0;
+    for (unsigned int i=0; i<scene.m_campus->getNumMeshes(); i++)
+    {
+        cCoherentCollisionAABB* detector =
+            dynamic_cast<cCoherentCollisionAABB*>(scene.m_campus->getMesh(i)->getCollisionDetector());
+        if (detector != NULL)
+        {
+            coherentDetectors.push_back(detector);
+            numNeighbors += detector->getNumNeighbors();
+            neighborMemory += detector->getMemoryUsage();
+        }
+    }
+    if (!coherentDetectors.empty())
+    {
+        cout << "collision neighbours: " << numNeighbors << " in " << coherentDetectors.size() << " meshes, "
+             << neighborMemory / 1024 << " KiB" << endl;
+    }
+
+    // routing: A* between random pairs of vertices of the walkable network,
+    // then guidance from the start of the probe path to the far end of it
+    cRoutePlanner* planner = NULL;
+    if (scene.m_routeGraph)
+    {
+        const cRouteGraph& graph = *scene.m_routeGraph;
+        cRouteSearch search(graph);
+        vector<int> route;
+        cLatencyStats statsRoute("routeQuery");
+        statsRoute.reserve(1000);
+        mt19937 random(1);
+        uniform_int_distribution<int> vertex(0, graph.getNumVertices() - 1);
+        int numFound = 0;
+        double settled = 0.0;
+        for (int i=0; i<1000; i++)
+        {
+            int from = vertex(random);
+            int to = vertex(random);
+            double start = benchTime();
+            bool found = search.find(from, to, route);
+            statsRoute.add(benchTime() - start);
+            if (found)
+            {
+                numFound++;
+                settled += search.getNumSettled();
+            }
+        }
+        cout << "route graph: " << graph.getNumVertices() << " vertices, " << graph.getNumEdges() << " edges, "
+             << graph.getMemoryUsage() / 1024 << " KiB; A* p50 " << cStr(1e6 * statsRoute.getPercentile(50.0), 1)
+             << " us, p99 " << cStr(1e6 * statsRoute.getPercentile(99.0), 1) << " us, "
+             << numFound << " of 1000 connected, " << cStr(settled / cMax(1, numFound), 0) << " vertices settled" << endl;
+
+        if (settings.m_guidance)
+        {
+            planner = new cRoutePlanner(scene.m_routeGraph);
+            planner->start();
+            planner->setGoal(graph.getVertex(graph.getNumVertices() - 1));
+            for (int i=0; (i<100) && (planner->getNumRoutes() == 0); i++)
+            {
+                this_thread::sleep_for(chrono::milliseconds(10));
+            }
+        }
+    }
+    else if (settings.m_guidance)
+    {
+        cout << "Warning - guidance needs an OSM map with paths" << endl;
+    }
+
+
+    //--------------------------------------------------------------------------
+    // HAPTIC LOOP
+    //--------------------------------------------------------------------------
+
+    cLatencyStats statsGlobalPositions("computeGlobalPositions");
+    cLatencyStats statsUpdateFromDevice("updateFromDevice");
+    cLatencyStats statsHeightField("heightField");
+    cLatencyStats statsInteractionForces("computeInteractionForces");
+    cLatencyStats statsTextures("hapticTextures");
+    cLatencyStats statsProximity("proximity");
+    cLatencyStats statsGuidance("routeGuidance");
+    cLatencyStats statsFeatures("featureIndex");
+    cLatencyStats statsRecorder("sessionRecorder");
+    cLatencyStats statsTick("tick");
+
+    statsGlobalPositions.reserve(settings.m_ticks);
+    statsUpdateFromDevice.reserve(settings.m_ticks);
+    statsHeightField.reserve(settings.m_ticks);
+    statsInteractionForces.reserve(settings.m_ticks);
+    statsTextures.reserve(settings.m_ticks);
+    statsProximity.reserve(settings.m_ticks);
+    statsGuidance.reserve(settings.m_ticks);
+    statsFeatures.reserve(settings.m_ticks);
+    statsRecorder.reserve(settings.m_ticks);
+    statsTick.reserve(settings.m_ticks);
+
+    // the global frames of the scene are up to date; each thread only
+    // follows its own tool
+    cTransformUpdater transformUpdater(tool);
+    transformUpdater.addDynamicNode(tool, true);
+
+    bool paced = (settings.m_scheduleRate > 0.0);
+    cHapticScheduler scheduler(paced ? settings.m_scheduleRate : 1000.0,
+                               paced ? C_SCHEDULER_HYBRID : C_SCHEDULER_FREE_RUNNING);
+    scheduler.start();
+
+    scene.m_textures->setServoRate(settings.m_rate);
+
+    // the force effects, as updateHaptics() sets them up
+    cMapForcePipeline forces;
+    forces.get<cTextureEffect>().m_renderer = scene.m_textures.get();
+    forces.get<cProximityEffect>().m_renderer = proximity;
+    forces.get<cGuidanceEffect>().m_planner = planner;
+    forces.setDeviceLimit(device->getSpecifications());
+
+    // the other stations follow the same path, spread evenly along it, each
+    // paced at the servo rate on its own core when there are enough
+    int numCores = (int)thread::hardware_concurrency();
+    vector<int> cores = cRealtime::getServoCores(settings.m_realtime);
+    size_t numIsolatedCores = settings.m_realtime ? cRealtime::getIsolatedCores().size() : 0;
+    bool pinThreads = (numCores > settings.m_stations) || (numIsolatedCores >= (size_t)settings.m_stations);
+    if (pinThreads && !cHapticScheduler::pinCurrentThread(cores[0]))
+    {
+        cout << "Warning - bench thread could not be pinned to core " << cores[0] << endl;
+    }
+    if (settings.m_realtime)
+    {
+        cMemoryLock lock = cRealtime::lockMemory(C_BENCH_HEAP_RESERVE);
+        int priority = cRealtime::setFifoPriority(C_BENCH_FIFO_PRIORITY);
+        cRealtime::prefaultStack();
+        cout << "real-time:         " << numIsolatedCores << " isolated cores, memory "
+             << cRealtime::describe(lock) << ", "
+             << ((priority >= 0) ? "SCHED_FIFO priority " + cStr(priority) : string("normal priority")) << endl;
+    }
+    vector<cBenchStation*> stations;
+    for (int i=1; i<settings.m_stations; i++)
+    {
+        cBenchStation* station = new cBenchStation();
+        station->m_device = cSimulatedHapticDevice::create(&trajectory);
+        for (size_t k=0; k<i*trajectory.size()/settings.m_stations; k++)
+        {
+            station->m_device->step();
+        }
+
+        station->m_tool = new cToolCursor(world);
+        world->addChild(station->m_tool);
+        station->m_tool->setHapticDevice(station->m_device);
+        station->m_tool->setRadius(toolRadius);
+        station->m_tool->setWorkspaceRadius(0.25);
+        station->m_tool->setLocalRot(camera->getLocalRot());
+        station->m_tool->setWaitForSmallForce(true);
+        station->m_tool->start();
+        cReserveToolEvents(station->m_tool);
+
+        station->m_transformUpdater = new cTransformUpdater(station->m_tool);
+        station->m_transformUpdater->addDynamicNode(station->m_tool, true);
+        station->m_textures = *scene.m_textures;
+        if (distanceField)
+        {
+            station->m_proximity = new cProximityRenderer(distanceField, toolRadius);
+        }
+        station->m_forces.get<cTextureEffect>().m_renderer = &station->m_textures;
+        station->m_forces.get<cProximityEffect>().m_renderer = station->m_proximity;
+        station->m_forces.setDeviceLimit(station->m_device->getSpecifications());
+        station->m_scheduler.setRate(settings.m_rate);
+        station->m_scheduler.setMode(C_SCHEDULER_HYBRID);
+        station->m_core = pinThreads ? cores[i] : -1;
+        station->m_realtime = settings.m_realtime;
+        stations.push_back(station);
+    }
+    atomic<bool> stationsRunning(true);
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        stations[i]->m_thread = thread(runStation, stations[i], &scene, 1.5 * toolRadius, &stationsRunning);
+    }
+
+    int contactTicks = 0;
+    int textureTicks = 0;
+    int featureTicks = 0;
+    double textureLevel = 0.0;
+    double runStart = 0.0;
+    double maxForceDifference = 0.0;
+    double sumForceDifference = 0.0;
+
+    cSessionRecorder recorder;
+    if (!settings.m_recordFile.empty() && !recorder.start(settings.m_recordFile, settings.m_rate))
+    {
+        return (1);
+    }
+
+    cAllocationTracker allocations("tick");
+    for (int i=0; i<settings.m_warmup + settings.m_ticks; i++)
+    {
+        bool measure = (i >= settings.m_warmup);
+        if (i == settings.m_warmup)
+        {
+            scheduler.resetStatistics();
+            for (size_t k=0; k<coherentDetectors.size(); k++)
+            {
+                coherentDetectors[k]->resetStatistics();
+            }
+            allocations.attach();
+            runStart = benchTime();
+        }
+
+        scheduler.waitForNextTick();
+
+        double t0 = benchTime();
+
+        // compute global reference frames for each object
+        if (settings.m_incrementalTransforms)
+        {
+            transformUpdater.update();
+        }
+        else
+        {
+            world->computeGlobalPositions(true);
+        }
+
+        double t1 = benchTime();
+
+        // update position and orientation of tool
+        tool->updateFromDevice();
+
+        double t2 = benchTime();
+
+        // move the height field proxy
+        if (heightField != NULL)
+        {
+            heightField->update(tool);
+        }
+
+        double t2b = benchTime();
+
+        // compute interaction forces
+        tool->computeInteractionForces();
+
+        double t3 = benchTime();
+
+        // send forces to the (simulated) device, as updateHaptics() does,
+        // noting when each effect is done: textures, proximity, guidance,
+        // damping and bias
+        cForceContext context;
+        context.set(tool, scene.m_campus, heightField);
+        double effectEnd[5];
+        auto timeEffect = [&](size_t a_effect) { effectEnd[a_effect] = benchTime(); };
+        cVector3d computedForce = forces.compute(context, timeEffect);
+        device->setForce(computedForce);
+        const cVector3d& proxy = context.m_proxy;
+        const cVector3d& localProxy = context.m_localProxy;
+
+        double t4 = effectEnd[0];
+        double t4b = effectEnd[1];
+        double t5 = benchTime();
+
+        // feature under the proxy, as updateHaptics() looks it up
+        bool inContact = context.m_inContact;
+        int feature = -1;
+        if (inContact)
+        {
+            feature = scene.m_features->find(localProxy, 1.5 * toolRadius);
+        }
+
+        double t6 = benchTime();
+
+        // log the tick, as updateHaptics() does
+        if (measure && recorder.isRecording())
+        {
+            recorder.record(tool, proxy, computedForce, feature);
+        }
+
+        double t7 = benchTime();
+
+        if (measure)
+        {
+            statsGlobalPositions.add(t1 - t0);
+            statsUpdateFromDevice.add(t2 - t1);
+            statsHeightField.add(t2b - t2);
+            statsInteractionForces.add(t3 - t2b);
+            statsTextures.add(t4 - t3);
+            statsProximity.add(t4b - t4);
+            statsGuidance.add(t5 - t4b);
+            statsFeatures.add(t6 - t5);
+            statsRecorder.add(t7 - t6);
+            statsTick.add(benchTime() - t0);
+
+            if (scene.m_textures->getActiveZone() != NULL)
+            {
+                textureTicks++;
+                textureLevel += scene.m_textures->getLevel();
+            }
+            if (inContact)
+            {
+                contactTicks++;
+            }
+            if (feature >= 0)
+            {
+                featureTicks++;
+            }
+            if (!session.empty())
+            {
+                const float* logged = session[device->getIndex() % session.size()].m_force;
+                double difference = (computedForce - cVector3d(logged[0], logged[1], logged[2])).length();
+                maxForceDifference = cMax(maxForceDifference, difference);
+                sumForceDifference += difference;
+            }
+        }
+
+        device->step();
+        allocations.endTick();
+    }
+    cAllocationTracker::detach();
+
+    double runTime = benchTime() - runStart;
+    recorder.stop();
+
+    stationsRunning.store(false, memory_order_release);
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        stations[i]->m_thread.join();
+    }
+
+
+    //--------------------------------------------------------------------------
+    // REPORT
+    //--------------------------------------------------------------------------
+
+    cout << endl;
+    cout << "ticks:          " << settings.m_ticks << endl;
+    if (paced)
+    {
+        cout << "paced rate:     " << cStr((double)settings.m_ticks / runTime, 0) << " of "
+             << cStr(settings.m_scheduleRate, 0) << " Hz" << endl;
+        cout << "overruns:       " << scheduler.getNumOverruns() << endl;
+        cout << "wake jitter:    p50 " << cStr(1e6 * scheduler.getJitterPercentile(50.0), 0)
+             << " us, p99 " << cStr(1e6 * scheduler.getJitterPercentile(99.0), 0)
+             << " us, max " << cStr(1e6 * scheduler.getMaxJitter(), 0) << " us" << endl;
+    }
+    else
+    {
+        cout << "free-run rate:  " << cStr((double)settings.m_ticks / runTime, 0) << " Hz" << endl;
+    }
+    cout << "ticks in contact: " << cStr(100.0 * (double)contactTicks / (double)settings.m_ticks, 1) << " %" << endl;
+    if (textureTicks > 0)
+    {
+        cout << "ticks on texture: " << cStr(100.0 * (double)textureTicks / (double)settings.m_ticks, 1)
+             << " %, mean pyramid level " << cStr(textureLevel / (double)textureTicks, 2) << endl;
+    }
+    cout << "ticks on a feature: " << cStr(100.0 * (double)featureTicks / (double)settings.m_ticks, 1) << " %" << endl;
+    if (!session.empty())
+    {
+        cout << "force vs log:   max " << cStr(maxForceDifference, 4) << " N, mean "
+             << cStr(sumForceDifference / (double)settings.m_ticks, 4) << " N" << endl;
+    }
+    if (!settings.m_recordFile.empty())
+    {
+        cout << "session log:    " << recorder.getNumWritten() << " ticks written, "
+             << recorder.getNumDropped() << " dropped" << endl;
+    }
+    if ((heightField != NULL) && settings.m_heightFieldFallback)
+    {
+        cout << "mesh fallbacks: " << heightField->getNumFallbacks() << endl;
+    }
+    if (!coherentDetectors.empty())
+    {
+        uint64_t numCoherent = 0;
+        uint64_t numFallbacks = 0;
+        for (size_t i=0; i<coherentDetectors.size(); i++)
+        {
+            numCoherent += coherentDetectors[i]->getNumCoherent();
+            numFallbacks += coherentDetectors[i]->getNumFallbacks();
+        }
+        uint64_t numQueries = max(numCoherent + numFallbacks, (uint64_t)1);
+        cout << "coherent queries: " << cStr(100.0 * (double)numCoherent / (double)numQueries, 1) << " % of "
+             << numCoherent + numFallbacks << " measured map queries" << endl;
+    }
+    if (cAllocationTracker::isAvailable())
+    {
+        cout << "heap allocations: " << allocations.getNumAllocations() << " in " << allocations.getNumAllocatingTicks()
+             << " ticks, at most " << allocations.getMaxPerTick() << " in one tick" << endl;
+    }
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        const cHapticScheduler& stationScheduler = stations[i]->m_scheduler;
+        cout << "station " << i + 1 << ":      " << cStr(stationScheduler.getEffectiveRate(), 0) << " of "
+             << cStr(settings.m_rate, 0) << " Hz, " << stationScheduler.getNumOverruns() << " overruns, jitter p99 "
+             << cStr(1e6 * stationScheduler.getJitterPercentile(99.0), 0) << " us" << endl;
+    }
+    cout << endl;
+
+    cLatencyStats::printHeader(cout);
+    statsGlobalPositions.printRow(cout);
+    statsUpdateFromDevice.printRow(cout);
+    if (heightField != NULL)
+    {
+        statsHeightField.printRow(cout);
+    }
+    statsInteractionForces.printRow(cout);
+    statsTextures.printRow(cout);
+    if (proximity != NULL)
+    {
+        statsProximity.printRow(cout);
+    }
+    if (planner != NULL)
+    {
+        statsGuidance.printRow(cout);
+    }
+    statsFeatures.printRow(cout);
+    if (!settings.m_recordFile.empty())
+    {
+        statsRecorder.printRow(cout);
+    }
+    statsTick.printRow(cout);
+
+    // where the allocations of the measured ticks came from
+    if (allocations.getNumAllocations() > 0)
+    {
+        cout << endl;
+        allocations.writeReport(cout);
+    }
+
+    if (!settings.m_csvFile.empty())
+    {
+        ofstream csv(settings.m_csvFile.c_str());
+        csv << "computeGlobalPositions,updateFromDevice,heightField,computeInteractionForces,hapticTextures,proximity,routeGuidance,featureIndex,sessionRecorder,tick" << endl;
+        for (int i=0; i<(int)statsTick.size(); i++)
+        {
+            csv << 1e6 * statsGlobalPositions.getSample(i) << ","
+                << 1e6 * statsUpdateFromDevice.getSample(i) << ","
+                << 1e6 * statsHeightField.getSample(i) << ","
+                << 1e6 * statsInteractionForces.getSample(i) << ","
+                << 1e6 * statsTextures.getSample(i) << ","
+                << 1e6 * statsProximity.getSample(i) << ","
+                << 1e6 * statsGuidance.getSample(i) << ","
+                << 1e6 * statsFeatures.getSample(i) << ","
+                << 1e6 * statsRecorder.getSample(i) << ","
+                << 1e6 * statsTick.getSample(i) << endl;
+        }
+    }
+
+    tool->stop();
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        stations[i]->m_tool->stop();
+        delete stations[i]->m_proximity;
+        delete stations[i]->m_transformUpdater;
+        delete stations[i];
+    }
+    delete planner;
+    delete proximity;
+    delete heightField;
+    delete world;
+
+    // regression gates
+    int result = 0;
+    if ((settings.m_maxP99 > 0.0) && (1e6 * statsTick.getPercentile(99.0) > settings.m_maxP99))
+    {
+        cout << "FAIL - tick p99 above " << settings.m_maxP99 << " us" << endl;
+        result = 2;
+    }
+    if ((settings.m_maxP999 > 0.0) && (1e6 * statsTick.getPercentile(99.9) > settings.m_maxP999))
+    {
+        cout << "FAIL - tick p99.9 above " << settings.m_maxP999 << " us" << endl;
+        result = 2;
+    }
+    if ((settings.m_maxAllocations >= 0) && (allocations.getNumAllocations() > (uint64_t)settings.m_maxAllocations))
+    {
+        cout << "FAIL - " << allocations.getNumAllocations() << " heap allocations in the measured ticks, at most "
+             << settings.m_maxAllocations << " allowed" << endl;
+        result = 2;
+    }
+
+    return (result);
+}
@@ -0,0 +1,77 @@
+# Shared CHAI3D build configuration for the HapMap targets
+# (hapmap.pro and the tools built next to it)
+
+INCLUDEPATH += $$PWD/src
+DEPENDPATH  += $$PWD/src
+
+# count the heap allocations of the servo threads (qmake CONFIG+=track_allocations);
+# -rdynamic names the functions in the reported call stacks
+track_allocations {
+    DEFINES += C_TRACK_ALLOCATIONS
+    unix: QMAKE_LFLAGS += -rdynamic
+}
+
+win32{
+    CHAI3D = D:/chai3d-3.2.0
+
+    DEFINES += WIN64
+    DEFINES += D_CRT_SECURE_NO_DEPRECATE
+    QMAKE_CXXFLAGS += /EHsc /MP
+
+    INCLUDEPATH += $${CHAI3D}/src
+    INCLUDEPATH += $${CHAI3D}/external/Eigen
+    INCLUDEPATH += $${CHAI3D}/external/glew/include
+    INCLUDEPATH += $${CHAI3D}/extras/GLFW/include
+
+    DEPENDPATH += $${CHAI3D}/src
+    LIBS += -L$${CHAI3D}/lib/Release/x64/ -lchai3d -lglu32 -lopengl32 -lwinmm
+    LIBS += -L$${CHAI3D}/extras/GLFW/lib/Release/x64/ -lglfw
+
+    # zlib, for OSM PBF files
+    ZLIB = D:/zlib-1.2.11
+    INCLUDEPATH += $${ZLIB}
+    LIBS += -L$${ZLIB}/lib -lzlib
+    LIBS += -lglu32 -lOpenGl32 -lglu32 -lOpenGl32 -lwinmm -luser32
+    LIBS += kernel32.lib
+    LIBS += user32.lib
+    LIBS += gdi32.lib
+    LIBS += winspool.lib
+    LIBS += comdlg32.lib
+    LIBS += advapi32.lib
+    LIBS += shell32.lib
+    LIBS += ole32.lib
+    LIBS += oleaut32.lib
+    LIBS += uuid.lib
+    LIBS += odbc32.lib
+    LIBS += odbccp32.lib
+}
+
+# Configured for the KTH CSC Karmosin computer halls
+unix {
+    CHAI3D = /opt/chai3d/3.2.0
+
+    INCLUDEPATH += $${CHAI3D}/src
+    INCLUDEPATH += $${CHAI3D}/external/Eigen
+    INCLUDEPATH += $${CHAI3D}/external/glew/include
+    INCLUDEPATH += $${CHAI3D}/extras/GLFW/include
+
+    DEFINES += LINUX
+    QMAKE_CXXFLAGS += -std=c++0x
+    LIBS += -L$${CHAI3D}/external/DHD/lib/lin-x86_64/
+    LIBS += -L$${CHAI3D}/build/extras/GLFW
+    LIBS += -L$${CHAI3D}/build
+    LIBS += -lchai3d
+    LIBS += -ldrd
+    LIBS += -lpthread
+    LIBS += -lrt
+    LIBS += -ldl
+    LIBS += -lGL
+    LIBS += -lGLU
+    LIBS += -lusb-1.0
+    LIBS += -lglfw
+    LIBS += -lz
+    LIBS += -lX11
+    LIBS += -lXcursor
+    LIBS += -lXrandr
+    LIBS += -lXinerama
+}
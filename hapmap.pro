@@ -4,64 +4,72 @@ CONFIG -= app_bundle
 CONFIG -= qt
 
 SOURCES += main.cpp
+SOURCES += src/CAllocationTracker.cpp
+SOURCES += src/CBakedTileSource.cpp
+SOURCES += src/CCampusScene.cpp
+SOURCES += src/CCoherentCollisionAABB.cpp
+SOURCES += src/CDistanceField.cpp
+SOURCES += src/CFeatureIndex.cpp
+SOURCES += src/CForcePipeline.cpp
+SOURCES += src/CHapticTextures.cpp
+SOURCES += src/CHeightFieldRenderer.cpp
+SOURCES += src/CMapLabels.cpp
+SOURCES += src/CMappedFile.cpp
+SOURCES += src/CMeshCache.cpp
+SOURCES += src/COsmMap.cpp
+SOURCES += src/COsmMeshBuilder.cpp
+SOURCES += src/COsmPbfReader.cpp
+SOURCES += src/COsmTileSource.cpp
+SOURCES += src/CPersistentCollisionAABB.cpp
+SOURCES += src/CProbeTrajectory.cpp
+SOURCES += src/CRealtime.cpp
+SOURCES += src/CRouteGraph.cpp
+SOURCES += src/CRoutePlanner.cpp
+SOURCES += src/CSessionRecorder.cpp
+SOURCES += src/CSimulatedHapticDevice.cpp
+SOURCES += src/CStageProfiler.cpp
+SOURCES += src/CSurfaceRaster.cpp
+SOURCES += src/CTileFile.cpp
+SOURCES += src/CTileManager.cpp
+SOURCES += src/CTransformUpdater.cpp
+SOURCES += src/CWorkerPool.cpp
+SOURCES += src/CXmlStreamReader.cpp
+SOURCES += src/CHapticScheduler.cpp
 
-win32{
-    CHAI3D = D:/chai3d-3.2.0
-
-    DEFINES += WIN64
-    DEFINES += D_CRT_SECURE_NO_DEPRECATE
-    QMAKE_CXXFLAGS += /EHsc /MP
-
-    INCLUDEPATH += $${CHAI3D}/src
-    INCLUDEPATH += $${CHAI3D}/external/Eigen
-    INCLUDEPATH += $${CHAI3D}/external/glew/include
-    INCLUDEPATH += $${CHAI3D}/extras/GLFW/include
-
-    DEPENDPATH += $${CHAI3D}/src
-    LIBS += -L$${CHAI3D}/lib/Release/x64/ -lchai3d -lglu32 -lopengl32 -lwinmm
-    LIBS += -L$${CHAI3D}/extras/GLFW/lib/Release/x64/ -lglfw
-    LIBS += -lglu32 -lOpenGl32 -lglu32 -lOpenGl32 -lwinmm -luser32
-    LIBS += kernel32.lib
-    LIBS += user32.lib
-    LIBS += gdi32.lib
-    LIBS += winspool.lib
-    LIBS += comdlg32.lib
-    LIBS += advapi32.lib
-    LIBS += shell32.lib
-    LIBS += ole32.lib
-    LIBS += oleaut32.lib
-    LIBS += uuid.lib
-    LIBS += odbc32.lib
-    LIBS += odbccp32.lib
-}
-
-# Configured for the KTH CSC Karmosin computer halls
-unix {
-    CHAI3D = /opt/chai3d/3.2.0
-
-    INCLUDEPATH += $${CHAI3D}/src
-    INCLUDEPATH += $${CHAI3D}/external/Eigen
-    INCLUDEPATH += $${CHAI3D}/external/glew/include
-    INCLUDEPATH += $${CHAI3D}/extras/GLFW/include
-
-    DEFINES += LINUX
-    QMAKE_CXXFLAGS += -std=c++0x
-    LIBS += -L$${CHAI3D}/external/DHD/lib/lin-x86_64/
-    LIBS += -L$${CHAI3D}/build/extras/GLFW
-    LIBS += -L$${CHAI3D}/build
-    LIBS += -lchai3d
-    LIBS += -ldrd
-    LIBS += -lpthread
-    LIBS += -lrt
-    LIBS += -ldl
-    LIBS += -lGL
-    LIBS += -lGLU
-    LIBS += -lusb-1.0
-    LIBS += -lglfw
-    LIBS += -lX11
-    LIBS += -lXcursor
-    LIBS += -lXrandr
-    LIBS += -lXinerama
-}
-
+HEADERS += src/CAllocationTracker.h
+HEADERS += src/CBakedTileSource.h
+HEADERS += src/CCampusScene.h
+HEADERS += src/CCoherentCollisionAABB.h
+HEADERS += src/CDistanceField.h
+HEADERS += src/CFeatureIndex.h
+HEADERS += src/CFloat4Grid.h
+HEADERS += src/CForcePipeline.h
+HEADERS += src/CHapticTextures.h
+HEADERS += src/CHeightFieldRenderer.h
+HEADERS += src/CMapLabels.h
+HEADERS += src/CMappedFile.h
+HEADERS += src/CMeshCache.h
+HEADERS += src/COsmMap.h
+HEADERS += src/COsmMeshBuilder.h
+HEADERS += src/COsmPbfReader.h
+HEADERS += src/COsmProjection.h
+HEADERS += src/COsmTileSource.h
+HEADERS += src/CPersistentCollisionAABB.h
+HEADERS += src/CProbeTrajectory.h
+HEADERS += src/CRealtime.h
+HEADERS += src/CRouteGraph.h
+HEADERS += src/CRoutePlanner.h
+HEADERS += src/CSessionRecorder.h
+HEADERS += src/CSimulatedHapticDevice.h
+HEADERS += src/CStageProfiler.h
+HEADERS += src/CSurfaceRaster.h
+HEADERS += src/CTileFile.h
+HEADERS += src/CTileManager.h
+HEADERS += src/CTileSource.h
+HEADERS += src/CTransformUpdater.h
+HEADERS += src/CTripleBuffer.h
+HEADERS += src/CWorkerPool.h
+HEADERS += src/CXmlStreamReader.h
+HEADERS += src/CHapticScheduler.h
 
+include(hapmap.pri)
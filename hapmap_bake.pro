@@ -0,0 +1,32 @@
+# Offline tile baker: turns an OSM extract or an OBJ mesh into a tile
+# pyramid (.hmtiles) for the application. Needs no display.
+
+TEMPLATE = app
+TARGET = hapmap_bake
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += tools/hapmap_bake.cpp
+SOURCES += src/CMappedFile.cpp
+SOURCES += src/COsmMap.cpp
+SOURCES += src/COsmMeshBuilder.cpp
+SOURCES += src/COsmPbfReader.cpp
+SOURCES += src/CPersistentCollisionAABB.cpp
+SOURCES += src/CTileBaker.cpp
+SOURCES += src/CTileFile.cpp
+SOURCES += src/CWorkerPool.cpp
+SOURCES += src/CXmlStreamReader.cpp
+
+HEADERS += src/CMappedFile.h
+HEADERS += src/COsmMap.h
+HEADERS += src/COsmMeshBuilder.h
+HEADERS += src/COsmPbfReader.h
+HEADERS += src/COsmProjection.h
+HEADERS += src/CPersistentCollisionAABB.h
+HEADERS += src/CTileBaker.h
+HEADERS += src/CTileFile.h
+HEADERS += src/CWorkerPool.h
+HEADERS += src/CXmlStreamReader.h
+
+include(hapmap.pri)
@@ -0,0 +1,78 @@
+# Headless haptic-loop benchmark: loads the campus scene, drives the tool
+# from a simulated device and reports per-stage latency percentiles.
+# Needs neither a haptic device nor a display.
+
+TEMPLATE = app
+TARGET = hapmap_bench
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += bench/hapmap_bench.cpp
+SOURCES += src/CAllocationTracker.cpp
+SOURCES += src/CBakedTileSource.cpp
+SOURCES += src/CCampusScene.cpp
+SOURCES += src/CCoherentCollisionAABB.cpp
+SOURCES += src/CDistanceField.cpp
+SOURCES += src/CFeatureIndex.cpp
+SOURCES += src/CForcePipeline.cpp
+SOURCES += src/CHapticTextures.cpp
+SOURCES += src/CHeightFieldRenderer.cpp
+SOURCES += src/CMappedFile.cpp
+SOURCES += src/CMeshCache.cpp
+SOURCES += src/COsmMap.cpp
+SOURCES += src/COsmMeshBuilder.cpp
+SOURCES += src/COsmPbfReader.cpp
+SOURCES += src/COsmTileSource.cpp
+SOURCES += src/CPersistentCollisionAABB.cpp
+SOURCES += src/CRealtime.cpp
+SOURCES += src/CRouteGraph.cpp
+SOURCES += src/CRoutePlanner.cpp
+SOURCES += src/CSessionRecorder.cpp
+SOURCES += src/CSurfaceRaster.cpp
+SOURCES += src/CTileFile.cpp
+SOURCES += src/CTileManager.cpp
+SOURCES += src/CTransformUpdater.cpp
+SOURCES += src/CWorkerPool.cpp
+SOURCES += src/CXmlStreamReader.cpp
+SOURCES += src/CHapticScheduler.cpp
+SOURCES += src/CSimulatedHapticDevice.cpp
+SOURCES += src/CProbeTrajectory.cpp
+SOURCES += src/CLatencyStats.cpp
+
+HEADERS += src/CAllocationTracker.h
+HEADERS += src/CBakedTileSource.h
+HEADERS += src/CCampusScene.h
+HEADERS += src/CCoherentCollisionAABB.h
+HEADERS += src/CDistanceField.h
+HEADERS += src/CFeatureIndex.h
+HEADERS += src/CFloat4Grid.h
+HEADERS += src/CForcePipeline.h
+HEADERS += src/CHapticTextures.h
+HEADERS += src/CHeightFieldRenderer.h
+HEADERS += src/CMappedFile.h
+HEADERS += src/CMeshCache.h
+HEADERS += src/COsmMap.h
+HEADERS += src/COsmMeshBuilder.h
+HEADERS += src/COsmPbfReader.h
+HEADERS += src/COsmProjection.h
+HEADERS += src/COsmTileSource.h
+HEADERS += src/CPersistentCollisionAABB.h
+HEADERS += src/CRealtime.h
+HEADERS += src/CRouteGraph.h
+HEADERS += src/CRoutePlanner.h
+HEADERS += src/CSessionRecorder.h
+HEADERS += src/CSurfaceRaster.h
+HEADERS += src/CTileFile.h
+HEADERS += src/CTileManager.h
+HEADERS += src/CTileSource.h
+HEADERS += src/CTransformUpdater.h
+HEADERS += src/CTripleBuffer.h
+HEADERS += src/CWorkerPool.h
+HEADERS += src/CXmlStreamReader.h
+HEADERS += src/CHapticScheduler.h
+HEADERS += src/CSimulatedHapticDevice.h
+HEADERS += src/CProbeTrajectory.h
+HEADERS += src/CLatencyStats.h
+
+include(hapmap.pri)
@@ -13,6 +13,27 @@
 #include "chai3d.h"
 //------------------------------------------------------------------------------
 #include <GLFW/glfw3.h>
+#include <atomic>
+#include <fstream>
+#include <thread>
+//------------------------------------------------------------------------------
+#include "CAllocationTracker.h"
+#include "CCampusScene.h"
+#include "CDistanceField.h"
+#include "CFeatureIndex.h"
+#include "CForcePipeline.h"
+#include "CHapticScheduler.h"
+#include "CHeightFieldRenderer.h"
+#include "CMapLabels.h"
+#include "CRealtime.h"
+#include "CRoutePlanner.h"
+#include "CSessionRecorder.h"
+#include "CSimulatedHapticDevice.h"
+#include "CStageProfiler.h"
+#include "CTileManager.h"
+#include "CTransformUpdater.h"
+#include "CTripleBuffer.h"
+#include "CWorkerPool.h"
 //------------------------------------------------------------------------------
 using namespace chai3d;
 using namespace std;
@@ -37,6 +58,84 @@ bool fullscreen = false;
 // mirrored display
 bool mirroredDisplay = false;
 
+// recompute global frames only for the parts of the scene graph that moved,
+// instead of walking the whole world on every haptic tick
+bool incrementalTransforms = true;
+
+// OpenStreetMap extract to build the map from, e.g. "osm/osm/map_4.osm"
+// (empty = use the Blender export kth_campus.obj)
+string osmMapFile = "";
+
+// cut the OSM map into square tiles of this size [world units] and only keep
+// the tiles around the tool loaded (0 = load the whole map)
+double mapTileSize = 0.0;
+
+// tile pyramid baked by hapmap_bake to stream the map from, e.g.
+// "osm/osm/map_4.hmtiles" (empty = build the map at startup)
+string mapTileFile = "";
+
+// render the map, ground and grass through a 2.5D height field instead of
+// colliding with their meshes (not available with tiled maps)
+bool heightFieldRendering = false;
+
+// let the mesh take over from the height field near sharp edges and walls
+bool heightFieldEdgeFallback = false;
+
+// push the tool away from buildings once it comes within this distance of
+// them [world units], from a distance field baked at startup (0 = off; not
+// available with tiled maps)
+double proximityRange = 0.0;
+
+// force effects added to the contact force of each tool: a downward bias
+// that keeps the tool on the map [N], and viscous damping while the tool
+// touches the map [N s/m] (0 = off). the textures, the proximity cue and
+// route guidance follow; the total is clamped to the force of the device.
+double gravityBias = 0.5;
+double contactDamping = 0.0;
+
+// haptic servo rate [Hz] and how the haptic thread waits for each deadline
+/*
+    C_SCHEDULER_FREE_RUNNING:     busy loop, as fast as possible (rate is ignored)
+    C_SCHEDULER_SLEEP:            sleep until each deadline
+    C_SCHEDULER_HYBRID:           sleep until shortly before each deadline, then spin
+*/
+double hapticRate = 1000.0;
+cSchedulerMode hapticSchedulerMode = C_SCHEDULER_HYBRID;
+
+// serve up to this many haptic devices on the same map (e.g. a guide and a
+// visitor), each with its own tool and servo thread (0 = every connected
+// device). tiled maps and height field rendering serve the first one only.
+int maxHapticDevices = 0;
+
+// opt-in real-time servo threads: each one runs on a core of its own,
+// isolated ones (isolcpus= boot option) first, under SCHED_FIFO at
+// realtimePriority, with the process memory locked and the heap and the
+// servo stacks prefaulted. what could be set up is reported at startup;
+// without the permissions for a step, the servo threads run without it.
+bool realtimeServo = false;
+int realtimePriority = 80;
+
+// heap prefaulted by the real-time mode [bytes]
+size_t realtimeHeapReserve = 64 * 1024 * 1024;
+
+// record every haptic tick (device pose, proxy, forces, contacts) to this
+// session log, e.g. "session.hmrec"; further devices write to
+// "session.hmrec.2" and so on (empty = off)
+string sessionLogFile = "";
+
+// feed a session log back through the first tool instead of a haptic
+// device, looping at the end (empty = use the connected devices)
+string replayLogFile = "";
+
+// write the time spent in each stage of the haptic and graphics loops to
+// this file on exit (empty = off). [p] shows it on screen while running.
+string profileReportFile = "hapmap_profile.txt";
+
+// in builds that track allocations (qmake CONFIG+=track_allocations), count
+// the heap allocations of each servo thread once it has run this many ticks,
+// and add them with their call stacks to the profile report
+int allocationWarmupTicks = 1000;
+
 
 //------------------------------------------------------------------------------
 // DECLARED VARIABLES
@@ -51,14 +150,134 @@ cCamera* camera;
 // a light source to illuminate the objects in the world
 cDirectionalLight *light;
 
+// a light source for the tool cursors, drawn in the front layer
+cDirectionalLight *cursorLight;
+
 // a haptic device handler
 cHapticDeviceHandler* handler;
 
-// a pointer to the current haptic device
-cGenericHapticDevicePtr hapticDevice;
+// stages of the servo loop, timed by the profiler of each station
+enum cHapticStage
+{
+    C_HAPTIC_GLOBAL_POSITIONS,
+    C_HAPTIC_UPDATE_FROM_DEVICE,
+    C_HAPTIC_INTERACTION_FORCES,
+    C_HAPTIC_FORCE_CUES,
+    C_HAPTIC_SET_FORCE,
+    C_HAPTIC_TICK
+};
 
-// a virtual tool representing the haptic device in the scene
-cToolCursor* tool;
+// device positions of the session log being replayed
+cProbeTrajectory replayTrajectory;
+
+//------------------------------------------------------------------------------
+// What the graphics thread shows of a tool, published by its servo thread
+// once per tick.
+//------------------------------------------------------------------------------
+struct cToolSnapshot
+{
+    cToolSnapshot() :
+        m_numContacts(0),
+        m_feature(-1),
+        m_hapticRate(0.0) {}
+
+    // proxy and device position (global coordinates)
+    cVector3d m_proxyPos;
+    cVector3d m_devicePos;
+
+    // force sent to the device [N]
+    cVector3d m_force;
+
+    // contacts of the proxy, and the feature it touches (-1 = none)
+    int m_numContacts;
+    int m_feature;
+
+    // measured servo rate [Hz]
+    double m_hapticRate;
+};
+
+//------------------------------------------------------------------------------
+// One haptic device and everything its servo thread writes: the tool, the
+// pacing and the state of the renderers that follow the tool. The scene, the
+// baked fields and the feature index are shared and only read by the servo
+// threads, so devices never wait for each other.
+//------------------------------------------------------------------------------
+struct cHapticStation
+{
+    cHapticStation(int a_index) :
+        m_index(a_index),
+        m_tool(NULL),
+        m_thread(NULL),
+        m_core(-1),
+        m_isolatedCore(false),
+        m_profiler("haptics " + to_string(a_index + 1)),
+        m_allocations("haptics " + to_string(a_index + 1)),
+        m_transformUpdater(NULL),
+        m_proximity(NULL),
+        m_routePlanner(NULL),
+        m_recorder(NULL),
+        m_cursor(NULL),
+        m_cursorRadius(0.0),
+        m_announcedFeature(-1),
+        m_finished(true)
+    {
+        m_profiler.addStage("computeGlobalPositions");
+        m_profiler.addStage("updateFromDevice");
+        m_profiler.addStage("computeInteractionForces");
+        m_profiler.addStage("forceCues");
+        m_profiler.addStage("setForce");
+        m_profiler.addStage("tick");
+    }
+
+    // number of the device (0 = first)
+    int m_index;
+
+    // the haptic device and the virtual tool representing it in the scene
+    cGenericHapticDevicePtr m_device;
+    cToolCursor* m_tool;
+
+    // servo thread, paced at hapticRate and pinned to m_core (-1 = not
+    // pinned), which may be a core isolated from other tasks
+    cThread* m_thread;
+    cHapticScheduler m_scheduler;
+    cFrequencyCounter m_freqCounter;
+    int m_core;
+    bool m_isolatedCore;
+
+    // time spent in each cHapticStage, and the heap allocations of the
+    // servo thread
+    cStageProfiler m_profiler;
+    cAllocationTracker m_allocations;
+
+    // keeps the global frames of the tool up to date
+    cTransformUpdater* m_transformUpdater;
+
+    // haptic textures, proximity cue and route guidance of this tool, and
+    // the pipeline that adds them and the other effects to its force
+    cHapticTextureRenderer m_textures;
+    cProximityRenderer* m_proximity;
+    cRoutePlanner* m_routePlanner;
+    cMapForcePipeline m_forces;
+
+    // session log of this station, and the simulated device that replays
+    // one (NULL = a real device)
+    cSessionRecorder* m_recorder;
+    cSimulatedHapticDevicePtr m_replayDevice;
+
+    // state of the tool for the graphics thread, which draws the cursor
+    // (radius in world units) from it instead of reading the tool, and the
+    // feature last announced
+    cTripleBuffer<cToolSnapshot> m_snapshot;
+    cShapeSphere* m_cursor;
+    double m_cursorRadius;
+    int m_announcedFeature;
+
+    // set once the servo thread has terminated
+    atomic<bool> m_finished;
+};
+
+// one station per haptic device
+vector<cHapticStation*> stations;
 
 // a few mesh objects
 cMultiMesh* object;
@@ -75,19 +294,20 @@ cFontPtr font;
 // a label to display the rate [Hz] at which the simulation is running
 cLabel* labelRates;
 
-// add labels for buildings
-cLabel* buildingLabel;
-cLabel* buildingLabel2;
-cLabel* buildingLabel3;
-cLabel* buildingLabel4;
-cLabel* buildingLabel5;
-cLabel* buildingLabel6;
+// a label to display the name of the feature the tool touches
+cLabel* labelFeature;
 
-// a flag that indicates if the haptic simulation is currently running
-bool simulationRunning = false;
+// one label per line of the profiler overlay, shown with [p], and when it
+// was last refreshed [ns]
+vector<cLabel*> labelsProfile;
+bool showProfile = false;
+int64_t profileUpdateTime = 0;
 
-// a flag that indicates if the haptic simulation has terminated
-bool simulationFinished = true;
+// names of the buildings
+cMapLabels* mapLabels = NULL;
+
+// a flag that indicates if the haptic simulation is currently running
+atomic<bool> simulationRunning(false);
 
 // display options
 bool showEdges = true;
@@ -100,11 +320,35 @@ int collisionTreeDisplayLevel = 0;
 // a frequency counter to measure the simulation graphic rate
 cFrequencyCounter freqCounterGraphics;
 
-// a frequency counter to measure the simulation haptic rate
-cFrequencyCounter freqCounterHaptics;
+// stages of the graphics loop and the time spent in each
+enum cGraphicsStage
+{
+    C_GRAPHICS_SHADOW_MAPS,
+    C_GRAPHICS_RENDER_VIEW,
+    C_GRAPHICS_FINISH,
+    C_GRAPHICS_SWAP,
+    C_GRAPHICS_FRAME
+};
+cStageProfiler graphicsProfiler("graphics");
+
+// streams the tiles of a tiled map around the tool
+shared_ptr<cTileSource> tileSource;
+cTileManager* tileManager = NULL;
+
+// renders the static map from a height field when heightFieldRendering is set
+cHeightFieldRenderer* heightField = NULL;
+
+// features of the map. the servo threads publish the one their tool
+// touches and the graphics thread announces it.
+shared_ptr<cFeatureIndex> featureIndex;
+
+// distance from a feature within which the tool centre touches it
+double featureReach = 0.0;
 
-// haptic thread
-cThread* hapticsThread;
+// buildings the tools are guided to along the paths of OSM maps, and the
+// one chosen with [g] (-1 = no guidance)
+vector<cTileLabel> destinations;
+int destination = -1;
 
 // a handle to window display context
 GLFWwindow* window = NULL;
@@ -146,8 +390,11 @@ void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action,
 // this function renders the scene
 void updateGraphics(void);
 
-// this function contains the main haptics simulation loop
-void updateHaptics(void);
+// this function draws a tool cursor at a_pos (global coordinates)
+void updateCursor(cShapeSphere* a_cursor, const cVector3d& a_pos, double a_radius);
+
+// this function contains the haptics simulation loop of a station
+void updateHaptics(void* a_station);
 
 // this function closes the application
 void close(void);
@@ -177,6 +424,9 @@ int main(int argc, char* argv[])
     cout << "Keyboard Options:" << endl << endl;
     cout << "[f] - Enable/Disable full screen mode" << endl;
     cout << "[m] - Enable/Disable vertical mirroring" << endl;
+    cout << "[s] - Cycle haptic rate (1 kHz, 2 kHz, 4 kHz)" << endl;
+    cout << "[g] - Guide to the next building (OSM maps), then off" << endl;
+    cout << "[p] - Show/hide the time spent in each stage of the loops" << endl;
     cout << "[q] - Exit application" << endl;
     cout << endl << endl;
 
@@ -312,6 +562,13 @@ int main(int argc, char* argv[])
     light->m_diffuse.set(0.8f, 0.8f, 0.8f);
     light->m_specular.set(1.0f, 1.0f, 1.0f);
 
+    // light the tool cursors, which live in the front layer of the camera
+    // so that the servo threads never walk them, from the upper left
+    cursorLight = new cDirectionalLight(camera->m_frontLayer);
+    cursorLight->setEnabled(true);
+    camera->m_frontLayer->addChild(cursorLight);
+    cursorLight->setDir(0.5, -0.5, -1.0);
+
 
     //--------------------------------------------------------------------------
     // HAPTIC DEVICES / TOOLS
@@ -320,47 +577,123 @@ int main(int argc, char* argv[])
     // create a haptic device handler
     handler = new cHapticDeviceHandler();
 
-    // get access to the first available haptic device
-    handler->getDevice(hapticDevice, 0);
-
-    // retrieve information about the current haptic device
-    cHapticDeviceInfo hapticDeviceInfo = hapticDevice->getSpecifications();
-
-    // create a 3D tool and add it to the world
-    tool = new cToolCursor(world);
-    world->addChild(tool);
-
-    // connect the haptic device to the tool
-    tool->setHapticDevice(hapticDevice);
-
-    // if the haptic device has a gripper, enable it as a user switch
-    hapticDevice->setEnableGripperUserSwitch(true);
+    // serve every connected device, up to maxHapticDevices. tiled maps and
+    // the height field change the scene from the servo thread of the tool
+    // they follow, so they keep to the first device.
+    int numDevices = cMax(1, (int)handler->getNumDevices());
+    if (maxHapticDevices > 0)
+    {
+        numDevices = cMin(numDevices, maxHapticDevices);
+    }
+    if ((numDevices > 1) && (!mapTileFile.empty() || (mapTileSize > 0.0) || heightFieldRendering))
+    {
+        cout << "Warning - tiled maps and height field rendering serve the first haptic device only" << endl;
+        numDevices = 1;
+    }
+    double replayRate = 0.0;
+    if (!replayLogFile.empty())
+    {
+        vector<cSessionSample> samples;
+        if (!cLoadSessionLog(replayLogFile, replayRate, samples) || samples.empty())
+        {
+            cout << "Error - failed to load session log " << replayLogFile << endl;
+            close();
+            return (-1);
+        }
+        vector<cVector3d> positions(samples.size());
+        for (size_t i=0; i<samples.size(); i++)
+        {
+            const float* p = samples[i].m_devicePos;
+            positions[i].set(p[0], p[1], p[2]);
+        }
+        replayTrajectory.assign(positions, replayRate);
+        cout << "Replaying " << samples.size() << " ticks of " << replayLogFile << " at " << replayRate << " Hz" << endl;
+        numDevices = 1;
+    }
+    if ((numDevices > 1) && !incrementalTransforms)
+    {
+        cout << "Warning - several haptic devices need incremental transforms" << endl;
+        incrementalTransforms = true;
+    }
 
     // set radius of tool
     double toolRadius = 0.005;
 
-    // define a radius for the tool
-    tool->setRadius(toolRadius);
+    for (int i=0; i<numDevices; i++)
+    {
+        cHapticStation* station = new cHapticStation(i);
+        station->m_scheduler.setRate(hapticRate);
+        station->m_scheduler.setMode(hapticSchedulerMode);
+        stations.push_back(station);
+
+        // get access to the haptic device, or replay the session log at the
+        // rate it was recorded at
+        if (!replayLogFile.empty())
+        {
+            station->m_replayDevice = cSimulatedHapticDevice::create(&replayTrajectory);
+            station->m_device = station->m_replayDevice;
+            station->m_scheduler.setRate(replayRate);
+        }
+        else
+        {
+            handler->getDevice(station->m_device, i);
+        }
 
-    // hide the device sphere. only show proxy.
-    tool->setShowContactPoints(true, false);
+        // create a 3D tool and add it to the world
+        cToolCursor* tool = new cToolCursor(world);
+        station->m_tool = tool;
+        world->addChild(tool);
+
+        // connect the haptic device to the tool
+        tool->setHapticDevice(station->m_device);
+
+        // if the haptic device has a gripper, enable it as a user switch
+        station->m_device->setEnableGripperUserSwitch(true);
+
+        // define a radius for the tool
+        tool->setRadius(toolRadius);
+
+        // the servo thread moves the tool while the world is rendered, so
+        // the tool is hidden and the graphics thread draws a cursor of its
+        // own at the proxy published in each snapshot. the cursor is
+        // projected into the front layer, outside the world the servo
+        // threads walk (see updateCursor()).
+        tool->setShowEnabled(false);
+        station->m_cursor = new cShapeSphere(toolRadius);
+        station->m_cursor->setHapticEnabled(false);
+        station->m_cursorRadius = toolRadius;
+        camera->m_frontLayer->addChild(station->m_cursor);
+
+        // a blue cursor for the first device, other colors for the others
+        cMaterialPtr cursor = station->m_cursor->m_material;
+        switch (i % 3)
+        {
+            case 0: cursor->setBlueCadet(); break;
+            case 1: cursor->setOrangeTomato(); break;
+            default: cursor->setGreenLightSea(); break;
+        }
 
-    // create a white cursor
-    tool->m_hapticPoint->m_sphereProxy->m_material->setBlueCadet();
+        // map the physical workspace of the haptic device to a larger virtual workspace.
+        tool->setWorkspaceRadius(0.25);
 
-    // map the physical workspace of the haptic device to a larger virtual workspace.
-    tool->setWorkspaceRadius(0.25);
+        // oriente tool with camera
+        tool->setLocalRot(camera->getLocalRot());
 
-    // oriente tool with camera
-    tool->setLocalRot(camera->getLocalRot());
+        // haptic forces are enabled only if small forces are first sent to the device;
+        // this mode avoids the force spike that occurs when the application starts when
+        // the tool is located inside an object for instance.
+        tool->setWaitForSmallForce(true);
 
-    // haptic forces are enabled only if small forces are first sent to the device;
-    // this mode avoids the force spike that occurs when the application starts when 
-    // the tool is located inside an object for instance. 
-    tool->setWaitForSmallForce(true);
+        // start the haptic tool
+        tool->start();
 
-    // start the haptic tool
-    tool->start();
+        // room for the contacts of the tool, so that touching more
+        // triangles at once than before does not allocate in the servo loop
+        cReserveToolEvents(tool);
+    }
+
+    // retrieve information about the first haptic device
+    cHapticDeviceInfo hapticDeviceInfo = stations[0]->m_device->getSpecifications();
 
 
     //--------------------------------------------------------------------------
@@ -375,217 +708,134 @@ int main(int argc, char* argv[])
     double maxStiffness = hapticDeviceInfo.m_maxLinearStiffness;// / workspaceScaleFactor;
 
 
-    /////////////////////////////////////////////////////////////////////////
-    // OBJECT 0: KTH Map - Thea, Linnéa, Kirsten
-    ////////////////////////////////////////////////////////////////////////
-
-    // create a multimesh
-    object = new cMultiMesh();
-
-    // add object to world
-    world->addChild(object);
-
-    // set graphic properties
-    bool fileload;
-    fileload = object->loadFromFile("image_objects/kth_campus.obj");
+    // load the campus map (map, ground plane, grass patch and beacon)
+    cCampusSceneSettings sceneSettings;
+    sceneSettings.m_toolRadius = toolRadius;
+    sceneSettings.m_maxStiffness = maxStiffness;
+    sceneSettings.m_showEdges = showEdges;
+    sceneSettings.m_showTriangles = showTriangles;
+    sceneSettings.m_showNormals = showNormals;
+    sceneSettings.m_osmFile = osmMapFile;
+    sceneSettings.m_tileSize = mapTileSize;
+    sceneSettings.m_tileFile = mapTileFile;
+
+    cCampusScene scene;
+    bool fileload = cCreateCampusScene(world, sceneSettings, scene);
+    object  = scene.m_campus;
+    object1 = scene.m_plane;
+    object2 = scene.m_grass;
+    object3 = scene.m_beacon;
     if (!fileload)
     {
-        cout << "Error -  image failed to load correctly." << endl;
         close();
         return (-1);
     }
-
-    // set material of object
-    cMaterial m;
-    m.setWhite();
-    object->setMaterial(m);
-    // object->setTransparencyLevel(0.8);
-
-    // disable culling so that faces are rendered on both sides
-    object->setUseCulling(false);
-
-    // compute a boundary box
-    object->computeBoundaryBox(true);
-
-    // show/hide boundary box
-    object->setShowBoundaryBox(false);
-
-    // create collision detector
-    object->createAABBCollisionDetector(toolRadius);
-
-    // center object in scene
-    object->setLocalPos(-1.0 * object->getBoundaryCenter());
-    std::cout <<"Position: "<< object->getLocalPos() << std::endl;
-    object->setLocalPos(0.05, 0, 0.05);
-
-    // compute all edges of object for which adjacent triangles have more than 40 degree angle
-    object->computeAllEdges(0);
-
-    // set line width of edges and color
-    cColorf colorEdges;
-    colorEdges.setBlack();
-    object->setEdgeProperties(1, colorEdges);
-
-    // set normal properties for display
-    cColorf colorNormals;
-    colorNormals.setOrangeTomato();
-    object->setNormalsProperties(0.01, colorNormals);
-
-    // set haptic properties
-    object->setStiffness(0.3*maxStiffness);
-
-    // display options
-    object->setShowTriangles(showTriangles);
-    object->setShowEdges(showEdges);
-    object->setShowNormals(showNormals);
-
-    /////////////////////////////////////////////////////////////////////////
-    // OBJECT 1: Plane - Thea, Linnéa, Kirsten
-    ////////////////////////////////////////////////////////////////////////
-
-    // create a multimesh
-    object1 = new cMultiMesh();
-
-    // add object to world
-    world->addChild(object1);
-
-    // set the position of the object
-    object1->setLocalPos(0, 0, 0.05);
-
-    // set graphic properties
-    fileload = object1->loadFromFile("image_objects/kth_campus_plane.obj");
-    if (!fileload)
+    for (size_t i=0; i<stations.size(); i++)
     {
-        cout << "Error -  image failed to load correctly." << endl;
-        close();
-        return (-1);
+        stations[i]->m_textures = *scene.m_textures;
+        stations[i]->m_textures.setServoRate(stations[i]->m_scheduler.getRate());
     }
+    featureIndex = scene.m_features;
+    featureReach = 1.5 * toolRadius;
 
-    // create collision detector
-    object1->createAABBCollisionDetector(toolRadius);
-
-    // set material of object
-    cMaterial p;
-    p.setGray();
-    object1->setMaterial(p);
-
-    // disable culling so that faces are rendered on both sides
-    object1->setUseCulling(false);
-
-    // compute a boundary box
-    object1->computeBoundaryBox(true);
-
-    // show/hide boundary box
-    object1->setShowBoundaryBox(false);
-
-    // center object in scene
-    //object1->setLocalPos(-1.0 * object->getBoundaryCenter());
-
-    // compute all edges of object for which adjacent triangles have more than 40 degree angle
-    object1->computeAllEdges(0);
-
-    // set haptic properties
-    object1->setStiffness(0.3 * maxStiffness);
-    object1->setFriction(0.5, 0.1);
-
-    // display options
-    object1->setShowTriangles(showTriangles);
-    object1->setShowEdges(false);
-    object1->setShowNormals(false);
-
-
-    /////////////////////////////////////////////////////////////////////////
-    // OBJECT 2: Grass Texture - Thea, Linnéa, Kirsten
-    ////////////////////////////////////////////////////////////////////////
-
-    // create a mesh
-    object2 = new cMesh();
-
-    // create plane
-    cCreatePlane(object2, 0.19, 0.14);
-
-    // create collision detector
-    object2->createAABBCollisionDetector(toolRadius);
-
-    // add object to world
-    world->addChild(object2);
-
-    // set the position of the object
-    object2->setLocalPos(-0.02, 0.15, 0.0501);
-
-    object2->rotateAboutLocalAxisDeg (0,0,1,-20);
-
-    // set graphic properties
-    object2->m_texture = cTexture2d::create();
-    fileload = object2->m_texture->loadFromFile("image_objects/grass.jpg");
-    if (!fileload)
+    // tiled map: load the tiles around the centre of the workspace now,
+    // the others in the background as the tool moves
+    if (scene.m_tileSource)
     {
-        cout << "Error - Texture image failed to load correctly." << endl;
-        close();
-        return (-1);
+        cTileManagerSettings tileSettings;
+        tileSettings.m_toolRadius = toolRadius;
+        tileSettings.m_stiffness = 0.3 * maxStiffness;
+        tileSettings.m_showEdges = showEdges;
+        tileSettings.m_showTriangles = showTriangles;
+        tileSettings.m_showNormals = showNormals;
+
+        tileSource = scene.m_tileSource;
+        tileManager = new cTileManager(object, tileSource.get(), tileSettings);
+        tileManager->preload(cVector3d(0.0, 0.0, 0.0));
+        tileManager->start();
     }
 
-    // enable texture mapping
-    object2->setUseTexture(true);
-    object2->m_material->setWhite();
-
-    // create normal map from texture data
-    cNormalMapPtr normalMap2 = cNormalMap::create();
-    normalMap2->createMap(object2->m_texture);
-    object2->m_normalMap = normalMap2;
-
-    // set haptic properties
-    object2->m_material->setStiffness(0.2 * maxStiffness);
-    object2->m_material->setStaticFriction(0.2);
-    object2->m_material->setDynamicFriction(0.2);
-    object2->m_material->setTextureLevel(0.075);
-    object2->m_material->setHapticTriangleSides(true, false);
-
-
-    /////////////////////////////////////////////////////////////////////////
-    // OBJECT 3: Beacon - Thea, Linnéa, Kirsten
-    ////////////////////////////////////////////////////////////////////////
-
-    // create a multimesh
-    object3 = new cMultiMesh();
-
-    // add object to world
-    world->addChild(object3);
-
-    // set the position of the object
-    object3->setLocalPos(0.16, -.16, 0.055);
-
-    // set graphic properties
-    fileload = object3->loadFromFile("image_objects/beacon.obj");
-    if (!fileload)
+    // route guidance along the paths of OSM maps, from where each tool is
+    if (scene.m_routeGraph)
     {
-        cout << "Error -  image failed to load correctly." << endl;
-        close();
-        return (-1);
+        for (size_t i=0; i<stations.size(); i++)
+        {
+            stations[i]->m_routePlanner = new cRoutePlanner(scene.m_routeGraph);
+            stations[i]->m_routePlanner->start();
+        }
+        destinations = scene.m_labels;
     }
 
-    // create collision detector
-    object3->createAABBCollisionDetector(toolRadius);
-
-    // disable culling so that faces are rendered on both sides
-    object3->setUseCulling(false);
+    // height field rendering of the static map
+    if (heightFieldRendering && (tileManager != NULL))
+    {
+        cout << "Warning - height field rendering is not available with tiled maps" << endl;
+    }
+    else if (heightFieldRendering)
+    {
+        cHeightFieldSettings heightFieldSettings;
+        heightFieldSettings.m_stiffness = 0.3 * maxStiffness;
+        heightFieldSettings.m_edgeFallback = heightFieldEdgeFallback;
 
-    // compute a boundary box
-    object3->computeBoundaryBox(true);
+        vector<cGenericObject*> objects;
+        objects.push_back(object);
+        objects.push_back(object1);
+        objects.insert(objects.end(), scene.m_textureZones.begin(), scene.m_textureZones.end());
 
-    // show/hide boundary box
-    object3->setShowBoundaryBox(false);
+        world->computeGlobalPositions(true);
+        heightField = new cHeightFieldRenderer(heightFieldSettings);
+        if (heightField->build(objects, toolRadius, cWorkerPool::getDefault()))
+        {
+            heightField->enable(stations[0]->m_tool);
+        }
+        else
+        {
+            cout << "Warning - nothing to rasterize, using mesh collision" << endl;
+            delete heightField;
+            heightField = NULL;
+        }
+    }
 
-    // compute all edges of object for which adjacent triangles have more than 40 degree angle
-    object3->computeAllEdges(0);
+    // distance field of the buildings for the proximity cue
+    if ((proximityRange > 0.0) && (tileManager != NULL))
+    {
+        cout << "Warning - the proximity cue is not available with tiled maps" << endl;
+    }
+    else if (proximityRange > 0.0)
+    {
+        vector<cGenericObject*> objects;
+        objects.push_back(object);
 
-    // set haptic properties
-    object3->setStiffness(0.005 * maxStiffness);
+        world->computeGlobalPositions(true);
+        shared_ptr<cDistanceField> distanceField = make_shared<cDistanceField>();
+        if (distanceField->build(objects, cWorkerPool::getDefault()))
+        {
+            cProximitySettings proximitySettings;
+            proximitySettings.m_range = proximityRange;
+            for (size_t i=0; i<stations.size(); i++)
+            {
+                stations[i]->m_proximity = new cProximityRenderer(distanceField, toolRadius, proximitySettings);
+            }
+        }
+        else
+        {
+            cout << "Warning - no buildings, the proximity cue is off" << endl;
+        }
+    }
 
-    // display options
-    object3->setShowTriangles(showTriangles);
-    object3->setShowEdges(false);
-    object3->setShowNormals(false);
+    // the force effects of each tool, clamped to what its device can render
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        cHapticStation* station = stations[i];
+        cMapForcePipeline& forces = station->m_forces;
+        forces.get<cTextureEffect>().m_renderer = &station->m_textures;
+        forces.get<cProximityEffect>().m_renderer = station->m_proximity;
+        forces.get<cGuidanceEffect>().m_planner = station->m_routePlanner;
+        forces.get<cContactDampingEffect>().m_damping = contactDamping;
+        forces.get<cContactDampingEffect>().m_settings.m_enabled = (contactDamping > 0.0);
+        forces.get<cGravityBiasEffect>().m_bias.set(0.0, 0.0, -gravityBias);
+        forces.setDeviceLimit(station->m_device->getSpecifications());
+    }
 
 
     //--------------------------------------------------------------------------
@@ -597,33 +847,41 @@ int main(int argc, char* argv[])
     
     // create a label to display the haptic and graphic rate of the simulation
     labelRates = new cLabel(font);
-    labelRates->m_fontColor.setBlack();
-    // camera->m_frontLayer->addChild(labelRates);
-
-
-    buildingLabel = new cLabel(font);
-    buildingLabel->m_fontColor.setGrayLight();
-    camera->m_frontLayer->addChild(buildingLabel);
-
-    buildingLabel2 = new cLabel(font);
-    buildingLabel2->m_fontColor.setWhite();
-    // camera->m_frontLayer->addChild(buildingLabel2);
-
-    buildingLabel3 = new cLabel(font);
-    buildingLabel3->m_fontColor.setWhite();
-    // camera->m_frontLayer->addChild(buildingLabel3);
-
-    buildingLabel4 = new cLabel(font);
-    buildingLabel4->m_fontColor.setWhite();
-    // camera->m_frontLayer->addChild(buildingLabel4);
+    labelRates->m_fontColor.setWhite();
+    camera->m_frontLayer->addChild(labelRates);
+
+    // create a label to display what the tool touches
+    labelFeature = new cLabel(font);
+    labelFeature->m_fontColor.setWhite();
+    camera->m_frontLayer->addChild(labelFeature);
+
+    // create the profiler overlay: a title and a line per stage for the
+    // graphics loop and each servo loop
+    graphicsProfiler.addStage("updateShadowMaps");
+    graphicsProfiler.addStage("renderView");
+    graphicsProfiler.addStage("glFinish");
+    graphicsProfiler.addStage("swapBuffers");
+    graphicsProfiler.addStage("frame");
+    int numProfileLines = 1 + graphicsProfiler.getNumStages();
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        numProfileLines += 1 + stations[i]->m_profiler.getNumStages();
+    }
+    for (int i=0; i<numProfileLines; i++)
+    {
+        cLabel* label = new cLabel(font);
+        label->m_fontColor.setWhite();
+        label->setShowEnabled(false);
+        camera->m_frontLayer->addChild(label);
+        labelsProfile.push_back(label);
+    }
 
-    buildingLabel5 = new cLabel(font);
-    buildingLabel5->m_fontColor.setWhite();
-    // camera->m_frontLayer->addChild(buildingLabel5);
+    // measure the time stamp counter now rather than on the first frame
+    cCycleClock::getFrequency();
 
-    buildingLabel6 = new cLabel(font);
-    buildingLabel6->m_fontColor.setWhite();
-    // camera->m_frontLayer->addChild(buildingLabel6);
+    // create the labels of the buildings, pinned to the map
+    mapLabels = new cMapLabels(camera, font, object);
+    mapLabels->addLabels(scene.m_labels);
 
     // create a background
     background = new cBackground();
@@ -640,9 +898,60 @@ int main(int argc, char* argv[])
     // START SIMULATION
     //--------------------------------------------------------------------------
 
-    // create a thread which starts the main haptics rendering loop
-    hapticsThread = new cThread();
-    hapticsThread->start(updateHaptics, CTHREAD_PRIORITY_HAPTICS);
+    // the scene is static apart from the tools. its frames are computed
+    // once here; each servo thread then only refreshes its own tool.
+    world->computeGlobalPositions(true);
+
+    // one core per servo thread: in real-time mode the isolated cores
+    // first, then counting down from the last one so that the graphics loop
+    // and the loaders keep core 0
+    int numCores = (int)thread::hardware_concurrency();
+    vector<int> cores = cRealtime::getServoCores(realtimeServo);
+    size_t numIsolatedCores = realtimeServo ? cRealtime::getIsolatedCores().size() : 0;
+    bool pinThreads = (numCores > (int)stations.size()) || (numIsolatedCores >= stations.size());
+    if (!pinThreads && (stations.size() > 1))
+    {
+        cout << "Warning - fewer cores than haptic devices plus graphics, servo threads are not pinned" << endl;
+    }
+
+    // lock the memory the servo threads touch into RAM
+    if (realtimeServo)
+    {
+        cMemoryLock memoryLock = cRealtime::lockMemory(realtimeHeapReserve);
+        cout << "Real-time servo: " << numIsolatedCores << " isolated cores, memory "
+             << cRealtime::describe(memoryLock) << endl;
+        if (memoryLock != C_MEMORY_LOCKED_ALL)
+        {
+            cout << "Warning - locking all memory needs CAP_IPC_LOCK or an unlimited memlock limit (ulimit -l)" << endl;
+        }
+        if (numIsolatedCores < stations.size())
+        {
+            cout << "Warning - fewer isolated cores than servo threads (boot with isolcpus= to keep other tasks off them)" << endl;
+        }
+    }
+
+    // create a thread per station which starts its haptics rendering loop
+    simulationRunning = true;
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        cHapticStation* station = stations[i];
+        station->m_transformUpdater = new cTransformUpdater(station->m_tool);
+        station->m_transformUpdater->addDynamicNode(station->m_tool, true);
+        station->m_core = pinThreads ? cores[i] : -1;
+        station->m_isolatedCore = (i < numIsolatedCores);
+        if (!sessionLogFile.empty())
+        {
+            string filename = (i == 0) ? sessionLogFile : sessionLogFile + "." + to_string(i + 1);
+            station->m_recorder = new cSessionRecorder();
+            if (station->m_recorder->start(filename, station->m_scheduler.getRate()))
+            {
+                cout << "Recording haptic device " << i + 1 << " to " << filename << endl;
+            }
+        }
+        station->m_finished = false;
+        station->m_thread = new cThread();
+        station->m_thread->start(updateHaptics, CTHREAD_PRIORITY_HAPTICS, station);
+    }
 
     // setup callback when application exits
     atexit(close);
@@ -662,10 +971,15 @@ int main(int argc, char* argv[])
         glfwGetWindowSize(window, &width, &height);
 
         // render graphics
+        uint64_t frameStart = cCycleClock::now();
         updateGraphics();
 
         // swap buffers
-        glfwSwapBuffers(window);
+        {
+            cScopedStageTimer timer(graphicsProfiler, C_GRAPHICS_SWAP);
+            glfwSwapBuffers(window);
+        }
+        graphicsProfiler.record(C_GRAPHICS_FRAME, cCycleClock::now() - frameStart);
 
         // process events
         glfwPollEvents();
@@ -751,6 +1065,63 @@ void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action,
         mirroredDisplay = !mirroredDisplay;
         camera->setMirrorVertical(mirroredDisplay);
     }
+
+    // option - cycle haptic servo rate
+    else if (a_key == GLFW_KEY_S)
+    {
+        double rate = stations[0]->m_scheduler.getRate();
+        if (rate < 1500.0)      rate = 2000.0;
+        else if (rate < 3000.0) rate = 4000.0;
+        else                    rate = 1000.0;
+        for (size_t i=0; i<stations.size(); i++)
+        {
+            stations[i]->m_scheduler.setRate(rate);
+            stations[i]->m_scheduler.requestReset();
+        }
+        cout << "> Haptic rate set to " << cStr(rate, 0) << " Hz" << endl;
+    }
+
+    // option - show or hide the profiler overlay
+    else if (a_key == GLFW_KEY_P)
+    {
+        showProfile = !showProfile;
+        for (size_t i=0; i<labelsProfile.size(); i++)
+        {
+            labelsProfile[i]->setShowEnabled(showProfile);
+        }
+        profileUpdateTime = 0;
+    }
+
+    // option - guide to the next building
+    else if (a_key == GLFW_KEY_G)
+    {
+        if ((stations[0]->m_routePlanner == NULL) || destinations.empty())
+        {
+            cout << "> Guidance needs an OSM map with named buildings" << endl;
+            return;
+        }
+        destination++;
+        for (size_t i=0; i<stations.size(); i++)
+        {
+            if (destination >= (int)destinations.size())
+            {
+                stations[i]->m_routePlanner->clearGoal();
+            }
+            else
+            {
+                stations[i]->m_routePlanner->setGoal(destinations[destination].m_pos);
+            }
+        }
+        if (destination >= (int)destinations.size())
+        {
+            destination = -1;
+            cout << "> Guidance off" << endl;
+        }
+        else
+        {
+            cout << "> Guiding to " << destinations[destination].m_name << endl;
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -761,63 +1132,258 @@ void close(void)
     simulationRunning = false;
 
     // wait for graphics and haptics loops to terminate
-    while (!simulationFinished) { cSleepMs(100); }
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        while (!stations[i]->m_finished) { cSleepMs(100); }
+    }
 
-    // close haptic device
-    tool->stop();
+    // close haptic devices
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        stations[i]->m_tool->stop();
+    }
+
+    // stop loading tiles
+    delete tileManager;
+    tileManager = NULL;
+
+    delete heightField;
+    heightField = NULL;
+
+    // time spent in each stage of the loops
+    if (!profileReportFile.empty() && !stations.empty())
+    {
+        ofstream report(profileReportFile.c_str());
+        graphicsProfiler.writeReport(report);
+        for (size_t i=0; i<stations.size(); i++)
+        {
+            stations[i]->m_profiler.writeReport(report);
+            if (cAllocationTracker::isAvailable())
+            {
+                stations[i]->m_allocations.writeReport(report);
+            }
+        }
+        if (report)
+        {
+            cout << "Profile written to " << profileReportFile << endl;
+        }
+    }
+
+    // stop planning routes, and the rest of the station state (the tools
+    // belong to the world)
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        if (cAllocationTracker::isAvailable())
+        {
+            const cAllocationTracker& allocations = stations[i]->m_allocations;
+            cout << "Servo thread " << i + 1 << ": " << allocations.getNumAllocations() << " heap allocations in "
+                 << allocations.getNumAllocatingTicks() << " of " << allocations.getNumTicks() << " ticks" << endl;
+        }
+        if (stations[i]->m_recorder != NULL)
+        {
+            stations[i]->m_recorder->stop();
+            cout << "Session log: " << stations[i]->m_recorder->getNumWritten() << " ticks written, "
+                 << stations[i]->m_recorder->getNumDropped() << " dropped" << endl;
+        }
+        delete stations[i]->m_recorder;
+        delete stations[i]->m_routePlanner;
+        delete stations[i]->m_proximity;
+        delete stations[i]->m_thread;
+        delete stations[i]->m_transformUpdater;
+        delete stations[i];
+    }
+    stations.clear();
+
+    // the labels themselves belong to the front layer of the camera
+    delete mapLabels;
+    mapLabels = NULL;
 
     // delete resources
-    delete hapticsThread;
     delete world;
     delete handler;
 }
 
 //------------------------------------------------------------------------------
 
+void updateCursor(cShapeSphere* a_cursor, const cVector3d& a_pos, double a_radius)
+{
+    // camera frame: col 0 points back towards the viewer, col 1 to the
+    // right of the screen and col 2 up (see cMapLabels)
+    cMatrix3d eyeRot = camera->getGlobalRot();
+    cVector3d p = a_pos - camera->getGlobalPos();
+    double depth = -p.dot(eyeRot.getCol0());
+    if ((depth <= 0.0) || (width <= 0) || (height <= 0))
+    {
+        a_cursor->setShowEnabled(false);
+        return;
+    }
+
+    // pixels per world unit at the depth of the cursor
+    double tanHalfFov = tan(0.5 * camera->getFieldViewAngleDeg() * C_PI / 180.0);
+    double scale = 0.5 * height / (depth * tanHalfFov);
+    double x = 0.5 * width + p.dot(eyeRot.getCol1()) * scale;
+    double y = 0.5 * height + p.dot(eyeRot.getCol2()) * scale;
+    if (camera->getMirrorVertical())
+    {
+        x = width - x;
+    }
+    a_cursor->setShowEnabled(true);
+    a_cursor->setLocalPos(x, y, 0.0);
+    a_cursor->setRadius(a_radius * scale);
+}
+
+//------------------------------------------------------------------------------
+
 void updateGraphics(void)
 {
     /////////////////////////////////////////////////////////////////////
     // UPDATE WIDGETS
     /////////////////////////////////////////////////////////////////////
 
-    // update haptic and graphic rate data
-    labelRates->setText(cStr(freqCounterGraphics.getFrequency(), 0) + " Hz / " +
-                        cStr(freqCounterHaptics.getFrequency(), 0) + " Hz");
+    // take over the newest snapshot of each tool and move its cursor there
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        stations[i]->m_snapshot.update();
+        updateCursor(stations[i]->m_cursor, stations[i]->m_snapshot.getReadBuffer().m_proxyPos,
+                     stations[i]->m_cursorRadius);
+    }
+
+    // update haptic and graphic rate data, for each device
+    string rates = cStr(freqCounterGraphics.getFrequency(), 0) + " Hz";
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        const cHapticScheduler& scheduler = stations[i]->m_scheduler;
+        if (scheduler.getMode() == C_SCHEDULER_FREE_RUNNING)
+        {
+            rates += " / " + cStr(stations[i]->m_snapshot.getReadBuffer().m_hapticRate, 0) + " Hz";
+        }
+        else
+        {
+            rates += " / " + cStr(scheduler.getEffectiveRate(), 0) + " of " +
+                     cStr(scheduler.getRate(), 0) + " Hz - " +
+                     cStr((int)scheduler.getNumOverruns()) + " overruns - jitter p99 " +
+                     cStr(1e6 * scheduler.getJitterPercentile(99.0), 0) + " us";
+        }
+    }
+    labelRates->setText(rates);
 
     // update position of label
     labelRates->setLocalPos((int)(0.5 * (width - labelRates->getWidth())), 15);
 
-    buildingLabel->setText("Nymble");
-    buildingLabel->setLocalPos((int)(.27 * width), (int)(.48 * height));
-
-    buildingLabel2->setText("Entre");
-    buildingLabel2->setLocalPos(400,175,0);
-
-    buildingLabel3->setText("D");
-    buildingLabel3->setLocalPos(725,100,0);
-
-    buildingLabel4->setText("E");
-    buildingLabel4->setLocalPos(555,135,0);
+    // announce the features the tools touch when they change. with several
+    // devices, each name is prefixed with the number of its device.
+    bool touchChanged = false;
+    for (size_t i=0; i<stations.size(); i++)
+    {
+        cHapticStation* station = stations[i];
+        int feature = station->m_snapshot.getReadBuffer().m_feature;
+        if (feature != station->m_announcedFeature)
+        {
+            station->m_announcedFeature = feature;
+            touchChanged = true;
+            if (feature >= 0)
+            {
+                string device = (stations.size() > 1) ? " (" + cStr((int)i + 1) + ")" : "";
+                cout << "Touching" << device << ": " << featureIndex->getFeature(feature).m_name << endl;
+            }
+        }
+    }
+    if (touchChanged)
+    {
+        string touching;
+        for (size_t i=0; i<stations.size(); i++)
+        {
+            int feature = stations[i]->m_announcedFeature;
+            if (feature < 0)
+            {
+                continue;
+            }
+            if (!touching.empty())
+            {
+                touching += "   ";
+            }
+            if (stations.size() > 1)
+            {
+                touching += cStr((int)i + 1) + ": ";
+            }
+            touching += featureIndex->getFeature(feature).m_name;
+        }
+        labelFeature->setText(touching);
+    }
+    labelFeature->setLocalPos((int)(0.5 * (width - labelFeature->getWidth())), height - 40);
 
-    buildingLabel5->setText("Biblioteket");
-    buildingLabel5->setLocalPos(400,410,0);
+    // place the labels of the buildings (only if the view changed)
+    mapLabels->update(width, height);
 
-    buildingLabel6->setText("Arktektur");
-    buildingLabel6->setLocalPos(425,300,0);
+    // refresh the profiler overlay four times a second
+    int64_t now = cHapticScheduler::now();
+    if (showProfile && (now - profileUpdateTime > 250000000))
+    {
+        profileUpdateTime = now;
+        vector<string> lines;
+        vector<const cStageProfiler*> profilers(1, &graphicsProfiler);
+        for (size_t i=0; i<stations.size(); i++)
+        {
+            profilers.push_back(&stations[i]->m_profiler);
+        }
+        for (size_t i=0; i<profilers.size(); i++)
+        {
+            const cStageProfiler* profiler = profilers[i];
+            lines.push_back((i == 0) ? string("graphics [us]") : "haptics " + cStr((int)i) + " [us]");
+            for (int k=0; k<profiler->getNumStages(); k++)
+            {
+                lines.push_back("  " + profiler->getStageName(k) +
+                                "   p50 " + cStr(1e6 * profiler->getPercentile(k, 50.0), 1) +
+                                "   p99 " + cStr(1e6 * profiler->getPercentile(k, 99.0), 1) +
+                                "   max " + cStr(1e6 * profiler->getMax(k), 1));
+            }
+        }
+        for (size_t i=0; i<labelsProfile.size(); i++)
+        {
+            labelsProfile[i]->setText(lines[i]);
+        }
+    }
+    for (size_t i=0; i<labelsProfile.size(); i++)
+    {
+        labelsProfile[i]->setLocalPos(10, height - 80 - 22 * (int)i);
+    }
 
 
     /////////////////////////////////////////////////////////////////////
     // RENDER SCENE
     /////////////////////////////////////////////////////////////////////
 
+    // the haptic thread swaps map tiles only while the world is not rendered
+    unique_lock<mutex> sceneLock;
+    if (tileManager != NULL)
+    {
+        sceneLock = unique_lock<mutex>(tileManager->getSceneMutex());
+    }
+
     // update shadow maps (if any)
-    world->updateShadowMaps(false, mirroredDisplay);
+    {
+        cScopedStageTimer timer(graphicsProfiler, C_GRAPHICS_SHADOW_MAPS);
+        world->updateShadowMaps(false, mirroredDisplay);
+    }
 
     // render world
-    camera->renderView(width, height);
+    {
+        cScopedStageTimer timer(graphicsProfiler, C_GRAPHICS_RENDER_VIEW);
+        camera->renderView(width, height);
+    }
+
+    // delete tiles the haptic thread has evicted
+    if (tileManager != NULL)
+    {
+        sceneLock.unlock();
+        tileManager->collectGarbage();
+    }
 
     // wait until all GL commands are completed
-    glFinish();
+    {
+        cScopedStageTimer timer(graphicsProfiler, C_GRAPHICS_FINISH);
+        glFinish();
+    }
 
     // check for any OpenGL errors
     GLenum err = glGetError();
@@ -831,34 +1397,103 @@ enum cMode
     SELECTION
 };
 
-void updateHaptics(void)
+void updateHaptics(void* a_station)
 {
+    cHapticStation* station = (cHapticStation*)a_station;
+    cToolCursor* tool = station->m_tool;
+    cTransformUpdater* transformUpdater = station->m_transformUpdater;
+    cHapticScheduler& hapticScheduler = station->m_scheduler;
+    cStageProfiler& profiler = station->m_profiler;
+
     cMode state = IDLE;
     cGenericObject* selectedObject = NULL;
     cTransform tool_T_object;
 
-    // simulation in now running
-    simulationRunning  = true;
-    simulationFinished = false;
+    // keep to the core of this station
+    if ((station->m_core >= 0) && !cHapticScheduler::pinCurrentThread(station->m_core))
+    {
+        cout << "Warning - servo thread " << station->m_index + 1 << " could not be pinned to core " << station->m_core << endl;
+    }
+
+    // real-time scheduling, and a stack that never takes a page fault
+    if (realtimeServo)
+    {
+        int priority = cRealtime::setFifoPriority(realtimePriority);
+        cRealtime::prefaultStack();
+        string core = (station->m_core < 0) ? string("not pinned") :
+                      "core " + cStr(station->m_core) + (station->m_isolatedCore ? " (isolated)" : "");
+        cout << "Servo thread " << station->m_index + 1 << ": " << core << ", "
+             << ((priority >= 0) ? "SCHED_FIFO priority " + cStr(priority) : string("normal priority")) << ", "
+             << cRealtime::C_STACK_PREFAULT / 1024 << " KiB of stack prefaulted" << endl;
+        if (priority < 0)
+        {
+            cout << "Warning - SCHED_FIFO needs CAP_SYS_NICE or an rtprio limit (ulimit -r)" << endl;
+        }
+    }
+
+    // first deadline one period from now
+    hapticScheduler.start();
+    int64_t lastTick = cHapticScheduler::now();
+    int numTicks = 0;
 
     // main haptic simulation loop
     while(simulationRunning)
     {
+        // wait for the next servo deadline
+        hapticScheduler.waitForNextTick();
+        uint64_t tickStart = cCycleClock::now();
+
+        // count heap allocations once the loop has warmed up
+        if (numTicks++ == allocationWarmupTicks)
+        {
+            station->m_allocations.attach();
+        }
+
         /////////////////////////////////////////////////////////////////////////
         // HAPTIC RENDERING
         /////////////////////////////////////////////////////////////////////////
 
         // signal frequency counter
-        freqCounterHaptics.signal(1);
+        station->m_freqCounter.signal(1);
 
         // compute global reference frames for each object
-        world->computeGlobalPositions(true);
+        {
+            cScopedStageTimer timer(profiler, C_HAPTIC_GLOBAL_POSITIONS);
+            if (incrementalTransforms)
+            {
+                transformUpdater->update();
+            }
+            else
+            {
+                world->computeGlobalPositions(true);
+            }
+        }
+
+        // attach and evict map tiles around the proxy
+        if (tileManager != NULL)
+        {
+            int64_t tick = cHapticScheduler::now();
+            tileManager->update(tool->m_hapticPoint->getGlobalPosProxy(), tool->m_hapticPoint, 1e-9 * (tick - lastTick));
+            lastTick = tick;
+        }
 
         // update position and orientation of tool
-        tool->updateFromDevice();
+        {
+            cScopedStageTimer timer(profiler, C_HAPTIC_UPDATE_FROM_DEVICE);
+            tool->updateFromDevice();
+        }
+
+        // move the height field proxy (hands over to the meshes near sharp edges)
+        if (heightField != NULL)
+        {
+            heightField->update(tool);
+        }
 
         // compute interaction forces
-        tool->computeInteractionForces();
+        {
+            cScopedStageTimer timer(profiler, C_HAPTIC_INTERACTION_FORCES);
+            tool->computeInteractionForces();
+        }
 
 /*
 
@@ -923,6 +1558,7 @@ void updateHaptics(void)
 
             // assign new local transformation to object
             selectedObject->setLocalTransform(parent_T_object);
+            transformUpdater->markDirty(selectedObject);
 
             // set zero forces when manipulating objects
             tool->setDeviceGlobalForce(0.0, 0.0, 0.0);
@@ -945,16 +1581,57 @@ void updateHaptics(void)
         // FINALIZE
         /////////////////////////////////////////////////////////////////////////
 
-        // send forces to haptic device
+        // send forces to haptic device: the contact force plus the
+        // textures, proximity cue, route guidance, damping and bias
         //tool->applyToDevice();
-        cVector3d computedForce = tool->getDeviceGlobalForce();
-        computedForce += cVector3d(0,0,-.5);
-        hapticDevice->setForce(computedForce);
+        uint64_t cuesStart = cCycleClock::now();
+        cForceContext context;
+        context.set(tool, object, heightField);
+        cVector3d computedForce = station->m_forces.compute(context);
+        const cVector3d& proxy = context.m_proxy;
+        const cVector3d& localProxy = context.m_localProxy;
+        profiler.record(C_HAPTIC_FORCE_CUES, cCycleClock::now() - cuesStart);
+        {
+            cScopedStageTimer timer(profiler, C_HAPTIC_SET_FORCE);
+            station->m_device->setForce(computedForce);
+        }
+
+        // look up the feature the tool touches, for the graphics thread
+        int feature = -1;
+        if (featureIndex && context.m_inContact)
+        {
+            feature = featureIndex->find(localProxy, featureReach);
+        }
+
+        // log the tick for later analysis or replay
+        if (station->m_recorder != NULL)
+        {
+            station->m_recorder->record(tool, proxy, computedForce, feature);
+        }
+
+        // move on to the next tick of a replayed session
+        if (station->m_replayDevice)
+        {
+            station->m_replayDevice->step();
+        }
 
+        // publish the state of the tool for the graphics thread
+        cToolSnapshot& snapshot = station->m_snapshot.getWriteBuffer();
+        snapshot.m_proxyPos = proxy;
+        snapshot.m_devicePos = tool->getDeviceGlobalPos();
+        snapshot.m_force = computedForce;
+        snapshot.m_numContacts = tool->m_hapticPoint->getNumCollisionEvents();
+        snapshot.m_feature = feature;
+        snapshot.m_hapticRate = station->m_freqCounter.getFrequency();
+        station->m_snapshot.publish();
+
+        profiler.record(C_HAPTIC_TICK, cCycleClock::now() - tickStart);
+        station->m_allocations.endTick();
     }
     
     // exit haptics thread
-    simulationFinished = true;
+    cAllocationTracker::detach();
+    station->m_finished = true;
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,391 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CAllocationTracker.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <new>
+#include <vector>
+#if defined(LINUX)
+#include <execinfo.h>
+#endif
+#if defined(WIN32) || defined(WIN64)
+#include <windows.h>
+#endif
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+namespace
+{
+    // tracker of the calling thread, and whether the thread is inside the
+    // tracker already (capturing a stack may allocate)
+    thread_local cAllocationTracker* t_tracker = NULL;
+    thread_local bool t_inTracker = false;
+
+    // return addresses of the calling thread, innermost first
+    int captureStack(void** a_frames, int a_maxFrames)
+    {
+#if defined(LINUX)
+        return (backtrace(a_frames, a_maxFrames));
+#elif defined(WIN32) || defined(WIN64)
+        return ((int)CaptureStackBackTrace(0, (DWORD)a_maxFrames, a_frames, NULL));
+#else
+        return (0);
+#endif
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cAllocationTracker::cAllocationTracker(const string& a_name) :
+    m_name(a_name)
+{
+    reset();
+}
+
+//------------------------------------------------------------------------------
+
+bool cAllocationTracker::isAvailable()
+{
+#if defined(C_TRACK_ALLOCATIONS)
+    return (true);
+#else
+    return (false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void cAllocationTracker::attach()
+{
+    // the first stack capture loads the unwinder, which allocates; do it
+    // now rather than on the first counted allocation
+    void* frames[C_MAX_FRAMES];
+    t_inTracker = true;
+    captureStack(frames, C_MAX_FRAMES);
+    t_inTracker = false;
+
+    m_tickStart = getNumAllocations();
+    t_tracker = this;
+}
+
+//------------------------------------------------------------------------------
+
+void cAllocationTracker::detach()
+{
+    t_tracker = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+void cAllocationTracker::endTick()
+{
+    if (t_tracker != this)
+    {
+        return;
+    }
+    uint64_t numAllocations = getNumAllocations();
+    uint64_t count = numAllocations - m_tickStart;
+    m_tickStart = numAllocations;
+
+    m_numTicks.store(getNumTicks() + 1, memory_order_relaxed);
+    if (count > 0)
+    {
+        m_numAllocatingTicks.store(getNumAllocatingTicks() + 1, memory_order_relaxed);
+        if (count > getMaxPerTick())
+        {
+            m_maxPerTick.store(count, memory_order_relaxed);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cAllocationTracker::reset()
+{
+    m_numAllocations.store(0, memory_order_relaxed);
+    m_numBytes.store(0, memory_order_relaxed);
+    m_numTicks.store(0, memory_order_relaxed);
+    m_numAllocatingTicks.store(0, memory_order_relaxed);
+    m_maxPerTick.store(0, memory_order_relaxed);
+    m_tickStart = 0;
+    for (int i=0; i<C_MAX_STACKS; i++)
+    {
+        m_stacks[i].m_count.store(0, memory_order_relaxed);
+    }
+    m_numStacks.store(0, memory_order_release);
+    m_numUnknownStacks.store(0, memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+
+void cAllocationTracker::onAllocation(size_t a_size)
+{
+    cAllocationTracker* tracker = t_tracker;
+    if ((tracker == NULL) || t_inTracker)
+    {
+        return;
+    }
+    t_inTracker = true;
+    tracker->add(a_size);
+    t_inTracker = false;
+}
+
+//------------------------------------------------------------------------------
+
+void cAllocationTracker::add(size_t a_size)
+{
+    m_numAllocations.store(getNumAllocations() + 1, memory_order_relaxed);
+    m_numBytes.store(getNumBytes() + a_size, memory_order_relaxed);
+
+    // the stack without this function
+    void* frames[C_MAX_FRAMES + 1];
+    int numFrames = max(0, captureStack(frames, C_MAX_FRAMES + 1) - 1);
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i=0; i<numFrames; i++)
+    {
+        hash = (hash ^ (uint64_t)(uintptr_t)frames[i + 1]) * 1099511628211ULL;
+    }
+
+    int numStacks = m_numStacks.load(memory_order_relaxed);
+    for (int i=0; i<numStacks; i++)
+    {
+        cStack& stack = m_stacks[i];
+        if ((stack.m_hash == hash) && (stack.m_numFrames == numFrames) &&
+            (memcmp(stack.m_frames, frames + 1, numFrames * sizeof(void*)) == 0))
+        {
+            stack.m_count.store(stack.m_count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            return;
+        }
+    }
+    if (numStacks == C_MAX_STACKS)
+    {
+        m_numUnknownStacks.store(m_numUnknownStacks.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        return;
+    }
+
+    // readers only look at the stacks below m_numStacks
+    cStack& stack = m_stacks[numStacks];
+    stack.m_hash = hash;
+    stack.m_numFrames = numFrames;
+    memcpy(stack.m_frames, frames + 1, numFrames * sizeof(void*));
+    stack.m_count.store(1, memory_order_relaxed);
+    m_numStacks.store(numStacks + 1, memory_order_release);
+}
+
+//------------------------------------------------------------------------------
+
+void cAllocationTracker::writeReport(ostream& a_out) const
+{
+    a_out << "# " << m_name << " allocations" << endl;
+    if (!isAvailable())
+    {
+        a_out << "not tracked, build with CONFIG+=track_allocations" << endl << endl;
+        return;
+    }
+    a_out << getNumAllocations() << " allocations (" << getNumBytes() << " bytes) in "
+          << getNumAllocatingTicks() << " of " << getNumTicks() << " ticks, at most "
+          << getMaxPerTick() << " in one tick" << endl;
+
+    // most frequent stack first
+    int numStacks = m_numStacks.load(memory_order_acquire);
+    vector<int> order(numStacks);
+    for (int i=0; i<numStacks; i++)
+    {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [this](int a, int b)
+    {
+        return (m_stacks[a].m_count.load(memory_order_relaxed) > m_stacks[b].m_count.load(memory_order_relaxed));
+    });
+
+    for (int i=0; i<numStacks; i++)
+    {
+        const cStack& stack = m_stacks[order[i]];
+        a_out << endl << stack.m_count.load(memory_order_relaxed) << " from:" << endl;
+#if defined(LINUX)
+        char** symbols = backtrace_symbols(stack.m_frames, stack.m_numFrames);
+        for (int k=0; k<stack.m_numFrames; k++)
+        {
+            a_out << "    " << ((symbols != NULL) ? symbols[k] : "?") << endl;
+        }
+        free(symbols);
+#else
+        for (int k=0; k<stack.m_numFrames; k++)
+        {
+            a_out << "    0x" << hex << (uintptr_t)stack.m_frames[k] << dec << endl;
+        }
+#endif
+    }
+    uint64_t numUnknown = m_numUnknownStacks.load(memory_order_relaxed);
+    if (numUnknown > 0)
+    {
+        a_out << endl << numUnknown << " from further call stacks" << endl;
+    }
+    a_out << endl;
+}
+
+//------------------------------------------------------------------------------
+
+void cReserveToolEvents(cGenericTool* a_tool, size_t a_numEvents)
+{
+    for (int i=0; i<a_tool->getNumHapticPoints(); i++)
+    {
+        cHapticPoint* point = a_tool->getHapticPoint(i);
+        cAlgorithmFingerProxy* proxy = point->m_algorithmFingerProxy;
+        proxy->m_collisionRecorderConstraint0.m_collisions.reserve(a_numEvents);
+        proxy->m_collisionRecorderConstraint1.m_collisions.reserve(a_numEvents);
+        proxy->m_collisionRecorderConstraint2.m_collisions.reserve(a_numEvents);
+        point->m_algorithmPotentialField->m_interactionRecorder.m_interactions.reserve(a_numEvents);
+    }
+}
+
+//------------------------------------------------------------------------------
+// ALLOCATION HOOKS
+//------------------------------------------------------------------------------
+
+#if defined(C_TRACK_ALLOCATIONS)
+#if defined(__GLIBC__)
+
+// glibc: everything, operator new included, ends up in malloc, calloc,
+// realloc or one of the aligned allocators, which hand over to the allocator
+// of glibc after counting
+extern "C"
+{
+    void* __libc_malloc(size_t a_size);
+    void* __libc_calloc(size_t a_count, size_t a_size);
+    void* __libc_realloc(void* a_pointer, size_t a_size);
+    void* __libc_memalign(size_t a_alignment, size_t a_size);
+    void* __libc_valloc(size_t a_size);
+    void* __libc_pvalloc(size_t a_size);
+
+    void* malloc(size_t a_size) throw()
+    {
+        cAllocationTracker::onAllocation(a_size);
+        return (__libc_malloc(a_size));
+    }
+
+    void* calloc(size_t a_count, size_t a_size) throw()
+    {
+        cAllocationTracker::onAllocation(a_count * a_size);
+        return (__libc_calloc(a_count, a_size));
+    }
+
+    void* realloc(void* a_pointer, size_t a_size) throw()
+    {
+        cAllocationTracker::onAllocation(a_size);
+        return (__libc_realloc(a_pointer, a_size));
+    }
+
+    void* memalign(size_t a_alignment, size_t a_size) throw()
+    {
+        cAllocationTracker::onAllocation(a_size);
+        return (__libc_memalign(a_alignment, a_size));
+    }
+
+    int posix_memalign(void** a_pointer, size_t a_alignment, size_t a_size) throw()
+    {
+        cAllocationTracker::onAllocation(a_size);
+
+        // memalign() accepts any alignment, posix_memalign() does not
+        if ((a_alignment == 0) || ((a_alignment & (a_alignment - 1)) != 0) ||
+            ((a_alignment % sizeof(void*)) != 0))
+        {
+            return (EINVAL);
+        }
+
+        void* pointer = __libc_memalign(a_alignment, a_size);
+        if (pointer == NULL)
+        {
+            return (ENOMEM);
+        }
+        *a_pointer = pointer;
+        return (0);
+    }
+
+    void* aligned_alloc(size_t a_alignment, size_t a_size) throw()
+    {
+        cAllocationTracker::onAllocation(a_size);
+        return (__libc_memalign(a_alignment, a_size));
+    }
+
+    void* valloc(size_t a_size) throw()
+    {
+        cAllocationTracker::onAllocation(a_size);
+        return (__libc_valloc(a_size));
+    }
+
+    void* pvalloc(size_t a_size) throw()
+    {
+        cAllocationTracker::onAllocation(a_size);
+        return (__libc_pvalloc(a_size));
+    }
+}
+
+#else
+
+// elsewhere only operator new can be replaced portably
+void* operator new(size_t a_size)
+{
+    cAllocationTracker::onAllocation(a_size);
+    void* pointer = malloc((a_size > 0) ? a_size : 1);
+    if (pointer == NULL)
+    {
+        throw bad_alloc();
+    }
+    return (pointer);
+}
+
+void* operator new[](size_t a_size)
+{
+    return (operator new(a_size));
+}
+
+void* operator new(size_t a_size, const nothrow_t&) throw()
+{
+    cAllocationTracker::onAllocation(a_size);
+    return (malloc((a_size > 0) ? a_size : 1));
+}
+
+void* operator new[](size_t a_size, const nothrow_t& a_nothrow) throw()
+{
+    return (operator new(a_size, a_nothrow));
+}
+
+void operator delete(void* a_pointer) throw()
+{
+    free(a_pointer);
+}
+
+void operator delete[](void* a_pointer) throw()
+{
+    free(a_pointer);
+}
+
+void operator delete(void* a_pointer, const nothrow_t&) throw()
+{
+    free(a_pointer);
+}
+
+void operator delete[](void* a_pointer, const nothrow_t&) throw()
+{
+    free(a_pointer);
+}
+
+#endif
+#endif
+
+//------------------------------------------------------------------------------
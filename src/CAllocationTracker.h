@@ -0,0 +1,116 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CAllocationTrackerH
+#define CAllocationTrackerH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Counts the heap allocations made by one thread, per tick of its loop, and
+// keeps the call stacks they came from.
+//
+// Allocations are only seen in builds with C_TRACK_ALLOCATIONS defined
+// (qmake CONFIG+=track_allocations), which replace malloc, calloc, realloc,
+// memalign, posix_memalign, aligned_alloc, valloc and pvalloc (glibc) or
+// operator new (elsewhere) with versions that report to the tracker of the
+// calling thread. In other builds a tracker counts
+// nothing, and isAvailable() tells them apart.
+//
+// The counting runs on the allocating thread, without allocating itself;
+// the counts and stacks may be read from any thread.
+//------------------------------------------------------------------------------
+class cAllocationTracker
+{
+public:
+
+    // distinct call stacks kept, and frames kept of each one
+    static const int C_MAX_STACKS = 32;
+    static const int C_MAX_FRAMES = 16;
+
+    cAllocationTracker(const std::string& a_name = "");
+
+    // true if this build intercepts allocations
+    static bool isAvailable();
+
+    // calling thread: count its allocations into this tracker from now on
+    void attach();
+
+    // calling thread: stop counting its allocations
+    static void detach();
+
+    // attached thread: close a tick, counting it and its allocations
+    void endTick();
+
+    // forget everything counted so far, e.g. after a warm-up
+    void reset();
+
+    // allocations, their bytes, ticks closed, ticks with at least one
+    // allocation, and the most allocations in one tick
+    uint64_t getNumAllocations() const { return (m_numAllocations.load(std::memory_order_relaxed)); }
+    uint64_t getNumBytes() const { return (m_numBytes.load(std::memory_order_relaxed)); }
+    uint64_t getNumTicks() const { return (m_numTicks.load(std::memory_order_relaxed)); }
+    uint64_t getNumAllocatingTicks() const { return (m_numAllocatingTicks.load(std::memory_order_relaxed)); }
+    uint64_t getMaxPerTick() const { return (m_maxPerTick.load(std::memory_order_relaxed)); }
+
+    // the counts, then every call stack with the number of allocations made
+    // from it, most frequent first
+    void writeReport(std::ostream& a_out) const;
+
+    // allocation hook: a_size bytes were allocated by the calling thread
+    static void onAllocation(size_t a_size);
+
+protected:
+
+    struct cStack
+    {
+        std::atomic<uint64_t> m_count;
+        uint64_t m_hash;
+        int m_numFrames;
+        void* m_frames[C_MAX_FRAMES];
+    };
+
+    void add(size_t a_size);
+
+    std::string m_name;
+
+    std::atomic<uint64_t> m_numAllocations;
+    std::atomic<uint64_t> m_numBytes;
+    std::atomic<uint64_t> m_numTicks;
+    std::atomic<uint64_t> m_numAllocatingTicks;
+    std::atomic<uint64_t> m_maxPerTick;
+
+    // m_numAllocations when the current tick started
+    uint64_t m_tickStart;
+
+    // call stacks, filled in order; allocations from further stacks are only
+    // counted in m_numUnknownStacks
+    cStack m_stacks[C_MAX_STACKS];
+    std::atomic<int> m_numStacks;
+    std::atomic<uint64_t> m_numUnknownStacks;
+};
+
+//------------------------------------------------------------------------------
+// Reserve room for a_numEvents collision and interaction events in every
+// haptic point of a_tool. CHAI3D keeps these events in vectors that are
+// cleared but not shrunk each tick, so without this the servo loop
+// allocates the first time the tool touches more triangles than ever before.
+//------------------------------------------------------------------------------
+void cReserveToolEvents(chai3d::cGenericTool* a_tool, size_t a_numEvents = 64);
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
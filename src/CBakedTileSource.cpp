@@ -0,0 +1,88 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CBakedTileSource.h"
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+cBakedTileSource::cBakedTileSource(double a_toolRadius, unsigned int a_level) :
+    m_toolRadius(a_toolRadius),
+    m_level(a_level)
+{
+}
+
+//------------------------------------------------------------------------------
+
+bool cBakedTileSource::open(const string& a_filename)
+{
+    if (!m_file.open(a_filename))
+    {
+        cout << "Error - " << a_filename << " is not a tile file of version " << cTileFile::C_VERSION << endl;
+        return (false);
+    }
+    if (m_level >= m_file.getNumLevels())
+    {
+        cout << "Error - " << a_filename << " has no level " << m_level << endl;
+        m_file.close();
+        return (false);
+    }
+    if (m_file.getToolRadius() != m_toolRadius)
+    {
+        cout << "Warning - " << a_filename << " was baked for a tool radius of " << m_file.getToolRadius()
+             << ", collision trees will be rebuilt" << endl;
+    }
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void cBakedTileSource::getTileRange(int& a_minX, int& a_minY, int& a_maxX, int& a_maxY) const
+{
+    m_file.getTileRange(m_level, a_minX, a_minY, a_maxX, a_maxY);
+}
+
+//------------------------------------------------------------------------------
+
+void cBakedTileSource::getLabels(int a_x, int a_y, vector<cTileLabel>& a_labels) const
+{
+    const cTileEntry* entry = m_file.findTile(m_level, a_x, a_y);
+    if (entry != NULL)
+    {
+        m_file.getLabels(*entry, a_labels);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cBakedTileSource::getLabels(vector<cTileLabel>& a_labels) const
+{
+    for (size_t i=0; i<m_file.getNumTiles(); i++)
+    {
+        const cTileEntry* entry = m_file.getTile(i);
+        if (entry->m_level == (int32_t)m_level)
+        {
+            m_file.getLabels(*entry, a_labels);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cMultiMesh* cBakedTileSource::loadTile(int a_x, int a_y)
+{
+    const cTileEntry* entry = m_file.findTile(m_level, a_x, a_y);
+    if ((entry == NULL) || ((entry->m_numVisualTriangles == 0) && (entry->m_numHapticTriangles == 0)))
+    {
+        return (NULL);
+    }
+    return (m_file.createTile(*entry, m_toolRadius));
+}
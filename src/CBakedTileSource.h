@@ -0,0 +1,57 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CBakedTileSourceH
+#define CBakedTileSourceH
+//------------------------------------------------------------------------------
+#include "CTileFile.h"
+#include "CTileSource.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Tiles read from one level of a pyramid baked by hapmap_bake. Tiles come
+// with their edges and collision trees, so loading a tile only copies data
+// out of the mapped file.
+//------------------------------------------------------------------------------
+class cBakedTileSource : public cTileSource
+{
+public:
+
+    // a_toolRadius should match the radius the file was baked for; otherwise
+    // the collision trees are rebuilt as tiles are loaded
+    cBakedTileSource(double a_toolRadius, unsigned int a_level = 0);
+
+    // map a tile file. returns false if it cannot be read or lacks the level.
+    bool open(const std::string& a_filename);
+
+    // the mapped pyramid
+    const cTileFile& getFile() const { return (m_file); }
+
+    // label anchors of a tile of this level
+    void getLabels(int a_x, int a_y, std::vector<cTileLabel>& a_labels) const;
+
+    // label anchors of all tiles of this level
+    virtual void getLabels(std::vector<cTileLabel>& a_labels) const;
+
+    virtual double getTileSize() const { return (m_file.getTileSize(m_level)); }
+    virtual void getTileRange(int& a_minX, int& a_minY, int& a_maxX, int& a_maxY) const;
+    virtual bool isPreprocessed() const { return (true); }
+    virtual chai3d::cMultiMesh* loadTile(int a_x, int a_y);
+
+private:
+
+    cTileFile m_file;
+    double m_toolRadius;
+    unsigned int m_level;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,465 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CCampusScene.h"
+#include "CBakedTileSource.h"
+#include "CCoherentCollisionAABB.h"
+#include "CMeshCache.h"
+#include "COsmTileSource.h"
+#include "CPersistentCollisionAABB.h"
+#include "CWorkerPool.h"
+//------------------------------------------------------------------------------
+#include <fstream>
+#include <map>
+#include <sstream>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+// build the campus multimesh from an OpenStreetMap extract
+static bool createOsmCampus(cMultiMesh* a_object,
+                            const cCampusSceneSettings& a_settings,
+                            cCampusScene& a_scene)
+{
+    shared_ptr<cOsmMap> map = make_shared<cOsmMap>();
+    if (!map->loadFromFile(a_settings.m_osmFile))
+    {
+        return (false);
+    }
+
+    // tiled maps are loaded later, tile by tile
+    if (a_settings.m_tileSize > 0.0)
+    {
+        shared_ptr<cOsmTileSource> source = make_shared<cOsmTileSource>(map, a_settings.m_osmSettings,
+                                                                       a_settings.m_tileSize);
+        cout << "OSM map: " << source->getNumTiles() << " tiles" << endl;
+        a_scene.m_osmMap = map;
+        a_scene.m_osmProjection = source->getProjection();
+        a_scene.m_tileSource = source;
+        source->getLabels(a_scene.m_labels);
+        return (source->getNumTiles() > 0);
+    }
+
+    cOsmMeshBuilder builder(*map, a_settings.m_osmSettings);
+    if (!builder.build(a_object))
+    {
+        return (false);
+    }
+
+    // edges and collision detectors, as the mesh cache does for .obj assets
+    a_object->computeAllEdges(0);
+    for (unsigned int i=0; i<a_object->getNumMeshes(); i++)
+    {
+        cPersistentCollisionAABB::create(a_object->getMesh(i), a_settings.m_toolRadius);
+    }
+
+    vector<cOsmBuilding> buildings;
+    builder.extractBuildings(buildings);
+    for (size_t i=0; i<buildings.size(); i++)
+    {
+        if (!buildings[i].m_name.empty())
+        {
+            cTileLabel label;
+            label.m_name = buildings[i].m_name;
+            label.m_pos = builder.getLabelAnchor(buildings[i]);
+            a_scene.m_labels.push_back(label);
+        }
+    }
+
+    a_scene.m_osmMap = map;
+    a_scene.m_osmProjection = builder.getProjection();
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+// open a tile pyramid baked by hapmap_bake. the tiles are loaded later.
+static bool createBakedCampus(const cCampusSceneSettings& a_settings,
+                              cCampusScene& a_scene)
+{
+    shared_ptr<cBakedTileSource> source = make_shared<cBakedTileSource>(a_settings.m_toolRadius,
+                                                                       a_settings.m_tileLevel);
+    if (!source->open(a_settings.m_tileFile))
+    {
+        return (false);
+    }
+    cout << "Baked map: " << source->getFile().getNumTiles() << " tiles in "
+         << source->getFile().getNumLevels() << " levels" << endl;
+    a_scene.m_tileSource = source;
+    source->getLabels(a_scene.m_labels);
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+// read the labels of the Blender export: one "x y z name" per line, in local
+// coordinates of the map, '#' starts a comment. a missing file is no error.
+static void loadLabelTable(const string& a_filename, vector<cTileLabel>& a_labels)
+{
+    ifstream file(a_filename.c_str());
+    string line;
+    while (getline(file, line))
+    {
+        size_t comment = line.find('#');
+        if (comment != string::npos)
+        {
+            line.erase(comment);
+        }
+
+        istringstream stream(line);
+        cTileLabel label;
+        if (!(stream >> label.m_pos(0) >> label.m_pos(1) >> label.m_pos(2)))
+        {
+            continue;
+        }
+        getline(stream >> ws, label.m_name);
+        size_t end = label.m_name.find_last_not_of(" \t\r");
+        if (end == string::npos)
+        {
+            continue;
+        }
+        label.m_name.erase(end + 1);
+        a_labels.push_back(label);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// index the features of the map, once it is loaded
+static void createFeatureIndex(const cCampusSceneSettings& a_settings,
+                               cCampusScene& a_scene)
+{
+    shared_ptr<cFeatureIndex> features = make_shared<cFeatureIndex>();
+    if (a_scene.m_osmMap)
+    {
+        cOsmMeshBuilder builder(*a_scene.m_osmMap, a_settings.m_osmSettings);
+        features->addOsmFeatures(*a_scene.m_osmMap, builder);
+    }
+    else
+    {
+        features->addLabels(a_scene.m_labels, a_settings.m_labelRadius);
+    }
+    features->build();
+    a_scene.m_features = features;
+}
+
+//------------------------------------------------------------------------------
+
+// build the walkable network of an OSM map
+static void createRouteGraph(cCampusScene& a_scene)
+{
+    if (!a_scene.m_osmMap)
+    {
+        return;
+    }
+    shared_ptr<cRouteGraph> graph = make_shared<cRouteGraph>();
+    if (graph->build(*a_scene.m_osmMap, a_scene.m_osmProjection))
+    {
+        cout << "Route graph: " << graph->getNumVertices() << " vertices, "
+             << graph->getNumEdges() << " edges" << endl;
+        a_scene.m_routeGraph = graph;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// create a textured patch and register its haptic texture
+static cMesh* createTextureZone(cWorld* a_world,
+                                const cCampusSceneSettings& a_settings,
+                                const cTextureZoneSettings& a_zone,
+                                map<string, shared_ptr<cHapticTextureMap> >& a_maps,
+                                cHapticTextureRenderer& a_textures)
+{
+    // create a mesh
+    cMesh* object = new cMesh();
+    object->m_name = a_zone.m_image;
+
+    // create plane
+    cCreatePlane(object, a_zone.m_width, a_zone.m_height);
+
+    // create collision detector
+    if (a_settings.m_coherentCollision)
+    {
+        cCoherentCollisionAABB::create(object, a_settings.m_toolRadius);
+    }
+    else
+    {
+        object->createAABBCollisionDetector(a_settings.m_toolRadius);
+    }
+
+    // add object to world
+    a_world->addChild(object);
+
+    // set the position of the object
+    object->setLocalPos(a_zone.m_pos);
+
+    object->rotateAboutLocalAxisDeg(0, 0, 1, a_zone.m_rotationDeg);
+
+    // set graphic properties
+    object->m_texture = cTexture2d::create();
+    if (!object->m_texture->loadFromFile(a_settings.m_assetPath + a_zone.m_image))
+    {
+        cout << "Error - Texture image failed to load correctly." << endl;
+        return (NULL);
+    }
+
+    // enable texture mapping
+    object->setUseTexture(true);
+    object->m_material->setWhite();
+
+    // bake the haptic texture, once per image
+    shared_ptr<cHapticTextureMap>& textureMap = a_maps[a_zone.m_image];
+    if (!textureMap)
+    {
+        textureMap = make_shared<cHapticTextureMap>();
+        if (!textureMap->create(*object->m_texture->m_image, cWorkerPool::getDefault(), a_settings.m_useTextureCache))
+        {
+            cout << "Error - Texture image failed to load correctly." << endl;
+            return (NULL);
+        }
+    }
+    object->computeGlobalPositions(true);
+    a_textures.addZone(object, textureMap, a_zone.m_textureLevel, a_settings.m_toolRadius);
+
+    // set haptic properties
+    object->m_material->setStiffness(a_zone.m_stiffness * a_settings.m_maxStiffness);
+    object->m_material->setStaticFriction(a_zone.m_staticFriction);
+    object->m_material->setDynamicFriction(a_zone.m_dynamicFriction);
+    object->m_material->setHapticTriangleSides(true, false);
+
+    return (object);
+}
+
+//------------------------------------------------------------------------------
+
+bool cCreateCampusScene(cWorld* a_world,
+                        const cCampusSceneSettings& a_settings,
+                        cCampusScene& a_scene)
+{
+    double toolRadius = a_settings.m_toolRadius;
+    double maxStiffness = a_settings.m_maxStiffness;
+    bool fileload;
+
+
+    /////////////////////////////////////////////////////////////////////////
+    // OBJECT 0: KTH Map - Thea, Linnéa, Kirsten
+    ////////////////////////////////////////////////////////////////////////
+
+    // create a multimesh
+    cMultiMesh* object = new cMultiMesh();
+    a_scene.m_campus = object;
+
+    // add object to world
+    a_world->addChild(object);
+
+    // set graphic properties. the loader also computes all edges of the object
+    // (adjacent triangles with more than 0 degree angle) and its collision
+    // detector, or restores both from the mesh cache
+    bool bakedMap = !a_settings.m_tileFile.empty();
+    bool osmMap = !a_settings.m_osmFile.empty();
+    if (bakedMap)
+    {
+        fileload = createBakedCampus(a_settings, a_scene);
+    }
+    else if (osmMap)
+    {
+        fileload = createOsmCampus(object, a_settings, a_scene);
+    }
+    else
+    {
+        fileload = cMeshCache::load(object, a_settings.m_assetPath + "kth_campus.obj",
+                                    toolRadius, 0, a_settings.m_useMeshCache);
+        loadLabelTable(a_settings.m_assetPath + "kth_campus.labels", a_scene.m_labels);
+    }
+    if (!fileload)
+    {
+        cout << "Error -  image failed to load correctly." << endl;
+        return (false);
+    }
+
+    // index what the tool can touch, to tell the user, and where it can walk
+    createFeatureIndex(a_settings, a_scene);
+    createRouteGraph(a_scene);
+
+    // set material of object (OSM and baked maps keep their colors)
+    if (!osmMap && !bakedMap)
+    {
+        cMaterial m;
+        m.setWhite();
+        object->setMaterial(m);
+        // object->setTransparencyLevel(0.8);
+    }
+
+    // disable culling so that faces are rendered on both sides
+    object->setUseCulling(false);
+
+    // compute a boundary box
+    object->computeBoundaryBox(true);
+
+    // show/hide boundary box
+    object->setShowBoundaryBox(false);
+
+    // center object in scene. OSM and baked maps are already centered and
+    // stand on the ground plane.
+    if (!osmMap && !bakedMap)
+    {
+        object->setLocalPos(-1.0 * object->getBoundaryCenter());
+        std::cout <<"Position: "<< object->getLocalPos() << std::endl;
+    }
+    object->setLocalPos(0.05, 0, 0.05);
+
+    // warm-start the collision queries from the last contact
+    if (a_settings.m_coherentCollision && (a_scene.m_tileSource == NULL))
+    {
+        cCoherentCollisionAABB::create(object, toolRadius);
+    }
+
+    // set line width of edges and color
+    cColorf colorEdges;
+    colorEdges.setBlack();
+    object->setEdgeProperties(1, colorEdges);
+
+    // set normal properties for display
+    cColorf colorNormals;
+    colorNormals.setOrangeTomato();
+    object->setNormalsProperties(0.01, colorNormals);
+
+    // set haptic properties
+    object->setStiffness(0.3*maxStiffness);
+
+    // display options
+    object->setShowTriangles(a_settings.m_showTriangles);
+    object->setShowEdges(a_settings.m_showEdges);
+    object->setShowNormals(a_settings.m_showNormals);
+
+    /////////////////////////////////////////////////////////////////////////
+    // OBJECT 1: Plane - Thea, Linnéa, Kirsten
+    ////////////////////////////////////////////////////////////////////////
+
+    // create a multimesh
+    cMultiMesh* object1 = new cMultiMesh();
+    a_scene.m_plane = object1;
+
+    // add object to world
+    a_world->addChild(object1);
+
+    // set the position of the object
+    object1->setLocalPos(0, 0, 0.05);
+
+    // set graphic properties, edges and collision detector
+    fileload = cMeshCache::load(object1, a_settings.m_assetPath + "kth_campus_plane.obj",
+                                toolRadius, 0, a_settings.m_useMeshCache);
+    if (!fileload)
+    {
+        cout << "Error -  image failed to load correctly." << endl;
+        return (false);
+    }
+
+    // set material of object
+    cMaterial p;
+    p.setGray();
+    object1->setMaterial(p);
+
+    if (a_settings.m_coherentCollision)
+    {
+        cCoherentCollisionAABB::create(object1, toolRadius);
+    }
+
+    // disable culling so that faces are rendered on both sides
+    object1->setUseCulling(false);
+
+    // compute a boundary box
+    object1->computeBoundaryBox(true);
+
+    // show/hide boundary box
+    object1->setShowBoundaryBox(false);
+
+    // center object in scene
+    //object1->setLocalPos(-1.0 * object->getBoundaryCenter());
+
+    // set haptic properties
+    object1->setStiffness(0.3 * maxStiffness);
+    object1->setFriction(0.5, 0.1);
+
+    // display options
+    object1->setShowTriangles(a_settings.m_showTriangles);
+    object1->setShowEdges(false);
+    object1->setShowNormals(false);
+
+
+    /////////////////////////////////////////////////////////////////////////
+    // OBJECT 2: Grass Texture - Thea, Linnéa, Kirsten
+    ////////////////////////////////////////////////////////////////////////
+
+    // the grass and any other textured zones, felt through baked texture
+    // maps instead of CHAI3D normal maps
+    a_scene.m_textures = make_shared<cHapticTextureRenderer>();
+    map<string, shared_ptr<cHapticTextureMap> > textureMaps;
+    for (size_t i=0; i<a_settings.m_textureZones.size(); i++)
+    {
+        cMesh* zone = createTextureZone(a_world, a_settings, a_settings.m_textureZones[i],
+                                        textureMaps, *a_scene.m_textures);
+        if (zone == NULL)
+        {
+            return (false);
+        }
+        a_scene.m_textureZones.push_back(zone);
+    }
+    a_scene.m_grass = a_scene.m_textureZones.empty() ? NULL : a_scene.m_textureZones[0];
+
+
+    /////////////////////////////////////////////////////////////////////////
+    // OBJECT 3: Beacon - Thea, Linnéa, Kirsten
+    ////////////////////////////////////////////////////////////////////////
+
+    // create a multimesh
+    cMultiMesh* object3 = new cMultiMesh();
+    a_scene.m_beacon = object3;
+
+    // add object to world
+    a_world->addChild(object3);
+
+    // set the position of the object
+    object3->setLocalPos(0.16, -.16, 0.055);
+
+    // set graphic properties, edges and collision detector
+    fileload = cMeshCache::load(object3, a_settings.m_assetPath + "beacon.obj",
+                                toolRadius, 0, a_settings.m_useMeshCache);
+    if (!fileload)
+    {
+        cout << "Error -  image failed to load correctly." << endl;
+        return (false);
+    }
+
+    if (a_settings.m_coherentCollision)
+    {
+        cCoherentCollisionAABB::create(object3, toolRadius);
+    }
+
+    // disable culling so that faces are rendered on both sides
+    object3->setUseCulling(false);
+
+    // compute a boundary box
+    object3->computeBoundaryBox(true);
+
+    // show/hide boundary box
+    object3->setShowBoundaryBox(false);
+
+    // set haptic properties
+    object3->setStiffness(0.005 * maxStiffness);
+
+    // display options
+    object3->setShowTriangles(a_settings.m_showTriangles);
+    object3->setShowEdges(false);
+    object3->setShowNormals(false);
+
+    return (true);
+}
@@ -0,0 +1,189 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CCampusSceneH
+#define CCampusSceneH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CFeatureIndex.h"
+#include "CHapticTextures.h"
+#include "COsmMeshBuilder.h"
+#include "CRouteGraph.h"
+#include "CTileSource.h"
+//------------------------------------------------------------------------------
+#include <memory>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// A flat patch of the map with a haptic texture, e.g. the grass field.
+//------------------------------------------------------------------------------
+struct cTextureZoneSettings
+{
+    cTextureZoneSettings(const std::string& a_image = "grass.jpg",
+                         const chai3d::cVector3d& a_pos = chai3d::cVector3d(-0.02, 0.15, 0.0501),
+                         double a_width = 0.19, double a_height = 0.14, double a_rotationDeg = -20.0) :
+        m_image(a_image),
+        m_pos(a_pos),
+        m_width(a_width),
+        m_height(a_height),
+        m_rotationDeg(a_rotationDeg),
+        m_stiffness(0.2),
+        m_staticFriction(0.2),
+        m_dynamicFriction(0.2),
+        m_textureLevel(0.075) {}
+
+    // texture image in the asset directory, shown and felt
+    std::string m_image;
+
+    // centre of the patch, its size and its rotation about the vertical axis
+    chai3d::cVector3d m_pos;
+    double m_width;
+    double m_height;
+    double m_rotationDeg;
+
+    // stiffness as a fraction of the device maximum, and friction
+    double m_stiffness;
+    double m_staticFriction;
+    double m_dynamicFriction;
+
+    // strength of the haptic texture
+    double m_textureLevel;
+};
+
+//------------------------------------------------------------------------------
+// Settings used when building the campus scene. Shared by the application and
+// the headless benchmark so that both exercise exactly the same geometry.
+//------------------------------------------------------------------------------
+struct cCampusSceneSettings
+{
+    cCampusSceneSettings() :
+        m_assetPath("image_objects/"),
+        m_toolRadius(0.005),
+        m_maxStiffness(1000.0),
+        m_showEdges(true),
+        m_showTriangles(true),
+        m_showNormals(false),
+        m_useMeshCache(true),
+        m_useTextureCache(true),
+        m_coherentCollision(true),
+        m_tileSize(0.0),
+        m_tileLevel(0),
+        m_labelRadius(0.02),
+        m_textureZones(1, cTextureZoneSettings()) {}
+
+    // directory holding the .obj and texture files
+    std::string m_assetPath;
+
+    // radius of the tool, used when building the collision trees
+    double m_toolRadius;
+
+    // maximum stiffness of the haptic device
+    double m_maxStiffness;
+
+    // display options
+    bool m_showEdges;
+    bool m_showTriangles;
+    bool m_showNormals;
+
+    // load the .obj assets through their binary caches (see cMeshCache)
+    bool m_useMeshCache;
+
+    // load the haptic texture maps through their caches (see
+    // cHapticTextureMap)
+    bool m_useTextureCache;
+
+    // start the collision queries of the meshes from the triangle touched
+    // last (see cCoherentCollisionAABB); maps loaded as tiles keep the
+    // plain trees
+    bool m_coherentCollision;
+
+    // build the map from this OpenStreetMap extract instead of kth_campus.obj
+    // (empty = use the Blender export)
+    std::string m_osmFile;
+
+    // how OSM features are turned into geometry
+    cOsmMeshSettings m_osmSettings;
+
+    // cut the OSM map into tiles of this size [world units] that are loaded
+    // around the tool (see cTileManager); 0 = build the whole map at once
+    double m_tileSize;
+
+    // load the map from a tile pyramid baked by hapmap_bake instead (empty =
+    // build the map from m_osmFile or kth_campus.obj), using this level
+    std::string m_tileFile;
+    unsigned int m_tileLevel;
+
+    // maps without OSM footprints: distance from a label anchor within
+    // which the tool touches the building [world units]
+    double m_labelRadius;
+
+    // textured patches of the map (default: the grass field). images
+    // shared by several zones are loaded once.
+    std::vector<cTextureZoneSettings> m_textureZones;
+};
+
+//------------------------------------------------------------------------------
+// The four objects that make up the campus map.
+//------------------------------------------------------------------------------
+struct cCampusScene
+{
+    cCampusScene() : m_campus(NULL), m_plane(NULL), m_grass(NULL), m_beacon(NULL) {}
+
+    // OBJECT 0: KTH map
+    chai3d::cMultiMesh* m_campus;
+
+    // OSM data the map was built from, and the mapping from geographic to
+    // local coordinates of m_campus (only set for OSM maps)
+    std::shared_ptr<cOsmMap> m_osmMap;
+    cOsmProjection m_osmProjection;
+
+    // tiles of a tiled map. m_campus is then empty and only holds the
+    // tiles that are resident.
+    std::shared_ptr<cTileSource> m_tileSource;
+
+    // names of the buildings, in local coordinates of m_campus: from the
+    // OSM name tags, the baked tiles or kth_campus.labels
+    std::vector<cTileLabel> m_labels;
+
+    // features of the map the tool can touch, in local coordinates of
+    // m_campus: OSM features, or the labels for other maps
+    std::shared_ptr<cFeatureIndex> m_features;
+
+    // walkable network of OSM maps, in local coordinates of m_campus (NULL
+    // for other maps)
+    std::shared_ptr<cRouteGraph> m_routeGraph;
+
+    // OBJECT 1: ground plane
+    chai3d::cMultiMesh* m_plane;
+
+    // OBJECT 2: grass texture, the first of the textured zones
+    chai3d::cMesh* m_grass;
+    std::vector<chai3d::cMesh*> m_textureZones;
+
+    // haptic textures of the zones
+    std::shared_ptr<cHapticTextureRenderer> m_textures;
+
+    // OBJECT 3: beacon
+    chai3d::cMultiMesh* m_beacon;
+};
+
+//------------------------------------------------------------------------------
+
+// load the campus objects and add them to the world. returns false and prints
+// an error if one of the assets could not be loaded.
+bool cCreateCampusScene(chai3d::cWorld* a_world,
+                        const cCampusSceneSettings& a_settings,
+                        cCampusScene& a_scene);
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
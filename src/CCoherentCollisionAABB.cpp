@@ -0,0 +1,435 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CCoherentCollisionAABB.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+namespace
+{
+    // last contact of the calling thread per detector, in a small table
+    // indexed by the address of the detector; a detector whose slot was
+    // taken over by another one starts again from the tree
+    const int C_NUM_CONTACT_SLOTS = 64;
+
+    struct cLastContact
+    {
+        const cCoherentCollisionAABB* m_detector;
+        int m_triangle;
+    };
+
+    thread_local cLastContact t_lastContacts[C_NUM_CONTACT_SLOTS];
+
+    inline cLastContact& lastContact(const cCoherentCollisionAABB* a_detector)
+    {
+        uintptr_t address = (uintptr_t)a_detector;
+        return (t_lastContacts[((address >> 4) ^ (address >> 10)) % C_NUM_CONTACT_SLOTS]);
+    }
+
+    // the clearance of a triangle covers a contact anywhere on it, the
+    // radius of the tool twice (contact, then the next query) and this much
+    // motion of the tool between two queries [tool radii]
+    const double C_MOTION_MARGIN = 0.5;
+
+    // the grid that finds the neighbours has at most this many cells;
+    // triangles covering more than C_MAX_CELLS_PER_TRIANGLE of them are
+    // checked against every triangle instead
+    const size_t C_MAX_CELLS = 1 << 21;
+    const size_t C_MAX_CELLS_PER_TRIANGLE = 64;
+
+    // triangles whose clearance covers more cells than this keep no
+    // neighbours and always query the tree
+    const size_t C_MAX_QUERY_CELLS = 4096;
+
+    // distance from a_point to the box a_min, a_max
+    inline double boxDistance(const double* a_point, const float* a_min, const float* a_max)
+    {
+        double distanceSq = 0.0;
+        for (int k=0; k<3; k++)
+        {
+            double d = max(max((double)a_min[k] - a_point[k], a_point[k] - (double)a_max[k]), 0.0);
+            distanceSq += d * d;
+        }
+        return (sqrt(distanceSq));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cCoherentCollisionAABB* cCoherentCollisionAABB::create(cMesh* a_mesh, double a_radius)
+{
+    cCoherentCollisionAABB* detector = new cCoherentCollisionAABB();
+
+    // take over the tree of a persistent detector, e.g. one restored from
+    // the mesh cache, rather than building it again
+    cPersistentCollisionAABB* current = dynamic_cast<cPersistentCollisionAABB*>(a_mesh->getCollisionDetector());
+    if ((current != NULL) && (current->getNumNodeRecords() > 0))
+    {
+        vector<cAABBNodeRecord> records(current->getNumNodeRecords());
+        for (int i=0; i<(int)records.size(); i++)
+        {
+            current->getNodeRecord(i, records[i]);
+        }
+        detector->restore(a_mesh->m_triangles, current->getRadius(), current->getRootIndex(),
+                          current->getMaxDepth(), records.data(), (int)records.size());
+    }
+    else
+    {
+        detector->initialize(a_mesh->m_triangles, a_radius);
+    }
+    detector->buildNeighbors(a_mesh, a_radius);
+
+    a_mesh->deleteCollisionDetector(false);
+    a_mesh->setCollisionDetector(detector);
+    return (detector);
+}
+
+//------------------------------------------------------------------------------
+
+void cCoherentCollisionAABB::create(cMultiMesh* a_object, double a_radius)
+{
+    for (unsigned int i=0; i<a_object->getNumMeshes(); i++)
+    {
+        create(a_object->getMesh(i), a_radius);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cCoherentCollisionAABB::buildNeighbors(cMesh* a_mesh, double a_radius)
+{
+    cTriangleArrayPtr triangles = a_mesh->m_triangles;
+    cVertexArrayPtr vertices = a_mesh->m_vertices;
+    int numTriangles = (int)triangles->getNumElements();
+
+    m_centroids.assign(3 * numTriangles, 0.0);
+    m_clearances.assign(numTriangles, 0.0);
+    m_first.assign(numTriangles + 1, 0);
+    m_neighbors.clear();
+
+    // bounding box, rounded outwards to float, and target clearance of every
+    // allocated triangle
+    vector<cNeighbor> boxes(numTriangles);
+    vector<double> targets(numTriangles, 0.0);
+    vector<int> allocated;
+    allocated.reserve(numTriangles);
+    float inf = numeric_limits<float>::infinity();
+    float lower[3] = { inf, inf, inf };
+    float upper[3] = { -inf, -inf, -inf };
+    for (int i=0; i<numTriangles; i++)
+    {
+        if (!triangles->getAllocated(i))
+        {
+            continue;
+        }
+        cVector3d v[3];
+        for (int k=0; k<3; k++)
+        {
+            v[k] = vertices->getLocalPos(triangles->getVertexIndex(i, k));
+        }
+        cVector3d centroid = (v[0] + v[1] + v[2]) / 3.0;
+        double extent = 0.0;
+        cNeighbor& box = boxes[i];
+        box.m_index = i;
+        for (int k=0; k<3; k++)
+        {
+            extent = max(extent, centroid.distance(v[k]));
+            m_centroids[3 * i + k] = centroid(k);
+            double low = min(v[0](k), min(v[1](k), v[2](k)));
+            double high = max(v[0](k), max(v[1](k), v[2](k)));
+            box.m_min[k] = nextafter((float)low, -inf);
+            box.m_max[k] = nextafter((float)high, inf);
+            lower[k] = min(lower[k], box.m_min[k]);
+            upper[k] = max(upper[k], box.m_max[k]);
+        }
+        targets[i] = extent + (2.0 + C_MOTION_MARGIN) * a_radius;
+        allocated.push_back(i);
+    }
+    if (allocated.empty())
+    {
+        return;
+    }
+
+    // uniform grid with cells about as large as a typical clearance
+    vector<double> sorted;
+    sorted.reserve(allocated.size());
+    for (int i : allocated)
+    {
+        sorted.push_back(targets[i]);
+    }
+    nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    double cellSize = max(sorted[sorted.size() / 2], 1e-9);
+    int dims[3];
+    for (;;)
+    {
+        size_t numCells = 1;
+        for (int k=0; k<3; k++)
+        {
+            dims[k] = (int)((upper[k] - lower[k]) / cellSize) + 1;
+            numCells *= (size_t)dims[k];
+        }
+        if (numCells <= C_MAX_CELLS)
+        {
+            break;
+        }
+        cellSize *= 2.0;
+    }
+    auto cellRange = [&](const double* a_min, const double* a_max, int* a_first, int* a_last)
+    {
+        size_t count = 1;
+        for (int k=0; k<3; k++)
+        {
+            a_first[k] = max(0, (int)floor((a_min[k] - lower[k]) / cellSize));
+            a_last[k] = min(dims[k] - 1, (int)floor((a_max[k] - lower[k]) / cellSize));
+            count *= (size_t)max(0, a_last[k] - a_first[k] + 1);
+        }
+        return (count);
+    };
+
+    // triangles of every cell, as with m_first and m_neighbors; large
+    // triangles go to their own list
+    vector<int> cellFirst((size_t)dims[0] * dims[1] * dims[2] + 1, 0);
+    vector<int> cellTriangles;
+    vector<int> large;
+    for (int pass=0; pass<2; pass++)
+    {
+        if (pass == 1)
+        {
+            for (size_t c=1; c<cellFirst.size(); c++)
+            {
+                cellFirst[c] += cellFirst[c - 1];
+            }
+            cellTriangles.resize(cellFirst.back());
+        }
+        for (int i : allocated)
+        {
+            double low[3], high[3];
+            for (int k=0; k<3; k++)
+            {
+                low[k] = boxes[i].m_min[k];
+                high[k] = boxes[i].m_max[k];
+            }
+            int first[3], last[3];
+            if (cellRange(low, high, first, last) > C_MAX_CELLS_PER_TRIANGLE)
+            {
+                if (pass == 0)
+                {
+                    large.push_back(i);
+                }
+                continue;
+            }
+            for (int z=first[2]; z<=last[2]; z++)
+            for (int y=first[1]; y<=last[1]; y++)
+            for (int x=first[0]; x<=last[0]; x++)
+            {
+                size_t cell = ((size_t)z * dims[1] + y) * dims[0] + x;
+                if (pass == 0)
+                {
+                    cellFirst[cell + 1]++;
+                }
+                else
+                {
+                    cellTriangles[--cellFirst[cell + 1]] = i;
+                }
+            }
+        }
+        if (pass == 1)
+        {
+            // the decrements above moved every start back by one cell
+            rotate(cellFirst.begin(), cellFirst.begin() + 1, cellFirst.end());
+            cellFirst.back() = (int)cellTriangles.size();
+        }
+    }
+
+    // the closest candidates of every triangle; a triangle spanning several
+    // cells is met once per cell and counted once, by the stamp
+    vector<int> stamp(numTriangles, -1);
+    vector<pair<double, int> > candidates;
+    m_neighbors.reserve(allocated.size() * 8);
+    int next = 0;
+    for (int i : allocated)
+    {
+        for (; next<=i; next++)
+        {
+            m_first[next] = (int)m_neighbors.size();
+        }
+        const double* centroid = &m_centroids[3 * i];
+        double target = targets[i];
+        double low[3], high[3];
+        for (int k=0; k<3; k++)
+        {
+            low[k] = centroid[k] - target;
+            high[k] = centroid[k] + target;
+        }
+        int first[3], last[3];
+        if (cellRange(low, high, first, last) > C_MAX_QUERY_CELLS)
+        {
+            continue;
+        }
+
+        candidates.clear();
+        auto consider = [&](int a_other)
+        {
+            if (stamp[a_other] == i)
+            {
+                return;
+            }
+            stamp[a_other] = i;
+            double distance = boxDistance(centroid, boxes[a_other].m_min, boxes[a_other].m_max);
+            if (distance < target)
+            {
+                candidates.push_back(make_pair(distance, a_other));
+            }
+        };
+        for (int z=first[2]; z<=last[2]; z++)
+        for (int y=first[1]; y<=last[1]; y++)
+        for (int x=first[0]; x<=last[0]; x++)
+        {
+            size_t cell = ((size_t)z * dims[1] + y) * dims[0] + x;
+            for (int c=cellFirst[cell]; c<cellFirst[cell + 1]; c++)
+            {
+                consider(cellTriangles[c]);
+            }
+        }
+        for (int other : large)
+        {
+            consider(other);
+        }
+
+        // keep the closest ones; a triangle left out is at least as far as
+        // the clearance, so no query within it can reach the triangle
+        double clearance = target;
+        if ((int)candidates.size() > C_MAX_NEIGHBORS)
+        {
+            nth_element(candidates.begin(), candidates.begin() + C_MAX_NEIGHBORS, candidates.end());
+            clearance = candidates[C_MAX_NEIGHBORS].first;
+            candidates.resize(C_MAX_NEIGHBORS);
+        }
+        sort(candidates.begin(), candidates.end());
+        for (size_t c=0; c<candidates.size(); c++)
+        {
+            m_neighbors.push_back(boxes[candidates[c].second]);
+        }
+        m_clearances[i] = clearance;
+    }
+    for (; next<=numTriangles; next++)
+    {
+        m_first[next] = (int)m_neighbors.size();
+    }
+    m_neighbors.shrink_to_fit();
+}
+
+//------------------------------------------------------------------------------
+
+bool cCoherentCollisionAABB::computeCollision(cGenericObject* a_object,
+                                              cVector3d& a_segmentPointA,
+                                              cVector3d& a_segmentPointB,
+                                              cCollisionRecorder& a_recorder,
+                                              cCollisionSettings& a_settings)
+{
+    double radius = a_settings.m_collisionRadius;
+    cLastContact& last = lastContact(this);
+    int triangle = (last.m_detector == this) ? last.m_triangle : -1;
+
+    bool hit = false;
+    bool coherent = false;
+    if ((triangle >= 0) && (triangle < (int)m_clearances.size()))
+    {
+        const double* centroid = &m_centroids[3 * triangle];
+        cVector3d c(centroid[0], centroid[1], centroid[2]);
+        double reach = sqrt(max(a_segmentPointA.distancesq(c), a_segmentPointB.distancesq(c))) + radius;
+        if (reach < m_clearances[triangle])
+        {
+            // box of the swept sphere
+            double low[3], high[3];
+            for (int k=0; k<3; k++)
+            {
+                low[k] = min(a_segmentPointA(k), a_segmentPointB(k)) - radius;
+                high[k] = max(a_segmentPointA(k), a_segmentPointB(k)) + radius;
+            }
+            for (int n=m_first[triangle]; n<m_first[triangle + 1]; n++)
+            {
+                const cNeighbor& neighbor = m_neighbors[n];
+                if ((neighbor.m_min[0] > high[0]) || (neighbor.m_max[0] < low[0]) ||
+                    (neighbor.m_min[1] > high[1]) || (neighbor.m_max[1] < low[1]) ||
+                    (neighbor.m_min[2] > high[2]) || (neighbor.m_max[2] < low[2]))
+                {
+                    continue;
+                }
+                if (m_elements->computeCollision(neighbor.m_index, a_object, a_segmentPointA,
+                                                 a_segmentPointB, a_recorder, a_settings))
+                {
+                    hit = true;
+                }
+            }
+            coherent = true;
+        }
+    }
+
+    // several servo threads may query the same mesh
+    if (coherent)
+    {
+        m_numCoherent.fetch_add(1, memory_order_relaxed);
+    }
+    else
+    {
+        m_numFallbacks.fetch_add(1, memory_order_relaxed);
+        hit = cCollisionAABB::computeCollision(a_object, a_segmentPointA, a_segmentPointB,
+                                               a_recorder, a_settings);
+    }
+    if (!hit)
+    {
+        return (false);
+    }
+
+    // move the last contact to the triangle that was hit, the nearest one
+    // if it is on this mesh
+    int contact = -1;
+    if (a_recorder.m_nearestCollision.m_object == a_object)
+    {
+        contact = a_recorder.m_nearestCollision.m_index;
+    }
+    else
+    {
+        for (size_t e=a_recorder.m_collisions.size(); e>0; e--)
+        {
+            if (a_recorder.m_collisions[e - 1].m_object == a_object)
+            {
+                contact = a_recorder.m_collisions[e - 1].m_index;
+                break;
+            }
+        }
+    }
+    if ((contact >= 0) && (contact < (int)m_clearances.size()))
+    {
+        last.m_detector = this;
+        last.m_triangle = contact;
+    }
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+size_t cCoherentCollisionAABB::getMemoryUsage() const
+{
+    return (m_centroids.capacity() * sizeof(double) +
+            m_clearances.capacity() * sizeof(double) +
+            m_first.capacity() * sizeof(int) +
+            m_neighbors.capacity() * sizeof(cNeighbor));
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,113 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CCoherentCollisionAABBH
+#define CCoherentCollisionAABBH
+//------------------------------------------------------------------------------
+#include "CPersistentCollisionAABB.h"
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// AABB collision detector that starts each query from the triangle the
+// calling thread touched last, instead of from the root of the tree.
+//
+// Every triangle keeps its neighbours: the triangles whose bounding boxes
+// come closer to its centroid than its clearance. These are the adjacent
+// triangles and the next ring around them, but also close triangles of
+// other parts of the mesh, such as the underside of an arch. A query whose
+// swept sphere stays within the clearance of the last contact can only hit
+// one of its neighbours, so only they are tested, with the same result as
+// the tree. Any other query walks the tree from the root as cCollisionAABB
+// does. The last contact moves to whichever triangle the query hit.
+//
+// The last contact is kept per thread, so several servo threads may query
+// the same mesh at once.
+//------------------------------------------------------------------------------
+class cCoherentCollisionAABB : public cPersistentCollisionAABB
+{
+public:
+
+    // neighbours kept per triangle at most; more crowded triangles get a
+    // smaller clearance instead
+    static const int C_MAX_NEIGHBORS = 32;
+
+    cCoherentCollisionAABB() : m_numCoherent(0), m_numFallbacks(0) {}
+    virtual ~cCoherentCollisionAABB() {}
+
+    // give a_mesh a coherent detector, taking over the tree of its current
+    // detector if that is a cPersistentCollisionAABB (e.g. restored from the
+    // mesh cache), building one otherwise. a_radius is the radius of the
+    // tool.
+    static cCoherentCollisionAABB* create(chai3d::cMesh* a_mesh, double a_radius);
+
+    // same for every mesh of a_object
+    static void create(chai3d::cMultiMesh* a_object, double a_radius);
+
+    // haptic thread: as cCollisionAABB::computeCollision()
+    virtual bool computeCollision(chai3d::cGenericObject* a_object,
+                                  chai3d::cVector3d& a_segmentPointA,
+                                  chai3d::cVector3d& a_segmentPointB,
+                                  chai3d::cCollisionRecorder& a_recorder,
+                                  chai3d::cCollisionSettings& a_settings);
+
+    // queries answered from the neighbours of the last contact, and from
+    // the tree. counted by every querying thread, read from any thread.
+    uint64_t getNumCoherent() const { return (m_numCoherent.load(std::memory_order_relaxed)); }
+    uint64_t getNumFallbacks() const { return (m_numFallbacks.load(std::memory_order_relaxed)); }
+
+    // any thread: clear both counts, e.g. after a warm-up
+    void resetStatistics()
+    {
+        m_numCoherent.store(0, std::memory_order_relaxed);
+        m_numFallbacks.store(0, std::memory_order_relaxed);
+    }
+
+    // neighbours of all triangles
+    size_t getNumNeighbors() const { return (m_neighbors.size()); }
+
+    // bytes used on top of the tree
+    size_t getMemoryUsage() const;
+
+protected:
+
+    // a neighbour and its bounding box, tested before the triangle itself
+    struct cNeighbor
+    {
+        int m_index;
+        float m_min[3];
+        float m_max[3];
+    };
+
+    // centroids, clearances and neighbours of the triangles of a_mesh
+    void buildNeighbors(chai3d::cMesh* a_mesh, double a_radius);
+
+    // centroid of each triangle
+    std::vector<double> m_centroids;
+
+    // a query reaching less than this far from the centroid of a triangle
+    // [local units] can only hit its neighbours
+    std::vector<double> m_clearances;
+
+    // neighbours of triangle i, itself included, are m_neighbors[m_first[i]]
+    // up to m_neighbors[m_first[i + 1]]
+    std::vector<int> m_first;
+    std::vector<cNeighbor> m_neighbors;
+
+    std::atomic<uint64_t> m_numCoherent;
+    std::atomic<uint64_t> m_numFallbacks;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,273 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CDistanceField.h"
+#include "CSurfaceRaster.h"
+#include "CWorkerPool.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+namespace
+{
+    // scratch space of the distance transform of one line
+    struct cLineBuffers
+    {
+        cLineBuffers(size_t a_count) : m_f(a_count), m_v(a_count), m_z(a_count + 1) {}
+
+        std::vector<float> m_f;
+        std::vector<int> m_v;
+        std::vector<float> m_z;
+    };
+
+    // squared distance transform of a line of a_count values, a_stride
+    // apart (Felzenszwalb and Huttenlocher): each value becomes the smallest
+    // (q - p)^2 + value[p] over the line. FLT_MAX marks values without a
+    // seed; a line without any seed is left as it is.
+    void transformLine(float* a_data, size_t a_count, size_t a_stride, cLineBuffers& a_buffers)
+    {
+        float* f = &a_buffers.m_f[0];
+        int* v = &a_buffers.m_v[0];
+        float* z = &a_buffers.m_z[0];
+        for (size_t q=0; q<a_count; q++)
+        {
+            f[q] = a_data[q * a_stride];
+        }
+
+        // lower envelope of the parabolas rooted at the seeds
+        int k = -1;
+        for (int q=0; q<(int)a_count; q++)
+        {
+            if (f[q] == FLT_MAX)
+            {
+                continue;
+            }
+            float s = -FLT_MAX;
+            while (k >= 0)
+            {
+                int p = v[k];
+                s = ((f[q] + (float)q * q) - (f[p] + (float)p * p)) / (float)(2 * (q - p));
+                if (s > z[k])
+                {
+                    break;
+                }
+                k--;
+            }
+            k++;
+            v[k] = q;
+            z[k] = (k == 0) ? -FLT_MAX : s;
+            z[k + 1] = FLT_MAX;
+        }
+        if (k < 0)
+        {
+            return;
+        }
+
+        int j = 0;
+        for (int q=0; q<(int)a_count; q++)
+        {
+            while (z[j + 1] < (float)q)
+            {
+                j++;
+            }
+            float d = (float)(q - v[j]);
+            a_data[q * a_stride] = d * d + f[v[j]];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cDistanceField::cDistanceField(const cDistanceFieldSettings& a_settings) :
+    m_settings(a_settings),
+    m_voxelSize(1.0),
+    m_invVoxelSize(1.0)
+{
+    for (int k=0; k<3; k++)
+    {
+        m_size[k] = 0;
+        m_origin[k] = 0.0;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool cDistanceField::build(const vector<cGenericObject*>& a_objects, cWorkerPool& a_pool)
+{
+    m_data.clear();
+
+    vector<cRasterTriangle> triangles;
+    cAppendRasterTriangles(a_objects, triangles);
+    if (triangles.empty())
+    {
+        cout << "Error - nothing to rasterize into the distance field" << endl;
+        return (false);
+    }
+
+    // field over the buildings, from the ground up, with the margin around
+    // and above them
+    double minX, minY, maxX, maxY;
+    cGetRasterBounds(triangles, minX, minY, maxX, maxY);
+    double minZ = DBL_MAX, maxZ = -DBL_MAX;
+    for (size_t i=0; i<triangles.size(); i++)
+    {
+        for (int k=0; k<3; k++)
+        {
+            minZ = cMin(minZ, triangles[i].m_z[k]);
+            maxZ = cMax(maxZ, triangles[i].m_z[k]);
+        }
+    }
+    double margin = m_settings.m_margin;
+    double extent[3] = { maxX - minX + 2.0 * margin, maxY - minY + 2.0 * margin, maxZ - minZ + margin };
+    double voxelSize = m_settings.m_voxelSize;
+    double numVoxels = (extent[0] / voxelSize) * (extent[1] / voxelSize) * (extent[2] / voxelSize);
+    if (numVoxels > m_settings.m_maxVoxels)
+    {
+        voxelSize *= cbrt(numVoxels / m_settings.m_maxVoxels);
+        cout << "Warning - distance field voxels enlarged to " << voxelSize << " to fit " << m_settings.m_maxVoxels << " voxels" << endl;
+    }
+    m_voxelSize = voxelSize;
+    m_invVoxelSize = 1.0 / voxelSize;
+    m_origin[0] = minX - margin;
+    m_origin[1] = minY - margin;
+    m_origin[2] = minZ;
+    for (int k=0; k<3; k++)
+    {
+        m_size[k] = max(2, (int)ceil(extent[k] / voxelSize));
+    }
+    int sizeX = m_size[0], sizeY = m_size[1], sizeZ = m_size[2];
+    size_t strideZ = (size_t)sizeX * sizeY;
+
+    // top of each column, and the columns that are buildings
+    vector<float> surface;
+    cRasterizeSurface(triangles, m_origin[0], m_origin[1], voxelSize, sizeX, sizeY, a_pool, surface);
+    float minTop = (float)(minZ + m_settings.m_minHeight);
+    size_t numColumns = 0;
+    for (size_t i=0; i<surface.size(); i++)
+    {
+        if (surface[i] >= minTop)
+        {
+            numColumns++;
+        }
+        else
+        {
+            surface[i] = -FLT_MAX;
+        }
+    }
+    if (numColumns == 0)
+    {
+        cout << "Error - the distance field objects have no buildings" << endl;
+        return (false);
+    }
+
+    // seeds: the building voxels for the distance outside, the empty voxels
+    // for the distance inside
+    vector<float> outside(strideZ * sizeZ);
+    vector<float> inside(strideZ * sizeZ);
+    a_pool.parallelFor((size_t)sizeZ, [&](size_t a_z)
+    {
+        float z = (float)(m_origin[2] + (a_z + 0.5) * voxelSize);
+        for (size_t i=0; i<strideZ; i++)
+        {
+            bool solid = (z < surface[i]);
+            outside[a_z * strideZ + i] = solid ? 0.0f : FLT_MAX;
+            inside[a_z * strideZ + i] = solid ? FLT_MAX : 0.0f;
+        }
+    });
+
+    // one pass per axis. x and y lines are cut by layers, z lines by rows.
+    a_pool.parallelFor((size_t)sizeZ, [&](size_t a_z)
+    {
+        cLineBuffers buffers(max(sizeX, sizeY));
+        for (int y=0; y<sizeY; y++)
+        {
+            size_t first = a_z * strideZ + (size_t)y * sizeX;
+            transformLine(&outside[first], sizeX, 1, buffers);
+            transformLine(&inside[first], sizeX, 1, buffers);
+        }
+        for (int x=0; x<sizeX; x++)
+        {
+            size_t first = a_z * strideZ + x;
+            transformLine(&outside[first], sizeY, sizeX, buffers);
+            transformLine(&inside[first], sizeY, sizeX, buffers);
+        }
+    });
+    a_pool.parallelFor((size_t)sizeY, [&](size_t a_y)
+    {
+        cLineBuffers buffers(sizeZ);
+        for (int x=0; x<sizeX; x++)
+        {
+            size_t first = a_y * sizeX + x;
+            transformLine(&outside[first], sizeZ, strideZ, buffers);
+            transformLine(&inside[first], sizeZ, strideZ, buffers);
+        }
+    });
+
+    // signed distance between voxel centres, moved by half a voxel onto the
+    // boundary between the building and the empty voxels
+    m_data.resize(strideZ * sizeZ);
+    a_pool.parallelFor((size_t)sizeZ, [&](size_t a_z)
+    {
+        for (size_t i=a_z*strideZ; i<(a_z+1)*strideZ; i++)
+        {
+            float distance = (outside[i] > 0.0f) ? sqrt(outside[i]) - 0.5f : 0.5f - sqrt(inside[i]);
+            m_data[i] = distance * (float)voxelSize;
+        }
+    });
+
+    cout << "Distance field: " << sizeX << " x " << sizeY << " x " << sizeZ << " voxels of " << voxelSize << ", "
+         << numColumns << " building columns, " << getMemoryUsage() / (1024 * 1024) << " MB" << endl;
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+cProximityRenderer::cProximityRenderer(const shared_ptr<const cDistanceField>& a_field, double a_toolRadius,
+                                       const cProximitySettings& a_settings) :
+    m_field(a_field),
+    m_toolRadius(a_toolRadius),
+    m_settings(a_settings),
+    m_distance(DBL_MAX),
+    m_force(0.0, 0.0, 0.0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void cProximityRenderer::update(const cVector3d& a_pos)
+{
+    m_force.zero();
+    double distance;
+    cVector3d gradient;
+    if (!m_field->sample(a_pos, distance, gradient))
+    {
+        m_distance = DBL_MAX;
+        return;
+    }
+    m_distance = distance - m_toolRadius;
+    if (m_distance >= m_settings.m_range)
+    {
+        return;
+    }
+
+    // away from the building, along the gradient of the field
+    double length = gradient.length();
+    if (length > 1e-9)
+    {
+        double magnitude = m_settings.m_maxForce * cMin(1.0, 1.0 - m_distance / m_settings.m_range);
+        m_force = (magnitude / length) * gradient;
+    }
+}
+
+//------------------------------------------------------------------------------
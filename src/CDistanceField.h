@@ -0,0 +1,203 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CDistanceFieldH
+#define CDistanceFieldH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <memory>
+#include <vector>
+//------------------------------------------------------------------------------
+class cWorkerPool;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+
+struct cDistanceFieldSettings
+{
+    cDistanceFieldSettings() :
+        m_voxelSize(0.002),
+        m_maxVoxels(1 << 23),
+        m_margin(0.02),
+        m_minHeight(0.003) {}
+
+    // edge length of a voxel [world units]
+    double m_voxelSize;
+
+    // largest number of voxels; the voxels grow if needed
+    int m_maxVoxels;
+
+    // room around and above the buildings covered by the field [world
+    // units]. farther away, the field has no value.
+    double m_margin;
+
+    // columns that rise less than this above the ground are not buildings
+    // (paths, flat areas) [world units]
+    double m_minHeight;
+};
+
+//------------------------------------------------------------------------------
+// Signed distance to the buildings of a static 2.5D map, sampled on a
+// regular 3D grid: positive outside, negative inside.
+//
+// build() rasterizes the objects from above, as the height field does, and
+// fills every column that rises at least m_minHeight above the lowest
+// surface from the ground up to its top. The exact Euclidean distance to
+// the filled and to the empty voxels is then computed with the separable
+// transform of Felzenszwalb and Huttenlocher, one pass per axis, each
+// pass spread over the lines of the grid.
+//
+// sample() interpolates the field trilinearly and returns its gradient
+// from the same eight voxels, so a query costs the same anywhere on the
+// map.
+//------------------------------------------------------------------------------
+class cDistanceField
+{
+public:
+
+    cDistanceField(const cDistanceFieldSettings& a_settings = cDistanceFieldSettings());
+
+    // bake the field of a_objects (cMesh or cMultiMesh, global frames up to
+    // date). returns false if they hold no buildings.
+    bool build(const std::vector<chai3d::cGenericObject*>& a_objects, cWorkerPool& a_pool);
+
+    int getSizeX() const { return (m_size[0]); }
+    int getSizeY() const { return (m_size[1]); }
+    int getSizeZ() const { return (m_size[2]); }
+    double getVoxelSize() const { return (m_voxelSize); }
+
+    // distance at the centre of a voxel [world units]
+    float getVoxel(int a_x, int a_y, int a_z) const
+    {
+        return (m_data[((size_t)a_z * m_size[1] + a_y) * m_size[0] + a_x]);
+    }
+
+    // size of the field [bytes]
+    size_t getMemoryUsage() const { return (m_data.size() * sizeof(float)); }
+
+    // distance at a_pos (global coordinates) and its gradient. returns
+    // false, leaving the results untouched, outside the voxel centres of
+    // the field.
+    inline bool sample(const chai3d::cVector3d& a_pos, double& a_distance, chai3d::cVector3d& a_gradient) const
+    {
+        double f[3];
+        int i[3];
+        float t[3];
+        for (int k=0; k<3; k++)
+        {
+            f[k] = (a_pos(k) - m_origin[k]) * m_invVoxelSize - 0.5;
+            if (!(f[k] >= 0.0) || (f[k] > (double)(m_size[k] - 1)) || (m_size[k] < 2))
+            {
+                return (false);
+            }
+            i[k] = (int)f[k];
+            if (i[k] == m_size[k] - 1) i[k]--;
+            t[k] = (float)(f[k] - i[k]);
+        }
+
+        size_t strideY = (size_t)m_size[0];
+        size_t strideZ = strideY * m_size[1];
+        const float* c000 = &m_data[i[2] * strideZ + i[1] * strideY + i[0]];
+        const float* c010 = c000 + strideY;
+        const float* c001 = c000 + strideZ;
+        const float* c011 = c001 + strideY;
+
+        // interpolate along x, then y, then z, keeping the differences for
+        // the gradient
+        float x00 = c000[0] + (c000[1] - c000[0]) * t[0];
+        float x10 = c010[0] + (c010[1] - c010[0]) * t[0];
+        float x01 = c001[0] + (c001[1] - c001[0]) * t[0];
+        float x11 = c011[0] + (c011[1] - c011[0]) * t[0];
+        float y0 = x00 + (x10 - x00) * t[1];
+        float y1 = x01 + (x11 - x01) * t[1];
+
+        float dx00 = c000[1] - c000[0];
+        float dx10 = c010[1] - c010[0];
+        float dx01 = c001[1] - c001[0];
+        float dx11 = c011[1] - c011[0];
+        float dx0 = dx00 + (dx10 - dx00) * t[1];
+        float dx1 = dx01 + (dx11 - dx01) * t[1];
+        float dy0 = x10 - x00;
+        float dy1 = x11 - x01;
+
+        a_distance = y0 + (y1 - y0) * t[2];
+        a_gradient.set((dx0 + (dx1 - dx0) * t[2]) * m_invVoxelSize,
+                       (dy0 + (dy1 - dy0) * t[2]) * m_invVoxelSize,
+                       (y1 - y0) * m_invVoxelSize);
+        return (true);
+    }
+
+private:
+
+    cDistanceFieldSettings m_settings;
+
+    // voxel (x, y, z) is centred at m_origin + (x + 0.5, y + 0.5, z + 0.5) *
+    // m_voxelSize and stored at (z * m_size[1] + y) * m_size[0] + x
+    int m_size[3];
+    double m_origin[3];
+    double m_voxelSize;
+    double m_invVoxelSize;
+    std::vector<float> m_data;
+};
+
+//------------------------------------------------------------------------------
+
+struct cProximitySettings
+{
+    cProximitySettings() :
+        m_range(0.01),
+        m_maxForce(0.5) {}
+
+    // the tool is pushed away from a building once its surface comes closer
+    // than this [world units]
+    double m_range;
+
+    // push when the tool touches the building, fading to zero at m_range [N]
+    double m_maxForce;
+};
+
+//------------------------------------------------------------------------------
+// Proximity cue from a cDistanceField: a push away from the nearest
+// building that grows as the tool approaches it. One field sample per
+// tick.
+//------------------------------------------------------------------------------
+class cProximityRenderer
+{
+public:
+
+    cProximityRenderer(const std::shared_ptr<const cDistanceField>& a_field, double a_toolRadius,
+                       const cProximitySettings& a_settings = cProximitySettings());
+
+    // haptic thread: a_pos is the proxy in global coordinates. the force is
+    // then available from getForce().
+    void update(const chai3d::cVector3d& a_pos);
+
+    // force of the last update
+    const chai3d::cVector3d& getForce() const { return (m_force); }
+
+    // distance from the surface of the tool to the nearest building at the
+    // last update [world units], negative inside, DBL_MAX outside the field
+    double getDistance() const { return (m_distance); }
+
+private:
+
+    std::shared_ptr<const cDistanceField> m_field;
+    double m_toolRadius;
+    cProximitySettings m_settings;
+
+    // haptic thread state
+    double m_distance;
+    chai3d::cVector3d m_force;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,392 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CFeatureIndex.h"
+#include "COsmMeshBuilder.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+cFeatureIndex::cFeatureIndex() :
+    m_numLeafNodes(0),
+    m_root(-1)
+{
+}
+
+//------------------------------------------------------------------------------
+
+int cFeatureIndex::addPolygon(cFeatureType a_type, int64_t a_id, const string& a_name,
+                              const vector<cVector3d>& a_ring)
+{
+    if (a_ring.size() < 3)
+    {
+        return (-1);
+    }
+
+    cFeature feature;
+    feature.m_type = a_type;
+    feature.m_id = a_id;
+    feature.m_name = a_name;
+    feature.m_first = (int)m_points.size() / 2;
+    feature.m_numPoints = (int)a_ring.size();
+    feature.m_radius = 0.0f;
+
+    cBox box;
+    box.m_min[0] = box.m_min[1] = FLT_MAX;
+    box.m_max[0] = box.m_max[1] = -FLT_MAX;
+    double area = 0.0;
+    for (size_t i=0; i<a_ring.size(); i++)
+    {
+        const cVector3d& a = a_ring[i];
+        const cVector3d& b = a_ring[(i + 1) % a_ring.size()];
+        area += a(0) * b(1) - b(0) * a(1);
+        for (int k=0; k<2; k++)
+        {
+            m_points.push_back((float)a(k));
+            box.m_min[k] = min(box.m_min[k], (float)a(k));
+            box.m_max[k] = max(box.m_max[k], (float)a(k));
+        }
+    }
+    feature.m_area = (float)fabs(0.5 * area);
+
+    m_features.push_back(feature);
+    m_featureBoxes.push_back(box);
+    return ((int)m_features.size() - 1);
+}
+
+//------------------------------------------------------------------------------
+
+int cFeatureIndex::addPoint(cFeatureType a_type, int64_t a_id, const string& a_name,
+                            const cVector3d& a_pos, double a_radius)
+{
+    cFeature feature;
+    feature.m_type = a_type;
+    feature.m_id = a_id;
+    feature.m_name = a_name;
+    feature.m_first = (int)m_points.size() / 2;
+    feature.m_numPoints = 1;
+    feature.m_radius = (float)a_radius;
+    feature.m_area = (float)(C_PI * a_radius * a_radius);
+    m_points.push_back((float)a_pos(0));
+    m_points.push_back((float)a_pos(1));
+
+    cBox box;
+    for (int k=0; k<2; k++)
+    {
+        box.m_min[k] = (float)(a_pos(k) - a_radius);
+        box.m_max[k] = (float)(a_pos(k) + a_radius);
+    }
+
+    m_features.push_back(feature);
+    m_featureBoxes.push_back(box);
+    return ((int)m_features.size() - 1);
+}
+
+//------------------------------------------------------------------------------
+
+void cFeatureIndex::addOsmFeatures(const cOsmMap& a_map, const cOsmMeshBuilder& a_builder)
+{
+    // tags that make an element worth announcing, most specific first
+    static const char* kinds[] = { "amenity", "shop", "tourism", "leisure" };
+    const int numKinds = sizeof(kinds) / sizeof(kinds[0]);
+
+    const cOsmProjection& projection = a_builder.getProjection();
+
+    // buildings, as the map shows them
+    vector<cOsmBuilding> buildings;
+    a_builder.extractBuildings(buildings);
+    for (size_t i=0; i<buildings.size(); i++)
+    {
+        const cOsmBuilding& building = buildings[i];
+        addPolygon(C_FEATURE_BUILDING, building.m_id,
+                   building.m_name.empty() ? string("building") : building.m_name, building.m_ring);
+    }
+
+    // areas that are not buildings: campus squares, parks, car parks...
+    const vector<cOsmWay>& ways = a_map.getWays();
+    vector<cVector3d> ring;
+    for (size_t i=0; i<ways.size(); i++)
+    {
+        const cOsmWay& way = ways[i];
+        if (!way.isClosed() || way.hasTag("building"))
+        {
+            continue;
+        }
+        const char* kind = NULL;
+        for (int k=0; (k<numKinds) && (kind == NULL); k++)
+        {
+            kind = way.getTag(kinds[k]);
+        }
+        if (kind == NULL)
+        {
+            continue;
+        }
+
+        ring.clear();
+        for (size_t k=0; k+1<way.m_nodeIds.size(); k++)
+        {
+            double lat, lon;
+            if (a_map.getNodeLocation(way.m_nodeIds[k], lat, lon))
+            {
+                ring.push_back(projection.toLocal(lat, lon));
+            }
+        }
+        const char* name = way.getTag("name");
+        addPolygon(C_FEATURE_AREA, way.m_id, (name != NULL) ? name : kind, ring);
+    }
+
+    // points of interest and entrances
+    const vector<cOsmNode>& nodes = a_map.getNodes();
+    for (size_t i=0; i<nodes.size(); i++)
+    {
+        const cOsmNode& node = nodes[i];
+        const char* name = node.getTag("name");
+        if (node.hasTag("entrance"))
+        {
+            addPoint(C_FEATURE_ENTRANCE, node.m_id, (name != NULL) ? name : "entrance",
+                     projection.toLocal(node.m_lat, node.m_lon), 0.0);
+            continue;
+        }
+        const char* kind = NULL;
+        for (int k=0; (k<numKinds) && (kind == NULL); k++)
+        {
+            kind = node.getTag(kinds[k]);
+        }
+        if (kind != NULL)
+        {
+            addPoint(C_FEATURE_POINT, node.m_id, (name != NULL) ? name : kind,
+                     projection.toLocal(node.m_lat, node.m_lon), 0.0);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cFeatureIndex::addLabels(const vector<cTileLabel>& a_labels, double a_radius)
+{
+    for (size_t i=0; i<a_labels.size(); i++)
+    {
+        addPoint(C_FEATURE_BUILDING, -1, a_labels[i].m_name, a_labels[i].m_pos, a_radius);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cFeatureIndex::build()
+{
+    m_nodeBoxes.clear();
+    m_nodeFirst.clear();
+    m_entries.clear();
+    m_numLeafNodes = 0;
+    m_root = -1;
+    if (m_features.empty())
+    {
+        return;
+    }
+
+    // first level: runs of features
+    vector<int> items(m_features.size());
+    for (size_t i=0; i<items.size(); i++)
+    {
+        items[i] = (int)i;
+    }
+    packLevel(items, m_featureBoxes);
+    m_numLeafNodes = (int)m_nodeBoxes.size();
+
+    // upper levels: runs of the nodes of the level below, until one is left.
+    // the boxes are copied as packLevel() appends to m_nodeBoxes.
+    while (items.size() > 1)
+    {
+        vector<cBox> boxes(m_nodeBoxes);
+        packLevel(items, boxes);
+    }
+    m_root = items[0];
+    m_nodeFirst.push_back((int)m_entries.size());
+}
+
+//------------------------------------------------------------------------------
+
+void cFeatureIndex::packLevel(vector<int>& a_items, const vector<cBox>& a_boxes)
+{
+    struct cCenterLess
+    {
+        cCenterLess(const vector<cBox>& a_boxes, int a_axis) : m_boxes(a_boxes), m_axis(a_axis) {}
+        bool operator()(int a_a, int a_b) const
+        {
+            const cBox& a = m_boxes[a_a];
+            const cBox& b = m_boxes[a_b];
+            return (a.m_min[m_axis] + a.m_max[m_axis] < b.m_min[m_axis] + b.m_max[m_axis]);
+        }
+        const vector<cBox>& m_boxes;
+        int m_axis;
+    };
+
+    // STR: sqrt(P) slices of sqrt(P) nodes each, P the number of nodes
+    size_t n = a_items.size();
+    size_t numNodes = (n + C_NODE_SIZE - 1) / C_NODE_SIZE;
+    size_t numSlices = (size_t)ceil(sqrt((double)numNodes));
+    size_t sliceSize = numSlices * C_NODE_SIZE;
+
+    sort(a_items.begin(), a_items.end(), cCenterLess(a_boxes, 0));
+    for (size_t begin=0; begin<n; begin+=sliceSize)
+    {
+        size_t end = min(n, begin + sliceSize);
+        sort(a_items.begin() + begin, a_items.begin() + end, cCenterLess(a_boxes, 1));
+    }
+
+    vector<int> nodes;
+    for (size_t begin=0; begin<n; begin+=C_NODE_SIZE)
+    {
+        size_t end = min(n, begin + C_NODE_SIZE);
+        cBox box = a_boxes[a_items[begin]];
+        m_nodeFirst.push_back((int)m_entries.size());
+        for (size_t i=begin; i<end; i++)
+        {
+            const cBox& child = a_boxes[a_items[i]];
+            for (int k=0; k<2; k++)
+            {
+                box.m_min[k] = min(box.m_min[k], child.m_min[k]);
+                box.m_max[k] = max(box.m_max[k], child.m_max[k]);
+            }
+            m_entries.push_back(a_items[i]);
+        }
+        nodes.push_back((int)m_nodeBoxes.size());
+        m_nodeBoxes.push_back(box);
+    }
+    a_items.swap(nodes);
+}
+
+//------------------------------------------------------------------------------
+
+float cFeatureIndex::getDistance2(const cFeature& a_feature, float a_x, float a_y) const
+{
+    const float* points = &m_points[2 * a_feature.m_first];
+
+    if (a_feature.m_numPoints == 1)
+    {
+        float dx = a_x - points[0];
+        float dy = a_y - points[1];
+        float distance = max(0.0f, sqrt(dx * dx + dy * dy) - a_feature.m_radius);
+        return (distance * distance);
+    }
+
+    // even-odd rule for the inside, closest edge for the outside
+    bool inside = false;
+    float distance2 = FLT_MAX;
+    int n = a_feature.m_numPoints;
+    for (int i=0, j=n-1; i<n; j=i++)
+    {
+        float ax = points[2*j], ay = points[2*j+1];
+        float bx = points[2*i], by = points[2*i+1];
+        if (((ay > a_y) != (by > a_y)) &&
+            (a_x < ax + (bx - ax) * (a_y - ay) / (by - ay)))
+        {
+            inside = !inside;
+        }
+
+        float ex = bx - ax, ey = by - ay;
+        float px = a_x - ax, py = a_y - ay;
+        float length2 = ex * ex + ey * ey;
+        float t = (length2 > 0.0f) ? max(0.0f, min(1.0f, (px * ex + py * ey) / length2)) : 0.0f;
+        float dx = px - t * ex, dy = py - t * ey;
+        distance2 = min(distance2, dx * dx + dy * dy);
+    }
+    return (inside ? 0.0f : distance2);
+}
+
+//------------------------------------------------------------------------------
+
+int cFeatureIndex::find(const cVector3d& a_pos, double a_radius) const
+{
+    if (m_root < 0)
+    {
+        return (-1);
+    }
+
+    float x = (float)a_pos(0);
+    float y = (float)a_pos(1);
+    float radius = (float)a_radius;
+    float radius2 = radius * radius;
+
+    // best candidate so far: lowest rank (entrance, point, footprint), then
+    // nearest point or smallest footprint
+    int best = -1;
+    int bestRank = 3;
+    float bestKey = FLT_MAX;
+
+    int stack[C_STACK_SIZE];
+    int size = 0;
+    stack[size++] = m_root;
+    while (size > 0)
+    {
+        int node = stack[--size];
+        int first = m_nodeFirst[node];
+        int last = m_nodeFirst[node + 1];
+
+        if (node >= m_numLeafNodes)
+        {
+            for (int i=first; (i<last) && (size<C_STACK_SIZE); i++)
+            {
+                int child = m_entries[i];
+                if (m_nodeBoxes[child].contains(x, y, radius))
+                {
+                    stack[size++] = child;
+                }
+            }
+            continue;
+        }
+
+        for (int i=first; i<last; i++)
+        {
+            int index = m_entries[i];
+            if (!m_featureBoxes[index].contains(x, y, radius))
+            {
+                continue;
+            }
+            const cFeature& feature = m_features[index];
+            int rank = (feature.m_type == C_FEATURE_ENTRANCE) ? 0 : ((feature.m_numPoints == 1) ? 1 : 2);
+            if (rank > bestRank)
+            {
+                continue;
+            }
+            float distance2 = getDistance2(feature, x, y);
+            if (distance2 > radius2)
+            {
+                continue;
+            }
+            float key = (rank < 2) ? distance2 : feature.m_area;
+            if ((rank < bestRank) || (key < bestKey))
+            {
+                best = index;
+                bestRank = rank;
+                bestKey = key;
+            }
+        }
+    }
+    return (best);
+}
+
+//------------------------------------------------------------------------------
+
+size_t cFeatureIndex::getMemoryUsage() const
+{
+    return (m_features.size() * sizeof(cFeature) +
+            m_featureBoxes.size() * sizeof(cBox) +
+            m_points.size() * sizeof(float) +
+            m_nodeBoxes.size() * sizeof(cBox) +
+            (m_nodeFirst.size() + m_entries.size()) * sizeof(int));
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,154 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CFeatureIndexH
+#define CFeatureIndexH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CTileSource.h"
+//------------------------------------------------------------------------------
+#include <stdint.h>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+class cOsmMap;
+class cOsmMeshBuilder;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+
+enum cFeatureType
+{
+    C_FEATURE_BUILDING,
+    C_FEATURE_AREA,
+    C_FEATURE_POINT,
+    C_FEATURE_ENTRANCE
+};
+
+//------------------------------------------------------------------------------
+// A feature of the map that can be announced to the user.
+//------------------------------------------------------------------------------
+struct cFeature
+{
+    cFeatureType m_type;
+
+    // OSM element id, or -1
+    int64_t m_id;
+
+    // name, or the kind of feature if it has none ("cafe", "entrance"...)
+    std::string m_name;
+
+    // footprint: m_numPoints points from m_first on. a single point is a
+    // disc of radius m_radius.
+    int m_first;
+    int m_numPoints;
+    float m_radius;
+
+    // area of the footprint; smaller areas win where footprints overlap
+    float m_area;
+};
+
+//------------------------------------------------------------------------------
+// Answers "which feature of the map is the tool touching" from the haptic
+// thread.
+//
+// Features are footprints in the xy plane of the map (buildings, amenity
+// areas) and discs (points of interest, entrances, label anchors of maps
+// without footprints). build() packs their bounding boxes into a static
+// R-tree with the Sort-Tile-Recursive method: leaves are sorted into
+// vertical slices by x and along each slice by y, so that every node is
+// full and siblings hardly overlap. The tree is stored as flat arrays,
+// level after level.
+//
+// After build() the index is read only: find() walks the tree with a
+// fixed-size stack, allocates nothing and takes no lock, so any number of
+// threads may query it.
+//------------------------------------------------------------------------------
+class cFeatureIndex
+{
+public:
+
+    cFeatureIndex();
+
+    // add features, in local coordinates of the map. must be called before
+    // build().
+    int addPolygon(cFeatureType a_type, int64_t a_id, const std::string& a_name,
+                   const std::vector<chai3d::cVector3d>& a_ring);
+    int addPoint(cFeatureType a_type, int64_t a_id, const std::string& a_name,
+                 const chai3d::cVector3d& a_pos, double a_radius);
+
+    // buildings, tagged areas, points of interest and entrances of an OSM
+    // extract, laid out by a_builder
+    void addOsmFeatures(const cOsmMap& a_map, const cOsmMeshBuilder& a_builder);
+
+    // label anchors, as discs of radius a_radius
+    void addLabels(const std::vector<cTileLabel>& a_labels, double a_radius);
+
+    // pack the tree
+    void build();
+
+    // feature touched by a tool of radius a_radius at a_pos (local
+    // coordinates of the map), or -1. entrances win over points of interest,
+    // which win over the smallest footprint within reach.
+    int find(const chai3d::cVector3d& a_pos, double a_radius) const;
+
+    int getNumFeatures() const { return ((int)m_features.size()); }
+    const cFeature& getFeature(int a_index) const { return (m_features[a_index]); }
+
+    // size of the features and the tree [bytes], names excluded
+    size_t getMemoryUsage() const;
+
+private:
+
+    // most entries of a node
+    static const int C_NODE_SIZE = 16;
+
+    // room on the stack of find(); deep enough for any tree of fewer than
+    // 16^6 features
+    static const int C_STACK_SIZE = 6 * C_NODE_SIZE;
+
+    struct cBox
+    {
+        float m_min[2];
+        float m_max[2];
+
+        bool contains(float a_x, float a_y, float a_margin) const
+        {
+            return ((a_x >= m_min[0] - a_margin) && (a_x <= m_max[0] + a_margin) &&
+                    (a_y >= m_min[1] - a_margin) && (a_y <= m_max[1] + a_margin));
+        }
+    };
+
+    // squared distance from (a_x, a_y) to a feature, 0 inside its footprint
+    float getDistance2(const cFeature& a_feature, float a_x, float a_y) const;
+
+    // sort a_items (indices into a_boxes) into slices and runs of
+    // C_NODE_SIZE, add a node per run and replace a_items by the new nodes
+    void packLevel(std::vector<int>& a_items, const std::vector<cBox>& a_boxes);
+
+    std::vector<cFeature> m_features;
+    std::vector<cBox> m_featureBoxes;
+
+    // footprint points, x and y interleaved
+    std::vector<float> m_points;
+
+    // nodes of all levels, the leaves' parents first and the root last.
+    // entries of node i are m_entries[m_nodeFirst[i] .. m_nodeFirst[i+1]]:
+    // features on the first level, nodes of the level below above it.
+    std::vector<cBox> m_nodeBoxes;
+    std::vector<int> m_nodeFirst;
+    std::vector<int> m_entries;
+    int m_numLeafNodes;
+    int m_root;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
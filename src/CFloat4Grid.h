@@ -0,0 +1,116 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CFloat4GridH
+#define CFloat4GridH
+//------------------------------------------------------------------------------
+#include <cmath>
+#include <vector>
+//------------------------------------------------------------------------------
+#if defined(__SSE2__) || defined(_M_X64)
+#define C_FLOAT4GRID_SSE
+#include <xmmintrin.h>
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Regular 2D grid with four floats per cell, sampled bilinearly. Cell (i, j)
+// is centred at origin + ((i + 0.5) * cell, (j + 0.5) * cell). The four
+// channels are interpolated together with one set of SSE operations, so a
+// sample costs the same whatever the channels hold.
+//------------------------------------------------------------------------------
+class cFloat4Grid
+{
+public:
+
+    cFloat4Grid() : m_width(0), m_height(0), m_originX(0.0), m_originY(0.0), m_cellSize(1.0), m_invCellSize(1.0) {}
+
+    // allocate a_width x a_height cells, all zero
+    void resize(int a_width, int a_height, double a_originX, double a_originY, double a_cellSize)
+    {
+        m_width = a_width;
+        m_height = a_height;
+        m_originX = a_originX;
+        m_originY = a_originY;
+        m_cellSize = a_cellSize;
+        m_invCellSize = 1.0 / a_cellSize;
+        m_data.assign(4 * (size_t)a_width * (size_t)a_height, 0.0f);
+    }
+
+    int getWidth() const { return (m_width); }
+    int getHeight() const { return (m_height); }
+    double getOriginX() const { return (m_originX); }
+    double getOriginY() const { return (m_originY); }
+    double getCellSize() const { return (m_cellSize); }
+
+    // the four channels of a cell
+    float* cell(int a_x, int a_y) { return (&m_data[4 * ((size_t)a_y * m_width + a_x)]); }
+    const float* cell(int a_x, int a_y) const { return (&m_data[4 * ((size_t)a_y * m_width + a_x)]); }
+
+    // size of the cell data [bytes]
+    size_t getMemoryUsage() const { return (m_data.size() * sizeof(float)); }
+
+    // bilinear sample at (a_x, a_y). returns false, leaving a_result
+    // untouched, outside the cell centres of the grid.
+    inline bool sample(double a_x, double a_y, float* a_result) const
+    {
+        double fx = (a_x - m_originX) * m_invCellSize - 0.5;
+        double fy = (a_y - m_originY) * m_invCellSize - 0.5;
+        if (!(fx >= 0.0) || !(fy >= 0.0) || (fx > (double)(m_width - 1)) || (fy > (double)(m_height - 1)) ||
+            (m_width < 2) || (m_height < 2))
+        {
+            return (false);
+        }
+
+        int ix = (int)fx;
+        int iy = (int)fy;
+        if (ix == m_width - 1) ix--;
+        if (iy == m_height - 1) iy--;
+        float tx = (float)(fx - ix);
+        float ty = (float)(fy - iy);
+
+        const float* c00 = cell(ix, iy);
+        const float* c01 = c00 + 4 * (size_t)m_width;
+
+#if defined(C_FLOAT4GRID_SSE)
+        __m128 v00 = _mm_loadu_ps(c00);
+        __m128 v10 = _mm_loadu_ps(c00 + 4);
+        __m128 v01 = _mm_loadu_ps(c01);
+        __m128 v11 = _mm_loadu_ps(c01 + 4);
+        __m128 wx = _mm_set1_ps(tx);
+        __m128 wy = _mm_set1_ps(ty);
+        __m128 v0 = _mm_add_ps(v00, _mm_mul_ps(_mm_sub_ps(v10, v00), wx));
+        __m128 v1 = _mm_add_ps(v01, _mm_mul_ps(_mm_sub_ps(v11, v01), wx));
+        _mm_storeu_ps(a_result, _mm_add_ps(v0, _mm_mul_ps(_mm_sub_ps(v1, v0), wy)));
+#else
+        for (int k=0; k<4; k++)
+        {
+            float v0 = c00[k] + (c00[k+4] - c00[k]) * tx;
+            float v1 = c01[k] + (c01[k+4] - c01[k]) * tx;
+            a_result[k] = v0 + (v1 - v0) * ty;
+        }
+#endif
+        return (true);
+    }
+
+private:
+
+    int m_width;
+    int m_height;
+    double m_originX;
+    double m_originY;
+    double m_cellSize;
+    double m_invCellSize;
+    std::vector<float> m_data;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,37 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CForcePipeline.h"
+//------------------------------------------------------------------------------
+using namespace chai3d;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+
+void cForceContext::set(cGenericTool* a_tool, cGenericObject* a_map, cHeightFieldRenderer* a_heightField)
+{
+    m_contactForce = a_tool->getDeviceGlobalForce();
+    m_proxy = a_tool->m_hapticPoint->getGlobalPosProxy();
+    m_inContact = (a_tool->m_hapticPoint->getNumCollisionEvents() > 0);
+    if (a_heightField != NULL)
+    {
+        m_contactForce += a_heightField->getForce();
+        if (!a_heightField->isUsingMesh())
+        {
+            m_proxy = a_heightField->getProxy();
+        }
+        m_inContact = m_inContact || a_heightField->isInContact();
+    }
+    m_mapRot = a_map->getGlobalRot();
+    m_localProxy = m_mapRot.trans() * (m_proxy - a_map->getGlobalPos());
+    m_deviceVel = a_tool->getDeviceGlobalLinVel();
+}
+
+//------------------------------------------------------------------------------
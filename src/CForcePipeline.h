@@ -0,0 +1,318 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CForcePipelineH
+#define CForcePipelineH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include "CDistanceField.h"
+#include "CHapticTextures.h"
+#include "CHeightFieldRenderer.h"
+#include "CRoutePlanner.h"
+//------------------------------------------------------------------------------
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+
+// what the force effects see of the tool each tick
+struct cForceContext
+{
+    cForceContext() : m_inContact(false) {}
+
+    // proxy in global coordinates and in those of the map, and the rotation
+    // of the map
+    chai3d::cVector3d m_proxy;
+    chai3d::cVector3d m_localProxy;
+    chai3d::cMatrix3d m_mapRot;
+
+    // force of the contacts with the map [N], and whether there are any
+    chai3d::cVector3d m_contactForce;
+    bool m_inContact;
+
+    // velocity of the device in global coordinates [m/s]
+    chai3d::cVector3d m_deviceVel;
+
+    // read the state of a_tool, after computeInteractionForces(), and of
+    // a_heightField (NULL = mesh collision) if it renders the map a_map
+    void set(chai3d::cGenericTool* a_tool, chai3d::cGenericObject* a_map, cHeightFieldRenderer* a_heightField);
+};
+
+//------------------------------------------------------------------------------
+
+struct cForceEffectSettings
+{
+    cForceEffectSettings() :
+        m_enabled(true),
+        m_gain(1.0),
+        m_maxForce(0.0) {}
+
+    // a disabled effect is not computed and adds nothing
+    bool m_enabled;
+
+    // scale of the force of the effect
+    double m_gain;
+
+    // the scaled force is saturated at this magnitude [N] (0 = no limit)
+    double m_maxForce;
+};
+
+//------------------------------------------------------------------------------
+// Base of the force effects. An effect T derives from cForceEffect<T> and
+// provides
+//
+//     chai3d::cVector3d compute(const cForceContext& a_context);
+//
+// which cForcePipeline reaches through apply() without a virtual call.
+//------------------------------------------------------------------------------
+template <typename T>
+class cForceEffect
+{
+public:
+
+    cForceEffectSettings m_settings;
+
+    // haptic thread: compute the force of the effect, scaled and saturated
+    // as m_settings says
+    inline const chai3d::cVector3d& apply(const cForceContext& a_context)
+    {
+        if (!m_settings.m_enabled)
+        {
+            m_force.zero();
+            return (m_force);
+        }
+        m_force = m_settings.m_gain * static_cast<T*>(this)->compute(a_context);
+        double maxForce = m_settings.m_maxForce;
+        if ((maxForce > 0.0) && (m_force.lengthsq() > maxForce * maxForce))
+        {
+            m_force *= maxForce / m_force.length();
+        }
+        return (m_force);
+    }
+
+    // force of the last apply()
+    const chai3d::cVector3d& getForce() const { return (m_force); }
+
+protected:
+
+    chai3d::cVector3d m_force;
+};
+
+//------------------------------------------------------------------------------
+// Constant force, by default the downward bias that keeps the tool resting
+// on the map.
+//------------------------------------------------------------------------------
+class cGravityBiasEffect : public cForceEffect<cGravityBiasEffect>
+{
+public:
+
+    cGravityBiasEffect() : m_bias(0.0, 0.0, -0.5) {}
+
+    inline chai3d::cVector3d compute(const cForceContext&) { return (m_bias); }
+
+    // [N], global coordinates
+    chai3d::cVector3d m_bias;
+};
+
+//------------------------------------------------------------------------------
+// Haptic texture of the zone under the proxy.
+//------------------------------------------------------------------------------
+class cTextureEffect : public cForceEffect<cTextureEffect>
+{
+public:
+
+    cTextureEffect() : m_renderer(NULL) {}
+
+    inline chai3d::cVector3d compute(const cForceContext& a_context)
+    {
+        if (m_renderer == NULL)
+        {
+            return (chai3d::cVector3d(0.0, 0.0, 0.0));
+        }
+        m_renderer->update(a_context.m_proxy, a_context.m_contactForce);
+        return (m_renderer->getForce());
+    }
+
+    // NULL = off
+    cHapticTextureRenderer* m_renderer;
+};
+
+//------------------------------------------------------------------------------
+// Push away from nearby buildings.
+//------------------------------------------------------------------------------
+class cProximityEffect : public cForceEffect<cProximityEffect>
+{
+public:
+
+    cProximityEffect() : m_renderer(NULL) {}
+
+    inline chai3d::cVector3d compute(const cForceContext& a_context)
+    {
+        if (m_renderer == NULL)
+        {
+            return (chai3d::cVector3d(0.0, 0.0, 0.0));
+        }
+        m_renderer->update(a_context.m_proxy);
+        return (m_renderer->getForce());
+    }
+
+    // NULL = off
+    cProximityRenderer* m_renderer;
+};
+
+//------------------------------------------------------------------------------
+// Pull along the planned route.
+//------------------------------------------------------------------------------
+class cGuidanceEffect : public cForceEffect<cGuidanceEffect>
+{
+public:
+
+    cGuidanceEffect() : m_planner(NULL) {}
+
+    inline chai3d::cVector3d compute(const cForceContext& a_context)
+    {
+        if (m_planner == NULL)
+        {
+            return (chai3d::cVector3d(0.0, 0.0, 0.0));
+        }
+        m_planner->update(a_context.m_localProxy);
+        return (a_context.m_mapRot * m_planner->getForce());
+    }
+
+    // NULL = off
+    cRoutePlanner* m_planner;
+};
+
+//------------------------------------------------------------------------------
+// Viscous damping while the tool touches the map, which calms the buzz of
+// stiff walls. Disabled until enabled in m_settings.
+//------------------------------------------------------------------------------
+class cContactDampingEffect : public cForceEffect<cContactDampingEffect>
+{
+public:
+
+    cContactDampingEffect() : m_damping(0.0) { m_settings.m_enabled = false; }
+
+    inline chai3d::cVector3d compute(const cForceContext& a_context)
+    {
+        if (!a_context.m_inContact)
+        {
+            return (chai3d::cVector3d(0.0, 0.0, 0.0));
+        }
+        return ((-m_damping) * a_context.m_deviceVel);
+    }
+
+    // [N s/m]
+    double m_damping;
+};
+
+//------------------------------------------------------------------------------
+// The force sent to the device: the contact force plus the effects, in the
+// order given, clamped to what the device can render.
+//
+// The effects are members of a tuple and are applied by a loop unrolled at
+// compile time, so a tick costs no virtual call and no allocation. Reach an
+// effect for its settings with get<cSomeEffect>().
+//------------------------------------------------------------------------------
+template <typename... Effects>
+class cForcePipeline
+{
+public:
+
+    cForcePipeline() : m_maxForce(0.0), m_clamped(false) {}
+
+    // the effect of type T
+    template <typename T>
+    T& get() { return (std::get<cIndexOf<T, Effects...>::value>(m_effects)); }
+
+    // the total force is clamped to this magnitude [N] (0 = no limit)
+    void setMaxForce(double a_maxForce) { m_maxForce = a_maxForce; }
+
+    // clamp to the largest force of a device
+    void setDeviceLimit(const chai3d::cHapticDeviceInfo& a_info) { m_maxForce = a_info.m_maxLinearForce; }
+
+    double getMaxForce() const { return (m_maxForce); }
+
+    // haptic thread: the force for the device this tick
+    inline chai3d::cVector3d compute(const cForceContext& a_context)
+    {
+        cNoObserver observer;
+        return (compute(a_context, observer));
+    }
+
+    // as above, calling a_observer(i) after effect i, e.g. to time them
+    template <typename Observer>
+    inline chai3d::cVector3d compute(const cForceContext& a_context, Observer& a_observer)
+    {
+        chai3d::cVector3d force = a_context.m_contactForce;
+        add<0>(a_context, force, a_observer);
+        m_clamped = (m_maxForce > 0.0) && (force.lengthsq() > m_maxForce * m_maxForce);
+        if (m_clamped)
+        {
+            force *= m_maxForce / force.length();
+        }
+        return (force);
+    }
+
+    // whether the last force was clamped
+    bool isClamped() const { return (m_clamped); }
+
+protected:
+
+    // index of T in Ts
+    template <typename T, typename... Ts>
+    struct cIndexOf;
+
+    template <typename T, typename... Ts>
+    struct cIndexOf<T, T, Ts...> : std::integral_constant<size_t, 0> {};
+
+    template <typename T, typename U, typename... Ts>
+    struct cIndexOf<T, U, Ts...> : std::integral_constant<size_t, 1 + cIndexOf<T, Ts...>::value> {};
+
+    struct cNoObserver
+    {
+        inline void operator()(size_t) {}
+    };
+
+    template <size_t I, typename Observer>
+    inline typename std::enable_if<(I < sizeof...(Effects))>::type add(const cForceContext& a_context,
+                                                                       chai3d::cVector3d& a_force,
+                                                                       Observer& a_observer)
+    {
+        a_force += std::get<I>(m_effects).apply(a_context);
+        a_observer(I);
+        add<I + 1>(a_context, a_force, a_observer);
+    }
+
+    template <size_t I, typename Observer>
+    inline typename std::enable_if<(I == sizeof...(Effects))>::type add(const cForceContext&,
+                                                                        chai3d::cVector3d&,
+                                                                        Observer&) {}
+
+    std::tuple<Effects...> m_effects;
+    double m_maxForce;
+    bool m_clamped;
+};
+
+//------------------------------------------------------------------------------
+
+// the effects of the map, in the order they are added to the contact force
+typedef cForcePipeline<cTextureEffect,
+                       cProximityEffect,
+                       cGuidanceEffect,
+                       cContactDampingEffect,
+                       cGravityBiasEffect> cMapForcePipeline;
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
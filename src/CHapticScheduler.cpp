@@ -0,0 +1,264 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CHapticScheduler.h"
+//------------------------------------------------------------------------------
+#if defined(LINUX)
+#include <cerrno>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+#if defined(WIN32) || defined(WIN64)
+#include <windows.h>
+#endif
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+cHapticScheduler::cHapticScheduler(double a_rate, cSchedulerMode a_mode, double a_spinMargin) :
+    m_mode(a_mode),
+    m_spinMarginNs((int64_t)(a_spinMargin * 1e9)),
+    m_deadline(0),
+    m_windowStart(0),
+    m_windowTicks(0),
+    m_resetRequested(false)
+{
+    setRate(a_rate);
+    resetStatistics();
+}
+
+//------------------------------------------------------------------------------
+
+void cHapticScheduler::setRate(double a_rate)
+{
+    if (a_rate <= 0.0)
+    {
+        return;
+    }
+    m_periodNs.store((int64_t)(1e9 / a_rate), memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+
+double cHapticScheduler::getRate() const
+{
+    return (1e9 / (double)m_periodNs.load(memory_order_relaxed));
+}
+
+//------------------------------------------------------------------------------
+
+int64_t cHapticScheduler::now()
+{
+#if defined(LINUX)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec);
+#else
+    return (chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+bool cHapticScheduler::pinCurrentThread(int a_core)
+{
+    if (a_core < 0)
+    {
+        return (false);
+    }
+#if defined(LINUX)
+    if (a_core >= CPU_SETSIZE)
+    {
+        return (false);
+    }
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(a_core, &cores);
+    return (pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) == 0);
+#elif defined(WIN32) || defined(WIN64)
+    if (a_core >= (int)(8 * sizeof(DWORD_PTR)))
+    {
+        return (false);
+    }
+    return (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << a_core) != 0);
+#else
+    return (false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void cHapticScheduler::sleepUntil(int64_t a_time) const
+{
+#if defined(LINUX)
+    struct timespec ts;
+    ts.tv_sec = (time_t)(a_time / 1000000000LL);
+    ts.tv_nsec = (long)(a_time % 1000000000LL);
+    int result;
+    do
+    {
+        // interrupted by a signal, go back to sleep
+        result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    while (result == EINTR);
+
+    // any other error returns early; the caller spins or runs the tick early
+    // rather than retrying forever. say so once.
+    static atomic<bool> reported(false);
+    if ((result != 0) && !reported.exchange(true))
+    {
+        cout << "Warning - clock_nanosleep failed (error " << result << "), haptic ticks are not paced" << endl;
+    }
+#else
+    this_thread::sleep_until(chrono::steady_clock::time_point(chrono::nanoseconds(a_time)));
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void cHapticScheduler::resetStatistics()
+{
+    m_numTicks.store(0, memory_order_relaxed);
+    m_numOverruns.store(0, memory_order_relaxed);
+    m_maxJitterNs.store(0, memory_order_relaxed);
+    for (int i=0; i<C_JITTER_BINS; i++)
+    {
+        m_histogram[i].store(0, memory_order_relaxed);
+    }
+    m_effectiveRate.store(0.0, memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+
+void cHapticScheduler::start()
+{
+    int64_t time = now();
+    m_deadline = time + m_periodNs.load(memory_order_relaxed);
+    m_windowStart = time;
+    m_windowTicks = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void cHapticScheduler::record(int64_t a_wakeTime, bool a_overrun)
+{
+    // only the haptic thread writes the counters, so plain load/store pairs
+    // are enough; readers may see a value that is one tick old
+    m_numTicks.store(m_numTicks.load(memory_order_relaxed) + 1, memory_order_relaxed);
+
+    if (a_overrun)
+    {
+        m_numOverruns.store(m_numOverruns.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+    else
+    {
+        int64_t jitter = a_wakeTime - m_deadline;
+        if (jitter < 0) jitter = 0;
+
+        int bin = (int)(jitter / C_JITTER_BIN_NS);
+        if (bin >= C_JITTER_BINS) bin = C_JITTER_BINS - 1;
+        m_histogram[bin].store(m_histogram[bin].load(memory_order_relaxed) + 1, memory_order_relaxed);
+
+        if (jitter > m_maxJitterNs.load(memory_order_relaxed))
+        {
+            m_maxJitterNs.store(jitter, memory_order_relaxed);
+        }
+    }
+
+    // effective rate over one second windows
+    m_windowTicks++;
+    int64_t window = a_wakeTime - m_windowStart;
+    if (window >= 1000000000LL)
+    {
+        m_effectiveRate.store(1e9 * (double)m_windowTicks / (double)window, memory_order_relaxed);
+        m_windowStart = a_wakeTime;
+        m_windowTicks = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cHapticScheduler::waitForNextTick()
+{
+    if (m_resetRequested.exchange(false, memory_order_acquire))
+    {
+        resetStatistics();
+    }
+
+    int64_t period = m_periodNs.load(memory_order_relaxed);
+    int64_t time = now();
+
+    if (m_mode == C_SCHEDULER_FREE_RUNNING)
+    {
+        m_deadline = time;
+        record(time, false);
+        return;
+    }
+
+    // the previous tick ran past this deadline: run now and resume on the
+    // first deadline that is still ahead, skipping the missed ones
+    if (time > m_deadline)
+    {
+        int64_t missed = (time - m_deadline) / period + 1;
+        m_deadline += missed * period;
+        record(time, true);
+        return;
+    }
+
+    if (m_mode == C_SCHEDULER_SLEEP)
+    {
+        sleepUntil(m_deadline);
+    }
+    else
+    {
+        // sleep coarsely, then spin the last stretch for a precise wake-up
+        if (m_deadline - time > m_spinMarginNs)
+        {
+            sleepUntil(m_deadline - m_spinMarginNs);
+        }
+        while (now() < m_deadline) {}
+    }
+
+    record(now(), false);
+    m_deadline += period;
+}
+
+//------------------------------------------------------------------------------
+
+double cHapticScheduler::getJitterPercentile(double a_percent) const
+{
+    uint64_t total = 0;
+    for (int i=0; i<C_JITTER_BINS; i++)
+    {
+        total += m_histogram[i].load(memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+        return (0.0);
+    }
+
+    // report the upper edge of the bin holding the percentile
+    uint64_t rank = (uint64_t)(a_percent / 100.0 * (double)total);
+    uint64_t count = 0;
+    for (int i=0; i<C_JITTER_BINS; i++)
+    {
+        count += m_histogram[i].load(memory_order_relaxed);
+        if (count > rank)
+        {
+            return (1e-9 * (double)((i + 1) * C_JITTER_BIN_NS));
+        }
+    }
+    return (1e-9 * (double)(C_JITTER_BINS * C_JITTER_BIN_NS));
+}
@@ -0,0 +1,134 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CHapticSchedulerH
+#define CHapticSchedulerH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <cstdint>
+//------------------------------------------------------------------------------
+
+// how the haptic thread waits for its next deadline
+enum cSchedulerMode
+{
+    C_SCHEDULER_FREE_RUNNING,   // no pacing, run the loop as fast as possible
+    C_SCHEDULER_SLEEP,          // sleep until the deadline
+    C_SCHEDULER_HYBRID          // sleep until shortly before the deadline, then spin
+};
+
+//------------------------------------------------------------------------------
+// Paces the haptic servo loop at a fixed rate against absolute deadlines.
+//
+// Each call to waitForNextTick() blocks until the next deadline. Lateness
+// with respect to the deadline (wake-up jitter) goes into a histogram, and a
+// tick that starts waiting after its deadline has already passed counts as
+// an overrun. Missed deadlines are skipped rather than caught up, so one slow
+// tick never causes a burst of back-to-back ticks.
+//
+// Statistics are written by the haptic thread only and may be read from any
+// other thread (e.g. to display them in the graphics loop). Other threads
+// clear them through requestReset(), which the haptic thread carries out.
+//------------------------------------------------------------------------------
+class cHapticScheduler
+{
+public:
+
+    // jitter histogram resolution
+    static const int C_JITTER_BINS = 100;
+    static const int C_JITTER_BIN_NS = 5000;
+
+    cHapticScheduler(double a_rate = 1000.0,
+                     cSchedulerMode a_mode = C_SCHEDULER_HYBRID,
+                     double a_spinMargin = 100e-6);
+
+    // servo rate [Hz]. may be changed from any thread.
+    void setRate(double a_rate);
+    double getRate() const;
+
+    // waiting strategy
+    void setMode(cSchedulerMode a_mode) { m_mode = a_mode; }
+    cSchedulerMode getMode() const { return (m_mode); }
+
+    // time spent spinning before each deadline in hybrid mode [s]
+    void setSpinMargin(double a_spinMargin) { m_spinMarginNs = (int64_t)(a_spinMargin * 1e9); }
+
+    // reset the deadline to one period from now
+    void start();
+
+    // wait for the next deadline
+    void waitForNextTick();
+
+    // measured servo rate over the last second [Hz]
+    double getEffectiveRate() const { return (m_effectiveRate.load(std::memory_order_relaxed)); }
+
+    // number of ticks since start
+    uint64_t getNumTicks() const { return (m_numTicks.load(std::memory_order_relaxed)); }
+
+    // number of deadlines that were missed
+    uint64_t getNumOverruns() const { return (m_numOverruns.load(std::memory_order_relaxed)); }
+
+    // wake-up lateness percentile from the histogram [s]
+    double getJitterPercentile(double a_percent) const;
+
+    // largest wake-up lateness seen [s]
+    double getMaxJitter() const { return (1e-9 * (double)m_maxJitterNs.load(std::memory_order_relaxed)); }
+
+    // haptic thread, or before it starts: clear counters and histogram
+    void resetStatistics();
+
+    // any thread: have the haptic thread clear the statistics at its next
+    // tick
+    void requestReset() { m_resetRequested.store(true, std::memory_order_release); }
+
+    // monotonic clock [ns]
+    static int64_t now();
+
+    // run the calling thread on a_core only. returns false if the platform
+    // does not support it or the core does not exist.
+    static bool pinCurrentThread(int a_core);
+
+protected:
+
+    // block until a_time [ns]
+    void sleepUntil(int64_t a_time) const;
+
+    // record one tick in the statistics
+    void record(int64_t a_wakeTime, bool a_overrun);
+
+    // waiting strategy
+    cSchedulerMode m_mode;
+
+    // period [ns]
+    std::atomic<int64_t> m_periodNs;
+
+    // spin margin for hybrid mode [ns]
+    int64_t m_spinMarginNs;
+
+    // next deadline [ns]
+    int64_t m_deadline;
+
+    // statistics
+    std::atomic<uint64_t> m_numTicks;
+    std::atomic<uint64_t> m_numOverruns;
+    std::atomic<int64_t> m_maxJitterNs;
+    std::atomic<uint32_t> m_histogram[C_JITTER_BINS];
+    std::atomic<double> m_effectiveRate;
+
+    // rate measurement window
+    int64_t m_windowStart;
+    uint64_t m_windowTicks;
+
+    // set by requestReset()
+    std::atomic<bool> m_resetRequested;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,709 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CHapticTextures.h"
+#include "CWorkerPool.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+namespace
+{
+    // relief of the bump normal: full white stands this many texels above
+    // full black
+    const float C_BUMP_SCALE = 4.0f;
+
+    // buckets along the longer side of the zone footprints
+    const int C_NUM_BUCKETS = 16;
+
+    // rows are processed in bands of this many rows, independent of the
+    // number of threads so that the image hash is the same on every machine
+    const int C_BAND_ROWS = 32;
+
+    //--------------------------------------------------------------------------
+    // CACHE FILE LAYOUT
+    //--------------------------------------------------------------------------
+
+    const char C_MAGIC[8] = { 'H', 'M', 'A', 'P', 'T', 'E', 'X', 'M' };
+
+    struct cTextureFileHeader
+    {
+        char m_magic[8];
+        uint32_t m_version;
+        uint32_t m_headerSize;
+        uint64_t m_fileSize;
+        uint64_t m_imageHash;
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_numLevels;
+        float m_bumpScale;
+    };
+
+    //--------------------------------------------------------------------------
+
+    // FNV-1a, eight bytes at a time
+    inline uint64_t fnv1a(uint64_t a_hash, const unsigned char* a_data, size_t a_size)
+    {
+        size_t i = 0;
+        for (; i+8<=a_size; i+=8)
+        {
+            uint64_t word;
+            memcpy(&word, a_data + i, 8);
+            a_hash = (a_hash ^ word) * 1099511628211ULL;
+        }
+        for (; i<a_size; i++)
+        {
+            a_hash = (a_hash ^ a_data[i]) * 1099511628211ULL;
+        }
+        return (a_hash);
+    }
+
+    //--------------------------------------------------------------------------
+
+    // number of pyramid levels of a width x height image
+    int countLevels(int a_width, int a_height)
+    {
+        int numLevels = 1;
+        while ((a_width > 1) || (a_height > 1))
+        {
+            a_width = (a_width + 1) / 2;
+            a_height = (a_height + 1) / 2;
+            numLevels++;
+        }
+        return (numLevels);
+    }
+
+    //--------------------------------------------------------------------------
+
+    // luminance (0..1) of row a_y into a_result
+    void convertRow(cImage& a_image, int a_y, float* a_result)
+    {
+        int width = (int)a_image.getWidth();
+        int bytesPerPixel = (int)a_image.getBytesPerPixel();
+        const unsigned char* data = a_image.getData();
+
+        if ((data != NULL) && ((bytesPerPixel == 3) || (bytesPerPixel == 4)))
+        {
+            const unsigned char* pixel = data + (size_t)a_y * width * bytesPerPixel;
+            for (int x=0; x<width; x++, pixel+=bytesPerPixel)
+            {
+                a_result[x] = (0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2]) * (1.0f / 255.0f);
+            }
+        }
+        else if ((data != NULL) && ((bytesPerPixel == 1) || (bytesPerPixel == 2)))
+        {
+            const unsigned char* pixel = data + (size_t)a_y * width * bytesPerPixel;
+            for (int x=0; x<width; x++, pixel+=bytesPerPixel)
+            {
+                a_result[x] = pixel[0] * (1.0f / 255.0f);
+            }
+        }
+        else
+        {
+            for (int x=0; x<width; x++)
+            {
+                cColorb color;
+                a_image.getPixelColor(x, a_y, color);
+                a_result[x] = (0.299f * color.getR() + 0.587f * color.getG() + 0.114f * color.getB()) * (1.0f / 255.0f);
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
+    // Sobel gradient of the luminance rows above, at and below a row (each
+    // padded with the wrapped texel on both sides), turned into the cells
+    // of the row: height, normal u, normal v, 0
+    void sobelRow(const float* a_above, const float* a_row, const float* a_below, int a_width, float* a_cells)
+    {
+        const float scale = C_BUMP_SCALE / 8.0f;
+        int x = 0;
+
+#if defined(C_FLOAT4GRID_SSE)
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 minusScale = _mm_set1_ps(-scale);
+        for (; x+4<=a_width; x+=4)
+        {
+            __m128 left0 = _mm_loadu_ps(a_above + x - 1);
+            __m128 center0 = _mm_loadu_ps(a_above + x);
+            __m128 right0 = _mm_loadu_ps(a_above + x + 1);
+            __m128 left1 = _mm_loadu_ps(a_row + x - 1);
+            __m128 center1 = _mm_loadu_ps(a_row + x);
+            __m128 right1 = _mm_loadu_ps(a_row + x + 1);
+            __m128 left2 = _mm_loadu_ps(a_below + x - 1);
+            __m128 center2 = _mm_loadu_ps(a_below + x);
+            __m128 right2 = _mm_loadu_ps(a_below + x + 1);
+
+            __m128 gu = _mm_add_ps(_mm_add_ps(_mm_sub_ps(right0, left0), _mm_mul_ps(two, _mm_sub_ps(right1, left1))),
+                                   _mm_sub_ps(right2, left2));
+            __m128 gv = _mm_sub_ps(_mm_add_ps(_mm_add_ps(left2, _mm_mul_ps(two, center2)), right2),
+                                   _mm_add_ps(_mm_add_ps(left0, _mm_mul_ps(two, center0)), right0));
+            gu = _mm_mul_ps(gu, minusScale);
+            gv = _mm_mul_ps(gv, minusScale);
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(one, _mm_add_ps(_mm_mul_ps(gu, gu), _mm_mul_ps(gv, gv))));
+
+            // four cells from four channels
+            __m128 height = center1;
+            __m128 normalU = _mm_div_ps(gu, length);
+            __m128 normalV = _mm_div_ps(gv, length);
+            __m128 zero = _mm_setzero_ps();
+            _MM_TRANSPOSE4_PS(height, normalU, normalV, zero);
+            _mm_storeu_ps(a_cells + 4 * x, height);
+            _mm_storeu_ps(a_cells + 4 * x + 4, normalU);
+            _mm_storeu_ps(a_cells + 4 * x + 8, normalV);
+            _mm_storeu_ps(a_cells + 4 * x + 12, zero);
+        }
+#endif
+
+        // same operations, one texel at a time
+        for (; x<a_width; x++)
+        {
+            float gu = ((a_above[x+1] - a_above[x-1]) + 2.0f * (a_row[x+1] - a_row[x-1])) + (a_below[x+1] - a_below[x-1]);
+            float gv = ((a_below[x-1] + 2.0f * a_below[x]) + a_below[x+1]) - ((a_above[x-1] + 2.0f * a_above[x]) + a_above[x+1]);
+            gu *= -scale;
+            gv *= -scale;
+            float length = sqrtf(1.0f + (gu * gu + gv * gv));
+            a_cells[4*x]   = a_row[x];
+            a_cells[4*x+1] = gu / length;
+            a_cells[4*x+2] = gv / length;
+            a_cells[4*x+3] = 0.0f;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// TEXTURE MAP
+//------------------------------------------------------------------------------
+
+bool cHapticTextureMap::create(cImage& a_image, cWorkerPool& a_pool, bool a_useCache, bool* a_fromCache)
+{
+    if (a_fromCache != NULL)
+    {
+        *a_fromCache = false;
+    }
+
+    int width = (int)a_image.getWidth();
+    int height = (int)a_image.getHeight();
+    if ((width < 1) || (height < 1))
+    {
+        return (false);
+    }
+    int numBands = (height + C_BAND_ROWS - 1) / C_BAND_ROWS;
+
+    // a warm start only hashes the image
+    string cacheFilename = getCacheFilename(a_image.getFilename());
+    bool useCache = a_useCache && !a_image.getFilename().empty();
+    uint64_t hash = 0;
+    if (useCache)
+    {
+        hash = hashImage(a_image, a_pool);
+        if (read(cacheFilename, hash, width, height))
+        {
+            if (a_fromCache != NULL)
+            {
+                *a_fromCache = true;
+            }
+            return (true);
+        }
+    }
+
+    // luminance, with a wrapped texel before and after every row and a
+    // wrapped row above and below the image
+    int stride = width + 2;
+    vector<float> luminance((size_t)stride * (height + 2));
+    a_pool.parallelFor(numBands, [&](size_t a_band)
+    {
+        int end = min(height, (int)(a_band + 1) * C_BAND_ROWS);
+        for (int y=(int)a_band*C_BAND_ROWS; y<end; y++)
+        {
+            float* row = &luminance[(size_t)(y + 1) * stride + 1];
+            convertRow(a_image, y, row);
+            row[-1] = row[width - 1];
+            row[width] = row[0];
+        }
+    });
+    copy(&luminance[(size_t)height * stride], &luminance[(size_t)(height + 1) * stride], &luminance[0]);
+    copy(&luminance[(size_t)stride], &luminance[(size_t)2 * stride], &luminance[(size_t)(height + 1) * stride]);
+
+    // level 0: one extra row and column, copies of the first ones, so that
+    // bilinear samples wrap around without a branch
+    m_levels.assign(countLevels(width, height), cFloat4Grid());
+    m_levels[0].resize(width + 1, height + 1, -0.5, -0.5, 1.0);
+    a_pool.parallelFor(numBands, [&](size_t a_band)
+    {
+        int end = min(height, (int)(a_band + 1) * C_BAND_ROWS);
+        for (int y=(int)a_band*C_BAND_ROWS; y<end; y++)
+        {
+            const float* row = &luminance[(size_t)(y + 1) * stride + 1];
+            sobelRow(row - stride, row, row + stride, width, m_levels[0].cell(0, y));
+        }
+    });
+    wrapEdges(m_levels[0]);
+
+    // prefiltered levels, down to a single texel: box filter of the level
+    // below, wrapping around odd sizes. averaging the normals shortens them
+    // where bumps cancel out, which is what smooths the force.
+    for (size_t level=1; level<m_levels.size(); level++)
+    {
+        const cFloat4Grid& fine = m_levels[level - 1];
+        int fineWidth = width;
+        int fineHeight = height;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+
+        cFloat4Grid& coarse = m_levels[level];
+        coarse.resize(width + 1, height + 1, -0.5, -0.5, 1.0);
+        a_pool.parallelFor((height + C_BAND_ROWS - 1) / C_BAND_ROWS, [&](size_t a_band)
+        {
+            int end = min(height, (int)(a_band + 1) * C_BAND_ROWS);
+            for (int y=(int)a_band*C_BAND_ROWS; y<end; y++)
+            {
+                const float* row0 = fine.cell(0, (2 * y) % fineHeight);
+                const float* row1 = fine.cell(0, (2 * y + 1) % fineHeight);
+                float* cell = coarse.cell(0, y);
+                for (int x=0; x<width; x++, cell+=4)
+                {
+                    int x0 = 4 * ((2 * x) % fineWidth);
+                    int x1 = 4 * ((2 * x + 1) % fineWidth);
+                    for (int k=0; k<4; k++)
+                    {
+                        cell[k] = 0.25f * ((row0[x0+k] + row0[x1+k]) + (row1[x0+k] + row1[x1+k]));
+                    }
+                }
+            }
+        });
+        wrapEdges(coarse);
+    }
+
+    if (useCache && !write(cacheFilename, hash))
+    {
+        cout << "Warning - could not write texture cache " << cacheFilename << endl;
+    }
+
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+string cHapticTextureMap::getCacheFilename(const string& a_imageFilename)
+{
+    return (a_imageFilename + ".htex");
+}
+
+//------------------------------------------------------------------------------
+
+uint64_t cHapticTextureMap::hashImage(cImage& a_image, cWorkerPool& a_pool)
+{
+    // FNV-1a of every band of rows, in parallel, then of the band hashes
+    int width = (int)a_image.getWidth();
+    int height = (int)a_image.getHeight();
+    int numBands = (height + C_BAND_ROWS - 1) / C_BAND_ROWS;
+    size_t rowSize = (size_t)width * a_image.getBytesPerPixel();
+    const unsigned char* data = a_image.getData();
+
+    vector<uint64_t> bandHashes(numBands, 1469598103934665603ULL);
+    a_pool.parallelFor(numBands, [&](size_t a_band)
+    {
+        int end = min(height, (int)(a_band + 1) * C_BAND_ROWS);
+        int begin = (int)a_band * C_BAND_ROWS;
+        if (data != NULL)
+        {
+            bandHashes[a_band] = fnv1a(bandHashes[a_band], data + begin * rowSize, (end - begin) * rowSize);
+            return;
+        }
+        for (int y=begin; y<end; y++)
+        {
+            for (int x=0; x<width; x++)
+            {
+                cColorb color;
+                a_image.getPixelColor(x, y, color);
+                unsigned char rgb[3] = { color.getR(), color.getG(), color.getB() };
+                bandHashes[a_band] = fnv1a(bandHashes[a_band], rgb, 3);
+            }
+        }
+    });
+
+    uint32_t size[3] = { (uint32_t)width, (uint32_t)height, a_image.getBytesPerPixel() };
+    uint64_t hash = fnv1a(1469598103934665603ULL, (const unsigned char*)size, sizeof(size));
+    return (fnv1a(hash, (const unsigned char*)&bandHashes[0], bandHashes.size() * sizeof(uint64_t)));
+}
+
+//------------------------------------------------------------------------------
+
+bool cHapticTextureMap::read(const string& a_filename, uint64_t a_hash, int a_width, int a_height)
+{
+    // read straight into the levels: mapping the file would fault in every
+    // page only to copy it again
+    ifstream in(a_filename.c_str(), ios::binary);
+    if (!in)
+    {
+        return (false);
+    }
+    in.seekg(0, ios::end);
+    uint64_t fileSize = (uint64_t)in.tellg();
+    in.seekg(0, ios::beg);
+
+    cTextureFileHeader header;
+    int numLevels = countLevels(a_width, a_height);
+    if (!in.read((char*)&header, sizeof(header)) ||
+        (memcmp(header.m_magic, C_MAGIC, sizeof(C_MAGIC)) != 0) ||
+        (header.m_version != C_VERSION) ||
+        (header.m_headerSize != sizeof(cTextureFileHeader)) ||
+        (header.m_fileSize != fileSize) ||
+        (header.m_imageHash != a_hash) ||
+        (header.m_width != (uint32_t)a_width) ||
+        (header.m_height != (uint32_t)a_height) ||
+        (header.m_numLevels != (uint32_t)numLevels) ||
+        (header.m_bumpScale != C_BUMP_SCALE))
+    {
+        return (false);
+    }
+
+    // the levels follow the header back to back
+    vector<cFloat4Grid> levels(numLevels);
+    uint64_t size = sizeof(cTextureFileHeader);
+    int width = a_width;
+    int height = a_height;
+    for (int i=0; i<numLevels; i++)
+    {
+        levels[i].resize(width + 1, height + 1, -0.5, -0.5, 1.0);
+        size += levels[i].getMemoryUsage();
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+    if (size != fileSize)
+    {
+        return (false);
+    }
+    for (int i=0; i<numLevels; i++)
+    {
+        if (!in.read((char*)levels[i].cell(0, 0), levels[i].getMemoryUsage()))
+        {
+            return (false);
+        }
+    }
+
+    m_levels.swap(levels);
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cHapticTextureMap::write(const string& a_filename, uint64_t a_hash) const
+{
+    cTextureFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, C_MAGIC, sizeof(C_MAGIC));
+    header.m_version = C_VERSION;
+    header.m_headerSize = sizeof(cTextureFileHeader);
+    header.m_fileSize = sizeof(cTextureFileHeader) + getMemoryUsage();
+    header.m_imageHash = a_hash;
+    header.m_width = (uint32_t)getWidth();
+    header.m_height = (uint32_t)getHeight();
+    header.m_numLevels = (uint32_t)m_levels.size();
+    header.m_bumpScale = C_BUMP_SCALE;
+
+    // write to a temporary file and rename it, so that a reader never sees a
+    // partially written cache
+    string tempFilename = a_filename + ".tmp";
+    ofstream out(tempFilename.c_str(), ios::binary | ios::trunc);
+    if (!out)
+    {
+        return (false);
+    }
+    out.write((const char*)&header, sizeof(header));
+    for (size_t i=0; i<m_levels.size(); i++)
+    {
+        out.write((const char*)m_levels[i].cell(0, 0), m_levels[i].getMemoryUsage());
+    }
+    out.close();
+
+    if (!out || (rename(tempFilename.c_str(), a_filename.c_str()) != 0))
+    {
+        remove(tempFilename.c_str());
+        return (false);
+    }
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void cHapticTextureMap::wrapEdges(cFloat4Grid& a_grid)
+{
+    int width = a_grid.getWidth() - 1;
+    int height = a_grid.getHeight() - 1;
+    for (int y=0; y<height; y++)
+    {
+        copy(a_grid.cell(0, y), a_grid.cell(0, y) + 4, a_grid.cell(width, y));
+    }
+    copy(a_grid.cell(0, 0), a_grid.cell(0, 0) + 4 * (width + 1), a_grid.cell(0, height));
+}
+
+//------------------------------------------------------------------------------
+
+size_t cHapticTextureMap::getMemoryUsage() const
+{
+    size_t size = 0;
+    for (size_t i=0; i<m_levels.size(); i++)
+    {
+        size += m_levels[i].getMemoryUsage();
+    }
+    return (size);
+}
+
+
+//------------------------------------------------------------------------------
+// RENDERER
+//------------------------------------------------------------------------------
+
+cHapticTextureRenderer::cHapticTextureRenderer() :
+    m_bucketMinX(0.0),
+    m_bucketMinY(0.0),
+    m_bucketSize(1.0),
+    m_numBucketsX(0),
+    m_numBucketsY(0),
+    m_servoRate(1000.0),
+    m_velocityCutoff(20.0),
+    m_activeZone(-1),
+    m_level(0.0),
+    m_hasLastProxy(false)
+{
+    m_force.zero();
+    m_lastProxy.zero();
+    m_velocity.zero();
+}
+
+//------------------------------------------------------------------------------
+
+bool cHapticTextureRenderer::addZone(cMesh* a_mesh, const shared_ptr<cHapticTextureMap>& a_map,
+                                     double a_level, double a_toolRadius)
+{
+    if ((a_mesh->getNumTriangles() == 0) || !a_map)
+    {
+        return (false);
+    }
+
+    cVector3d pos = a_mesh->getGlobalPos();
+    cMatrix3d rot = a_mesh->getGlobalRot();
+
+    // the mapping from positions to texture coordinates, from the first
+    // triangle: p = p0 + (u - u0) * eu + (v - v0) * ev
+    unsigned int i0 = a_mesh->m_triangles->getVertexIndex0(0);
+    unsigned int i1 = a_mesh->m_triangles->getVertexIndex1(0);
+    unsigned int i2 = a_mesh->m_triangles->getVertexIndex2(0);
+    cVector3d p0 = pos + rot * a_mesh->m_vertices->getLocalPos(i0);
+    cVector3d e1 = pos + rot * a_mesh->m_vertices->getLocalPos(i1) - p0;
+    cVector3d e2 = pos + rot * a_mesh->m_vertices->getLocalPos(i2) - p0;
+    cVector3d t0 = a_mesh->m_vertices->getTexCoord(i0);
+    cVector3d t1 = a_mesh->m_vertices->getTexCoord(i1) - t0;
+    cVector3d t2 = a_mesh->m_vertices->getTexCoord(i2) - t0;
+
+    double det = t1(0) * t2(1) - t2(0) * t1(1);
+    if (fabs(det) < 1e-12)
+    {
+        cout << "Warning - " << a_mesh->m_name << " has no texture coordinates, no haptic texture" << endl;
+        return (false);
+    }
+    cVector3d eu = (t2(1) * e1 - t1(1) * e2) / det;
+    cVector3d ev = (t1(0) * e2 - t2(0) * e1) / det;
+
+    // dual basis: dot(du, eu) = 1, dot(du, ev) = 0 and the other way round
+    double guu = eu.dot(eu);
+    double guv = eu.dot(ev);
+    double gvv = ev.dot(ev);
+    double gdet = guu * gvv - guv * guv;
+    if (gdet < 1e-24)
+    {
+        return (false);
+    }
+
+    cZone zone;
+    zone.m_mesh = a_mesh;
+    zone.m_map = a_map;
+    zone.m_level = a_level;
+    zone.m_origin = p0 - t0(0) * eu - t0(1) * ev;
+    zone.m_du = (gvv * eu - guv * ev) / gdet;
+    zone.m_dv = (guu * ev - guv * eu) / gdet;
+    zone.m_tangentU = eu;
+    zone.m_tangentU.normalize();
+    zone.m_tangentV = ev;
+    zone.m_tangentV.normalize();
+    e1.crossr(e2, zone.m_normal);
+    zone.m_normal.normalize();
+    zone.m_reach = 1.1 * a_toolRadius;
+
+    zone.m_minU = zone.m_minV = zone.m_minX = zone.m_minY = DBL_MAX;
+    zone.m_maxU = zone.m_maxV = zone.m_maxX = zone.m_maxY = -DBL_MAX;
+    for (unsigned int i=0; i<a_mesh->getNumVertices(); i++)
+    {
+        cVector3d vertex = pos + rot * a_mesh->m_vertices->getLocalPos(i);
+        cVector3d texCoord = a_mesh->m_vertices->getTexCoord(i);
+        zone.m_minU = cMin(zone.m_minU, texCoord(0));
+        zone.m_maxU = cMax(zone.m_maxU, texCoord(0));
+        zone.m_minV = cMin(zone.m_minV, texCoord(1));
+        zone.m_maxV = cMax(zone.m_maxV, texCoord(1));
+        zone.m_minX = cMin(zone.m_minX, vertex(0) - a_toolRadius);
+        zone.m_maxX = cMax(zone.m_maxX, vertex(0) + a_toolRadius);
+        zone.m_minY = cMin(zone.m_minY, vertex(1) - a_toolRadius);
+        zone.m_maxY = cMax(zone.m_maxY, vertex(1) + a_toolRadius);
+    }
+
+    m_zones.push_back(zone);
+    buildBuckets();
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void cHapticTextureRenderer::buildBuckets()
+{
+    m_bucketMinX = m_bucketMinY = DBL_MAX;
+    double maxX = -DBL_MAX;
+    double maxY = -DBL_MAX;
+    for (size_t i=0; i<m_zones.size(); i++)
+    {
+        m_bucketMinX = cMin(m_bucketMinX, m_zones[i].m_minX);
+        m_bucketMinY = cMin(m_bucketMinY, m_zones[i].m_minY);
+        maxX = cMax(maxX, m_zones[i].m_maxX);
+        maxY = cMax(maxY, m_zones[i].m_maxY);
+    }
+    m_bucketSize = cMax(maxX - m_bucketMinX, maxY - m_bucketMinY) / (double)C_NUM_BUCKETS;
+    m_numBucketsX = max(1, (int)ceil((maxX - m_bucketMinX) / m_bucketSize));
+    m_numBucketsY = max(1, (int)ceil((maxY - m_bucketMinY) / m_bucketSize));
+
+    // count, then fill each bucket with the zones overlapping it
+    int numBuckets = m_numBucketsX * m_numBucketsY;
+    m_bucketStart.assign(numBuckets + 1, 0);
+    for (int pass=0; pass<2; pass++)
+    {
+        vector<int> fill(m_bucketStart.begin(), m_bucketStart.end() - 1);
+        for (size_t i=0; i<m_zones.size(); i++)
+        {
+            const cZone& zone = m_zones[i];
+            int x0 = max(0, (int)floor((zone.m_minX - m_bucketMinX) / m_bucketSize));
+            int x1 = min(m_numBucketsX - 1, (int)floor((zone.m_maxX - m_bucketMinX) / m_bucketSize));
+            int y0 = max(0, (int)floor((zone.m_minY - m_bucketMinY) / m_bucketSize));
+            int y1 = min(m_numBucketsY - 1, (int)floor((zone.m_maxY - m_bucketMinY) / m_bucketSize));
+            for (int y=y0; y<=y1; y++)
+            {
+                for (int x=x0; x<=x1; x++)
+                {
+                    int bucket = y * m_numBucketsX + x;
+                    if (pass == 0)
+                    {
+                        m_bucketStart[bucket + 1]++;
+                    }
+                    else
+                    {
+                        m_bucketZones[fill[bucket]++] = (int)i;
+                    }
+                }
+            }
+        }
+        if (pass == 0)
+        {
+            for (int i=0; i<numBuckets; i++)
+            {
+                m_bucketStart[i + 1] += m_bucketStart[i];
+            }
+            m_bucketZones.assign(m_bucketStart[numBuckets], 0);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+int cHapticTextureRenderer::findZone(const cVector3d& a_proxy) const
+{
+    int x = (int)floor((a_proxy(0) - m_bucketMinX) / m_bucketSize);
+    int y = (int)floor((a_proxy(1) - m_bucketMinY) / m_bucketSize);
+    if ((x < 0) || (y < 0) || (x >= m_numBucketsX) || (y >= m_numBucketsY))
+    {
+        return (-1);
+    }
+
+    int bucket = y * m_numBucketsX + x;
+    for (int i=m_bucketStart[bucket]; i<m_bucketStart[bucket + 1]; i++)
+    {
+        const cZone& zone = m_zones[m_bucketZones[i]];
+        cVector3d offset = a_proxy - zone.m_origin;
+        double height = offset.dot(zone.m_normal);
+        if ((height < 0.0) || (height > zone.m_reach))
+        {
+            continue;
+        }
+        double u = offset.dot(zone.m_du);
+        double v = offset.dot(zone.m_dv);
+        if ((u >= zone.m_minU) && (u <= zone.m_maxU) && (v >= zone.m_minV) && (v <= zone.m_maxV))
+        {
+            return (m_bucketZones[i]);
+        }
+    }
+    return (-1);
+}
+
+//------------------------------------------------------------------------------
+
+void cHapticTextureRenderer::update(const cVector3d& a_proxy, const cVector3d& a_force)
+{
+    // low-pass filtered proxy velocity, so that the level does not follow
+    // the jitter of the proxy
+    if (m_hasLastProxy)
+    {
+        double alpha = 1.0 - exp(-2.0 * C_PI * m_velocityCutoff / m_servoRate);
+        m_velocity += alpha * ((a_proxy - m_lastProxy) * m_servoRate - m_velocity);
+    }
+    m_lastProxy = a_proxy;
+    m_hasLastProxy = true;
+
+    m_force.zero();
+    m_activeZone = m_zones.empty() ? -1 : findZone(a_proxy);
+    if (m_activeZone < 0)
+    {
+        return;
+    }
+
+    const cZone& zone = m_zones[m_activeZone];
+    double normalForce = a_force.dot(zone.m_normal);
+    if (normalForce <= 0.0)
+    {
+        return;
+    }
+
+    // texels of the full resolution level travelled per tick. a texel of
+    // level log2(step) is as large as the step, so the samples of
+    // successive ticks never skip a bump of the level they read.
+    const cHapticTextureMap& map = *zone.m_map;
+    double stepU = m_velocity.dot(zone.m_du) * map.getWidth() / m_servoRate;
+    double stepV = m_velocity.dot(zone.m_dv) * map.getHeight() / m_servoRate;
+    double step = sqrt(stepU * stepU + stepV * stepV);
+    m_level = (step > 1.0) ? log2(step) : 0.0;
+
+    // tilt the contact force by the bump normal of the texture
+    cVector3d offset = a_proxy - zone.m_origin;
+    float sample[4];
+    map.sample(offset.dot(zone.m_du), offset.dot(zone.m_dv), m_level, sample);
+    m_force = (normalForce * zone.m_level) * ((double)sample[1] * zone.m_tangentU + (double)sample[2] * zone.m_tangentV);
+}
+
+//------------------------------------------------------------------------------
+
+cMesh* cHapticTextureRenderer::getActiveZone() const
+{
+    return ((m_activeZone < 0) ? NULL : m_zones[m_activeZone].m_mesh);
+}
@@ -0,0 +1,241 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CHapticTexturesH
+#define CHapticTexturesH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CFloat4Grid.h"
+//------------------------------------------------------------------------------
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+class cWorkerPool;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Haptic relief of an image, baked once at load time. Each texel holds its
+// height (luminance, 0..1) and the tangential part of the bump normal along
+// u and v, so that the force path only does bilinear SSE samples instead of
+// reading and filtering image pixels.
+//
+// The map is a mip pyramid: each level averages 2x2 texels of the one
+// below, so that bumps smaller than the distance the proxy travels in one
+// servo tick are smoothed out instead of aliasing.
+//
+// Baking runs on a worker pool, in bands of rows, with SSE Sobel kernels.
+// The result is cached next to the image (<image>.htex), keyed by a hash
+// of its pixels, so a warm start only hashes the decoded image.
+//------------------------------------------------------------------------------
+class cHapticTextureMap
+{
+public:
+
+    // current cache format version; bump when the layout or the filters
+    // change
+    static const unsigned int C_VERSION = 1;
+
+    // bake the pyramid of a_image on a_pool, going through the cache when
+    // a_useCache is set and the image has a filename. a_fromCache reports
+    // whether the cache was hit. returns false if the image is empty.
+    bool create(chai3d::cImage& a_image, cWorkerPool& a_pool, bool a_useCache = true, bool* a_fromCache = NULL);
+
+    int getNumLevels() const { return ((int)m_levels.size()); }
+
+    // size of a level [texels]
+    int getWidth(int a_level = 0) const { return (m_levels[a_level].getWidth() - 1); }
+    int getHeight(int a_level = 0) const { return (m_levels[a_level].getHeight() - 1); }
+
+    // sample at texture coordinates (a_u, a_v), repeating the image outside
+    // [0, 1], blending the two levels around a_level (0 = full resolution):
+    // height, normal u, normal v, unused
+    inline void sample(double a_u, double a_v, double a_level, float* a_result) const
+    {
+        int numLevels = getNumLevels();
+        if (!(a_level > 0.0) || (numLevels < 2))
+        {
+            sampleLevel(0, a_u, a_v, a_result);
+            return;
+        }
+        if (a_level >= (double)(numLevels - 1))
+        {
+            sampleLevel(numLevels - 1, a_u, a_v, a_result);
+            return;
+        }
+
+        int level = (int)a_level;
+        float t = (float)(a_level - level);
+        float coarse[4];
+        sampleLevel(level, a_u, a_v, a_result);
+        sampleLevel(level + 1, a_u, a_v, coarse);
+        for (int k=0; k<4; k++)
+        {
+            a_result[k] += (coarse[k] - a_result[k]) * t;
+        }
+    }
+
+    // sample one level
+    inline void sampleLevel(int a_level, double a_u, double a_v, float* a_result) const
+    {
+        // texel i is centred at u = (i + 0.5) / width, which is cell i of
+        // the grid; the last row and column repeat the first ones
+        const cFloat4Grid& grid = m_levels[a_level];
+        double w = (double)(grid.getWidth() - 1);
+        double h = (double)(grid.getHeight() - 1);
+        double x = a_u * w - 0.5;
+        double y = a_v * h - 0.5;
+        x -= floor(x / w) * w;
+        y -= floor(y / h) * h;
+        if (!grid.sample(x, y, a_result))
+        {
+            a_result[0] = a_result[1] = a_result[2] = a_result[3] = 0.0f;
+        }
+    }
+
+    const cFloat4Grid& getGrid(int a_level = 0) const { return (m_levels[a_level]); }
+
+    // size of all levels [bytes]
+    size_t getMemoryUsage() const;
+
+    // cache file used for an image
+    static std::string getCacheFilename(const std::string& a_imageFilename);
+
+private:
+
+    // hash of the pixels of a_image, computed on a_pool
+    static uint64_t hashImage(chai3d::cImage& a_image, cWorkerPool& a_pool);
+
+    // restore the pyramid from a cache file. returns false if it is missing,
+    // stale or corrupt.
+    bool read(const std::string& a_filename, uint64_t a_hash, int a_width, int a_height);
+
+    // write the pyramid to a cache file
+    bool write(const std::string& a_filename, uint64_t a_hash) const;
+
+    // copy the first row and column of a level into its wrap row and column
+    static void wrapEdges(cFloat4Grid& a_grid);
+
+    std::vector<cFloat4Grid> m_levels;
+};
+
+//------------------------------------------------------------------------------
+// Renders the haptic textures of flat, textured zones of the scene (grass,
+// sand, stone...). Replaces the CHAI3D normal map, which reads the image in
+// every contact tick.
+//
+// Zones are looked up in a coarse grid over their footprints, so a tick
+// costs one bucket lookup, a point-in-zone test for the zones in the bucket
+// (usually one) and two bilinear samples of the pyramid, however many zones
+// there are. The pyramid level follows the filtered proxy velocity: one
+// texel of the level sampled spans the distance the proxy travels per tick.
+//------------------------------------------------------------------------------
+class cHapticTextureRenderer
+{
+public:
+
+    cHapticTextureRenderer();
+
+    // add a flat, textured mesh (global frame up to date). a_level scales the
+    // tangential force relative to the normal contact force, as the texture
+    // level of a CHAI3D material does. returns false if the mesh has no
+    // texture coordinates to map the image with.
+    bool addZone(chai3d::cMesh* a_mesh, const std::shared_ptr<cHapticTextureMap>& a_map,
+                 double a_level, double a_toolRadius);
+
+    int getNumZones() const { return ((int)m_zones.size()); }
+
+    // servo rate the proxy is sampled at [Hz], which sets how far apart the
+    // texture samples of a moving proxy are
+    void setServoRate(double a_rate) { m_servoRate = a_rate; }
+
+    // cutoff of the low-pass filter on the proxy velocity [Hz]
+    void setVelocityCutoff(double a_cutoff) { m_velocityCutoff = a_cutoff; }
+
+    // haptic thread: a_proxy is the centre of the tool sphere, a_force the
+    // contact force rendered this tick. the texture force to add is then
+    // available from getForce().
+    void update(const chai3d::cVector3d& a_proxy, const chai3d::cVector3d& a_force);
+
+    // texture force of the last update
+    const chai3d::cVector3d& getForce() const { return (m_force); }
+
+    // mesh of the zone touched in the last update, or NULL
+    chai3d::cMesh* getActiveZone() const;
+
+    // pyramid level sampled in the last update
+    double getLevel() const { return (m_level); }
+
+private:
+
+    struct cZone
+    {
+        chai3d::cMesh* m_mesh;
+        std::shared_ptr<cHapticTextureMap> m_map;
+        double m_level;
+
+        // texture coordinates of a global position p:
+        // u = dot(p - m_origin, m_du), v = dot(p - m_origin, m_dv)
+        chai3d::cVector3d m_origin;
+        chai3d::cVector3d m_du;
+        chai3d::cVector3d m_dv;
+
+        // unit vectors along u and v and the surface normal
+        chai3d::cVector3d m_tangentU;
+        chai3d::cVector3d m_tangentV;
+        chai3d::cVector3d m_normal;
+
+        // range of texture coordinates covered by the mesh
+        double m_minU, m_maxU;
+        double m_minV, m_maxV;
+
+        // footprint in the xy plane
+        double m_minX, m_maxX;
+        double m_minY, m_maxY;
+
+        // largest distance of the tool centre from the plane in contact
+        double m_reach;
+    };
+
+    // zone at a_proxy, or -1
+    int findZone(const chai3d::cVector3d& a_proxy) const;
+
+    void buildBuckets();
+
+    std::vector<cZone> m_zones;
+
+    // buckets over the footprints of all zones: zones of bucket i are
+    // m_bucketZones[m_bucketStart[i] .. m_bucketStart[i+1]]
+    double m_bucketMinX;
+    double m_bucketMinY;
+    double m_bucketSize;
+    int m_numBucketsX;
+    int m_numBucketsY;
+    std::vector<int> m_bucketStart;
+    std::vector<int> m_bucketZones;
+
+    double m_servoRate;
+    double m_velocityCutoff;
+
+    // haptic thread state
+    int m_activeZone;
+    chai3d::cVector3d m_force;
+    double m_level;
+
+    // filtered proxy velocity, from the proxy positions of successive ticks
+    bool m_hasLastProxy;
+    chai3d::cVector3d m_lastProxy;
+    chai3d::cVector3d m_velocity;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,345 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CHeightFieldRenderer.h"
+#include "CSurfaceRaster.h"
+#include "CWorkerPool.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+cHeightFieldRenderer::cHeightFieldRenderer(const cHeightFieldSettings& a_settings) :
+    m_settings(a_settings),
+    m_toolRadius(0.0),
+    m_edgeCurvature(0.0),
+    m_enabled(false),
+    m_usingMesh(false),
+    m_contact(false),
+    m_numFallbacks(0),
+    m_proxy(0.0, 0.0, 0.0),
+    m_force(0.0, 0.0, 0.0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+bool cHeightFieldRenderer::build(const vector<cGenericObject*>& a_objects, double a_toolRadius, cWorkerPool& a_pool)
+{
+    m_objects = a_objects;
+    m_toolRadius = a_toolRadius;
+    m_edgeCurvature = (m_settings.m_edgeCurvature > 0.0) ? m_settings.m_edgeCurvature : 2.0 / a_toolRadius;
+
+    vector<cRasterTriangle> triangles;
+    cAppendRasterTriangles(a_objects, triangles);
+    if (triangles.empty())
+    {
+        cout << "Error - nothing to rasterize into the height field" << endl;
+        return (false);
+    }
+
+    // grid over the footprint, with room for the tool around it
+    double minX, minY, maxX, maxY;
+    cGetRasterBounds(triangles, minX, minY, maxX, maxY);
+    double cellSize = m_settings.m_cellSize;
+    double margin = a_toolRadius + 2.0 * cellSize;
+    double extent = cMax(maxX - minX, maxY - minY) + 2.0 * margin;
+    if (extent / cellSize > m_settings.m_maxCells)
+    {
+        cellSize = extent / m_settings.m_maxCells;
+        margin = a_toolRadius + 2.0 * cellSize;
+        cout << "Warning - height field cells enlarged to " << cellSize << " to fit " << m_settings.m_maxCells << " cells" << endl;
+    }
+    double originX = minX - margin;
+    double originY = minY - margin;
+    int width = (int)ceil((maxX - minX + 2.0 * margin) / cellSize);
+    int height = (int)ceil((maxY - minY + 2.0 * margin) / cellSize);
+
+    // highest surface over each cell centre
+    vector<float> surface;
+    cRasterizeSurface(triangles, originX, originY, cellSize, width, height, a_pool, surface);
+
+    // cells without geometry continue the lowest surface
+    float floorHeight = FLT_MAX;
+    for (size_t i=0; i<surface.size(); i++)
+    {
+        if (surface[i] > -FLT_MAX)
+        {
+            floorHeight = min(floorHeight, surface[i]);
+        }
+    }
+    if (floorHeight == FLT_MAX)
+    {
+        cout << "Error - the height field objects have no horizontal surfaces" << endl;
+        return (false);
+    }
+    for (size_t i=0; i<surface.size(); i++)
+    {
+        if (surface[i] == -FLT_MAX)
+        {
+            surface[i] = floorHeight;
+        }
+    }
+
+    // height of the tool centre: the highest point of the spheres resting on
+    // the surface within one tool radius
+    struct cOffset { int m_x; int m_y; float m_lift; };
+    vector<cOffset> disc;
+    int reach = (int)ceil(a_toolRadius / cellSize);
+    for (int dy=-reach; dy<=reach; dy++)
+    {
+        for (int dx=-reach; dx<=reach; dx++)
+        {
+            double d2 = (dx * dx + dy * dy) * cellSize * cellSize;
+            if (d2 <= a_toolRadius * a_toolRadius)
+            {
+                cOffset offset = { dx, dy, (float)sqrt(a_toolRadius * a_toolRadius - d2) };
+                disc.push_back(offset);
+            }
+        }
+    }
+
+    m_grid.resize(width, height, originX, originY, cellSize);
+    a_pool.parallelFor((size_t)height, [&](size_t a_row)
+    {
+        int y = (int)a_row;
+        for (int x=0; x<width; x++)
+        {
+            float top = -FLT_MAX;
+            for (size_t k=0; k<disc.size(); k++)
+            {
+                int sx = x + disc[k].m_x;
+                int sy = y + disc[k].m_y;
+                if ((sx >= 0) && (sx < width) && (sy >= 0) && (sy < height))
+                {
+                    top = max(top, surface[(size_t)sy * width + sx] + disc[k].m_lift);
+                }
+            }
+            m_grid.cell(x, y)[0] = top;
+        }
+    });
+
+    // gradient by central differences
+    float invCell = (float)(1.0 / cellSize);
+    a_pool.parallelFor((size_t)height, [&](size_t a_row)
+    {
+        int y = (int)a_row;
+        int ym = max(0, y - 1), yp = min(height - 1, y + 1);
+        for (int x=0; x<width; x++)
+        {
+            int xm = max(0, x - 1), xp = min(width - 1, x + 1);
+            float* cell = m_grid.cell(x, y);
+            cell[1] = (xp > xm) ? (m_grid.cell(xp, y)[0] - m_grid.cell(xm, y)[0]) * invCell / (float)(xp - xm) : 0.0f;
+            cell[2] = (yp > ym) ? (m_grid.cell(x, yp)[0] - m_grid.cell(x, ym)[0]) * invCell / (float)(yp - ym) : 0.0f;
+        }
+    });
+
+    // curvature: largest change of the gradient to a neighbour, spread to
+    // the neighbours so that the mesh takes over one cell before the feature
+    vector<float> curvature((size_t)width * height, 0.0f);
+    a_pool.parallelFor((size_t)height, [&](size_t a_row)
+    {
+        int y = (int)a_row;
+        for (int x=0; x<width; x++)
+        {
+            const float* cell = m_grid.cell(x, y);
+            float result = 0.0f;
+            if (x + 1 < width)
+            {
+                const float* next = m_grid.cell(x + 1, y);
+                result = max(result, (float)sqrt((next[1] - cell[1]) * (next[1] - cell[1]) + (next[2] - cell[2]) * (next[2] - cell[2])));
+            }
+            if (y + 1 < height)
+            {
+                const float* next = m_grid.cell(x, y + 1);
+                result = max(result, (float)sqrt((next[1] - cell[1]) * (next[1] - cell[1]) + (next[2] - cell[2]) * (next[2] - cell[2])));
+            }
+            curvature[(size_t)y * width + x] = result * invCell;
+        }
+    });
+    a_pool.parallelFor((size_t)height, [&](size_t a_row)
+    {
+        int y = (int)a_row;
+        for (int x=0; x<width; x++)
+        {
+            float result = 0.0f;
+            for (int sy=max(0, y - 1); sy<=min(height - 1, y + 1); sy++)
+            {
+                for (int sx=max(0, x - 1); sx<=min(width - 1, x + 1); sx++)
+                {
+                    result = max(result, curvature[(size_t)sy * width + sx]);
+                }
+            }
+            m_grid.cell(x, y)[3] = result;
+        }
+    });
+
+    cout << "Height field: " << width << " x " << height << " cells of " << cellSize << ", "
+         << triangles.size() << " triangles, " << m_grid.getMemoryUsage() / (1024 * 1024) << " MB" << endl;
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void cHeightFieldRenderer::setObjectsHaptic(bool a_enabled)
+{
+    for (size_t i=0; i<m_objects.size(); i++)
+    {
+        m_objects[i]->setHapticEnabled(a_enabled, true);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cHeightFieldRenderer::enable(cGenericTool* a_tool)
+{
+    // start the proxy at the device, lifted out of the surface
+    m_proxy = a_tool->getDeviceGlobalPos();
+    float sample[4];
+    if (m_grid.sample(m_proxy(0), m_proxy(1), sample) && (m_proxy(2) < sample[0]))
+    {
+        m_proxy(2) = sample[0];
+    }
+    m_force.zero();
+    m_contact = false;
+    m_usingMesh = false;
+    m_enabled = true;
+    setObjectsHaptic(false);
+}
+
+//------------------------------------------------------------------------------
+
+void cHeightFieldRenderer::disable()
+{
+    m_enabled = false;
+    m_force.zero();
+    setObjectsHaptic(true);
+}
+
+//------------------------------------------------------------------------------
+
+void cHeightFieldRenderer::update(cGenericTool* a_tool)
+{
+    if (!m_enabled)
+    {
+        return;
+    }
+
+    cVector3d device = a_tool->getDeviceGlobalPos();
+
+    // near sharp features the CHAI3D proxy renders the meshes, starting from
+    // the field proxy; back on the field, the field proxy continues from the
+    // CHAI3D proxy
+    if (m_usingMesh)
+    {
+        m_proxy = a_tool->m_hapticPoint->getGlobalPosProxy();
+    }
+    if (m_settings.m_edgeFallback)
+    {
+        float sample[4];
+        double threshold = (m_usingMesh ? 0.5 : 1.0) * m_edgeCurvature;
+        bool sharp = m_grid.sample(m_proxy(0), m_proxy(1), sample) && (sample[3] > threshold);
+        if (sharp && !m_usingMesh)
+        {
+            setObjectsHaptic(true);
+            a_tool->m_hapticPoint->initialize(m_proxy);
+            m_usingMesh = true;
+            m_numFallbacks++;
+        }
+        else if (!sharp && m_usingMesh)
+        {
+            setObjectsHaptic(false);
+            m_usingMesh = false;
+        }
+    }
+    if (m_usingMesh)
+    {
+        m_force.zero();
+        m_contact = false;
+        return;
+    }
+
+    moveProxy(device);
+    m_contact = ((m_proxy - device).lengthsq() > 1e-12);
+    m_force = m_settings.m_stiffness * (m_proxy - device);
+}
+
+//------------------------------------------------------------------------------
+
+void cHeightFieldRenderer::moveProxy(const cVector3d& a_goal)
+{
+    float sample[4];
+
+    // no surface outside the grid
+    if (!m_grid.sample(a_goal(0), a_goal(1), sample))
+    {
+        m_proxy = a_goal;
+        return;
+    }
+
+    cVector3d start = m_proxy;
+    cVector3d delta = a_goal - m_proxy;
+    double length = delta.length();
+    if (length < 1e-12)
+    {
+        return;
+    }
+
+    // sub-steps of at most half a cell, so that no feature is skipped. a
+    // proxy that is left behind catches up on the next ticks.
+    int numSteps = (int)ceil(length / (0.5 * m_grid.getCellSize()));
+    numSteps = max(1, min(m_settings.m_maxSteps, numSteps));
+    cVector3d step = delta / (double)numSteps;
+
+    for (int i=0; i<numSteps; i++)
+    {
+        cVector3d next = m_proxy + step;
+        if (m_grid.sample(next(0), next(1), sample) && (next(2) < sample[0]))
+        {
+            // blocked: keep the part of the step along the surface
+            cVector3d normal(-sample[1], -sample[2], 1.0);
+            normal.normalize();
+            next = m_proxy + (step - step.dot(normal) * normal);
+            if (m_grid.sample(next(0), next(1), sample) && (next(2) < sample[0]))
+            {
+                next(2) = sample[0];
+            }
+        }
+        m_proxy = next;
+    }
+
+    // friction: the proxy stays behind while the device is inside the
+    // friction cone around it
+    if ((m_settings.m_friction > 0.0) && m_grid.sample(m_proxy(0), m_proxy(1), sample))
+    {
+        cVector3d normal(-sample[1], -sample[2], 1.0);
+        normal.normalize();
+        double depth = (m_proxy - a_goal).dot(normal);
+        if (depth > 0.0)
+        {
+            cVector3d lag = start - m_proxy;
+            lag -= lag.dot(normal) * normal;
+            double maxLag = m_settings.m_friction * depth;
+            double lagLength = lag.length();
+            if (lagLength > maxLag)
+            {
+                lag *= maxLag / lagLength;
+            }
+            m_proxy += lag;
+            if (m_grid.sample(m_proxy(0), m_proxy(1), sample) && (m_proxy(2) < sample[0]))
+            {
+                m_proxy(2) = sample[0];
+            }
+        }
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CHeightFieldRendererH
+#define CHeightFieldRendererH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CFloat4Grid.h"
+//------------------------------------------------------------------------------
+#include <vector>
+//------------------------------------------------------------------------------
+class cWorkerPool;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+
+struct cHeightFieldSettings
+{
+    cHeightFieldSettings() :
+        m_cellSize(0.001),
+        m_maxCells(4096),
+        m_maxSteps(16),
+        m_stiffness(0.0),
+        m_friction(0.3),
+        m_edgeFallback(false),
+        m_edgeCurvature(0.0) {}
+
+    // edge length of a grid cell [world units]
+    double m_cellSize;
+
+    // largest number of cells along a side; the cell size grows if needed
+    int m_maxCells;
+
+    // most sub-steps the proxy takes towards the device per tick
+    int m_maxSteps;
+
+    // stiffness of the surface [N/m]
+    double m_stiffness;
+
+    // friction coefficient between proxy and surface
+    double m_friction;
+
+    // hand the tool back to mesh collision where the surface bends more
+    // sharply than m_edgeCurvature [1/world unit] (0 = twice the curvature
+    // of the tool sphere)
+    bool m_edgeFallback;
+    double m_edgeCurvature;
+};
+
+//------------------------------------------------------------------------------
+// Haptic rendering of static, 2.5D geometry through a height field.
+//
+// build() rasterizes the given objects from above into a grid that holds,
+// per cell, the height of the centre of the tool sphere resting on the
+// geometry, its gradient and its curvature. The tool radius is thus folded
+// into the field, and contact reduces to "centre below surface".
+//
+// update() moves a god-object proxy from its last position towards the
+// device in at most m_maxSteps sub-steps, sliding along the surface where it
+// is blocked. Each sub-step is one bilinear grid sample, so the cost of a
+// tick does not depend on the number of buildings.
+//
+// While the proxy is near a sharp feature (concave creases, thin walls,
+// anything narrower than the tool) the field is only an approximation: with
+// m_edgeFallback set, haptics of the rasterized objects are switched back
+// on and the CHAI3D proxy takes over from the field proxy until the tool
+// leaves the feature. Overhangs (e.g. arches) cannot be represented.
+//------------------------------------------------------------------------------
+class cHeightFieldRenderer
+{
+public:
+
+    cHeightFieldRenderer(const cHeightFieldSettings& a_settings = cHeightFieldSettings());
+
+    // rasterize a_objects (cMesh or cMultiMesh, global frames up to date) for
+    // a tool of radius a_toolRadius. returns false if they hold no triangles.
+    bool build(const std::vector<chai3d::cGenericObject*>& a_objects, double a_toolRadius, cWorkerPool& a_pool);
+
+    // take over haptic rendering of the rasterized objects from CHAI3D
+    void enable(chai3d::cGenericTool* a_tool);
+
+    // give the objects back to CHAI3D
+    void disable();
+
+    // haptic thread: after tool->updateFromDevice(), before
+    // tool->computeInteractionForces(). the force to add to the tool force
+    // is then available from getForce().
+    void update(chai3d::cGenericTool* a_tool);
+
+    // force of the last update, zero while CHAI3D renders the objects
+    const chai3d::cVector3d& getForce() const { return (m_force); }
+
+    // proxy (centre of the tool sphere) of the last update
+    const chai3d::cVector3d& getProxy() const { return (m_proxy); }
+
+    // true if the proxy touches the field
+    bool isInContact() const { return (m_contact); }
+
+    // true while CHAI3D renders the objects near a sharp feature
+    bool isUsingMesh() const { return (m_usingMesh); }
+
+    // number of mesh fallbacks so far
+    int getNumFallbacks() const { return (m_numFallbacks); }
+
+    // the field: tool centre height, d/dx, d/dy, curvature
+    const cFloat4Grid& getGrid() const { return (m_grid); }
+
+private:
+
+    // move the proxy towards a_goal, staying on or above the surface
+    void moveProxy(const chai3d::cVector3d& a_goal);
+
+    void setObjectsHaptic(bool a_enabled);
+
+    cHeightFieldSettings m_settings;
+    std::vector<chai3d::cGenericObject*> m_objects;
+    cFloat4Grid m_grid;
+    double m_toolRadius;
+    double m_edgeCurvature;
+
+    // haptic thread state
+    bool m_enabled;
+    bool m_usingMesh;
+    bool m_contact;
+    int m_numFallbacks;
+    chai3d::cVector3d m_proxy;
+    chai3d::cVector3d m_force;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,95 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CLatencyStats.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+void cLatencyStats::sort() const
+{
+    if (m_sorted.size() != m_samples.size())
+    {
+        m_sorted = m_samples;
+        std::sort(m_sorted.begin(), m_sorted.end());
+    }
+}
+
+//------------------------------------------------------------------------------
+
+double cLatencyStats::getPercentile(double a_percent) const
+{
+    if (m_samples.empty())
+    {
+        return (0.0);
+    }
+
+    sort();
+
+    // nearest-rank percentile
+    size_t rank = (size_t)ceil(a_percent / 100.0 * (double)m_sorted.size());
+    if (rank < 1) rank = 1;
+    if (rank > m_sorted.size()) rank = m_sorted.size();
+    return (m_sorted[rank - 1]);
+}
+
+//------------------------------------------------------------------------------
+
+double cLatencyStats::getMax() const
+{
+    if (m_samples.empty())
+    {
+        return (0.0);
+    }
+    return (*max_element(m_samples.begin(), m_samples.end()));
+}
+
+//------------------------------------------------------------------------------
+
+double cLatencyStats::getMean() const
+{
+    if (m_samples.empty())
+    {
+        return (0.0);
+    }
+
+    double sum = 0.0;
+    for (size_t i=0; i<m_samples.size(); i++)
+    {
+        sum += m_samples[i];
+    }
+    return (sum / (double)m_samples.size());
+}
+
+//------------------------------------------------------------------------------
+
+void cLatencyStats::printHeader(ostream& a_out)
+{
+    a_out << left << setw(28) << "stage"
+          << right << setw(12) << "p50 [us]"
+          << setw(12) << "p99 [us]"
+          << setw(12) << "p99.9 [us]"
+          << setw(12) << "max [us]" << endl;
+}
+
+//------------------------------------------------------------------------------
+
+void cLatencyStats::printRow(ostream& a_out) const
+{
+    a_out << left << setw(28) << m_name << right << fixed << setprecision(2)
+          << setw(12) << 1e6 * getPercentile(50.0)
+          << setw(12) << 1e6 * getPercentile(99.0)
+          << setw(12) << 1e6 * getPercentile(99.9)
+          << setw(12) << 1e6 * getMax() << endl;
+}
@@ -0,0 +1,80 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CLatencyStatsH
+#define CLatencyStatsH
+//------------------------------------------------------------------------------
+#include <ostream>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Collects latency samples [s] into a preallocated buffer and reports
+// percentiles once the run is over. add() never allocates as long as the
+// number of samples stays below the reserved capacity.
+//------------------------------------------------------------------------------
+class cLatencyStats
+{
+public:
+
+    cLatencyStats(const std::string& a_name = "") : m_name(a_name) {}
+
+    // name shown in reports
+    const std::string& getName() const { return (m_name); }
+
+    // reserve room for a_count samples
+    void reserve(size_t a_count) { m_samples.reserve(a_count); }
+
+    // discard all samples
+    void clear() { m_samples.clear(); }
+
+    // add a sample [s]
+    void add(double a_seconds) { if (m_samples.size() < m_samples.capacity()) m_samples.push_back(a_seconds); }
+
+    // number of samples
+    size_t size() const { return (m_samples.size()); }
+
+    // sample a_index in the order it was added [s]
+    double getSample(size_t a_index) const { return (m_samples[a_index]); }
+
+    // a_percent-th percentile [s], e.g. 99.9
+    double getPercentile(double a_percent) const;
+
+    // largest sample [s]
+    double getMax() const;
+
+    // mean of all samples [s]
+    double getMean() const;
+
+    // print the header line of a report table
+    static void printHeader(std::ostream& a_out);
+
+    // print p50/p99/p99.9/max in microseconds as a table row
+    void printRow(std::ostream& a_out) const;
+
+protected:
+
+    // name of the measured stage
+    std::string m_name;
+
+    // samples in seconds
+    std::vector<double> m_samples;
+
+    // sorted copy, built lazily by the report functions
+    mutable std::vector<double> m_sorted;
+
+    // sort samples into m_sorted if needed
+    void sort() const;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
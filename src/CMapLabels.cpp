@@ -0,0 +1,248 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CMapLabels.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+// edge of the buckets overlaps are looked up in [pixels]
+static const double C_BUCKET_SIZE = 64.0;
+
+// free space kept around the text of a label [pixels]
+static const double C_LABEL_MARGIN = 2.0;
+
+//------------------------------------------------------------------------------
+
+cMapLabels::cMapLabels(cCamera* a_camera, cFontPtr a_font, cGenericObject* a_frame) :
+    m_camera(a_camera),
+    m_font(a_font),
+    m_frame(a_frame),
+    m_numVisible(0),
+    m_dirty(true),
+    m_numBucketsX(0),
+    m_numBucketsY(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+int cMapLabels::addLabel(const string& a_text, const cVector3d& a_pos, const cColorf& a_color)
+{
+    cMapLabel label;
+    label.m_label = new cLabel(m_font);
+    label.m_label->m_fontColor = a_color;
+    label.m_label->setText(a_text);
+    label.m_label->setShowEnabled(false);
+    m_camera->m_frontLayer->addChild(label.m_label);
+    label.m_text = a_text;
+    label.m_pos = a_pos;
+    label.m_width = label.m_label->getWidth();
+    label.m_height = label.m_label->getHeight();
+    m_labels.push_back(label);
+    m_dirty = true;
+    return ((int)m_labels.size() - 1);
+}
+
+//------------------------------------------------------------------------------
+
+void cMapLabels::addLabels(const vector<cTileLabel>& a_labels)
+{
+    for (size_t i=0; i<a_labels.size(); i++)
+    {
+        addLabel(a_labels[i].m_name, a_labels[i].m_pos);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cMapLabels::setText(int a_index, const string& a_text)
+{
+    cMapLabel& label = m_labels[a_index];
+    if (label.m_text == a_text)
+    {
+        return;
+    }
+
+    // rebuilding the text is the expensive part; the size may change, so
+    // the labels are placed again
+    label.m_label->setText(a_text);
+    label.m_text = a_text;
+    label.m_width = label.m_label->getWidth();
+    label.m_height = label.m_label->getHeight();
+    m_dirty = true;
+}
+
+//------------------------------------------------------------------------------
+
+void cMapLabels::getViewKey(int a_width, int a_height, vector<double>& a_key) const
+{
+    a_key.clear();
+    a_key.push_back(a_width);
+    a_key.push_back(a_height);
+    a_key.push_back(m_camera->getFieldViewAngleDeg());
+    a_key.push_back(m_camera->getMirrorVertical() ? 1.0 : 0.0);
+
+    cGenericObject* frames[2] = { m_camera, m_frame };
+    for (int k=0; k<2; k++)
+    {
+        cVector3d pos = frames[k]->getGlobalPos();
+        cMatrix3d rot = frames[k]->getGlobalRot();
+        for (int i=0; i<3; i++)
+        {
+            a_key.push_back(pos(i));
+            for (int j=0; j<3; j++)
+            {
+                a_key.push_back(rot(i, j));
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cMapLabels::update(int a_width, int a_height)
+{
+    getViewKey(a_width, a_height, m_newViewKey);
+    if (!m_dirty && (m_newViewKey == m_viewKey))
+    {
+        return;
+    }
+    m_viewKey.swap(m_newViewKey);
+    m_dirty = false;
+    place(a_width, a_height);
+}
+
+//------------------------------------------------------------------------------
+
+void cMapLabels::place(int a_width, int a_height)
+{
+    m_numVisible = 0;
+    if ((a_width <= 0) || (a_height <= 0))
+    {
+        for (size_t i=0; i<m_labels.size(); i++)
+        {
+            m_labels[i].m_label->setShowEnabled(false);
+        }
+        return;
+    }
+
+    // camera frame: col 0 points back towards the viewer, col 1 to the
+    // right of the screen and col 2 up
+    cVector3d eye = m_camera->getGlobalPos();
+    cMatrix3d eyeRot = m_camera->getGlobalRot();
+    cVector3d back = eyeRot.getCol0();
+    cVector3d right = eyeRot.getCol1();
+    cVector3d up = eyeRot.getCol2();
+    double tanHalfFov = tan(0.5 * m_camera->getFieldViewAngleDeg() * M_PI / 180.0);
+    double aspect = (double)a_width / (double)a_height;
+    bool mirror = m_camera->getMirrorVertical();
+
+    cVector3d framePos = m_frame->getGlobalPos();
+    cMatrix3d frameRot = m_frame->getGlobalRot();
+
+    // reset the buckets, keeping their memory
+    m_numBucketsX = (int)ceil(a_width / C_BUCKET_SIZE);
+    m_numBucketsY = (int)ceil(a_height / C_BUCKET_SIZE);
+    m_buckets.resize(m_numBucketsX * m_numBucketsY);
+    for (size_t i=0; i<m_buckets.size(); i++)
+    {
+        m_buckets[i].clear();
+    }
+    m_rects.clear();
+
+    for (size_t i=0; i<m_labels.size(); i++)
+    {
+        cMapLabel& label = m_labels[i];
+        cVector3d p = framePos + frameRot * label.m_pos - eye;
+        double depth = -p.dot(back);
+        bool show = (depth > 0.0);
+
+        double rect[4];
+        if (show)
+        {
+            double x = 0.5 * (p.dot(right) / (depth * tanHalfFov * aspect) + 1.0) * a_width;
+            double y = 0.5 * (p.dot(up) / (depth * tanHalfFov) + 1.0) * a_height;
+            if (mirror)
+            {
+                x = a_width - x;
+            }
+
+            // centre the text on the anchor, on whole pixels
+            rect[0] = floor(x - 0.5 * label.m_width);
+            rect[1] = floor(y - 0.5 * label.m_height);
+            rect[2] = rect[0] + label.m_width;
+            rect[3] = rect[1] + label.m_height;
+            show = (rect[0] >= 0.0) && (rect[1] >= 0.0) &&
+                   (rect[2] <= a_width) && (rect[3] <= a_height) &&
+                   !overlaps(rect);
+        }
+
+        label.m_label->setShowEnabled(show);
+        if (!show)
+        {
+            continue;
+        }
+        label.m_label->setLocalPos(rect[0], rect[1]);
+        m_numVisible++;
+
+        // register the rectangle, with its margin, in the buckets it covers
+        int index = (int)m_rects.size() / 4;
+        m_rects.push_back(rect[0] - C_LABEL_MARGIN);
+        m_rects.push_back(rect[1] - C_LABEL_MARGIN);
+        m_rects.push_back(rect[2] + C_LABEL_MARGIN);
+        m_rects.push_back(rect[3] + C_LABEL_MARGIN);
+        const double* stored = &m_rects[4 * index];
+        int minX = max(0, (int)floor(stored[0] / C_BUCKET_SIZE));
+        int minY = max(0, (int)floor(stored[1] / C_BUCKET_SIZE));
+        int maxX = min(m_numBucketsX - 1, (int)(stored[2] / C_BUCKET_SIZE));
+        int maxY = min(m_numBucketsY - 1, (int)(stored[3] / C_BUCKET_SIZE));
+        for (int by=minY; by<=maxY; by++)
+        {
+            for (int bx=minX; bx<=maxX; bx++)
+            {
+                m_buckets[by * m_numBucketsX + bx].push_back(index);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool cMapLabels::overlaps(const double* a_rect) const
+{
+    int minX = max(0, (int)(a_rect[0] / C_BUCKET_SIZE));
+    int minY = max(0, (int)(a_rect[1] / C_BUCKET_SIZE));
+    int maxX = min(m_numBucketsX - 1, (int)(a_rect[2] / C_BUCKET_SIZE));
+    int maxY = min(m_numBucketsY - 1, (int)(a_rect[3] / C_BUCKET_SIZE));
+    for (int by=minY; by<=maxY; by++)
+    {
+        for (int bx=minX; bx<=maxX; bx++)
+        {
+            const vector<int>& bucket = m_buckets[by * m_numBucketsX + bx];
+            for (size_t k=0; k<bucket.size(); k++)
+            {
+                const double* other = &m_rects[4 * bucket[k]];
+                if ((a_rect[0] < other[2]) && (other[0] < a_rect[2]) &&
+                    (a_rect[1] < other[3]) && (other[1] < a_rect[3]))
+                {
+                    return (true);
+                }
+            }
+        }
+    }
+    return (false);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,100 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CMapLabelsH
+#define CMapLabelsH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CTileSource.h"
+//------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Names pinned to points of the map, drawn in the front layer of a camera.
+//
+// Anchors are only projected to the screen when the camera, the viewport or
+// the map moved since the last update, and the text of a label is only
+// handed to CHAI3D when it changes, so a frame in which nothing moved costs
+// one comparison. Labels whose anchor is behind the camera or whose text
+// does not fit on the screen are hidden, as are labels overlapping one
+// added before them: the order of addLabel() is the priority.
+//------------------------------------------------------------------------------
+class cMapLabels
+{
+public:
+
+    // anchors are given in local coordinates of a_frame (e.g. the map)
+    cMapLabels(chai3d::cCamera* a_camera, chai3d::cFontPtr a_font, chai3d::cGenericObject* a_frame);
+
+    // add a label and return its index
+    int addLabel(const std::string& a_text, const chai3d::cVector3d& a_pos,
+                 const chai3d::cColorf& a_color = chai3d::cColorf(0.8f, 0.8f, 0.8f));
+
+    void addLabels(const std::vector<cTileLabel>& a_labels);
+
+    int getNumLabels() const { return ((int)m_labels.size()); }
+
+    // change the text of a label
+    void setText(int a_index, const std::string& a_text);
+
+    // place the labels for a viewport of a_width x a_height pixels. call once
+    // per frame, before rendering.
+    void update(int a_width, int a_height);
+
+    // number of labels shown after the last update
+    int getNumVisible() const { return (m_numVisible); }
+
+private:
+
+    struct cMapLabel
+    {
+        // owned by the front layer of the camera
+        chai3d::cLabel* m_label;
+        std::string m_text;
+        chai3d::cVector3d m_pos;
+
+        // size of the text [pixels]
+        double m_width;
+        double m_height;
+    };
+
+    // fill a_key with everything the projection depends on
+    void getViewKey(int a_width, int a_height, std::vector<double>& a_key) const;
+
+    // project and cull all labels
+    void place(int a_width, int a_height);
+
+    // true if a_rect overlaps a placed label; a_rect is x0, y0, x1, y1
+    bool overlaps(const double* a_rect) const;
+
+    chai3d::cCamera* m_camera;
+    chai3d::cFontPtr m_font;
+    chai3d::cGenericObject* m_frame;
+    std::vector<cMapLabel> m_labels;
+    int m_numVisible;
+
+    // view the labels were placed for, and set when labels change
+    std::vector<double> m_viewKey;
+    std::vector<double> m_newViewKey;
+    bool m_dirty;
+
+    // rectangles of the labels placed so far in place(), sorted into square
+    // buckets of the screen
+    int m_numBucketsX;
+    int m_numBucketsY;
+    std::vector<std::vector<int> > m_buckets;
+    std::vector<double> m_rects;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
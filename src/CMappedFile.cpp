@@ -0,0 +1,134 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CMappedFile.h"
+//------------------------------------------------------------------------------
+#include <cstdio>
+#include <sys/stat.h>
+#if defined(LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+cMappedFile::cMappedFile() :
+    m_data(NULL),
+    m_size(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+cMappedFile::~cMappedFile()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+
+bool cMappedFile::open(const string& a_filename)
+{
+    close();
+
+#if defined(LINUX)
+    int fd = ::open(a_filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return (false);
+    }
+
+    struct stat info;
+    if ((fstat(fd, &info) != 0) || (info.st_size == 0))
+    {
+        ::close(fd);
+        return (false);
+    }
+
+    void* address = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED)
+    {
+        return (false);
+    }
+
+    // the whole file is about to be read front to back
+    madvise(address, (size_t)info.st_size, MADV_WILLNEED);
+
+    m_data = (const unsigned char*)address;
+    m_size = (size_t)info.st_size;
+    return (true);
+#else
+    FILE* file = fopen(a_filename.c_str(), "rb");
+    if (file == NULL)
+    {
+        return (false);
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length <= 0)
+    {
+        fclose(file);
+        return (false);
+    }
+
+    m_buffer.resize((size_t)length);
+    size_t count = fread(&m_buffer[0], 1, (size_t)length, file);
+    fclose(file);
+    if (count != (size_t)length)
+    {
+        m_buffer.clear();
+        return (false);
+    }
+
+    m_data = &m_buffer[0];
+    m_size = m_buffer.size();
+    return (true);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void cMappedFile::close()
+{
+#if defined(LINUX)
+    if (m_data != NULL)
+    {
+        munmap((void*)m_data, m_size);
+    }
+#else
+    m_buffer.clear();
+#endif
+    m_data = NULL;
+    m_size = 0;
+}
+
+//------------------------------------------------------------------------------
+
+bool cMappedFile::getFileInfo(const string& a_filename, uint64_t& a_size, int64_t& a_mtimeNs)
+{
+    struct stat info;
+    if (stat(a_filename.c_str(), &info) != 0)
+    {
+        return (false);
+    }
+
+    a_size = (uint64_t)info.st_size;
+#if defined(LINUX)
+    a_mtimeNs = (int64_t)info.st_mtim.tv_sec * 1000000000LL + (int64_t)info.st_mtim.tv_nsec;
+#else
+    a_mtimeNs = (int64_t)info.st_mtime * 1000000000LL;
+#endif
+    return (true);
+}
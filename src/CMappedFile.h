@@ -0,0 +1,60 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CMappedFileH
+#define CMappedFileH
+//------------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Read-only view of a whole file. Uses mmap on Linux; elsewhere the file is
+// read into memory once.
+//------------------------------------------------------------------------------
+class cMappedFile
+{
+public:
+
+    cMappedFile();
+    ~cMappedFile();
+
+    // map a file, closing any previously mapped one
+    bool open(const std::string& a_filename);
+
+    // unmap the file
+    void close();
+
+    // start of the file contents (NULL if not open)
+    const unsigned char* data() const { return (m_data); }
+
+    // size of the file [bytes]
+    size_t size() const { return (m_size); }
+
+    // size and modification time of a file. returns false if it does not exist.
+    static bool getFileInfo(const std::string& a_filename, uint64_t& a_size, int64_t& a_mtimeNs);
+
+private:
+
+    cMappedFile(const cMappedFile&);
+    cMappedFile& operator=(const cMappedFile&);
+
+    const unsigned char* m_data;
+    size_t m_size;
+
+    // fallback storage when mmap is not available
+    std::vector<unsigned char> m_buffer;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
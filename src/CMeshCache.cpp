@@ -0,0 +1,496 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CMeshCache.h"
+#include "CMappedFile.h"
+#include "CPersistentCollisionAABB.h"
+//------------------------------------------------------------------------------
+#include <cstdio>
+#include <fstream>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// FILE LAYOUT
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const char C_MAGIC[8] = { 'H', 'M', 'A', 'P', 'M', 'E', 'S', 'H' };
+
+    struct cFileHeader
+    {
+        char m_magic[8];
+        uint32_t m_version;
+        uint32_t m_headerSize;
+        uint64_t m_fileSize;
+        uint64_t m_sourceSize;
+        int64_t m_sourceMtime;
+        uint64_t m_materialStamp;
+        double m_toolRadius;
+        double m_edgeAngle;
+        uint32_t m_numMeshes;
+        uint32_t m_reserved;
+    };
+
+    struct cMeshHeader
+    {
+        uint32_t m_numVertices;
+        uint32_t m_numTriangles;
+        uint32_t m_numEdges;
+        uint32_t m_numNodes;
+        int32_t m_rootIndex;
+        int32_t m_maxDepth;
+        uint32_t m_textureNameLength;
+        uint32_t m_shininess;
+        float m_ambient[4];
+        float m_diffuse[4];
+        float m_specular[4];
+        float m_emission[4];
+    };
+
+    struct cVertexRecord
+    {
+        double m_pos[3];
+        double m_normal[3];
+        double m_texCoord[3];
+        float m_color[4];
+    };
+
+    // every section starts on an 8 byte boundary
+    inline size_t align8(size_t a_size) { return ((a_size + 7) & ~(size_t)7); }
+
+    //--------------------------------------------------------------------------
+
+    // combined size/mtime stamp of the material files an OBJ may reference
+    uint64_t getMaterialStamp(const string& a_filename)
+    {
+        string candidates[2];
+        candidates[0] = a_filename + ".mtl";
+        size_t dot = a_filename.find_last_of('.');
+        candidates[1] = (dot == string::npos) ? a_filename + ".mtl" : a_filename.substr(0, dot) + ".mtl";
+
+        // FNV-1a over the stat results, "missing" included
+        uint64_t hash = 1469598103934665603ULL;
+        for (int i=0; i<2; i++)
+        {
+            uint64_t size = 0;
+            int64_t mtime = 0;
+            uint64_t values[3];
+            values[0] = cMappedFile::getFileInfo(candidates[i], size, mtime) ? 1 : 0;
+            values[1] = size;
+            values[2] = (uint64_t)mtime;
+            const unsigned char* bytes = (const unsigned char*)values;
+            for (size_t k=0; k<sizeof(values); k++)
+            {
+                hash = (hash ^ bytes[k]) * 1099511628211ULL;
+            }
+        }
+        return (hash);
+    }
+
+    //--------------------------------------------------------------------------
+
+    // bounds-checked reader over the mapped file
+    class cCursor
+    {
+    public:
+        cCursor(const unsigned char* a_data, size_t a_size) : m_data(a_data), m_size(a_size), m_offset(0) {}
+
+        // pointer to the next a_bytes bytes, or NULL if the file is too short
+        const void* take(size_t a_bytes)
+        {
+            if ((a_bytes > m_size) || (m_offset > m_size - a_bytes))
+            {
+                return (NULL);
+            }
+            const void* result = m_data + m_offset;
+            m_offset = align8(m_offset + a_bytes);
+            return (result);
+        }
+
+    private:
+        const unsigned char* m_data;
+        size_t m_size;
+        size_t m_offset;
+    };
+
+    //--------------------------------------------------------------------------
+
+    void writePadded(ofstream& a_out, const void* a_data, size_t a_bytes)
+    {
+        static const char zeros[8] = { 0 };
+        if (a_bytes > 0)
+        {
+            a_out.write((const char*)a_data, a_bytes);
+        }
+        a_out.write(zeros, align8(a_bytes) - a_bytes);
+    }
+
+    //--------------------------------------------------------------------------
+
+    void getColor(const cColorf& a_color, float* a_values)
+    {
+        a_values[0] = a_color.getR();
+        a_values[1] = a_color.getG();
+        a_values[2] = a_color.getB();
+        a_values[3] = a_color.getA();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+string cMeshCache::getCacheFilename(const string& a_filename)
+{
+    return (a_filename + ".hcache");
+}
+
+//------------------------------------------------------------------------------
+
+bool cMeshCache::load(cMultiMesh* a_multiMesh,
+                      const string& a_filename,
+                      double a_toolRadius,
+                      double a_edgeAngle,
+                      bool a_useCache,
+                      bool* a_fromCache)
+{
+    if (a_fromCache != NULL)
+    {
+        *a_fromCache = false;
+    }
+
+    if (a_useCache && read(a_multiMesh, a_filename, a_toolRadius, a_edgeAngle))
+    {
+        if (a_fromCache != NULL)
+        {
+            *a_fromCache = true;
+        }
+        return (true);
+    }
+
+    // cache miss: parse the asset and preprocess it
+    if (!a_multiMesh->loadFromFile(a_filename))
+    {
+        return (false);
+    }
+
+    a_multiMesh->computeAllEdges(a_edgeAngle);
+
+    for (unsigned int i=0; i<a_multiMesh->getNumMeshes(); i++)
+    {
+        cPersistentCollisionAABB::create(a_multiMesh->getMesh(i), a_toolRadius);
+    }
+
+    if (a_useCache && !write(a_multiMesh, a_filename, a_toolRadius, a_edgeAngle))
+    {
+        cout << "Warning - could not write mesh cache " << getCacheFilename(a_filename) << endl;
+    }
+
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cMeshCache::read(cMultiMesh* a_multiMesh,
+                      const string& a_filename,
+                      double a_toolRadius,
+                      double a_edgeAngle)
+{
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    if (!cMappedFile::getFileInfo(a_filename, sourceSize, sourceMtime))
+    {
+        return (false);
+    }
+
+    cMappedFile file;
+    if (!file.open(getCacheFilename(a_filename)))
+    {
+        return (false);
+    }
+
+    cCursor cursor(file.data(), file.size());
+
+    // check that the cache belongs to this asset and these settings
+    const cFileHeader* header = (const cFileHeader*)cursor.take(sizeof(cFileHeader));
+    if ((header == NULL) ||
+        (memcmp(header->m_magic, C_MAGIC, sizeof(C_MAGIC)) != 0) ||
+        (header->m_version != C_VERSION) ||
+        (header->m_headerSize != sizeof(cFileHeader)) ||
+        (header->m_fileSize != file.size()) ||
+        (header->m_sourceSize != sourceSize) ||
+        (header->m_sourceMtime != sourceMtime) ||
+        (header->m_materialStamp != getMaterialStamp(a_filename)) ||
+        (header->m_toolRadius != a_toolRadius) ||
+        (header->m_edgeAngle != a_edgeAngle))
+    {
+        return (false);
+    }
+
+    // validate all sections before touching the multimesh
+    const unsigned int numMeshes = header->m_numMeshes;
+    vector<const cMeshHeader*> meshHeaders(numMeshes);
+    vector<const cVertexRecord*> vertices(numMeshes);
+    vector<const uint32_t*> triangles(numMeshes);
+    vector<const int32_t*> edges(numMeshes);
+    vector<const cAABBNodeRecord*> nodes(numMeshes);
+    vector<const char*> textureNames(numMeshes);
+
+    for (unsigned int i=0; i<numMeshes; i++)
+    {
+        const cMeshHeader* mesh = (const cMeshHeader*)cursor.take(sizeof(cMeshHeader));
+        if (mesh == NULL)
+        {
+            return (false);
+        }
+        meshHeaders[i] = mesh;
+        vertices[i] = (const cVertexRecord*)cursor.take((size_t)mesh->m_numVertices * sizeof(cVertexRecord));
+        triangles[i] = (const uint32_t*)cursor.take((size_t)mesh->m_numTriangles * 3 * sizeof(uint32_t));
+        edges[i] = (const int32_t*)cursor.take((size_t)mesh->m_numEdges * 2 * sizeof(int32_t));
+        nodes[i] = (const cAABBNodeRecord*)cursor.take((size_t)mesh->m_numNodes * sizeof(cAABBNodeRecord));
+        textureNames[i] = (const char*)cursor.take(mesh->m_textureNameLength);
+        if ((vertices[i] == NULL) || (triangles[i] == NULL) || (edges[i] == NULL) ||
+            (nodes[i] == NULL) || (textureNames[i] == NULL))
+        {
+            return (false);
+        }
+
+        // indices into the vertices and the tree, validated the same way as
+        // cTileFile::createTile(); leaves refer to a triangle instead of a subtree
+        for (size_t k=0; k<(size_t)mesh->m_numTriangles * 3; k++)
+        {
+            if (triangles[i][k] >= mesh->m_numVertices)
+            {
+                return (false);
+            }
+        }
+        for (size_t k=0; k<(size_t)mesh->m_numEdges * 2; k++)
+        {
+            if ((edges[i][k] < 0) || ((uint32_t)edges[i][k] >= mesh->m_numVertices))
+            {
+                return (false);
+            }
+        }
+        int32_t numNodes = (int32_t)mesh->m_numNodes;
+        if ((numNodes < 0) ||
+            (mesh->m_rootIndex < -1) || (mesh->m_rootIndex >= numNodes) ||
+            (mesh->m_maxDepth < -1) || (mesh->m_maxDepth > numNodes))
+        {
+            return (false);
+        }
+        for (int32_t k=0; k<numNodes; k++)
+        {
+            const cAABBNodeRecord& node = nodes[i][k];
+            bool valid;
+            if (node.m_nodeType == (int32_t)C_AABB_NODE_LEAF)
+            {
+                valid = (node.m_leftSubTree >= -1) && (node.m_leftSubTree < (int32_t)mesh->m_numTriangles);
+            }
+            else
+            {
+                valid = ((node.m_nodeType == (int32_t)C_AABB_NODE_INTERNAL) ||
+                         (node.m_nodeType == (int32_t)C_AABB_NOT_DEFINED)) &&
+                        (node.m_leftSubTree >= -1) && (node.m_leftSubTree < numNodes) &&
+                        (node.m_rightSubTree >= -1) && (node.m_rightSubTree < numNodes);
+            }
+            if (!valid)
+            {
+                return (false);
+            }
+        }
+    }
+
+    // copy the data into CHAI3D meshes
+    for (unsigned int i=0; i<numMeshes; i++)
+    {
+        const cMeshHeader* meshHeader = meshHeaders[i];
+        cMesh* mesh = a_multiMesh->newMesh();
+
+        for (uint32_t k=0; k<meshHeader->m_numVertices; k++)
+        {
+            const cVertexRecord& v = vertices[i][k];
+            mesh->newVertex(cVector3d(v.m_pos[0], v.m_pos[1], v.m_pos[2]),
+                            cVector3d(v.m_normal[0], v.m_normal[1], v.m_normal[2]),
+                            cVector3d(v.m_texCoord[0], v.m_texCoord[1], v.m_texCoord[2]),
+                            cColorf(v.m_color[0], v.m_color[1], v.m_color[2], v.m_color[3]));
+        }
+
+        const uint32_t* t = triangles[i];
+        for (uint32_t k=0; k<meshHeader->m_numTriangles; k++)
+        {
+            mesh->newTriangle(t[3*k], t[3*k+1], t[3*k+2]);
+        }
+
+        const int32_t* e = edges[i];
+        mesh->m_edges.reserve(meshHeader->m_numEdges);
+        for (uint32_t k=0; k<meshHeader->m_numEdges; k++)
+        {
+            mesh->m_edges.push_back(cEdge(mesh, e[2*k], e[2*k+1]));
+        }
+
+        cPersistentCollisionAABB* detector = new cPersistentCollisionAABB();
+        detector->restore(mesh->m_triangles, a_toolRadius, meshHeader->m_rootIndex,
+                          meshHeader->m_maxDepth, nodes[i], (int)meshHeader->m_numNodes);
+        mesh->setCollisionDetector(detector);
+
+        cMaterialPtr material = mesh->m_material;
+        material->m_ambient.set(meshHeader->m_ambient[0], meshHeader->m_ambient[1], meshHeader->m_ambient[2], meshHeader->m_ambient[3]);
+        material->m_diffuse.set(meshHeader->m_diffuse[0], meshHeader->m_diffuse[1], meshHeader->m_diffuse[2], meshHeader->m_diffuse[3]);
+        material->m_specular.set(meshHeader->m_specular[0], meshHeader->m_specular[1], meshHeader->m_specular[2], meshHeader->m_specular[3]);
+        material->m_emission.set(meshHeader->m_emission[0], meshHeader->m_emission[1], meshHeader->m_emission[2], meshHeader->m_emission[3]);
+        material->setShininess(meshHeader->m_shininess);
+
+        if (meshHeader->m_textureNameLength > 0)
+        {
+            string textureName(textureNames[i], meshHeader->m_textureNameLength);
+            cTexture2dPtr texture = cTexture2d::create();
+            if (texture->loadFromFile(textureName))
+            {
+                mesh->setTexture(texture);
+                mesh->setUseTexture(true);
+            }
+        }
+    }
+
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cMeshCache::write(cMultiMesh* a_multiMesh,
+                       const string& a_filename,
+                       double a_toolRadius,
+                       double a_edgeAngle)
+{
+    cFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, C_MAGIC, sizeof(C_MAGIC));
+    header.m_version = C_VERSION;
+    header.m_headerSize = sizeof(cFileHeader);
+    header.m_materialStamp = getMaterialStamp(a_filename);
+    header.m_toolRadius = a_toolRadius;
+    header.m_edgeAngle = a_edgeAngle;
+    header.m_numMeshes = a_multiMesh->getNumMeshes();
+    if (!cMappedFile::getFileInfo(a_filename, header.m_sourceSize, header.m_sourceMtime))
+    {
+        return (false);
+    }
+
+    // write to a temporary file and rename it, so that a reader never sees a
+    // partially written cache
+    string cacheFilename = getCacheFilename(a_filename);
+    string tempFilename = cacheFilename + ".tmp";
+    ofstream out(tempFilename.c_str(), ios::binary | ios::trunc);
+    if (!out)
+    {
+        return (false);
+    }
+
+    writePadded(out, &header, sizeof(header));
+
+    vector<cVertexRecord> vertices;
+    vector<uint32_t> triangles;
+    vector<int32_t> edges;
+    vector<cAABBNodeRecord> nodes;
+
+    for (unsigned int i=0; i<header.m_numMeshes; i++)
+    {
+        cMesh* mesh = a_multiMesh->getMesh(i);
+        cPersistentCollisionAABB* detector = dynamic_cast<cPersistentCollisionAABB*>(mesh->getCollisionDetector());
+        if (detector == NULL)
+        {
+            out.close();
+            remove(tempFilename.c_str());
+            return (false);
+        }
+
+        cMeshHeader meshHeader;
+        memset(&meshHeader, 0, sizeof(meshHeader));
+
+        vertices.resize(mesh->getNumVertices());
+        for (size_t k=0; k<vertices.size(); k++)
+        {
+            cVertexRecord& v = vertices[k];
+            cVector3d pos = mesh->m_vertices->getLocalPos((unsigned int)k);
+            cVector3d normal = mesh->m_vertices->getNormal((unsigned int)k);
+            cVector3d texCoord = mesh->m_vertices->getTexCoord((unsigned int)k);
+            for (int j=0; j<3; j++)
+            {
+                v.m_pos[j] = pos(j);
+                v.m_normal[j] = normal(j);
+                v.m_texCoord[j] = texCoord(j);
+            }
+            getColor(mesh->m_vertices->getColor((unsigned int)k), v.m_color);
+        }
+
+        triangles.resize(3 * (size_t)mesh->getNumTriangles());
+        for (unsigned int k=0; k<mesh->getNumTriangles(); k++)
+        {
+            triangles[3*k]   = mesh->m_triangles->getVertexIndex0(k);
+            triangles[3*k+1] = mesh->m_triangles->getVertexIndex1(k);
+            triangles[3*k+2] = mesh->m_triangles->getVertexIndex2(k);
+        }
+
+        edges.resize(2 * mesh->m_edges.size());
+        for (size_t k=0; k<mesh->m_edges.size(); k++)
+        {
+            edges[2*k]   = mesh->m_edges[k].m_vertex0;
+            edges[2*k+1] = mesh->m_edges[k].m_vertex1;
+        }
+
+        nodes.resize(detector->getNumNodeRecords());
+        for (size_t k=0; k<nodes.size(); k++)
+        {
+            detector->getNodeRecord((int)k, nodes[k]);
+        }
+
+        string textureName;
+        if ((mesh->m_texture != NULL) && (mesh->m_texture->m_image != NULL))
+        {
+            textureName = mesh->m_texture->m_image->getFilename();
+        }
+
+        meshHeader.m_numVertices = (uint32_t)vertices.size();
+        meshHeader.m_numTriangles = mesh->getNumTriangles();
+        meshHeader.m_numEdges = (uint32_t)mesh->m_edges.size();
+        meshHeader.m_numNodes = (uint32_t)nodes.size();
+        meshHeader.m_rootIndex = detector->getRootIndex();
+        meshHeader.m_maxDepth = detector->getMaxDepth();
+        meshHeader.m_textureNameLength = (uint32_t)textureName.size();
+        meshHeader.m_shininess = mesh->m_material->getShininess();
+        getColor(mesh->m_material->m_ambient, meshHeader.m_ambient);
+        getColor(mesh->m_material->m_diffuse, meshHeader.m_diffuse);
+        getColor(mesh->m_material->m_specular, meshHeader.m_specular);
+        getColor(mesh->m_material->m_emission, meshHeader.m_emission);
+
+        writePadded(out, &meshHeader, sizeof(meshHeader));
+        writePadded(out, vertices.empty() ? NULL : &vertices[0], vertices.size() * sizeof(cVertexRecord));
+        writePadded(out, triangles.empty() ? NULL : &triangles[0], triangles.size() * sizeof(uint32_t));
+        writePadded(out, edges.empty() ? NULL : &edges[0], edges.size() * sizeof(int32_t));
+        writePadded(out, nodes.empty() ? NULL : &nodes[0], nodes.size() * sizeof(cAABBNodeRecord));
+        writePadded(out, textureName.data(), textureName.size());
+    }
+
+    // patch the total size into the header
+    header.m_fileSize = (uint64_t)out.tellp();
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    out.close();
+
+    if (!out || (rename(tempFilename.c_str(), cacheFilename.c_str()) != 0))
+    {
+        remove(tempFilename.c_str());
+        return (false);
+    }
+
+    return (true);
+}
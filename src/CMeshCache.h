@@ -0,0 +1,73 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CMeshCacheH
+#define CMeshCacheH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <string>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Binary cache of a loaded and preprocessed cMultiMesh.
+//
+// A cache file (<asset>.hcache, next to the asset) holds for every mesh the
+// vertices (position, normal, texture coordinate, color), the triangles, the
+// edge list from computeAllEdges(), the AABB collision tree and the material.
+// It is mapped into memory and copied straight into the CHAI3D arrays, so
+// neither the OBJ/MTL text nor the collision tree is rebuilt.
+//
+// The cache is keyed on the size and modification time of the asset and of
+// its material file, on the tool radius used for the collision tree and on
+// the edge angle. Any mismatch, or a cache written by another format
+// version, causes a normal load followed by a rewrite of the cache.
+//
+// The format uses native byte order and is not meant to be shared between
+// machines of different architectures.
+//------------------------------------------------------------------------------
+class cMeshCache
+{
+public:
+
+    // current format version; bump when the layout changes
+    static const unsigned int C_VERSION = 1;
+
+    // cache file used for an asset
+    static std::string getCacheFilename(const std::string& a_filename);
+
+    // load a_filename into a_multiMesh, compute its edges (a_edgeAngle) and
+    // build AABB collision trees (a_toolRadius), going through the cache
+    // when a_useCache is set. a_fromCache reports whether the cache was hit.
+    static bool load(chai3d::cMultiMesh* a_multiMesh,
+                     const std::string& a_filename,
+                     double a_toolRadius,
+                     double a_edgeAngle,
+                     bool a_useCache = true,
+                     bool* a_fromCache = NULL);
+
+    // restore a_multiMesh from the cache of a_filename. returns false if the
+    // cache is missing, stale or corrupt.
+    static bool read(chai3d::cMultiMesh* a_multiMesh,
+                     const std::string& a_filename,
+                     double a_toolRadius,
+                     double a_edgeAngle);
+
+    // write the cache of a_filename from a preprocessed a_multiMesh. every
+    // mesh must carry a cPersistentCollisionAABB.
+    static bool write(chai3d::cMultiMesh* a_multiMesh,
+                      const std::string& a_filename,
+                      double a_toolRadius,
+                      double a_edgeAngle);
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,809 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "COsmMap.h"
+#include "COsmPbfReader.h"
+#include "CXmlStreamReader.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+// STRING TABLE
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const size_t C_STRING_BLOCK_SIZE = 64 * 1024;
+
+    inline uint32_t hashString(const char* a_string, size_t a_length)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i=0; i<a_length; i++)
+        {
+            hash = (hash ^ (unsigned char)a_string[i]) * 16777619u;
+        }
+        return (hash);
+    }
+
+    // strings are stored with their length in the 4 bytes before them
+    inline uint32_t storedLength(const char* a_string)
+    {
+        uint32_t length;
+        memcpy(&length, a_string - sizeof(uint32_t), sizeof(uint32_t));
+        return (length);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cOsmStringTable::cOsmStringTable()
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmStringTable::clear()
+{
+    m_blocks.clear();
+    m_blockUsed = 0;
+    m_slots.assign(1024, (const char*)NULL);
+    m_numStrings = 0;
+}
+
+//------------------------------------------------------------------------------
+
+const char* cOsmStringTable::intern(const char* a_string, size_t a_length)
+{
+    size_t mask = m_slots.size() - 1;
+    size_t slot = hashString(a_string, a_length) & mask;
+    while (m_slots[slot] != NULL)
+    {
+        const char* stored = m_slots[slot];
+        if ((storedLength(stored) == a_length) && (memcmp(stored, a_string, a_length) == 0))
+        {
+            return (stored);
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    // store a new copy
+    size_t size = sizeof(uint32_t) + a_length + 1;
+    if (m_blocks.empty() || (m_blockUsed + size > m_blocks.back().size()))
+    {
+        m_blocks.push_back(vector<char>(max(size, C_STRING_BLOCK_SIZE)));
+        m_blockUsed = 0;
+    }
+    char* stored = &m_blocks.back()[m_blockUsed] + sizeof(uint32_t);
+    uint32_t length = (uint32_t)a_length;
+    memcpy(stored - sizeof(uint32_t), &length, sizeof(uint32_t));
+    memcpy(stored, a_string, a_length);
+    stored[a_length] = '\0';
+    m_blockUsed += size;
+
+    m_slots[slot] = stored;
+    m_numStrings++;
+
+    // keep the table at most half full
+    if (2 * m_numStrings > m_slots.size())
+    {
+        vector<const char*> slots(2 * m_slots.size(), (const char*)NULL);
+        mask = slots.size() - 1;
+        for (size_t i=0; i<m_slots.size(); i++)
+        {
+            if (m_slots[i] == NULL)
+            {
+                continue;
+            }
+            size_t k = hashString(m_slots[i], storedLength(m_slots[i])) & mask;
+            while (slots[k] != NULL)
+            {
+                k = (k + 1) & mask;
+            }
+            slots[k] = m_slots[i];
+        }
+        m_slots.swap(slots);
+    }
+
+    return (stored);
+}
+
+//------------------------------------------------------------------------------
+
+size_t cOsmStringTable::getMemoryUsage() const
+{
+    size_t size = m_slots.capacity() * sizeof(const char*);
+    for (size_t i=0; i<m_blocks.size(); i++)
+    {
+        size += m_blocks[i].capacity();
+    }
+    return (size);
+}
+
+//------------------------------------------------------------------------------
+// NODE TABLE
+//------------------------------------------------------------------------------
+
+void cOsmNodeTable::add(int64_t a_id, int32_t a_lat, int32_t a_lon)
+{
+    if (!m_ids.empty() && (a_id <= m_ids.back()))
+    {
+        m_sorted = false;
+    }
+    m_ids.push_back(a_id);
+    m_coords.push_back(a_lat);
+    m_coords.push_back(a_lon);
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmNodeTable::sort()
+{
+    if (m_sorted)
+    {
+        return;
+    }
+
+    vector<size_t> order(m_ids.size());
+    for (size_t i=0; i<order.size(); i++)
+    {
+        order[i] = i;
+    }
+    const vector<int64_t>& ids = m_ids;
+    std::sort(order.begin(), order.end(), [&ids](size_t a, size_t b) { return (ids[a] < ids[b]); });
+
+    vector<int64_t> sortedIds(m_ids.size());
+    vector<int32_t> sortedCoords(m_coords.size());
+    for (size_t i=0; i<order.size(); i++)
+    {
+        sortedIds[i] = m_ids[order[i]];
+        sortedCoords[2*i] = m_coords[2*order[i]];
+        sortedCoords[2*i+1] = m_coords[2*order[i]+1];
+    }
+    m_ids.swap(sortedIds);
+    m_coords.swap(sortedCoords);
+    m_sorted = true;
+}
+
+//------------------------------------------------------------------------------
+
+ptrdiff_t cOsmNodeTable::find(int64_t a_id) const
+{
+    vector<int64_t>::const_iterator it = lower_bound(m_ids.begin(), m_ids.end(), a_id);
+    if ((it == m_ids.end()) || (*it != a_id))
+    {
+        return (-1);
+    }
+    return (it - m_ids.begin());
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmNodeTable::compact(const vector<char>& a_keep)
+{
+    size_t count = 0;
+    for (size_t i=0; i<m_ids.size(); i++)
+    {
+        if (a_keep[i])
+        {
+            m_ids[count] = m_ids[i];
+            m_coords[2*count] = m_coords[2*i];
+            m_coords[2*count+1] = m_coords[2*i+1];
+            count++;
+        }
+    }
+    m_ids.resize(count);
+    m_coords.resize(2 * count);
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmNodeTable::clear()
+{
+    m_ids.clear();
+    m_coords.clear();
+    m_sorted = true;
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmNodeTable::shrinkToFit()
+{
+    vector<int64_t>(m_ids).swap(m_ids);
+    vector<int32_t>(m_coords).swap(m_coords);
+}
+
+//------------------------------------------------------------------------------
+
+size_t cOsmNodeTable::getMemoryUsage() const
+{
+    return (m_ids.capacity() * sizeof(int64_t) + m_coords.capacity() * sizeof(int32_t));
+}
+
+//------------------------------------------------------------------------------
+// MAP
+//------------------------------------------------------------------------------
+
+const char* cOsmTags::getTag(const char* a_key) const
+{
+    for (size_t i=0; i<m_tags.size(); i++)
+    {
+        if (strcmp(m_tags[i].m_key, a_key) == 0)
+        {
+            return (m_tags[i].m_value);
+        }
+    }
+    return (NULL);
+}
+
+//------------------------------------------------------------------------------
+
+cOsmMap::cOsmMap()
+{
+    m_tagFilter = getDefaultTagFilter();
+    clear();
+}
+
+//------------------------------------------------------------------------------
+
+vector<string> cOsmMap::getDefaultTagFilter()
+{
+    static const char* keys[] =
+    {
+        // geometry
+        "building", "building:*", "roof:*", "height", "min_height", "layer",
+        "bridge", "tunnel", "type", "area",
+        // paths and routing
+        "highway", "footway", "surface", "width", "lanes", "oneway", "access",
+        "foot", "wheelchair", "tactile_paving", "entrance",
+        // labels and points of interest
+        "name", "ref", "amenity", "shop", "tourism", "leisure", "landuse", "natural"
+    };
+    return (vector<string>(keys, keys + sizeof(keys) / sizeof(keys[0])));
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMap::clear()
+{
+    m_nodes.clear();
+    m_ways.clear();
+    m_relations.clear();
+    m_nodeTable.clear();
+    m_strings.clear();
+    m_nodeIndex.clear();
+    m_wayIndex.clear();
+    m_hasBounds = false;
+    m_minLat = m_minLon = m_maxLat = m_maxLon = 0.0;
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMap::setBounds(double a_minLat, double a_minLon, double a_maxLat, double a_maxLon)
+{
+    m_hasBounds = true;
+    m_minLat = a_minLat;
+    m_minLon = a_minLon;
+    m_maxLat = a_maxLat;
+    m_maxLon = a_maxLon;
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMap::addNodeLocation(int64_t a_id, int32_t a_lat, int32_t a_lon)
+{
+    m_nodeTable.add(a_id, a_lat, a_lon);
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMap::addNode(cOsmNode a_node)
+{
+    // untagged nodes are only kept as coordinates
+    if (!a_node.m_tags.empty())
+    {
+        m_nodes.push_back(std::move(a_node));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMap::addWay(cOsmWay a_way)
+{
+    // untagged ways are kept until finalize(), since relations that refer to
+    // them come later in the file
+    m_ways.push_back(std::move(a_way));
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMap::addRelation(cOsmRelation a_relation)
+{
+    if (!a_relation.m_tags.empty())
+    {
+        m_relations.push_back(std::move(a_relation));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool cOsmMap::keepKey(const char* a_key, size_t a_length) const
+{
+    if (m_tagFilter.empty())
+    {
+        return (true);
+    }
+    for (size_t i=0; i<m_tagFilter.size(); i++)
+    {
+        const string& filter = m_tagFilter[i];
+        size_t length = filter.size();
+        if ((length > 0) && (filter[length-1] == '*'))
+        {
+            if ((a_length >= length - 1) && (memcmp(a_key, filter.data(), length - 1) == 0))
+            {
+                return (true);
+            }
+        }
+        else if ((a_length == length) && (memcmp(a_key, filter.data(), length) == 0))
+        {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+//------------------------------------------------------------------------------
+
+bool cOsmMap::makeTag(const char* a_key, size_t a_keyLength,
+                      const char* a_value, size_t a_valueLength, cOsmTag& a_tag)
+{
+    if (!keepKey(a_key, a_keyLength))
+    {
+        return (false);
+    }
+    a_tag.m_key = m_strings.intern(a_key, a_keyLength);
+    a_tag.m_value = m_strings.intern(a_value, a_valueLength);
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMap::finalize()
+{
+    m_nodeTable.sort();
+
+    // ways: keep tagged ways and ways used by relations
+    vector<int64_t> members;
+    for (size_t i=0; i<m_relations.size(); i++)
+    {
+        for (size_t k=0; k<m_relations[i].m_members.size(); k++)
+        {
+            const cOsmMember& member = m_relations[i].m_members[k];
+            if (member.m_type == cOsmMember::C_WAY)
+            {
+                members.push_back(member.m_ref);
+            }
+        }
+    }
+    sort(members.begin(), members.end());
+    members.erase(unique(members.begin(), members.end()), members.end());
+
+    size_t count = 0;
+    for (size_t i=0; i<m_ways.size(); i++)
+    {
+        if (!m_ways[i].m_tags.empty() || binary_search(members.begin(), members.end(), m_ways[i].m_id))
+        {
+            if (count != i)
+            {
+                m_ways[count] = std::move(m_ways[i]);
+            }
+            count++;
+        }
+    }
+    m_ways.resize(count);
+    vector<cOsmWay>(std::make_move_iterator(m_ways.begin()),
+                    std::make_move_iterator(m_ways.end())).swap(m_ways);
+
+    // nodes: keep the coordinates of nodes that are used by kept elements
+    // (bounds are computed from all nodes first)
+    if (!m_hasBounds && (m_nodeTable.size() > 0))
+    {
+        m_minLat = m_maxLat = m_nodeTable.getLat(0);
+        m_minLon = m_maxLon = m_nodeTable.getLon(0);
+        for (size_t i=1; i<m_nodeTable.size(); i++)
+        {
+            double lat = m_nodeTable.getLat(i);
+            double lon = m_nodeTable.getLon(i);
+            if (lat < m_minLat) m_minLat = lat;
+            if (lat > m_maxLat) m_maxLat = lat;
+            if (lon < m_minLon) m_minLon = lon;
+            if (lon > m_maxLon) m_maxLon = lon;
+        }
+    }
+
+    vector<char> keep(m_nodeTable.size(), 0);
+    for (size_t i=0; i<m_nodes.size(); i++)
+    {
+        ptrdiff_t index = m_nodeTable.find(m_nodes[i].m_id);
+        if (index >= 0) keep[index] = 1;
+    }
+    for (size_t i=0; i<m_ways.size(); i++)
+    {
+        for (size_t k=0; k<m_ways[i].m_nodeIds.size(); k++)
+        {
+            ptrdiff_t index = m_nodeTable.find(m_ways[i].m_nodeIds[k]);
+            if (index >= 0) keep[index] = 1;
+        }
+    }
+    for (size_t i=0; i<m_relations.size(); i++)
+    {
+        for (size_t k=0; k<m_relations[i].m_members.size(); k++)
+        {
+            const cOsmMember& member = m_relations[i].m_members[k];
+            if (member.m_type == cOsmMember::C_NODE)
+            {
+                ptrdiff_t index = m_nodeTable.find(member.m_ref);
+                if (index >= 0) keep[index] = 1;
+            }
+        }
+    }
+    m_nodeTable.compact(keep);
+    m_nodeTable.shrinkToFit();
+
+    // tagged nodes take their coordinates from the table
+    for (size_t i=0; i<m_nodes.size(); i++)
+    {
+        ptrdiff_t index = m_nodeTable.find(m_nodes[i].m_id);
+        if (index >= 0)
+        {
+            m_nodes[i].m_lat = m_nodeTable.getLat(index);
+            m_nodes[i].m_lon = m_nodeTable.getLon(index);
+        }
+    }
+
+    m_nodeIndex.clear();
+    m_nodeIndex.reserve(m_nodes.size());
+    for (size_t i=0; i<m_nodes.size(); i++)
+    {
+        m_nodeIndex[m_nodes[i].m_id] = i;
+    }
+
+    m_wayIndex.clear();
+    m_wayIndex.reserve(m_ways.size());
+    for (size_t i=0; i<m_ways.size(); i++)
+    {
+        m_wayIndex[m_ways[i].m_id] = i;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+size_t cOsmMap::getMemoryUsage() const
+{
+    size_t size = m_nodeTable.getMemoryUsage() + m_strings.getMemoryUsage();
+    size += m_nodes.capacity() * sizeof(cOsmNode);
+    for (size_t i=0; i<m_nodes.size(); i++)
+    {
+        size += m_nodes[i].m_tags.capacity() * sizeof(cOsmTag);
+    }
+    size += m_ways.capacity() * sizeof(cOsmWay);
+    for (size_t i=0; i<m_ways.size(); i++)
+    {
+        size += m_ways[i].m_tags.capacity() * sizeof(cOsmTag);
+        size += m_ways[i].m_nodeIds.capacity() * sizeof(int64_t);
+    }
+    size += m_relations.capacity() * sizeof(cOsmRelation);
+    for (size_t i=0; i<m_relations.size(); i++)
+    {
+        size += m_relations[i].m_tags.capacity() * sizeof(cOsmTag);
+        size += m_relations[i].m_members.capacity() * sizeof(cOsmMember);
+    }
+
+    // hash indices: one node per element plus the bucket array
+    size += (m_nodeIndex.size() + m_wayIndex.size()) * (sizeof(int64_t) + sizeof(size_t) + 2 * sizeof(void*));
+    size += (m_nodeIndex.bucket_count() + m_wayIndex.bucket_count()) * sizeof(void*);
+    return (size);
+}
+
+//------------------------------------------------------------------------------
+
+const cOsmNode* cOsmMap::findNode(int64_t a_id) const
+{
+    unordered_map<int64_t, size_t>::const_iterator it = m_nodeIndex.find(a_id);
+    return ((it == m_nodeIndex.end()) ? NULL : &m_nodes[it->second]);
+}
+
+//------------------------------------------------------------------------------
+
+const cOsmWay* cOsmMap::findWay(int64_t a_id) const
+{
+    unordered_map<int64_t, size_t>::const_iterator it = m_wayIndex.find(a_id);
+    return ((it == m_wayIndex.end()) ? NULL : &m_ways[it->second]);
+}
+
+//------------------------------------------------------------------------------
+
+bool cOsmMap::getNodeLocation(int64_t a_id, double& a_lat, double& a_lon) const
+{
+    ptrdiff_t index = m_nodeTable.find(a_id);
+    if (index < 0)
+    {
+        return (false);
+    }
+    a_lat = m_nodeTable.getLat(index);
+    a_lon = m_nodeTable.getLon(index);
+    return (true);
+}
+
+
+//------------------------------------------------------------------------------
+// XML READER
+//------------------------------------------------------------------------------
+
+namespace
+{
+    inline bool nameIs(const char* a_name, size_t a_length, const char* a_expected)
+    {
+        return ((strncmp(a_name, a_expected, a_length) == 0) && (a_expected[a_length] == '\0'));
+    }
+
+    //--------------------------------------------------------------------------
+
+    int64_t parseInteger(const char* a_value, size_t a_length)
+    {
+        const char* c = a_value;
+        const char* end = a_value + a_length;
+        bool negative = ((c < end) && (*c == '-'));
+        if (negative) c++;
+        int64_t value = 0;
+        while ((c < end) && (*c >= '0') && (*c <= '9'))
+        {
+            value = 10 * value + (*c++ - '0');
+        }
+        return (negative ? -value : value);
+    }
+
+    //--------------------------------------------------------------------------
+
+    // decimal degrees to OSM fixed point (1e-7 degrees), rounded
+    int32_t parseCoordinate(const char* a_value, size_t a_length)
+    {
+        const char* c = a_value;
+        const char* end = a_value + a_length;
+        bool negative = ((c < end) && (*c == '-'));
+        if (negative || ((c < end) && (*c == '+'))) c++;
+
+        int64_t value = 0;
+        while ((c < end) && (*c >= '0') && (*c <= '9'))
+        {
+            value = 10 * value + (*c++ - '0');
+        }
+        int digits = 0;
+        if ((c < end) && (*c == '.'))
+        {
+            c++;
+            while ((c < end) && (*c >= '0') && (*c <= '9') && (digits < 7))
+            {
+                value = 10 * value + (*c++ - '0');
+                digits++;
+            }
+            if ((c < end) && (*c >= '5') && (*c <= '9'))
+            {
+                value++;
+            }
+        }
+        for (; digits < 7; digits++)
+        {
+            value *= 10;
+        }
+        return ((int32_t)(negative ? -value : value));
+    }
+
+    //--------------------------------------------------------------------------
+
+    // builds a cOsmMap from the elements of an .osm file
+    class cOsmXmlHandler : public cXmlHandler
+    {
+    public:
+
+        cOsmXmlHandler(cOsmMap& a_map) : m_map(a_map), m_parent(C_NONE) {}
+
+        virtual void startElement(const char* a_name, size_t a_nameLength,
+                                  const cXmlAttribute* a_attributes, size_t a_numAttributes)
+        {
+            if (nameIs(a_name, a_nameLength, "node"))
+            {
+                m_parent = C_NODE;
+                m_node.m_id = 0;
+                m_node.m_tags.clear();
+                m_lat = m_lon = 0;
+                for (size_t i=0; i<a_numAttributes; i++)
+                {
+                    const cXmlAttribute& a = a_attributes[i];
+                    if (a.is("id"))       m_node.m_id = parseInteger(a.m_value, a.m_valueLength);
+                    else if (a.is("lat")) m_lat = parseCoordinate(a.m_value, a.m_valueLength);
+                    else if (a.is("lon")) m_lon = parseCoordinate(a.m_value, a.m_valueLength);
+                }
+            }
+            else if (nameIs(a_name, a_nameLength, "nd"))
+            {
+                if (m_parent != C_WAY) return;
+                for (size_t i=0; i<a_numAttributes; i++)
+                {
+                    if (a_attributes[i].is("ref"))
+                    {
+                        m_way.m_nodeIds.push_back(parseInteger(a_attributes[i].m_value, a_attributes[i].m_valueLength));
+                    }
+                }
+            }
+            else if (nameIs(a_name, a_nameLength, "tag"))
+            {
+                if (m_parent == C_NONE) return;
+                const cXmlAttribute* key = NULL;
+                const cXmlAttribute* value = NULL;
+                for (size_t i=0; i<a_numAttributes; i++)
+                {
+                    if (a_attributes[i].is("k"))      key = &a_attributes[i];
+                    else if (a_attributes[i].is("v")) value = &a_attributes[i];
+                }
+                if ((key == NULL) || (value == NULL))
+                {
+                    return;
+                }
+
+                // filter on the raw key first; only kept tags are decoded
+                if (!m_map.keepKey(key->m_value, key->m_valueLength))
+                {
+                    return;
+                }
+                cOsmTag tag;
+                cXmlStreamReader::decode(key->m_value, key->m_valueLength, m_key);
+                cXmlStreamReader::decode(value->m_value, value->m_valueLength, m_value);
+                if (!m_map.makeTag(m_key.data(), m_key.size(), m_value.data(), m_value.size(), tag))
+                {
+                    return;
+                }
+
+                cOsmTags& tags = (m_parent == C_NODE) ? (cOsmTags&)m_node :
+                                 (m_parent == C_WAY) ? (cOsmTags&)m_way : (cOsmTags&)m_relation;
+                tags.m_tags.push_back(tag);
+            }
+            else if (nameIs(a_name, a_nameLength, "way"))
+            {
+                m_parent = C_WAY;
+                m_way = cOsmWay();
+                m_way.m_id = 0;
+                for (size_t i=0; i<a_numAttributes; i++)
+                {
+                    if (a_attributes[i].is("id")) m_way.m_id = parseInteger(a_attributes[i].m_value, a_attributes[i].m_valueLength);
+                }
+            }
+            else if (nameIs(a_name, a_nameLength, "member"))
+            {
+                if (m_parent != C_RELATION) return;
+                cOsmMember member;
+                member.m_type = cOsmMember::C_NODE;
+                member.m_ref = 0;
+                member.m_role = m_map.intern("", 0);
+                for (size_t i=0; i<a_numAttributes; i++)
+                {
+                    const cXmlAttribute& a = a_attributes[i];
+                    if (a.is("type"))
+                    {
+                        member.m_type = nameIs(a.m_value, a.m_valueLength, "way") ? cOsmMember::C_WAY :
+                                        nameIs(a.m_value, a.m_valueLength, "relation") ? cOsmMember::C_RELATION :
+                                                                                          cOsmMember::C_NODE;
+                    }
+                    else if (a.is("ref"))
+                    {
+                        member.m_ref = parseInteger(a.m_value, a.m_valueLength);
+                    }
+                    else if (a.is("role"))
+                    {
+                        cXmlStreamReader::decode(a.m_value, a.m_valueLength, m_value);
+                        member.m_role = m_map.intern(m_value.data(), m_value.size());
+                    }
+                }
+                m_relation.m_members.push_back(member);
+            }
+            else if (nameIs(a_name, a_nameLength, "relation"))
+            {
+                m_parent = C_RELATION;
+                m_relation = cOsmRelation();
+                m_relation.m_id = 0;
+                for (size_t i=0; i<a_numAttributes; i++)
+                {
+                    if (a_attributes[i].is("id")) m_relation.m_id = parseInteger(a_attributes[i].m_value, a_attributes[i].m_valueLength);
+                }
+            }
+            else if (nameIs(a_name, a_nameLength, "bounds"))
+            {
+                double minLat = 0, minLon = 0, maxLat = 0, maxLon = 0;
+                for (size_t i=0; i<a_numAttributes; i++)
+                {
+                    const cXmlAttribute& a = a_attributes[i];
+                    double value = 1e-7 * parseCoordinate(a.m_value, a.m_valueLength);
+                    if (a.is("minlat"))      minLat = value;
+                    else if (a.is("minlon")) minLon = value;
+                    else if (a.is("maxlat")) maxLat = value;
+                    else if (a.is("maxlon")) maxLon = value;
+                }
+                m_map.setBounds(minLat, minLon, maxLat, maxLon);
+            }
+        }
+
+        virtual void endElement(const char* a_name, size_t a_nameLength)
+        {
+            if ((m_parent == C_NODE) && nameIs(a_name, a_nameLength, "node"))
+            {
+                m_map.addNodeLocation(m_node.m_id, m_lat, m_lon);
+                if (!m_node.m_tags.empty())
+                {
+                    m_node.m_lat = 1e-7 * m_lat;
+                    m_node.m_lon = 1e-7 * m_lon;
+                    m_map.addNode(m_node);
+                }
+                m_parent = C_NONE;
+            }
+            else if ((m_parent == C_WAY) && nameIs(a_name, a_nameLength, "way"))
+            {
+                m_map.addWay(std::move(m_way));
+                m_parent = C_NONE;
+            }
+            else if ((m_parent == C_RELATION) && nameIs(a_name, a_nameLength, "relation"))
+            {
+                m_map.addRelation(std::move(m_relation));
+                m_parent = C_NONE;
+            }
+        }
+
+    private:
+
+        cOsmMap& m_map;
+        enum { C_NONE, C_NODE, C_WAY, C_RELATION } m_parent;
+
+        // element being read
+        cOsmNode m_node;
+        int32_t m_lat;
+        int32_t m_lon;
+        cOsmWay m_way;
+        cOsmRelation m_relation;
+
+        // decoded tag, reused between tags
+        string m_key;
+        string m_value;
+    };
+}
+
+//------------------------------------------------------------------------------
+
+bool cOsmMap::loadFromFile(const string& a_filename)
+{
+    if (cOsmPbfReader::isPbfFile(a_filename))
+    {
+        cOsmPbfReader reader;
+        return (reader.read(a_filename, *this));
+    }
+
+    clear();
+
+    cOsmXmlHandler handler(*this);
+    cXmlStreamReader reader;
+    if (!reader.read(a_filename, handler))
+    {
+        return (false);
+    }
+
+    finalize();
+    return (true);
+}
@@ -0,0 +1,252 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef COsmMapH
+#define COsmMapH
+//------------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Interned strings. Each distinct string is stored once; the returned
+// pointers stay valid until clear() and equal strings get equal pointers.
+//------------------------------------------------------------------------------
+class cOsmStringTable
+{
+public:
+
+    cOsmStringTable();
+
+    // stored copy of a_string[0..a_length)
+    const char* intern(const char* a_string, size_t a_length);
+
+    // remove all strings
+    void clear();
+
+    // number of distinct strings and bytes used to store them
+    size_t getNumStrings() const { return (m_numStrings); }
+    size_t getMemoryUsage() const;
+
+private:
+
+    // strings are stored back to back in blocks that are never reallocated
+    std::vector<std::vector<char> > m_blocks;
+    size_t m_blockUsed;
+
+    // open addressing table of stored strings
+    std::vector<const char*> m_slots;
+    size_t m_numStrings;
+};
+
+//------------------------------------------------------------------------------
+
+struct cOsmTag
+{
+    const char* m_key;
+    const char* m_value;
+};
+
+//------------------------------------------------------------------------------
+// Key/value tags attached to an OSM element. Keys and values are interned
+// by the map that owns the element.
+//------------------------------------------------------------------------------
+struct cOsmTags
+{
+    // value of tag a_key, or NULL if the element does not carry it
+    const char* getTag(const char* a_key) const;
+
+    // true if the element carries tag a_key
+    bool hasTag(const char* a_key) const { return (getTag(a_key) != NULL); }
+
+    std::vector<cOsmTag> m_tags;
+};
+
+//------------------------------------------------------------------------------
+
+struct cOsmNode : public cOsmTags
+{
+    int64_t m_id;
+    double m_lat;
+    double m_lon;
+};
+
+//------------------------------------------------------------------------------
+
+struct cOsmWay : public cOsmTags
+{
+    int64_t m_id;
+    std::vector<int64_t> m_nodeIds;
+
+    // first and last node are the same
+    bool isClosed() const { return ((m_nodeIds.size() > 3) && (m_nodeIds.front() == m_nodeIds.back())); }
+};
+
+//------------------------------------------------------------------------------
+
+struct cOsmMember
+{
+    enum cType { C_NODE, C_WAY, C_RELATION };
+
+    cType m_type;
+    int64_t m_ref;
+    const char* m_role;
+};
+
+//------------------------------------------------------------------------------
+
+struct cOsmRelation : public cOsmTags
+{
+    int64_t m_id;
+    std::vector<cOsmMember> m_members;
+};
+
+//------------------------------------------------------------------------------
+// Coordinates of all nodes, sorted by id. Coordinates are stored in OSM's
+// own fixed point format (1e-7 degrees), 16 bytes per node.
+//------------------------------------------------------------------------------
+class cOsmNodeTable
+{
+public:
+
+    cOsmNodeTable() : m_sorted(true) {}
+
+    // add a node. coordinates in 1e-7 degrees.
+    void add(int64_t a_id, int32_t a_lat, int32_t a_lon);
+
+    // sort by id if nodes were not added in order. must be called before find().
+    void sort();
+
+    // index of node a_id, or -1
+    ptrdiff_t find(int64_t a_id) const;
+
+    // keep only the nodes whose a_keep flag is set
+    void compact(const std::vector<char>& a_keep);
+
+    void clear();
+    void shrinkToFit();
+
+    size_t size() const { return (m_ids.size()); }
+    int64_t getId(size_t a_index) const { return (m_ids[a_index]); }
+    double getLat(size_t a_index) const { return (1e-7 * m_coords[2*a_index]); }
+    double getLon(size_t a_index) const { return (1e-7 * m_coords[2*a_index+1]); }
+    size_t getMemoryUsage() const;
+
+private:
+
+    std::vector<int64_t> m_ids;
+    std::vector<int32_t> m_coords;
+    bool m_sorted;
+};
+
+//------------------------------------------------------------------------------
+// In-memory OpenStreetMap extract. Only the tags named by the tag filter are
+// kept, and only nodes with such tags are stored as cOsmNode; all other
+// nodes are reduced to their coordinates. Ways without kept tags are dropped
+// unless a relation refers to them.
+//------------------------------------------------------------------------------
+class cOsmMap
+{
+public:
+
+    cOsmMap();
+
+    // load an OSM XML (.osm) or PBF (.osm.pbf) file. returns false if the
+    // file cannot be read.
+    bool loadFromFile(const std::string& a_filename);
+
+    // remove all data
+    void clear();
+
+    // tag keys to keep. a trailing '*' matches any suffix ("building:*").
+    // an empty filter keeps all tags. must be set before loading.
+    void setTagFilter(const std::vector<std::string>& a_keys) { m_tagFilter = a_keys; }
+    const std::vector<std::string>& getTagFilter() const { return (m_tagFilter); }
+
+    // the keys used by the map builders, labels and routing
+    static std::vector<std::string> getDefaultTagFilter();
+
+    // elements. nodes are the tagged nodes only.
+    const std::vector<cOsmNode>& getNodes() const { return (m_nodes); }
+    const std::vector<cOsmWay>& getWays() const { return (m_ways); }
+    const std::vector<cOsmRelation>& getRelations() const { return (m_relations); }
+
+    // tagged node / way with a given id, or NULL
+    const cOsmNode* findNode(int64_t a_id) const;
+    const cOsmWay* findWay(int64_t a_id) const;
+
+    // coordinates of node a_id. returns false if the node is not in the extract.
+    bool getNodeLocation(int64_t a_id, double& a_lat, double& a_lon) const;
+
+    // coordinates of all nodes
+    const cOsmNodeTable& getNodeTable() const { return (m_nodeTable); }
+
+    // bounding box of the extract, from <bounds> or from the nodes
+    double getMinLat() const { return (m_minLat); }
+    double getMinLon() const { return (m_minLon); }
+    double getMaxLat() const { return (m_maxLat); }
+    double getMaxLon() const { return (m_maxLon); }
+
+    // approximate heap memory used by the map, in bytes
+    size_t getMemoryUsage() const;
+
+    // builders, used by the file readers. tags are filtered and interned.
+    void setBounds(double a_minLat, double a_minLon, double a_maxLat, double a_maxLon);
+    void addNodeLocation(int64_t a_id, int32_t a_lat, int32_t a_lon);
+    void addNode(cOsmNode a_node);
+    void addWay(cOsmWay a_way);
+    void addRelation(cOsmRelation a_relation);
+
+    // true if the tag filter keeps tags with key a_key[0..a_length)
+    bool keepKey(const char* a_key, size_t a_length) const;
+
+    // interned copy of a tag for an element, or false if the filter drops it
+    bool makeTag(const char* a_key, size_t a_keyLength,
+                 const char* a_value, size_t a_valueLength, cOsmTag& a_tag);
+
+    // interned copy of a string (member roles)
+    const char* intern(const char* a_string, size_t a_length) { return (m_strings.intern(a_string, a_length)); }
+
+    // finish loading: drop unreferenced ways and nodes, build indices and
+    // compute bounds if none were given
+    void finalize();
+
+private:
+
+    // the map points into its string table, so it cannot be copied
+    cOsmMap(const cOsmMap&);
+    cOsmMap& operator=(const cOsmMap&);
+
+    std::vector<cOsmNode> m_nodes;
+    std::vector<cOsmWay> m_ways;
+    std::vector<cOsmRelation> m_relations;
+    cOsmNodeTable m_nodeTable;
+    cOsmStringTable m_strings;
+    std::vector<std::string> m_tagFilter;
+
+    // id -> index
+    std::unordered_map<int64_t, size_t> m_nodeIndex;
+    std::unordered_map<int64_t, size_t> m_wayIndex;
+
+    // bounds
+    bool m_hasBounds;
+    double m_minLat;
+    double m_minLon;
+    double m_maxLat;
+    double m_maxLon;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,533 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "COsmMeshBuilder.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+namespace
+{
+    // twice the signed area of a ring in the xy plane
+    double signedArea(const vector<cVector3d>& a_ring)
+    {
+        double area = 0.0;
+        for (size_t i=0, j=a_ring.size()-1; i<a_ring.size(); j=i++)
+        {
+            area += a_ring[j](0) * a_ring[i](1) - a_ring[i](0) * a_ring[j](1);
+        }
+        return (area);
+    }
+
+    //--------------------------------------------------------------------------
+
+    // z component of (b - a) x (c - a)
+    inline double cross2(const cVector3d& a, const cVector3d& b, const cVector3d& c)
+    {
+        return ((b(0) - a(0)) * (c(1) - a(1)) - (b(1) - a(1)) * (c(0) - a(0)));
+    }
+
+    //--------------------------------------------------------------------------
+
+    // join open way segments into closed rings of node ids
+    void assembleRings(vector<vector<int64_t> > a_segments, vector<vector<int64_t> >& a_rings)
+    {
+        while (!a_segments.empty())
+        {
+            vector<int64_t> ring = a_segments.back();
+            a_segments.pop_back();
+
+            bool extended = true;
+            while ((ring.front() != ring.back()) && extended)
+            {
+                extended = false;
+                for (size_t i=0; i<a_segments.size(); i++)
+                {
+                    vector<int64_t>& s = a_segments[i];
+                    if (s.front() == ring.back())
+                    {
+                        ring.insert(ring.end(), s.begin() + 1, s.end());
+                    }
+                    else if (s.back() == ring.back())
+                    {
+                        ring.insert(ring.end(), s.rbegin() + 1, s.rend());
+                    }
+                    else
+                    {
+                        continue;
+                    }
+                    a_segments.erase(a_segments.begin() + i);
+                    extended = true;
+                    break;
+                }
+            }
+
+            if ((ring.size() > 3) && (ring.front() == ring.back()))
+            {
+                a_rings.push_back(ring);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cOsmMeshBuilder::cOsmMeshBuilder(const cOsmMap& a_map, const cOsmMeshSettings& a_settings) :
+    m_map(a_map),
+    m_settings(a_settings)
+{
+    // metric frame centered on the extract
+    double lat0 = 0.5 * (a_map.getMinLat() + a_map.getMaxLat());
+    double lon0 = 0.5 * (a_map.getMinLon() + a_map.getMaxLon());
+    m_projection.setOrigin(lat0, lon0);
+
+    double scale = a_settings.m_scale;
+    if (scale <= 0.0)
+    {
+        double e0, n0, e1, n1;
+        m_projection.toMeters(a_map.getMinLat(), a_map.getMinLon(), e0, n0);
+        m_projection.toMeters(a_map.getMaxLat(), a_map.getMaxLon(), e1, n1);
+        double extent = cMax(e1 - e0, n1 - n0);
+        scale = (extent > 0.0) ? a_settings.m_mapSize / extent : 1.0;
+    }
+
+    m_projection.setScale(scale, scale * a_settings.m_heightExaggeration);
+    m_projection.setRotationDeg(a_settings.m_rotationDeg);
+}
+
+//------------------------------------------------------------------------------
+
+double cOsmMeshBuilder::getBuildingHeight(const cOsmTags& a_tags) const
+{
+    const char* height = a_tags.getTag("height");
+    if (height != NULL)
+    {
+        double value = strtod(height, NULL);
+        if (value > 0.0)
+        {
+            return (value);
+        }
+    }
+
+    const char* levels = a_tags.getTag("building:levels");
+    if (levels != NULL)
+    {
+        double value = strtod(levels, NULL);
+        if (value > 0.0)
+        {
+            return (value * m_settings.m_levelHeight);
+        }
+    }
+
+    return (m_settings.m_defaultLevels * m_settings.m_levelHeight);
+}
+
+//------------------------------------------------------------------------------
+
+double cOsmMeshBuilder::getPathWidth(const char* a_highway)
+{
+    struct cWidth { const char* m_type; double m_width; };
+    static const cWidth widths[] =
+    {
+        { "footway", 2.5 }, { "path", 2.0 }, { "steps", 2.5 }, { "cycleway", 3.0 },
+        { "pedestrian", 6.0 }, { "living_street", 6.0 }, { "service", 5.0 },
+        { "track", 4.0 }, { "residential", 7.0 }, { "unclassified", 7.0 },
+        { "tertiary", 8.0 }, { "secondary", 10.0 }, { "primary", 12.0 }
+    };
+
+    for (size_t i=0; i<sizeof(widths) / sizeof(widths[0]); i++)
+    {
+        if (strcmp(widths[i].m_type, a_highway) == 0)
+        {
+            return (widths[i].m_width);
+        }
+    }
+    return (0.0);
+}
+
+//------------------------------------------------------------------------------
+
+bool cOsmMeshBuilder::makeRing(const vector<int64_t>& a_nodeIds, vector<cVector3d>& a_ring) const
+{
+    a_ring.clear();
+    for (size_t i=0; i<a_nodeIds.size(); i++)
+    {
+        double lat, lon;
+        if (m_map.getNodeLocation(a_nodeIds[i], lat, lon))
+        {
+            a_ring.push_back(m_projection.toLocal(lat, lon));
+        }
+    }
+
+    // drop the closing node and repeated points
+    if ((a_ring.size() > 1) && a_ring.front().equals(a_ring.back()))
+    {
+        a_ring.pop_back();
+    }
+    for (size_t i=1; i<a_ring.size(); )
+    {
+        if (a_ring[i].equals(a_ring[i-1])) a_ring.erase(a_ring.begin() + i);
+        else i++;
+    }
+
+    return (a_ring.size() >= 3);
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMeshBuilder::extractBuildings(vector<cOsmBuilding>& a_buildings) const
+{
+    a_buildings.clear();
+
+    vector<cVector3d> ring;
+
+    // closed ways tagged building
+    const vector<cOsmWay>& ways = m_map.getWays();
+    for (size_t i=0; i<ways.size(); i++)
+    {
+        const cOsmWay& way = ways[i];
+        if (!way.hasTag("building") || !way.isClosed() || !makeRing(way.m_nodeIds, ring))
+        {
+            continue;
+        }
+
+        cOsmBuilding building;
+        building.m_id = way.m_id;
+        const char* name = way.getTag("name");
+        building.m_name = (name != NULL) ? name : "";
+        building.m_ring = ring;
+        building.m_height = getBuildingHeight(way);
+        a_buildings.push_back(building);
+    }
+
+    // multipolygon buildings: one volume per outer ring. inner rings
+    // (courtyards) are not cut out.
+    const vector<cOsmRelation>& relations = m_map.getRelations();
+    for (size_t i=0; i<relations.size(); i++)
+    {
+        const cOsmRelation& relation = relations[i];
+        const char* type = relation.getTag("type");
+        if (!relation.hasTag("building") || (type == NULL) || (strcmp(type, "multipolygon") != 0))
+        {
+            continue;
+        }
+
+        vector<vector<int64_t> > segments;
+        for (size_t k=0; k<relation.m_members.size(); k++)
+        {
+            const cOsmMember& member = relation.m_members[k];
+            if ((member.m_type != cOsmMember::C_WAY) || (strcmp(member.m_role, "outer") != 0))
+            {
+                continue;
+            }
+            const cOsmWay* way = m_map.findWay(member.m_ref);
+            if ((way != NULL) && (way->m_nodeIds.size() > 1))
+            {
+                segments.push_back(way->m_nodeIds);
+            }
+        }
+
+        vector<vector<int64_t> > rings;
+        assembleRings(segments, rings);
+
+        for (size_t k=0; k<rings.size(); k++)
+        {
+            if (!makeRing(rings[k], ring))
+            {
+                continue;
+            }
+
+            cOsmBuilding building;
+            building.m_id = relation.m_id;
+            const char* name = relation.getTag("name");
+            building.m_name = (name != NULL) ? name : "";
+            building.m_ring = ring;
+            building.m_height = getBuildingHeight(relation);
+            a_buildings.push_back(building);
+        }
+    }
+
+    // counter-clockwise footprints
+    for (size_t i=0; i<a_buildings.size(); i++)
+    {
+        if (signedArea(a_buildings[i].m_ring) < 0.0)
+        {
+            reverse(a_buildings[i].m_ring.begin(), a_buildings[i].m_ring.end());
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMeshBuilder::extractPaths(vector<cOsmPath>& a_paths) const
+{
+    a_paths.clear();
+
+    const vector<cOsmWay>& ways = m_map.getWays();
+    for (size_t i=0; i<ways.size(); i++)
+    {
+        const cOsmWay& way = ways[i];
+        const char* highway = way.getTag("highway");
+        const char* area = way.getTag("area");
+        if ((highway == NULL) || ((area != NULL) && (strcmp(area, "yes") == 0)))
+        {
+            continue;
+        }
+
+        double width = getPathWidth(highway);
+        if (width <= 0.0)
+        {
+            continue;
+        }
+
+        cOsmPath path;
+        path.m_id = way.m_id;
+        const char* name = way.getTag("name");
+        path.m_name = (name != NULL) ? name : "";
+        path.m_width = cMax(width * m_projection.getScale(), m_settings.m_minPathWidth);
+
+        for (size_t k=0; k<way.m_nodeIds.size(); k++)
+        {
+            double lat, lon;
+            if (m_map.getNodeLocation(way.m_nodeIds[k], lat, lon))
+            {
+                cVector3d p = m_projection.toLocal(lat, lon);
+                if (path.m_points.empty() || !path.m_points.back().equals(p))
+                {
+                    path.m_points.push_back(p);
+                }
+            }
+        }
+
+        if (path.m_points.size() >= 2)
+        {
+            a_paths.push_back(path);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMeshBuilder::triangulate(const vector<cVector3d>& a_ring, vector<int>& a_triangles)
+{
+    int n = (int)a_ring.size();
+    if (n < 3)
+    {
+        return;
+    }
+
+    vector<int> remaining(n);
+    for (int i=0; i<n; i++)
+    {
+        remaining[i] = i;
+    }
+
+    int guard = 2 * n;
+    int i = 0;
+    while ((remaining.size() > 3) && (guard > 0))
+    {
+        int count = (int)remaining.size();
+        int i0 = remaining[(i + count - 1) % count];
+        int i1 = remaining[i % count];
+        int i2 = remaining[(i + 1) % count];
+        const cVector3d& a = a_ring[i0];
+        const cVector3d& b = a_ring[i1];
+        const cVector3d& c = a_ring[i2];
+
+        // convex corner with no other vertex inside the triangle
+        bool ear = (cross2(a, b, c) > 0.0);
+        for (int k=0; ear && (k<count); k++)
+        {
+            int j = remaining[k];
+            if ((j == i0) || (j == i1) || (j == i2))
+            {
+                continue;
+            }
+            const cVector3d& p = a_ring[j];
+            if ((cross2(a, b, p) >= 0.0) && (cross2(b, c, p) >= 0.0) && (cross2(c, a, p) >= 0.0))
+            {
+                ear = false;
+            }
+        }
+
+        if (ear)
+        {
+            a_triangles.push_back(i0);
+            a_triangles.push_back(i1);
+            a_triangles.push_back(i2);
+            remaining.erase(remaining.begin() + (i % count));
+            guard = 2 * (int)remaining.size();
+        }
+        else
+        {
+            i++;
+            guard--;
+        }
+    }
+
+    // degenerate or self-intersecting leftovers: close with a fan
+    for (size_t k=1; k+1<remaining.size(); k++)
+    {
+        a_triangles.push_back(remaining[0]);
+        a_triangles.push_back(remaining[k]);
+        a_triangles.push_back(remaining[k+1]);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cVector3d cOsmMeshBuilder::getLabelAnchor(const cOsmBuilding& a_building) const
+{
+    cVector3d center(0.0, 0.0, 0.0);
+    for (size_t i=0; i<a_building.m_ring.size(); i++)
+    {
+        center += a_building.m_ring[i];
+    }
+    if (!a_building.m_ring.empty())
+    {
+        center /= (double)a_building.m_ring.size();
+    }
+    center(2) = a_building.m_height * m_projection.getVerticalScale();
+    return (center);
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMeshBuilder::appendBuilding(cMesh* a_mesh, const cOsmBuilding& a_building) const
+{
+    const vector<cVector3d>& ring = a_building.m_ring;
+    cVector3d up(0.0, 0.0, a_building.m_height * m_projection.getVerticalScale());
+
+    // walls, outward facing for a counter-clockwise footprint
+    for (size_t i=0; i<ring.size(); i++)
+    {
+        const cVector3d& a = ring[i];
+        const cVector3d& b = ring[(i + 1) % ring.size()];
+        a_mesh->newTriangle(a, b, b + up);
+        a_mesh->newTriangle(a, b + up, a + up);
+    }
+
+    // roof
+    vector<int> triangles;
+    triangulate(ring, triangles);
+    for (size_t i=0; i+2<triangles.size(); i+=3)
+    {
+        a_mesh->newTriangle(ring[triangles[i]] + up, ring[triangles[i+1]] + up, ring[triangles[i+2]] + up);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMeshBuilder::appendPath(cMesh* a_mesh, const cOsmPath& a_path) const
+{
+    const vector<cVector3d>& points = a_path.m_points;
+    size_t n = points.size();
+    double halfWidth = 0.5 * a_path.m_width;
+    cVector3d up(0.0, 0.0, m_settings.m_pathRaise);
+
+    // left/right borders with mitered joints
+    vector<cVector3d> left(n), right(n);
+    for (size_t i=0; i<n; i++)
+    {
+        cVector3d d0 = (i > 0) ? points[i] - points[i-1] : points[i+1] - points[i];
+        cVector3d d1 = (i + 1 < n) ? points[i+1] - points[i] : d0;
+        d0.normalize();
+        d1.normalize();
+
+        cVector3d n0(-d0(1), d0(0), 0.0);
+        cVector3d n1(-d1(1), d1(0), 0.0);
+        cVector3d miter = n0 + n1;
+        double length = miter.length();
+        if (length < C_SMALL)
+        {
+            miter = n0;
+        }
+        else
+        {
+            miter /= length;
+        }
+
+        // limit the spikes of sharp turns
+        double scale = halfWidth / cMax(miter.dot(n0), 0.5);
+        left[i] = points[i] + scale * miter;
+        right[i] = points[i] - scale * miter;
+    }
+
+    for (size_t i=0; i+1<n; i++)
+    {
+        // top
+        a_mesh->newTriangle(left[i] + up, right[i] + up, right[i+1] + up);
+        a_mesh->newTriangle(left[i] + up, right[i+1] + up, left[i+1] + up);
+
+        // sides
+        a_mesh->newTriangle(left[i], left[i] + up, left[i+1] + up);
+        a_mesh->newTriangle(left[i], left[i+1] + up, left[i+1]);
+        a_mesh->newTriangle(right[i], right[i+1], right[i+1] + up);
+        a_mesh->newTriangle(right[i], right[i+1] + up, right[i] + up);
+    }
+
+    // end caps
+    a_mesh->newTriangle(right[0], left[0], left[0] + up);
+    a_mesh->newTriangle(right[0], left[0] + up, right[0] + up);
+    a_mesh->newTriangle(left[n-1], right[n-1], right[n-1] + up);
+    a_mesh->newTriangle(left[n-1], right[n-1] + up, left[n-1] + up);
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmMeshBuilder::buildMeshes(cMultiMesh* a_multiMesh,
+                                  const vector<cOsmBuilding>& a_buildings,
+                                  const vector<cOsmPath>& a_paths) const
+{
+    cMesh* buildingMesh = a_multiMesh->newMesh();
+    buildingMesh->m_name = "buildings";
+    buildingMesh->m_material->m_diffuse.set(0.8f, 0.4f, 0.16f);
+    for (size_t i=0; i<a_buildings.size(); i++)
+    {
+        appendBuilding(buildingMesh, a_buildings[i]);
+    }
+
+    cMesh* pathMesh = a_multiMesh->newMesh();
+    pathMesh->m_name = "paths";
+    pathMesh->m_material->m_diffuse.set(0.53f, 0.53f, 0.53f);
+    for (size_t i=0; i<a_paths.size(); i++)
+    {
+        appendPath(pathMesh, a_paths[i]);
+    }
+
+    a_multiMesh->computeAllNormals();
+}
+
+//------------------------------------------------------------------------------
+
+bool cOsmMeshBuilder::build(cMultiMesh* a_multiMesh) const
+{
+    vector<cOsmBuilding> buildings;
+    vector<cOsmPath> paths;
+    extractBuildings(buildings);
+    extractPaths(paths);
+
+    if (buildings.empty() && paths.empty())
+    {
+        return (false);
+    }
+
+    buildMeshes(a_multiMesh, buildings, paths);
+
+    cout << "OSM map: " << buildings.size() << " buildings, " << paths.size() << " paths, "
+         << a_multiMesh->getNumTriangles() << " triangles" << endl;
+
+    return (true);
+}
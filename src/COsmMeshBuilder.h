@@ -0,0 +1,140 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef COsmMeshBuilderH
+#define COsmMeshBuilderH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "COsmMap.h"
+#include "COsmProjection.h"
+//------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Settings for turning OSM features into haptic geometry. Lengths are in
+// metres unless marked as world units.
+//------------------------------------------------------------------------------
+struct cOsmMeshSettings
+{
+    cOsmMeshSettings() :
+        m_mapSize(0.6),
+        m_scale(0.0),
+        m_rotationDeg(0.0),
+        m_heightExaggeration(1.0),
+        m_levelHeight(3.0),
+        m_defaultLevels(3.0),
+        m_pathRaise(0.002),
+        m_minPathWidth(0.004) {}
+
+    // size of the larger side of the extract in world units, used to derive
+    // the scale when m_scale is not set
+    double m_mapSize;
+
+    // world units per metre (0 = fit the extract into m_mapSize)
+    double m_scale;
+
+    // rotation of the map about the vertical axis [deg]
+    double m_rotationDeg;
+
+    // vertical exaggeration of buildings
+    double m_heightExaggeration;
+
+    // building height per level, and levels assumed when untagged
+    double m_levelHeight;
+    double m_defaultLevels;
+
+    // height of path strips above the ground [world units]
+    double m_pathRaise;
+
+    // paths are never narrower than this, so the tool can feel them [world units]
+    double m_minPathWidth;
+};
+
+//------------------------------------------------------------------------------
+// A building footprint, in local mesh coordinates (z = 0), counter-clockwise.
+//------------------------------------------------------------------------------
+struct cOsmBuilding
+{
+    int64_t m_id;
+    std::string m_name;
+    std::vector<chai3d::cVector3d> m_ring;
+    double m_height;
+};
+
+//------------------------------------------------------------------------------
+// A walkable path, as a polyline in local mesh coordinates (z = 0).
+//------------------------------------------------------------------------------
+struct cOsmPath
+{
+    int64_t m_id;
+    std::string m_name;
+    std::vector<chai3d::cVector3d> m_points;
+    double m_width;
+};
+
+//------------------------------------------------------------------------------
+// Turns an OSM extract into haptic map geometry: ways (and multipolygon
+// relations) tagged building become extruded, triangulated volumes, and
+// highway ways become raised strips the tool can follow.
+//------------------------------------------------------------------------------
+class cOsmMeshBuilder
+{
+public:
+
+    cOsmMeshBuilder(const cOsmMap& a_map, const cOsmMeshSettings& a_settings = cOsmMeshSettings());
+
+    // mapping from geographic to local mesh coordinates
+    const cOsmProjection& getProjection() const { return (m_projection); }
+
+    // extract features in local mesh coordinates
+    void extractBuildings(std::vector<cOsmBuilding>& a_buildings) const;
+    void extractPaths(std::vector<cOsmPath>& a_paths) const;
+
+    // point above the centre of the roof of a building, where its name goes
+    chai3d::cVector3d getLabelAnchor(const cOsmBuilding& a_building) const;
+
+    // append the geometry of one feature to a mesh
+    void appendBuilding(chai3d::cMesh* a_mesh, const cOsmBuilding& a_building) const;
+    void appendPath(chai3d::cMesh* a_mesh, const cOsmPath& a_path) const;
+
+    // add one mesh with a_buildings and one mesh with a_paths to a_multiMesh
+    void buildMeshes(chai3d::cMultiMesh* a_multiMesh,
+                     const std::vector<cOsmBuilding>& a_buildings,
+                     const std::vector<cOsmPath>& a_paths) const;
+
+    // fill a_multiMesh with one mesh of buildings and one mesh of paths.
+    // returns false if the extract holds neither.
+    bool build(chai3d::cMultiMesh* a_multiMesh) const;
+
+    // triangulate a simple counter-clockwise polygon (ear clipping). indices
+    // of the triangles are appended to a_triangles.
+    static void triangulate(const std::vector<chai3d::cVector3d>& a_ring, std::vector<int>& a_triangles);
+
+    // path width [m] for a highway type, 0 if the type is not a path
+    static double getPathWidth(const char* a_highway);
+
+protected:
+
+    // building height [m] from the height / building:levels tags
+    double getBuildingHeight(const cOsmTags& a_tags) const;
+
+    // convert a node list to a local ring, dropping unknown nodes
+    bool makeRing(const std::vector<int64_t>& a_nodeIds, std::vector<chai3d::cVector3d>& a_ring) const;
+
+    const cOsmMap& m_map;
+    cOsmMeshSettings m_settings;
+    cOsmProjection m_projection;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
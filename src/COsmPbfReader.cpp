@@ -0,0 +1,842 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "COsmPbfReader.h"
+#include "CMappedFile.h"
+#include "CWorkerPool.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <zlib.h>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+namespace
+{
+    // limits from the PBF specification
+    const uint32_t C_MAX_BLOB_HEADER_SIZE = 64 * 1024;
+    const uint32_t C_MAX_BLOB_SIZE = 32 * 1024 * 1024;
+
+    //--------------------------------------------------------------------------
+    // Protocol buffer message: a sequence of (field, wire type, value).
+    //--------------------------------------------------------------------------
+    class cPbfMessage
+    {
+    public:
+
+        enum { C_VARINT = 0, C_FIXED64 = 1, C_BYTES = 2, C_FIXED32 = 5 };
+
+        cPbfMessage() : m_pos(NULL), m_end(NULL), m_error(false), m_field(0), m_wireType(0) {}
+        cPbfMessage(const uint8_t* a_begin, const uint8_t* a_end) :
+            m_pos(a_begin), m_end(a_end), m_error(false), m_field(0), m_wireType(0) {}
+
+        // advance to the next field. returns false at the end or on an error.
+        bool next()
+        {
+            if ((m_pos >= m_end) || m_error)
+            {
+                return (false);
+            }
+            uint64_t key = varint();
+            m_field = (uint32_t)(key >> 3);
+            m_wireType = (uint32_t)(key & 7);
+            return (!m_error);
+        }
+
+        uint32_t field() const { return (m_field); }
+        uint32_t wireType() const { return (m_wireType); }
+        bool atEnd() const { return ((m_pos >= m_end) || m_error); }
+        bool hasError() const { return (m_error); }
+
+        uint64_t varint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                if (m_pos >= m_end)
+                {
+                    break;
+                }
+                uint8_t byte = *m_pos++;
+                value |= (uint64_t)(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return (value);
+                }
+            }
+            m_error = true;
+            return (0);
+        }
+
+        // zigzag encoded signed value (sint32, sint64)
+        int64_t svarint()
+        {
+            uint64_t value = varint();
+            return ((int64_t)(value >> 1) ^ -(int64_t)(value & 1));
+        }
+
+        // length-delimited value (bytes, string, sub-message, packed array)
+        cPbfMessage bytes()
+        {
+            uint64_t length = varint();
+            if (m_error || (length > (uint64_t)(m_end - m_pos)))
+            {
+                m_error = true;
+                return (cPbfMessage());
+            }
+            cPbfMessage result(m_pos, m_pos + length);
+            m_pos += length;
+            return (result);
+        }
+
+        const uint8_t* data() const { return (m_pos); }
+        size_t size() const { return (m_end - m_pos); }
+
+        // skip the value of the current field
+        void skip()
+        {
+            switch (m_wireType)
+            {
+                case C_VARINT:  varint(); break;
+                case C_BYTES:   bytes(); break;
+                case C_FIXED64: advance(8); break;
+                case C_FIXED32: advance(4); break;
+                default:        m_error = true; break;
+            }
+        }
+
+    private:
+
+        void advance(size_t a_count)
+        {
+            if (a_count > (size_t)(m_end - m_pos)) m_error = true;
+            else m_pos += a_count;
+        }
+
+        const uint8_t* m_pos;
+        const uint8_t* m_end;
+        bool m_error;
+        uint32_t m_field;
+        uint32_t m_wireType;
+    };
+
+    //--------------------------------------------------------------------------
+
+    // position of a blob in the file
+    struct cBlobRef
+    {
+        bool m_isHeader;
+        size_t m_offset;
+        size_t m_size;
+    };
+
+    //--------------------------------------------------------------------------
+
+    // decoded element; tags and references are ranges in the block arrays
+    struct cPbfElement
+    {
+        int64_t m_id;
+        int32_t m_lat;
+        int32_t m_lon;
+        size_t m_firstTag;
+        size_t m_numTags;
+        size_t m_firstRef;
+        size_t m_numRefs;
+    };
+
+    //--------------------------------------------------------------------------
+
+    // contents of one OSMData block, decoded on a worker thread
+    struct cPbfBlock
+    {
+        bool m_ok;
+        string m_error;
+
+        // decompressed block data; the string table points into it
+        vector<uint8_t> m_buffer;
+        vector<pair<const char*, size_t> > m_strings;
+
+        // every node's coordinates, in 1e-7 degrees
+        vector<int64_t> m_nodeIds;
+        vector<int32_t> m_nodeCoords;
+
+        vector<cPbfElement> m_taggedNodes;
+        vector<cPbfElement> m_ways;
+        vector<cPbfElement> m_relations;
+
+        // kept tags as string table indices
+        vector<pair<uint32_t, uint32_t> > m_tags;
+
+        // way nodes and relation members
+        vector<int64_t> m_refs;
+        vector<uint32_t> m_roles;
+        vector<uint8_t> m_types;
+
+        void clear()
+        {
+            m_ok = false;
+            m_error.clear();
+            m_buffer.clear();
+            m_strings.clear();
+            m_nodeIds.clear();
+            m_nodeCoords.clear();
+            m_taggedNodes.clear();
+            m_ways.clear();
+            m_relations.clear();
+            m_tags.clear();
+            m_refs.clear();
+            m_roles.clear();
+            m_types.clear();
+        }
+    };
+
+    //--------------------------------------------------------------------------
+
+    // read the Blob at a_blob and return its uncompressed contents, either
+    // in place (raw blocks) or in a_buffer
+    bool readBlob(const uint8_t* a_data, const cBlobRef& a_blob, vector<uint8_t>& a_buffer,
+                  cPbfMessage& a_contents, string& a_error)
+    {
+        cPbfMessage blob(a_data + a_blob.m_offset, a_data + a_blob.m_offset + a_blob.m_size);
+        cPbfMessage raw, compressed;
+        uint64_t rawSize = 0;
+        bool hasRaw = false, hasZlib = false;
+        while (blob.next())
+        {
+            switch (blob.field())
+            {
+                case 1:  raw = blob.bytes(); hasRaw = true; break;
+                case 2:  rawSize = blob.varint(); break;
+                case 3:  compressed = blob.bytes(); hasZlib = true; break;
+                case 4:
+                case 5:
+                case 6:
+                case 7:  a_error = "unsupported block compression"; return (false);
+                default: blob.skip(); break;
+            }
+        }
+        if (blob.hasError())
+        {
+            a_error = "corrupt blob";
+            return (false);
+        }
+
+        if (hasRaw)
+        {
+            a_contents = raw;
+            return (true);
+        }
+        if (!hasZlib || (rawSize > C_MAX_BLOB_SIZE))
+        {
+            a_error = "corrupt blob";
+            return (false);
+        }
+
+        a_buffer.resize((size_t)rawSize);
+        uLongf size = (uLongf)rawSize;
+        if ((uncompress(a_buffer.empty() ? NULL : &a_buffer[0], &size,
+                        compressed.data(), (uLong)compressed.size()) != Z_OK) || (size != rawSize))
+        {
+            a_error = "cannot decompress block";
+            return (false);
+        }
+        a_contents = cPbfMessage(a_buffer.empty() ? NULL : &a_buffer[0],
+                                 a_buffer.empty() ? NULL : &a_buffer[0] + a_buffer.size());
+        return (true);
+    }
+
+    //--------------------------------------------------------------------------
+
+    // block-wide coordinate encoding
+    struct cPbfGrid
+    {
+        int64_t m_granularity;
+        int64_t m_latOffset;
+        int64_t m_lonOffset;
+
+        // nanodegrees to 1e-7 degrees, rounded
+        static int32_t toFixed(int64_t a_nano)
+        {
+            return ((int32_t)((a_nano >= 0) ? (a_nano + 50) / 100 : (a_nano - 50) / 100));
+        }
+        int32_t lat(int64_t a_value) const { return (toFixed(m_latOffset + m_granularity * a_value)); }
+        int32_t lon(int64_t a_value) const { return (toFixed(m_lonOffset + m_granularity * a_value)); }
+    };
+
+    //--------------------------------------------------------------------------
+
+    class cPbfDecoder
+    {
+    public:
+
+        cPbfDecoder(const cOsmMap& a_map, cPbfBlock& a_block) : m_map(a_map), m_block(a_block) {}
+
+        bool decode(cPbfMessage a_message)
+        {
+            // the string table and the grid come before or after the groups
+            vector<cPbfMessage> groups;
+            m_grid.m_granularity = 100;
+            m_grid.m_latOffset = 0;
+            m_grid.m_lonOffset = 0;
+            while (a_message.next())
+            {
+                switch (a_message.field())
+                {
+                    case 1:
+                    {
+                        cPbfMessage table = a_message.bytes();
+                        while (table.next())
+                        {
+                            if (table.field() == 1)
+                            {
+                                cPbfMessage s = table.bytes();
+                                m_block.m_strings.push_back(make_pair((const char*)s.data(), s.size()));
+                            }
+                            else table.skip();
+                        }
+                        if (table.hasError()) return (false);
+                        break;
+                    }
+                    case 2:  groups.push_back(a_message.bytes()); break;
+                    case 17: m_grid.m_granularity = (int64_t)a_message.varint(); break;
+                    case 19: m_grid.m_latOffset = (int64_t)a_message.varint(); break;
+                    case 20: m_grid.m_lonOffset = (int64_t)a_message.varint(); break;
+                    default: a_message.skip(); break;
+                }
+            }
+            if (a_message.hasError())
+            {
+                return (false);
+            }
+
+            m_keyKept.assign(m_block.m_strings.size(), -1);
+
+            for (size_t i=0; i<groups.size(); i++)
+            {
+                cPbfMessage group = groups[i];
+                while (group.next())
+                {
+                    bool ok = true;
+                    switch (group.field())
+                    {
+                        case 1:  ok = decodeNode(group.bytes()); break;
+                        case 2:  ok = decodeDenseNodes(group.bytes()); break;
+                        case 3:  ok = decodeWay(group.bytes()); break;
+                        case 4:  ok = decodeRelation(group.bytes()); break;
+                        default: group.skip(); break;
+                    }
+                    if (!ok) return (false);
+                }
+                if (group.hasError()) return (false);
+            }
+            return (true);
+        }
+
+    private:
+
+        // add a tag if the map's tag filter keeps its key
+        bool addTag(uint64_t a_key, uint64_t a_value)
+        {
+            if ((a_key >= m_keyKept.size()) || (a_value >= m_block.m_strings.size()))
+            {
+                return (false);
+            }
+            if (m_keyKept[a_key] < 0)
+            {
+                const pair<const char*, size_t>& key = m_block.m_strings[a_key];
+                m_keyKept[a_key] = m_map.keepKey(key.first, key.second) ? 1 : 0;
+            }
+            if (m_keyKept[a_key])
+            {
+                m_block.m_tags.push_back(make_pair((uint32_t)a_key, (uint32_t)a_value));
+            }
+            return (true);
+        }
+
+        // keys and values as two packed arrays
+        bool addTags(cPbfMessage a_keys, cPbfMessage a_values)
+        {
+            while (!a_keys.atEnd() && !a_values.atEnd())
+            {
+                if (!addTag(a_keys.varint(), a_values.varint())) return (false);
+            }
+            return (!a_keys.hasError() && !a_values.hasError());
+        }
+
+        void beginElement(cPbfElement& a_element, int64_t a_id)
+        {
+            a_element.m_id = a_id;
+            a_element.m_lat = a_element.m_lon = 0;
+            a_element.m_firstTag = m_block.m_tags.size();
+            a_element.m_numTags = 0;
+            a_element.m_firstRef = m_block.m_refs.size();
+            a_element.m_numRefs = 0;
+        }
+
+        void endElement(cPbfElement& a_element)
+        {
+            a_element.m_numTags = m_block.m_tags.size() - a_element.m_firstTag;
+            a_element.m_numRefs = m_block.m_refs.size() - a_element.m_firstRef;
+        }
+
+        bool decodeNode(cPbfMessage a_message)
+        {
+            int64_t id = 0, lat = 0, lon = 0;
+            cPbfMessage keys, values;
+            while (a_message.next())
+            {
+                switch (a_message.field())
+                {
+                    case 1:  id = a_message.svarint(); break;
+                    case 2:  keys = a_message.bytes(); break;
+                    case 3:  values = a_message.bytes(); break;
+                    case 8:  lat = a_message.svarint(); break;
+                    case 9:  lon = a_message.svarint(); break;
+                    default: a_message.skip(); break;
+                }
+            }
+            if (a_message.hasError()) return (false);
+
+            cPbfElement node;
+            beginElement(node, id);
+            node.m_lat = m_grid.lat(lat);
+            node.m_lon = m_grid.lon(lon);
+            if (!addTags(keys, values)) return (false);
+            endElement(node);
+
+            m_block.m_nodeIds.push_back(id);
+            m_block.m_nodeCoords.push_back(node.m_lat);
+            m_block.m_nodeCoords.push_back(node.m_lon);
+            if (node.m_numTags > 0)
+            {
+                m_block.m_taggedNodes.push_back(node);
+            }
+            return (true);
+        }
+
+        bool decodeDenseNodes(cPbfMessage a_message)
+        {
+            cPbfMessage ids, lats, lons, keysValues;
+            while (a_message.next())
+            {
+                switch (a_message.field())
+                {
+                    case 1:  ids = a_message.bytes(); break;
+                    case 8:  lats = a_message.bytes(); break;
+                    case 9:  lons = a_message.bytes(); break;
+                    case 10: keysValues = a_message.bytes(); break;
+                    default: a_message.skip(); break;
+                }
+            }
+            if (a_message.hasError()) return (false);
+
+            // ids and coordinates are delta coded; tags are key, value pairs
+            // with a 0 after each node
+            int64_t id = 0, lat = 0, lon = 0;
+            while (!ids.atEnd())
+            {
+                id += ids.svarint();
+                lat += lats.svarint();
+                lon += lons.svarint();
+
+                cPbfElement node;
+                beginElement(node, id);
+                node.m_lat = m_grid.lat(lat);
+                node.m_lon = m_grid.lon(lon);
+                while (!keysValues.atEnd())
+                {
+                    uint64_t key = keysValues.varint();
+                    if (key == 0) break;
+                    if (!addTag(key, keysValues.varint())) return (false);
+                }
+                endElement(node);
+
+                m_block.m_nodeIds.push_back(id);
+                m_block.m_nodeCoords.push_back(node.m_lat);
+                m_block.m_nodeCoords.push_back(node.m_lon);
+                if (node.m_numTags > 0)
+                {
+                    m_block.m_taggedNodes.push_back(node);
+                }
+            }
+            return (!ids.hasError() && !lats.hasError() && !lons.hasError() && !keysValues.hasError());
+        }
+
+        bool decodeWay(cPbfMessage a_message)
+        {
+            int64_t id = 0;
+            cPbfMessage keys, values, refs;
+            while (a_message.next())
+            {
+                switch (a_message.field())
+                {
+                    case 1:  id = (int64_t)a_message.varint(); break;
+                    case 2:  keys = a_message.bytes(); break;
+                    case 3:  values = a_message.bytes(); break;
+                    case 8:  refs = a_message.bytes(); break;
+                    default: a_message.skip(); break;
+                }
+            }
+            if (a_message.hasError()) return (false);
+
+            cPbfElement way;
+            beginElement(way, id);
+            if (!addTags(keys, values)) return (false);
+            int64_t ref = 0;
+            while (!refs.atEnd())
+            {
+                ref += refs.svarint();
+                m_block.m_refs.push_back(ref);
+            }
+            endElement(way);
+            m_block.m_ways.push_back(way);
+            return (!refs.hasError());
+        }
+
+        bool decodeRelation(cPbfMessage a_message)
+        {
+            int64_t id = 0;
+            cPbfMessage keys, values, roles, memberIds, types;
+            while (a_message.next())
+            {
+                switch (a_message.field())
+                {
+                    case 1:  id = (int64_t)a_message.varint(); break;
+                    case 2:  keys = a_message.bytes(); break;
+                    case 3:  values = a_message.bytes(); break;
+                    case 8:  roles = a_message.bytes(); break;
+                    case 9:  memberIds = a_message.bytes(); break;
+                    case 10: types = a_message.bytes(); break;
+                    default: a_message.skip(); break;
+                }
+            }
+            if (a_message.hasError()) return (false);
+
+            cPbfElement relation;
+            beginElement(relation, id);
+            if (!addTags(keys, values)) return (false);
+            int64_t ref = 0;
+            while (!memberIds.atEnd())
+            {
+                ref += memberIds.svarint();
+                uint64_t role = roles.varint();
+                uint64_t type = types.varint();
+                if ((role >= m_block.m_strings.size()) || (type > 2)) return (false);
+                m_block.m_refs.push_back(ref);
+                m_block.m_roles.push_back((uint32_t)role);
+                m_block.m_types.push_back((uint8_t)type);
+            }
+            endElement(relation);
+            m_block.m_relations.push_back(relation);
+            return (!memberIds.hasError() && !roles.hasError() && !types.hasError());
+        }
+
+        const cOsmMap& m_map;
+        cPbfBlock& m_block;
+        cPbfGrid m_grid;
+
+        // per string table entry: -1 unknown, 0 dropped, 1 kept by the filter
+        vector<signed char> m_keyKept;
+    };
+
+    //--------------------------------------------------------------------------
+
+    void decodeBlock(const uint8_t* a_data, const cBlobRef& a_blob, const cOsmMap& a_map, cPbfBlock& a_block)
+    {
+        a_block.clear();
+        cPbfMessage contents;
+        if (!readBlob(a_data, a_blob, a_block.m_buffer, contents, a_block.m_error))
+        {
+            return;
+        }
+        cPbfDecoder decoder(a_map, a_block);
+        a_block.m_ok = decoder.decode(contents);
+        if (!a_block.m_ok)
+        {
+            a_block.m_error = "corrupt data block";
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
+    // kept tags of a decoded element, interned by the map
+    void copyTags(const cPbfBlock& a_block, const cPbfElement& a_element,
+                  cOsmMap& a_map, vector<cOsmTag>& a_tags)
+    {
+        a_tags.clear();
+        a_tags.reserve(a_element.m_numTags);
+        for (size_t k=0; k<a_element.m_numTags; k++)
+        {
+            const pair<uint32_t, uint32_t>& tag = a_block.m_tags[a_element.m_firstTag + k];
+            const pair<const char*, size_t>& key = a_block.m_strings[tag.first];
+            const pair<const char*, size_t>& value = a_block.m_strings[tag.second];
+            cOsmTag result;
+            if (a_map.makeTag(key.first, key.second, value.first, value.second, result))
+            {
+                a_tags.push_back(result);
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
+    // add a decoded block to the map (on the calling thread)
+    void mergeBlock(const cPbfBlock& a_block, cOsmMap& a_map)
+    {
+        for (size_t i=0; i<a_block.m_nodeIds.size(); i++)
+        {
+            a_map.addNodeLocation(a_block.m_nodeIds[i], a_block.m_nodeCoords[2*i], a_block.m_nodeCoords[2*i+1]);
+        }
+
+        for (size_t i=0; i<a_block.m_taggedNodes.size(); i++)
+        {
+            const cPbfElement& element = a_block.m_taggedNodes[i];
+            cOsmNode node;
+            node.m_id = element.m_id;
+            node.m_lat = 1e-7 * element.m_lat;
+            node.m_lon = 1e-7 * element.m_lon;
+            copyTags(a_block, element, a_map, node.m_tags);
+            a_map.addNode(std::move(node));
+        }
+
+        for (size_t i=0; i<a_block.m_ways.size(); i++)
+        {
+            const cPbfElement& element = a_block.m_ways[i];
+            cOsmWay way;
+            way.m_id = element.m_id;
+            copyTags(a_block, element, a_map, way.m_tags);
+            way.m_nodeIds.assign(a_block.m_refs.begin() + element.m_firstRef,
+                                 a_block.m_refs.begin() + element.m_firstRef + element.m_numRefs);
+            a_map.addWay(std::move(way));
+        }
+
+        for (size_t i=0; i<a_block.m_relations.size(); i++)
+        {
+            const cPbfElement& element = a_block.m_relations[i];
+            cOsmRelation relation;
+            relation.m_id = element.m_id;
+            copyTags(a_block, element, a_map, relation.m_tags);
+            relation.m_members.resize(element.m_numRefs);
+            for (size_t k=0; k<element.m_numRefs; k++)
+            {
+                size_t index = element.m_firstRef + k;
+                const pair<const char*, size_t>& role = a_block.m_strings[a_block.m_roles[index]];
+                cOsmMember& member = relation.m_members[k];
+                member.m_type = (cOsmMember::cType)a_block.m_types[index];
+                member.m_ref = a_block.m_refs[index];
+                member.m_role = a_map.intern(role.first, role.second);
+            }
+            a_map.addRelation(std::move(relation));
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
+    bool readHeader(const uint8_t* a_data, const cBlobRef& a_blob, cOsmMap& a_map, string& a_error)
+    {
+        vector<uint8_t> buffer;
+        cPbfMessage header;
+        if (!readBlob(a_data, a_blob, buffer, header, a_error))
+        {
+            return (false);
+        }
+
+        while (header.next())
+        {
+            if (header.field() == 1)
+            {
+                // bounding box in nanodegrees
+                cPbfMessage box = header.bytes();
+                int64_t left = 0, right = 0, top = 0, bottom = 0;
+                while (box.next())
+                {
+                    switch (box.field())
+                    {
+                        case 1:  left = box.svarint(); break;
+                        case 2:  right = box.svarint(); break;
+                        case 3:  top = box.svarint(); break;
+                        case 4:  bottom = box.svarint(); break;
+                        default: box.skip(); break;
+                    }
+                }
+                a_map.setBounds(1e-9 * bottom, 1e-9 * left, 1e-9 * top, 1e-9 * right);
+            }
+            else if (header.field() == 4)
+            {
+                cPbfMessage feature = header.bytes();
+                string name((const char*)feature.data(), feature.size());
+                if ((name != "OsmSchema-V0.6") && (name != "DenseNodes"))
+                {
+                    a_error = "unsupported required feature " + name;
+                    return (false);
+                }
+            }
+            else
+            {
+                header.skip();
+            }
+        }
+        if (header.hasError())
+        {
+            a_error = "corrupt header block";
+            return (false);
+        }
+        return (true);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cOsmPbfReader::cOsmPbfReader()
+{
+    m_pool = NULL;
+    m_numBlocks = 0;
+}
+
+//------------------------------------------------------------------------------
+
+bool cOsmPbfReader::isPbfFile(const string& a_filename)
+{
+    return ((a_filename.size() > 4) && (a_filename.compare(a_filename.size() - 4, 4, ".pbf") == 0));
+}
+
+//------------------------------------------------------------------------------
+
+bool cOsmPbfReader::read(const string& a_filename, cOsmMap& a_map)
+{
+    m_numBlocks = 0;
+    a_map.clear();
+
+    cMappedFile file;
+    if (!file.open(a_filename))
+    {
+        return (false);
+    }
+    const uint8_t* data = (const uint8_t*)file.data();
+    size_t size = file.size();
+
+    // index the blobs: 4 byte big-endian header size, BlobHeader, Blob
+    vector<cBlobRef> blobs;
+    size_t pos = 0;
+    while (pos < size)
+    {
+        if (size - pos < 4)
+        {
+            cout << "Error - truncated PBF file " << a_filename << endl;
+            return (false);
+        }
+        uint32_t headerSize = ((uint32_t)data[pos] << 24) | ((uint32_t)data[pos+1] << 16) |
+                              ((uint32_t)data[pos+2] << 8) | (uint32_t)data[pos+3];
+        pos += 4;
+        if ((headerSize > C_MAX_BLOB_HEADER_SIZE) || (headerSize > size - pos))
+        {
+            cout << "Error - corrupt PBF file " << a_filename << endl;
+            return (false);
+        }
+
+        cPbfMessage header(data + pos, data + pos + headerSize);
+        string type;
+        uint64_t blobSize = 0;
+        while (header.next())
+        {
+            if (header.field() == 1)
+            {
+                cPbfMessage s = header.bytes();
+                type.assign((const char*)s.data(), s.size());
+            }
+            else if (header.field() == 3)
+            {
+                blobSize = header.varint();
+            }
+            else
+            {
+                header.skip();
+            }
+        }
+        pos += headerSize;
+        if (header.hasError() || (blobSize > C_MAX_BLOB_SIZE) || (blobSize > size - pos))
+        {
+            cout << "Error - corrupt PBF file " << a_filename << endl;
+            return (false);
+        }
+
+        // unknown blob types are skipped, as the format asks
+        if ((type == "OSMHeader") || (type == "OSMData"))
+        {
+            cBlobRef blob;
+            blob.m_isHeader = (type == "OSMHeader");
+            blob.m_offset = pos;
+            blob.m_size = (size_t)blobSize;
+            blobs.push_back(blob);
+        }
+        pos += (size_t)blobSize;
+    }
+
+    // decode data blocks in parallel, in batches so that only a few
+    // decompressed blocks are held at a time, and add them in file order
+    cWorkerPool& pool = (m_pool != NULL) ? *m_pool : cWorkerPool::getDefault();
+    vector<cPbfBlock> batch(4 * pool.getNumThreads());
+    vector<size_t> batchBlobs;
+    string error;
+
+    size_t next = 0;
+    while ((next < blobs.size()) && error.empty())
+    {
+        batchBlobs.clear();
+        while ((next < blobs.size()) && (batchBlobs.size() < batch.size()))
+        {
+            if (blobs[next].m_isHeader)
+            {
+                // headers are read in order between data batches
+                if (!batchBlobs.empty()) break;
+                if (!readHeader(data, blobs[next], a_map, error)) break;
+            }
+            else
+            {
+                batchBlobs.push_back(next);
+            }
+            next++;
+        }
+        if (!error.empty())
+        {
+            break;
+        }
+
+        const cOsmMap& map = a_map;
+        pool.parallelFor(batchBlobs.size(), [&](size_t i)
+        {
+            decodeBlock(data, blobs[batchBlobs[i]], map, batch[i]);
+        });
+
+        for (size_t i=0; i<batchBlobs.size(); i++)
+        {
+            if (!batch[i].m_ok)
+            {
+                error = batch[i].m_error;
+                break;
+            }
+            mergeBlock(batch[i], a_map);
+            batch[i].clear();
+            m_numBlocks++;
+        }
+    }
+
+    if (!error.empty())
+    {
+        cout << "Error - " << error << " in " << a_filename << endl;
+        a_map.clear();
+        return (false);
+    }
+
+    a_map.finalize();
+    return (true);
+}
@@ -0,0 +1,55 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef COsmPbfReaderH
+#define COsmPbfReaderH
+//------------------------------------------------------------------------------
+#include "COsmMap.h"
+//------------------------------------------------------------------------------
+class cWorkerPool;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Reader for OSM PBF files (.osm.pbf). The file is memory mapped and its
+// data blocks are decompressed and decoded in parallel; the decoded blocks
+// are added to the map in file order, so the result is the same as for the
+// XML version of the extract.
+//
+// Supports raw and zlib compressed blocks, plain and dense nodes. Files that
+// require other features (history, LZ4/zstd blocks) are rejected.
+//------------------------------------------------------------------------------
+class cOsmPbfReader
+{
+public:
+
+    cOsmPbfReader();
+
+    // read a_filename into a_map. the map is finalized. returns false if the
+    // file cannot be read or is not a supported PBF file.
+    bool read(const std::string& a_filename, cOsmMap& a_map);
+
+    // threads used to decode blocks (default: cWorkerPool::getDefault())
+    void setWorkerPool(cWorkerPool* a_pool) { m_pool = a_pool; }
+
+    // number of data blocks in the last file read
+    size_t getNumBlocks() const { return (m_numBlocks); }
+
+    // true if a_filename ends in .pbf
+    static bool isPbfFile(const std::string& a_filename);
+
+private:
+
+    cWorkerPool* m_pool;
+    size_t m_numBlocks;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,98 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef COsmProjectionH
+#define COsmProjectionH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Maps geographic coordinates to the local frame of the map meshes.
+//
+// Latitude/longitude are first projected to metres east/north of an origin
+// (equirectangular, accurate to well below a metre across a district). The
+// metric plane is then laid out in the scene so that north points away from
+// the default camera (-x) and east points to the right of the screen (+y),
+// optionally rotated about z, and scaled to world units.
+//------------------------------------------------------------------------------
+class cOsmProjection
+{
+public:
+
+    cOsmProjection() :
+        m_lat0(0.0), m_lon0(0.0), m_metersPerDegLat(111195.0), m_metersPerDegLon(111195.0),
+        m_scale(1.0), m_verticalScale(1.0), m_cos(1.0), m_sin(0.0) {}
+
+    // origin of the metric frame
+    void setOrigin(double a_lat, double a_lon)
+    {
+        const double earthRadius = 6371008.8;
+        m_lat0 = a_lat;
+        m_lon0 = a_lon;
+        m_metersPerDegLat = earthRadius * chai3d::C_DEG2RAD;
+        m_metersPerDegLon = m_metersPerDegLat * cos(a_lat * chai3d::C_DEG2RAD);
+    }
+
+    // world units per metre, horizontally and vertically
+    void setScale(double a_scale, double a_verticalScale) { m_scale = a_scale; m_verticalScale = a_verticalScale; }
+    double getScale() const { return (m_scale); }
+    double getVerticalScale() const { return (m_verticalScale); }
+
+    // rotation of the map about the z axis [deg]
+    void setRotationDeg(double a_angle) { m_cos = cos(a_angle * chai3d::C_DEG2RAD); m_sin = sin(a_angle * chai3d::C_DEG2RAD); }
+
+    // geographic -> metres east/north of the origin
+    void toMeters(double a_lat, double a_lon, double& a_east, double& a_north) const
+    {
+        a_east = (a_lon - m_lon0) * m_metersPerDegLon;
+        a_north = (a_lat - m_lat0) * m_metersPerDegLat;
+    }
+
+    // metres east/north/up -> local mesh coordinates
+    chai3d::cVector3d metersToLocal(double a_east, double a_north, double a_up = 0.0) const
+    {
+        double x = -a_north * m_scale;
+        double y =  a_east * m_scale;
+        return (chai3d::cVector3d(m_cos * x - m_sin * y, m_sin * x + m_cos * y, a_up * m_verticalScale));
+    }
+
+    // geographic -> local mesh coordinates
+    chai3d::cVector3d toLocal(double a_lat, double a_lon) const
+    {
+        double east, north;
+        toMeters(a_lat, a_lon, east, north);
+        return (metersToLocal(east, north));
+    }
+
+    // local mesh coordinates -> metres east/north
+    void localToMeters(const chai3d::cVector3d& a_local, double& a_east, double& a_north) const
+    {
+        double x =  m_cos * a_local(0) + m_sin * a_local(1);
+        double y = -m_sin * a_local(0) + m_cos * a_local(1);
+        a_north = -x / m_scale;
+        a_east = y / m_scale;
+    }
+
+protected:
+
+    double m_lat0;
+    double m_lon0;
+    double m_metersPerDegLat;
+    double m_metersPerDegLon;
+    double m_scale;
+    double m_verticalScale;
+    double m_cos;
+    double m_sin;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
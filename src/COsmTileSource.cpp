@@ -0,0 +1,128 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "COsmTileSource.h"
+//------------------------------------------------------------------------------
+#include <cmath>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+cOsmTileSource::cOsmTileSource(shared_ptr<const cOsmMap> a_map,
+                               const cOsmMeshSettings& a_settings,
+                               double a_tileSize) :
+    m_map(a_map),
+    m_builder(*a_map, a_settings),
+    m_tileSize(a_tileSize)
+{
+    vector<cOsmBuilding> buildings;
+    m_builder.extractBuildings(buildings);
+    for (size_t i=0; i<buildings.size(); i++)
+    {
+        cVector3d center(0.0, 0.0, 0.0);
+        for (size_t k=0; k<buildings[i].m_ring.size(); k++)
+        {
+            center += buildings[i].m_ring[k];
+        }
+        center /= (double)buildings[i].m_ring.size();
+        m_tiles[getKey(center)].m_buildings.push_back(buildings[i]);
+    }
+
+    // split paths into runs of segments that fall into the same tile
+    vector<cOsmPath> paths;
+    m_builder.extractPaths(paths);
+    for (size_t i=0; i<paths.size(); i++)
+    {
+        const vector<cVector3d>& points = paths[i].m_points;
+        cOsmPath piece = paths[i];
+        piece.m_points.clear();
+        cTileKey current;
+        for (size_t k=0; k+1<points.size(); k++)
+        {
+            cTileKey key = getKey(0.5 * (points[k] + points[k+1]));
+            if (!piece.m_points.empty() && (key != current))
+            {
+                m_tiles[current].m_paths.push_back(piece);
+                piece.m_points.clear();
+            }
+            if (piece.m_points.empty())
+            {
+                piece.m_points.push_back(points[k]);
+                current = key;
+            }
+            piece.m_points.push_back(points[k+1]);
+        }
+        if (piece.m_points.size() >= 2)
+        {
+            m_tiles[current].m_paths.push_back(piece);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cOsmTileSource::cTileKey cOsmTileSource::getKey(const cVector3d& a_pos) const
+{
+    return (cTileKey((int)floor(a_pos(0) / m_tileSize), (int)floor(a_pos(1) / m_tileSize)));
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmTileSource::getTileRange(int& a_minX, int& a_minY, int& a_maxX, int& a_maxY) const
+{
+    a_minX = a_minY = a_maxX = a_maxY = 0;
+    bool first = true;
+    for (map<cTileKey, cTile>::const_iterator it = m_tiles.begin(); it != m_tiles.end(); ++it)
+    {
+        int x = it->first.first;
+        int y = it->first.second;
+        if (first || (x < a_minX)) a_minX = x;
+        if (first || (x > a_maxX)) a_maxX = x;
+        if (first || (y < a_minY)) a_minY = y;
+        if (first || (y > a_maxY)) a_maxY = y;
+        first = false;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cOsmTileSource::getLabels(vector<cTileLabel>& a_labels) const
+{
+    for (map<cTileKey, cTile>::const_iterator it = m_tiles.begin(); it != m_tiles.end(); ++it)
+    {
+        for (size_t i=0; i<it->second.m_buildings.size(); i++)
+        {
+            const cOsmBuilding& building = it->second.m_buildings[i];
+            if (!building.m_name.empty())
+            {
+                cTileLabel label;
+                label.m_name = building.m_name;
+                label.m_pos = m_builder.getLabelAnchor(building);
+                a_labels.push_back(label);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cMultiMesh* cOsmTileSource::loadTile(int a_x, int a_y)
+{
+    map<cTileKey, cTile>::const_iterator it = m_tiles.find(cTileKey(a_x, a_y));
+    if (it == m_tiles.end())
+    {
+        return (NULL);
+    }
+
+    cMultiMesh* tile = new cMultiMesh();
+    m_builder.buildMeshes(tile, it->second.m_buildings, it->second.m_paths);
+    return (tile);
+}
@@ -0,0 +1,65 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef COsmTileSourceH
+#define COsmTileSourceH
+//------------------------------------------------------------------------------
+#include "COsmMeshBuilder.h"
+#include "CTileSource.h"
+//------------------------------------------------------------------------------
+#include <map>
+#include <memory>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Tiles built from an OSM extract on demand. Features are extracted once and
+// sorted into tiles: buildings by the centre of their footprint, paths by
+// the midpoint of each segment, so every feature is felt in one tile only.
+//------------------------------------------------------------------------------
+class cOsmTileSource : public cTileSource
+{
+public:
+
+    cOsmTileSource(std::shared_ptr<const cOsmMap> a_map,
+                   const cOsmMeshSettings& a_settings,
+                   double a_tileSize);
+
+    // mapping from geographic to local map coordinates
+    const cOsmProjection& getProjection() const { return (m_builder.getProjection()); }
+
+    // number of tiles that hold geometry
+    size_t getNumTiles() const { return (m_tiles.size()); }
+
+    virtual double getTileSize() const { return (m_tileSize); }
+    virtual void getTileRange(int& a_minX, int& a_minY, int& a_maxX, int& a_maxY) const;
+    virtual void getLabels(std::vector<cTileLabel>& a_labels) const;
+    virtual chai3d::cMultiMesh* loadTile(int a_x, int a_y);
+
+private:
+
+    struct cTile
+    {
+        std::vector<cOsmBuilding> m_buildings;
+        std::vector<cOsmPath> m_paths;
+    };
+
+    typedef std::pair<int, int> cTileKey;
+
+    cTileKey getKey(const chai3d::cVector3d& a_pos) const;
+
+    std::shared_ptr<const cOsmMap> m_map;
+    cOsmMeshBuilder m_builder;
+    double m_tileSize;
+    std::map<cTileKey, cTile> m_tiles;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
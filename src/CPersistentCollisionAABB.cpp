@@ -0,0 +1,71 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CPersistentCollisionAABB.h"
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+cPersistentCollisionAABB* cPersistentCollisionAABB::create(cMesh* a_mesh, double a_radius)
+{
+    cPersistentCollisionAABB* detector = new cPersistentCollisionAABB();
+    detector->initialize(a_mesh->m_triangles, a_radius);
+    a_mesh->deleteCollisionDetector(false);
+    a_mesh->setCollisionDetector(detector);
+    return (detector);
+}
+
+//------------------------------------------------------------------------------
+
+void cPersistentCollisionAABB::getNodeRecord(int a_index, cAABBNodeRecord& a_record) const
+{
+    const cCollisionAABBNode& node = m_nodes[a_index];
+    cVector3d min = node.m_bbox.getMin();
+    cVector3d max = node.m_bbox.getMax();
+    for (int k=0; k<3; k++)
+    {
+        a_record.m_min[k] = min(k);
+        a_record.m_max[k] = max(k);
+    }
+    a_record.m_depth = node.m_depth;
+    a_record.m_nodeType = (int32_t)node.m_nodeType;
+    a_record.m_leftSubTree = node.m_leftSubTree;
+    a_record.m_rightSubTree = node.m_rightSubTree;
+}
+
+//------------------------------------------------------------------------------
+
+void cPersistentCollisionAABB::restore(const cGenericArrayPtr a_elements,
+                                       double a_radius,
+                                       int a_rootIndex,
+                                       int a_maxDepth,
+                                       const cAABBNodeRecord* a_records,
+                                       int a_numRecords)
+{
+    m_elements = a_elements;
+    m_numElements = (int)a_elements->getNumElements();
+    m_radius = a_radius;
+    m_rootIndex = a_rootIndex;
+    m_maxDepth = a_maxDepth;
+
+    m_nodes.resize(a_numRecords);
+    for (int i=0; i<a_numRecords; i++)
+    {
+        const cAABBNodeRecord& record = a_records[i];
+        cCollisionAABBNode& node = m_nodes[i];
+        node.m_bbox.setValue(cVector3d(record.m_min[0], record.m_min[1], record.m_min[2]),
+                             cVector3d(record.m_max[0], record.m_max[1], record.m_max[2]));
+        node.m_depth = record.m_depth;
+        node.m_nodeType = (cAABBNodeType)record.m_nodeType;
+        node.m_leftSubTree = record.m_leftSubTree;
+        node.m_rightSubTree = record.m_rightSubTree;
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CPersistentCollisionAABBH
+#define CPersistentCollisionAABBH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Flat, serializable form of one AABB tree node.
+//------------------------------------------------------------------------------
+struct cAABBNodeRecord
+{
+    double m_min[3];
+    double m_max[3];
+    int32_t m_depth;
+    int32_t m_nodeType;
+    int32_t m_leftSubTree;
+    int32_t m_rightSubTree;
+};
+
+//------------------------------------------------------------------------------
+// AABB collision detector whose tree can be written out and restored later
+// without rebuilding it. Behaves exactly like cCollisionAABB otherwise.
+//------------------------------------------------------------------------------
+class cPersistentCollisionAABB : public chai3d::cCollisionAABB
+{
+public:
+
+    cPersistentCollisionAABB() {}
+    virtual ~cPersistentCollisionAABB() {}
+
+    // build a tree over the triangles of a_mesh and attach it to the mesh,
+    // replacing cMesh::createAABBCollisionDetector()
+    static cPersistentCollisionAABB* create(chai3d::cMesh* a_mesh, double a_radius);
+
+    // tree layout
+    int getNumNodeRecords() const { return ((int)m_nodes.size()); }
+    int getRootIndex() const { return (m_rootIndex); }
+    int getMaxDepth() const { return (m_maxDepth); }
+    double getRadius() const { return (m_radius); }
+
+    // copy node a_index into a_record
+    void getNodeRecord(int a_index, cAABBNodeRecord& a_record) const;
+
+    // adopt a previously built tree over a_elements
+    void restore(const chai3d::cGenericArrayPtr a_elements,
+                 double a_radius,
+                 int a_rootIndex,
+                 int a_maxDepth,
+                 const cAABBNodeRecord* a_records,
+                 int a_numRecords);
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,238 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CProbeTrajectory.h"
+//------------------------------------------------------------------------------
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+bool cProbeTrajectory::loadFromFile(const string& a_filename, double a_rate)
+{
+    ifstream file(a_filename.c_str());
+    if (!file)
+    {
+        return (false);
+    }
+
+    m_positions.clear();
+    m_rate = a_rate;
+
+    string line;
+    while (getline(file, line))
+    {
+        if (line.empty() || (line[0] == '#'))
+        {
+            continue;
+        }
+
+        // accept both "x y z" and "t x y z"
+        istringstream in(line);
+        double v[4];
+        int count = 0;
+        while ((count < 4) && (in >> v[count]))
+        {
+            count++;
+        }
+
+        if (count == 3)
+        {
+            m_positions.push_back(cVector3d(v[0], v[1], v[2]));
+        }
+        else if (count == 4)
+        {
+            m_positions.push_back(cVector3d(v[1], v[2], v[3]));
+        }
+    }
+
+    return (!m_positions.empty());
+}
+
+//------------------------------------------------------------------------------
+
+bool cProbeTrajectory::saveToFile(const string& a_filename) const
+{
+    ofstream file(a_filename.c_str());
+    if (!file)
+    {
+        return (false);
+    }
+
+    file << "# t x y z (device frame)" << endl;
+    for (size_t i=0; i<m_positions.size(); i++)
+    {
+        const cVector3d& p = m_positions[i];
+        file << (double)i / m_rate << " " << p(0) << " " << p(1) << " " << p(2) << endl;
+    }
+
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void cProbeTrajectory::assign(const vector<cVector3d>& a_positions, double a_rate)
+{
+    m_positions = a_positions;
+    m_rate = a_rate;
+}
+
+//------------------------------------------------------------------------------
+
+bool cProbeTrajectory::parseShape(const string& a_name, cShape& a_shape)
+{
+    if (a_name == "raster")  { a_shape = C_RASTER; return (true); }
+    if (a_name == "circles") { a_shape = C_CIRCLES; return (true); }
+    if (a_name == "random")  { a_shape = C_RANDOM_WALK; return (true); }
+    return (false);
+}
+
+//------------------------------------------------------------------------------
+
+void cProbeTrajectory::resample(const vector<cVector3d>& a_polyline, double a_step)
+{
+    if (a_polyline.empty())
+    {
+        return;
+    }
+
+    m_positions.push_back(a_polyline[0]);
+
+    double carry = 0.0;
+    for (size_t i=1; i<a_polyline.size(); i++)
+    {
+        cVector3d a = a_polyline[i-1];
+        cVector3d b = a_polyline[i];
+        double length = a.distance(b);
+        if (length < C_SMALL)
+        {
+            continue;
+        }
+
+        double s = a_step - carry;
+        while (s <= length)
+        {
+            m_positions.push_back(a + (s / length) * (b - a));
+            s += a_step;
+        }
+        carry = length - (s - a_step);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cProbeTrajectory::createSynthetic(cShape a_shape,
+                                       const cVector3d& a_min,
+                                       const cVector3d& a_max,
+                                       double a_speed,
+                                       double a_rate,
+                                       double a_duration,
+                                       cGenericTool* a_tool,
+                                       unsigned int a_seed)
+{
+    m_positions.clear();
+    m_rate = a_rate;
+
+    double step = a_speed / a_rate;
+    size_t numSamples = (size_t)(a_duration * a_rate);
+    cVector3d center = 0.5 * (a_min + a_max);
+    cVector3d size = a_max - a_min;
+
+    vector<cVector3d> polyline;
+
+    // build the path in world coordinates until it is long enough
+    double pathLength = step * (double)numSamples;
+    if (a_shape == C_RASTER)
+    {
+        int lines = 12;
+        double length = 0.0;
+        for (int pass=0; length < pathLength; pass++)
+        {
+            for (int i=0; i<=lines; i++)
+            {
+                int row = (pass % 2 == 0) ? i : lines - i;
+                double y = a_min(1) + size(1) * (double)row / (double)lines;
+                double x0 = (row % 2 == 0) ? a_min(0) : a_max(0);
+                double x1 = (row % 2 == 0) ? a_max(0) : a_min(0);
+                polyline.push_back(cVector3d(x0, y, a_min(2)));
+                polyline.push_back(cVector3d(x1, y, a_min(2)));
+                length += size(0) + size(1) / (double)lines;
+            }
+        }
+    }
+    else if (a_shape == C_CIRCLES)
+    {
+        double radiusMax = 0.5 * cMin(size(0), size(1));
+        double length = 0.0;
+        for (int ring=0; length < pathLength; ring++)
+        {
+            double radius = radiusMax * (double)(1 + ring % 8) / 8.0;
+            for (int i=0; i<=64; i++)
+            {
+                double angle = 2.0 * C_PI * (double)i / 64.0;
+                polyline.push_back(cVector3d(center(0) + radius * cos(angle),
+                                             center(1) + radius * sin(angle),
+                                             a_min(2)));
+            }
+            length += 2.0 * C_PI * radius;
+        }
+    }
+    else
+    {
+        srand(a_seed);
+        cVector3d pos = center;
+        double heading = 0.0;
+        double length = 0.0;
+        double segment = 0.05 * cMin(size(0), size(1));
+        polyline.push_back(pos);
+        while (length < pathLength)
+        {
+            heading += ((double)rand() / (double)RAND_MAX - 0.5) * 1.5;
+            cVector3d next = pos + segment * cVector3d(cos(heading), sin(heading), 0.0);
+            next(2) = a_min(2) + size(2) * (double)rand() / (double)RAND_MAX;
+
+            // bounce off the borders of the map
+            for (int k=0; k<2; k++)
+            {
+                if ((next(k) < a_min(k)) || (next(k) > a_max(k)))
+                {
+                    next(k) = cClamp(next(k), a_min(k), a_max(k));
+                    heading += C_PI;
+                }
+            }
+
+            polyline.push_back(next);
+            length += pos.distance(next);
+            pos = next;
+        }
+    }
+
+    resample(polyline, step);
+    if (m_positions.size() > numSamples)
+    {
+        m_positions.resize(numSamples);
+    }
+
+    // map world positions into the device frame of the tool
+    if (a_tool != NULL)
+    {
+        a_tool->computeGlobalPositions(true);
+        cVector3d toolPos = a_tool->getGlobalPos();
+        cMatrix3d toolRotT = a_tool->getGlobalRot().trans();
+        double scale = a_tool->getWorkspaceScaleFactor();
+        for (size_t i=0; i<m_positions.size(); i++)
+        {
+            m_positions[i] = (1.0 / scale) * (toolRotT * (m_positions[i] - toolPos));
+        }
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CProbeTrajectoryH
+#define CProbeTrajectoryH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// A sequence of probe positions sampled at a fixed servo rate. Positions are
+// expressed in the device frame (what cGenericHapticDevice::getPosition()
+// reports), so a trajectory can be fed straight into a simulated device.
+//------------------------------------------------------------------------------
+class cProbeTrajectory
+{
+public:
+
+    // synthetic trajectory shapes
+    enum cShape
+    {
+        C_RASTER,       // lawnmower sweep over the map, sliding on the ground
+        C_CIRCLES,      // concentric circles around the map center
+        C_RANDOM_WALK   // smoothed random walk that keeps bumping into walls
+    };
+
+    cProbeTrajectory() : m_rate(1000.0) {}
+
+    // number of samples
+    size_t size() const { return (m_positions.size()); }
+
+    // sample rate [Hz]
+    double getRate() const { return (m_rate); }
+
+    // position of sample a_index (wraps around at the end)
+    const chai3d::cVector3d& getPosition(size_t a_index) const { return (m_positions[a_index % m_positions.size()]); }
+
+    // load a recorded trajectory. each line holds "x y z" or "t x y z" in the
+    // device frame; lines starting with '#' are ignored.
+    bool loadFromFile(const std::string& a_filename, double a_rate);
+
+    // write the trajectory as "t x y z" lines
+    bool saveToFile(const std::string& a_filename) const;
+
+    // replace the trajectory with a_positions (device frame) sampled at
+    // a_rate [Hz], e.g. the device positions of a session log
+    void assign(const std::vector<chai3d::cVector3d>& a_positions, double a_rate);
+
+    // build a synthetic trajectory that covers the world-space box
+    // [a_min, a_max] at a_speed [m/s], sampled at a_rate [Hz]. the path is
+    // mapped into the device frame of a_tool.
+    void createSynthetic(cShape a_shape,
+                         const chai3d::cVector3d& a_min,
+                         const chai3d::cVector3d& a_max,
+                         double a_speed,
+                         double a_rate,
+                         double a_duration,
+                         chai3d::cGenericTool* a_tool,
+                         unsigned int a_seed = 1);
+
+    // parse a shape name ("raster", "circles", "random")
+    static bool parseShape(const std::string& a_name, cShape& a_shape);
+
+protected:
+
+    // append world-space points spaced a_step apart along the polyline
+    void resample(const std::vector<chai3d::cVector3d>& a_polyline, double a_step);
+
+    // sample rate [Hz]
+    double m_rate;
+
+    // positions in the device frame
+    std::vector<chai3d::cVector3d> m_positions;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
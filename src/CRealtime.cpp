@@ -0,0 +1,188 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CRealtime.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#if defined(LINUX)
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#if defined(WIN32) || defined(WIN64)
+#include <windows.h>
+#endif
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+namespace
+{
+    // pages are touched this far apart
+    const size_t C_PAGE_STRIDE = 4096;
+}
+
+//------------------------------------------------------------------------------
+
+cMemoryLock cRealtime::lockMemory(size_t a_heapReserve)
+{
+#if defined(LINUX)
+    // lock the future pages as well only if nothing limits how much may be
+    // locked; otherwise later allocations could fail once over the limit
+    struct rlimit limit;
+    bool unlimited = (geteuid() == 0) ||
+                     ((getrlimit(RLIMIT_MEMLOCK, &limit) == 0) && (limit.rlim_cur == RLIM_INFINITY));
+
+    // keep freed memory in the heap and serve large blocks from it too, so
+    // that the prefaulted pages are reused rather than unmapped
+    if (unlimited)
+    {
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+    }
+
+    cMemoryLock result = C_MEMORY_UNLOCKED;
+    if (unlimited && (mlockall(MCL_CURRENT | MCL_FUTURE) == 0))
+    {
+        result = C_MEMORY_LOCKED_ALL;
+    }
+    else if (mlockall(MCL_CURRENT) == 0)
+    {
+        result = C_MEMORY_LOCKED_CURRENT;
+    }
+
+    // fault in the heap reserve; with future pages locked it stays resident
+    if ((result == C_MEMORY_LOCKED_ALL) && (a_heapReserve > 0))
+    {
+        volatile char* reserve = (volatile char*)malloc(a_heapReserve);
+        if (reserve != NULL)
+        {
+            for (size_t i=0; i<a_heapReserve; i+=C_PAGE_STRIDE)
+            {
+                reserve[i] = 0;
+            }
+            free((void*)reserve);
+        }
+    }
+    return (result);
+#else
+    return (C_MEMORY_UNLOCKED);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+vector<int> cRealtime::getIsolatedCores()
+{
+    vector<int> cores;
+#if defined(LINUX)
+    // a list such as "2-3,6"
+    ifstream file("/sys/devices/system/cpu/isolated");
+    string list;
+    if (!getline(file, list))
+    {
+        return (cores);
+    }
+    istringstream in(list);
+    string range;
+    while (getline(in, range, ','))
+    {
+        if (range.empty())
+        {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = (dash == string::npos) ? first : atoi(range.c_str() + dash + 1);
+        for (int core=first; core<=last; core++)
+        {
+            cores.push_back(core);
+        }
+    }
+    sort(cores.begin(), cores.end());
+#endif
+    return (cores);
+}
+
+//------------------------------------------------------------------------------
+
+vector<int> cRealtime::getServoCores(bool a_isolatedFirst)
+{
+    vector<int> cores;
+    if (a_isolatedFirst)
+    {
+        cores = getIsolatedCores();
+        reverse(cores.begin(), cores.end());
+    }
+    for (int core=(int)thread::hardware_concurrency()-1; core>=0; core--)
+    {
+        if (find(cores.begin(), cores.end(), core) == cores.end())
+        {
+            cores.push_back(core);
+        }
+    }
+    return (cores);
+}
+
+//------------------------------------------------------------------------------
+
+int cRealtime::setFifoPriority(int a_priority)
+{
+#if defined(LINUX)
+    int priority = max(sched_get_priority_min(SCHED_FIFO), min(a_priority, sched_get_priority_max(SCHED_FIFO)));
+    struct sched_param param;
+    param.sched_priority = priority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+    {
+        return (-1);
+    }
+    return (priority);
+#elif defined(WIN32) || defined(WIN64)
+    return (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) ? THREAD_PRIORITY_TIME_CRITICAL : -1);
+#else
+    return (-1);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void cRealtime::prefaultStack()
+{
+    volatile char stack[C_STACK_PREFAULT];
+    for (size_t i=0; i<C_STACK_PREFAULT; i+=C_PAGE_STRIDE)
+    {
+        stack[i] = 0;
+    }
+
+    // read back the last page written, so that the buffer counts as used
+    char last = stack[((C_STACK_PREFAULT - 1) / C_PAGE_STRIDE) * C_PAGE_STRIDE];
+    (void)last;
+}
+
+//------------------------------------------------------------------------------
+
+string cRealtime::describe(cMemoryLock a_lock)
+{
+    switch (a_lock)
+    {
+        case C_MEMORY_LOCKED_ALL: return ("locked");
+        case C_MEMORY_LOCKED_CURRENT: return ("current pages locked");
+        default: return ("not locked");
+    }
+}
+
+//------------------------------------------------------------------------------
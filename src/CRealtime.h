@@ -0,0 +1,74 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CRealtimeH
+#define CRealtimeH
+//------------------------------------------------------------------------------
+#include <cstddef>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+
+// how much of the address space lockMemory() could keep in RAM
+enum cMemoryLock
+{
+    C_MEMORY_UNLOCKED,          // nothing: pages may be swapped out
+    C_MEMORY_LOCKED_CURRENT,    // the pages mapped so far, not later ones
+    C_MEMORY_LOCKED_ALL         // current and future pages
+};
+
+//------------------------------------------------------------------------------
+// Operating system setup for a real-time servo loop. Every function reports
+// whether it succeeded and leaves things as they were if it did not, so the
+// caller can run with whatever the permissions of the process allow.
+//
+// Linux provides everything: core isolation (isolcpus=), SCHED_FIFO (needs
+// CAP_SYS_NICE or an rtprio limit), mlockall (needs CAP_IPC_LOCK or a large
+// enough memlock limit). Windows only raises the thread priority; other
+// platforms support none of it.
+//------------------------------------------------------------------------------
+class cRealtime
+{
+public:
+
+    // stack touched by prefaultStack() [bytes]
+    static const size_t C_STACK_PREFAULT = 256 * 1024;
+
+    // lock the pages of the process into RAM and prefault a_heapReserve
+    // bytes of heap, which the allocator then keeps instead of returning it
+    // to the system. future pages are only locked if the memlock limit
+    // allows it, so that later allocations cannot fail because of it.
+    static cMemoryLock lockMemory(size_t a_heapReserve);
+
+    // cores the kernel keeps other tasks off (isolcpus=), in ascending order
+    static std::vector<int> getIsolatedCores();
+
+    // cores to run servo threads on, best first: the isolated ones if
+    // a_isolatedFirst is set, then the others, each from the highest down so
+    // that core 0 is left to the graphics loop and the interrupts
+    static std::vector<int> getServoCores(bool a_isolatedFirst);
+
+    // run the calling thread under SCHED_FIFO at a_priority (clamped to the
+    // range of the policy). returns the priority that was set, or -1.
+    static int setFifoPriority(int a_priority);
+
+    // touch C_STACK_PREFAULT bytes of the stack of the calling thread, so
+    // that the servo loop never takes a page fault on it
+    static void prefaultStack();
+
+    // "locked", "current pages locked" or "not locked"
+    static std::string describe(cMemoryLock a_lock);
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
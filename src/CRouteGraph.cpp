@@ -0,0 +1,240 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CRouteGraph.h"
+#include "COsmMeshBuilder.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <unordered_map>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+// true if a_value is one of the null terminated a_values
+static bool isOneOf(const char* a_value, const char* const* a_values)
+{
+    for (int i=0; (a_value != NULL) && (a_values[i] != NULL); i++)
+    {
+        if (strcmp(a_value, a_values[i]) == 0)
+        {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+//------------------------------------------------------------------------------
+
+bool cRouteGraph::build(const cOsmMap& a_map, const cOsmProjection& a_projection)
+{
+    static const char* const closed[] = { "no", "private", NULL };
+    static const char* const allowed[] = { "yes", "designated", "permissive", NULL };
+
+    m_points.clear();
+    m_offsets.clear();
+    m_targets.clear();
+    m_lengths.clear();
+
+    // vertices of the OSM nodes on paths, and the segments between them
+    unordered_map<int64_t, int> vertices;
+    vector<pair<int, int> > edges;
+    const vector<cOsmWay>& ways = a_map.getWays();
+    for (size_t i=0; i<ways.size(); i++)
+    {
+        // the same ways as cOsmMeshBuilder::extractPaths()
+        const cOsmWay& way = ways[i];
+        const char* highway = way.getTag("highway");
+        const char* area = way.getTag("area");
+        if ((highway == NULL) || ((area != NULL) && (strcmp(area, "yes") == 0)) ||
+            (cOsmMeshBuilder::getPathWidth(highway) <= 0.0))
+        {
+            continue;
+        }
+        const char* foot = way.getTag("foot");
+        if ((foot != NULL) && (strcmp(foot, "no") == 0))
+        {
+            continue;
+        }
+        if (isOneOf(way.getTag("access"), closed) && !isOneOf(foot, allowed))
+        {
+            continue;
+        }
+
+        int last = -1;
+        for (size_t k=0; k<way.m_nodeIds.size(); k++)
+        {
+            double lat, lon;
+            if (!a_map.getNodeLocation(way.m_nodeIds[k], lat, lon))
+            {
+                continue;
+            }
+            pair<unordered_map<int64_t, int>::iterator, bool> vertex =
+                vertices.insert(make_pair(way.m_nodeIds[k], (int)m_points.size() / 2));
+            if (vertex.second)
+            {
+                cVector3d p = a_projection.toLocal(lat, lon);
+                m_points.push_back((float)p(0));
+                m_points.push_back((float)p(1));
+            }
+            int current = vertex.first->second;
+            if ((last >= 0) && (last != current))
+            {
+                edges.push_back(make_pair(last, current));
+                edges.push_back(make_pair(current, last));
+            }
+            last = current;
+        }
+    }
+
+    // compressed rows, without the duplicates of ways sharing segments
+    sort(edges.begin(), edges.end());
+    edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+    int numVertices = getNumVertices();
+    m_offsets.assign(numVertices + 1, 0);
+    m_targets.reserve(edges.size());
+    m_lengths.reserve(edges.size());
+    for (size_t i=0; i<edges.size(); i++)
+    {
+        m_offsets[edges[i].first + 1]++;
+        m_targets.push_back(edges[i].second);
+        m_lengths.push_back(getDistance(edges[i].first, edges[i].second));
+    }
+    for (int i=0; i<numVertices; i++)
+    {
+        m_offsets[i + 1] += m_offsets[i];
+    }
+
+    return (!m_targets.empty());
+}
+
+//------------------------------------------------------------------------------
+
+int cRouteGraph::findNearestVertex(const cVector3d& a_pos) const
+{
+    float x = (float)a_pos(0);
+    float y = (float)a_pos(1);
+    int nearest = -1;
+    float nearestDistance2 = FLT_MAX;
+    for (int i=0; i<getNumVertices(); i++)
+    {
+        float dx = m_points[2*i] - x;
+        float dy = m_points[2*i+1] - y;
+        float distance2 = dx * dx + dy * dy;
+        if (distance2 < nearestDistance2)
+        {
+            nearest = i;
+            nearestDistance2 = distance2;
+        }
+    }
+    return (nearest);
+}
+
+//------------------------------------------------------------------------------
+
+size_t cRouteGraph::getMemoryUsage() const
+{
+    return (m_points.size() * sizeof(float) +
+            m_offsets.size() * sizeof(int) +
+            m_targets.size() * sizeof(int) +
+            m_lengths.size() * sizeof(float));
+}
+
+//------------------------------------------------------------------------------
+
+cRouteSearch::cRouteSearch(const cRouteGraph& a_graph) :
+    m_graph(a_graph),
+    m_stamp(a_graph.getNumVertices(), 0),
+    m_cost(a_graph.getNumVertices()),
+    m_parent(a_graph.getNumVertices()),
+    m_settled(a_graph.getNumVertices()),
+    m_search(0),
+    m_routeLength(0.0f),
+    m_numSettled(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+bool cRouteSearch::find(int a_from, int a_to, vector<int>& a_route)
+{
+    a_route.clear();
+    m_numSettled = 0;
+    int numVertices = m_graph.getNumVertices();
+    if ((a_from < 0) || (a_to < 0) || (a_from >= numVertices) || (a_to >= numVertices))
+    {
+        return (false);
+    }
+
+    // a new search invalidates the state of all vertices
+    if (++m_search == 0)
+    {
+        fill(m_stamp.begin(), m_stamp.end(), 0);
+        m_search = 1;
+    }
+
+    // min-heap on cost plus heuristic
+    greater<pair<float, int> > order;
+    m_heap.clear();
+    m_stamp[a_from] = m_search;
+    m_cost[a_from] = 0.0f;
+    m_parent[a_from] = -1;
+    m_settled[a_from] = 0;
+    m_heap.push_back(make_pair(m_graph.getDistance(a_from, a_to), a_from));
+
+    while (!m_heap.empty())
+    {
+        int vertex = m_heap.front().second;
+        pop_heap(m_heap.begin(), m_heap.end(), order);
+        m_heap.pop_back();
+        if (m_settled[vertex])
+        {
+            continue;
+        }
+        m_settled[vertex] = 1;
+        m_numSettled++;
+
+        if (vertex == a_to)
+        {
+            m_routeLength = m_cost[a_to];
+            for (int v=a_to; v>=0; v=m_parent[v])
+            {
+                a_route.push_back(v);
+            }
+            reverse(a_route.begin(), a_route.end());
+            return (true);
+        }
+
+        for (int e=m_graph.getFirstEdge(vertex); e<m_graph.getLastEdge(vertex); e++)
+        {
+            int target = m_graph.getTarget(e);
+            float cost = m_cost[vertex] + m_graph.getLength(e);
+            if (m_stamp[target] != m_search)
+            {
+                m_stamp[target] = m_search;
+                m_settled[target] = 0;
+            }
+            else if (m_settled[target] || (cost >= m_cost[target]))
+            {
+                continue;
+            }
+            m_cost[target] = cost;
+            m_parent[target] = vertex;
+            m_heap.push_back(make_pair(cost + m_graph.getDistance(target, a_to), target));
+            push_heap(m_heap.begin(), m_heap.end(), order);
+        }
+    }
+    return (false);
+}
+
+//------------------------------------------------------------------------------
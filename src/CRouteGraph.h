@@ -0,0 +1,130 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CRouteGraphH
+#define CRouteGraphH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <cmath>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+//------------------------------------------------------------------------------
+class cOsmMap;
+class cOsmProjection;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Walkable network of an OSM extract: a vertex per node of a highway way the
+// map shows as a path, an edge per segment, both ways. Vertices are in the
+// xy plane of the map.
+//
+// The graph is stored in compressed sparse row form: the edges leaving
+// vertex i are m_targets[m_offsets[i] .. m_offsets[i+1]], with their
+// lengths in m_lengths. It is read only after build(), so any number of
+// cRouteSearch may use it from any thread.
+//------------------------------------------------------------------------------
+class cRouteGraph
+{
+public:
+
+    cRouteGraph() {}
+
+    // build the network of a_map, laid out by a_projection. ways tagged
+    // foot=no or access=no/private (without foot=yes/designated) are left
+    // out. returns false if there is no path.
+    bool build(const cOsmMap& a_map, const cOsmProjection& a_projection);
+
+    int getNumVertices() const { return ((int)m_points.size() / 2); }
+    int getNumEdges() const { return ((int)m_targets.size()); }
+
+    // position of a vertex, in local coordinates of the map (z = 0)
+    chai3d::cVector3d getVertex(int a_vertex) const
+    {
+        return (chai3d::cVector3d(m_points[2*a_vertex], m_points[2*a_vertex+1], 0.0));
+    }
+
+    // vertex nearest to a_pos in the xy plane, or -1 if the graph is empty.
+    // scans all vertices: a campus has a few thousand.
+    int findNearestVertex(const chai3d::cVector3d& a_pos) const;
+
+    // edges leaving a vertex
+    int getFirstEdge(int a_vertex) const { return (m_offsets[a_vertex]); }
+    int getLastEdge(int a_vertex) const { return (m_offsets[a_vertex + 1]); }
+    int getTarget(int a_edge) const { return (m_targets[a_edge]); }
+    float getLength(int a_edge) const { return (m_lengths[a_edge]); }
+
+    // straight-line distance between two vertices, a lower bound of the
+    // length of any route between them
+    float getDistance(int a_a, int a_b) const
+    {
+        float dx = m_points[2*a_a] - m_points[2*a_b];
+        float dy = m_points[2*a_a+1] - m_points[2*a_b+1];
+        return (sqrt(dx * dx + dy * dy));
+    }
+
+    // size of the graph [bytes]
+    size_t getMemoryUsage() const;
+
+private:
+
+    // vertex positions, x and y interleaved
+    std::vector<float> m_points;
+
+    std::vector<int> m_offsets;
+    std::vector<int> m_targets;
+    std::vector<float> m_lengths;
+};
+
+//------------------------------------------------------------------------------
+// A* search on a cRouteGraph, with the straight-line distance as heuristic.
+// The per-vertex state is kept between searches and invalidated by a
+// counter, so a search only touches the vertices it visits and allocates
+// nothing once the heap has grown. Not shared between threads.
+//------------------------------------------------------------------------------
+class cRouteSearch
+{
+public:
+
+    cRouteSearch(const cRouteGraph& a_graph);
+
+    // shortest route from a_from to a_to, as vertices from a_from to a_to.
+    // returns false if a_to cannot be reached.
+    bool find(int a_from, int a_to, std::vector<int>& a_route);
+
+    // length of the route of the last successful find()
+    float getRouteLength() const { return (m_routeLength); }
+
+    // vertices settled by the last find()
+    int getNumSettled() const { return (m_numSettled); }
+
+private:
+
+    const cRouteGraph& m_graph;
+
+    // per vertex: search the state belongs to, cost from the start, vertex
+    // it was reached from, and whether its cost is final
+    std::vector<uint32_t> m_stamp;
+    std::vector<float> m_cost;
+    std::vector<int> m_parent;
+    std::vector<char> m_settled;
+    uint32_t m_search;
+
+    // open vertices, ordered by cost plus heuristic (lazy deletion)
+    std::vector<std::pair<float, int> > m_heap;
+
+    float m_routeLength;
+    int m_numSettled;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
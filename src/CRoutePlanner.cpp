@@ -0,0 +1,323 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CRoutePlanner.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+// segments before and after the last closest one that the haptic thread
+// looks at
+static const int C_SEARCH_WINDOW = 8;
+
+//------------------------------------------------------------------------------
+
+cRoutePlanner::cRoutePlanner(const shared_ptr<const cRouteGraph>& a_graph,
+                             const cRouteGuidanceSettings& a_settings) :
+    m_graph(a_graph),
+    m_settings(a_settings),
+    m_hasGoal(false),
+    m_goalChanged(false),
+    m_running(false),
+    m_routeLength(0.0),
+    m_planningTime(0.0),
+    m_numRoutes(0),
+    m_position(packPosition(0.0f, 0.0f)),
+    m_offRoute(false),
+    m_lastFrom(-1),
+    m_lastTo(-1),
+    m_segment(0),
+    m_searchAll(false),
+    m_force(0.0, 0.0, 0.0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+cRoutePlanner::~cRoutePlanner()
+{
+    stop();
+}
+
+//------------------------------------------------------------------------------
+
+void cRoutePlanner::start()
+{
+    if (m_running)
+    {
+        return;
+    }
+    m_running = true;
+    m_thread = thread(&cRoutePlanner::run, this);
+}
+
+//------------------------------------------------------------------------------
+
+void cRoutePlanner::stop()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cRoutePlanner::setGoal(const cVector3d& a_goal)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_goal = a_goal;
+        m_hasGoal = true;
+        m_goalChanged = true;
+    }
+    m_wake.notify_all();
+}
+
+//------------------------------------------------------------------------------
+
+void cRoutePlanner::clearGoal()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_hasGoal = false;
+        m_goalChanged = true;
+    }
+    m_wake.notify_all();
+}
+
+//------------------------------------------------------------------------------
+
+uint64_t cRoutePlanner::packPosition(float a_x, float a_y)
+{
+    uint32_t x, y;
+    memcpy(&x, &a_x, sizeof(x));
+    memcpy(&y, &a_y, sizeof(y));
+    return (((uint64_t)x << 32) | y);
+}
+
+//------------------------------------------------------------------------------
+
+void cRoutePlanner::unpackPosition(uint64_t a_packed, float& a_x, float& a_y)
+{
+    uint32_t x = (uint32_t)(a_packed >> 32);
+    uint32_t y = (uint32_t)a_packed;
+    memcpy(&a_x, &x, sizeof(x));
+    memcpy(&a_y, &y, sizeof(y));
+}
+
+//------------------------------------------------------------------------------
+
+void cRoutePlanner::run()
+{
+    cRouteSearch search(*m_graph);
+    chrono::microseconds period((int64_t)(1e6 * m_settings.m_replanPeriod));
+
+    unique_lock<mutex> lock(m_mutex);
+    while (m_running)
+    {
+        m_wake.wait_for(lock, period);
+        if (!m_running)
+        {
+            break;
+        }
+
+        // a new goal, or the tool left the route
+        bool goalChanged = m_goalChanged;
+        if (!goalChanged && !(m_hasGoal && m_offRoute))
+        {
+            continue;
+        }
+        m_goalChanged = false;
+        cVector3d goal = m_goal;
+        bool hasGoal = m_hasGoal;
+
+        lock.unlock();
+        plan(search, goal, hasGoal, goalChanged);
+        lock.lock();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cRoutePlanner::plan(cRouteSearch& a_search, const cVector3d& a_goal, bool a_hasGoal, bool a_goalChanged)
+{
+    cRoute& route = m_routes.getWriteBuffer();
+    route.m_points.clear();
+    route.m_remaining.clear();
+
+    if (a_hasGoal)
+    {
+        float x, y;
+        unpackPosition(m_position, x, y);
+        int from = m_graph->findNearestVertex(cVector3d(x, y, 0.0));
+        int to = m_graph->findNearestVertex(a_goal);
+        if (!a_goalChanged && (from == m_lastFrom) && (to == m_lastTo))
+        {
+            return;
+        }
+        m_lastFrom = from;
+        m_lastTo = to;
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool found = a_search.find(from, to, m_vertices);
+        m_planningTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (!found)
+        {
+            cout << "Warning - no walkable route to the goal" << endl;
+        }
+
+        // the route and the length left from each of its points
+        route.m_remaining.resize(m_vertices.size());
+        float remaining = 0.0f;
+        for (size_t i=m_vertices.size(); i-->0; )
+        {
+            if (i + 1 < m_vertices.size())
+            {
+                remaining += m_graph->getDistance(m_vertices[i], m_vertices[i + 1]);
+            }
+            route.m_remaining[i] = remaining;
+        }
+        for (size_t i=0; i<m_vertices.size(); i++)
+        {
+            cVector3d p = m_graph->getVertex(m_vertices[i]);
+            route.m_points.push_back((float)p(0));
+            route.m_points.push_back((float)p(1));
+        }
+        m_routeLength = remaining;
+    }
+    else
+    {
+        m_lastFrom = m_lastTo = -1;
+        m_routeLength = 0.0;
+    }
+    m_numRoutes++;
+
+    // hand the route over to the haptic thread
+    m_routes.publish();
+}
+
+//------------------------------------------------------------------------------
+
+float cRoutePlanner::findClosest(const cRoute& a_route, int a_first, int a_last, float a_x, float a_y,
+                                 int& a_segment, float& a_t)
+{
+    const float* points = &a_route.m_points[0];
+    float best = FLT_MAX;
+    for (int i=a_first; i<a_last; i++)
+    {
+        float ax = points[2*i], ay = points[2*i+1];
+        float ex = points[2*i+2] - ax, ey = points[2*i+3] - ay;
+        float px = a_x - ax, py = a_y - ay;
+        float length2 = ex * ex + ey * ey;
+        float t = (length2 > 0.0f) ? max(0.0f, min(1.0f, (px * ex + py * ey) / length2)) : 0.0f;
+        float dx = px - t * ex, dy = py - t * ey;
+        float distance2 = dx * dx + dy * dy;
+        if (distance2 < best)
+        {
+            best = distance2;
+            a_segment = i;
+            a_t = t;
+        }
+    }
+    return (best);
+}
+
+//------------------------------------------------------------------------------
+
+void cRoutePlanner::update(const cVector3d& a_proxy)
+{
+    float x = (float)a_proxy(0);
+    float y = (float)a_proxy(1);
+    m_position.store(packPosition(x, y), memory_order_relaxed);
+
+    // take over a fresh route
+    if (m_routes.update())
+    {
+        m_segment = 0;
+        m_searchAll = true;
+    }
+
+    m_force.zero();
+    const cRoute& route = m_routes.getReadBuffer();
+    int numPoints = (int)route.m_points.size() / 2;
+    if (numPoints == 0)
+    {
+        m_offRoute = false;
+        return;
+    }
+
+    // closest point: near the last one, or anywhere if the tool jumped
+    float replan2 = (float)(m_settings.m_replanDistance * m_settings.m_replanDistance);
+    int segment = 0;
+    float t = 0.0f;
+    float distance2;
+    if (numPoints == 1)
+    {
+        float dx = route.m_points[0] - x, dy = route.m_points[1] - y;
+        distance2 = dx * dx + dy * dy;
+    }
+    else
+    {
+        int numSegments = numPoints - 1;
+        int first = m_searchAll ? 0 : max(0, m_segment - C_SEARCH_WINDOW);
+        int last = m_searchAll ? numSegments : min(numSegments, m_segment + C_SEARCH_WINDOW + 1);
+        distance2 = findClosest(route, first, last, x, y, segment, t);
+        if ((distance2 > replan2) && !m_searchAll)
+        {
+            distance2 = findClosest(route, 0, numSegments, x, y, segment, t);
+        }
+    }
+    m_segment = segment;
+    m_searchAll = false;
+    m_offRoute = (distance2 > replan2);
+
+    const float* a = &route.m_points[2 * segment];
+    cVector3d closest(a[0], a[1], 0.0);
+    cVector3d tangent(0.0, 0.0, 0.0);
+    double remaining = 0.0;
+    if (numPoints > 1)
+    {
+        cVector3d edge(a[2] - a[0], a[3] - a[1], 0.0);
+        double length = edge.length();
+        closest += t * edge;
+        remaining = route.m_remaining[segment + 1] + (1.0 - t) * length;
+        if (length > 0.0)
+        {
+            tangent = edge / length;
+        }
+    }
+
+    // spring onto the route, pull along it, fading out at the goal
+    cVector3d toRoute(closest(0) - a_proxy(0), closest(1) - a_proxy(1), 0.0);
+    m_force = m_settings.m_stiffness * toRoute;
+    if (m_settings.m_arrivalRadius > 0.0)
+    {
+        m_force += m_settings.m_pull * cMin(1.0, remaining / m_settings.m_arrivalRadius) * tangent;
+    }
+    double magnitude = m_force.length();
+    if (magnitude > m_settings.m_maxForce)
+    {
+        m_force *= m_settings.m_maxForce / magnitude;
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,166 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CRoutePlannerH
+#define CRoutePlannerH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CRouteGraph.h"
+#include "CTripleBuffer.h"
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+
+struct cRouteGuidanceSettings
+{
+    cRouteGuidanceSettings() :
+        m_stiffness(100.0),
+        m_pull(0.5),
+        m_maxForce(1.5),
+        m_arrivalRadius(0.01),
+        m_replanDistance(0.03),
+        m_replanPeriod(0.2) {}
+
+    // spring towards the closest point of the route [N per world unit]
+    double m_stiffness;
+
+    // force along the route, towards the goal [N]
+    double m_pull;
+
+    // largest guidance force [N]
+    double m_maxForce;
+
+    // the pull fades out over this distance before the goal [world units]
+    double m_arrivalRadius;
+
+    // the route is planned again from the proxy once it is this far from
+    // the route [world units], checked every m_replanPeriod [s]
+    double m_replanDistance;
+    double m_replanPeriod;
+};
+
+//------------------------------------------------------------------------------
+// Guides the tool along the walkable network of the map to a goal.
+//
+// Routes are planned with A* on a planner thread, from the vertex nearest
+// to the proxy to the vertex nearest to the goal, and again whenever the
+// goal changes or the proxy strays from the route. Finished routes are
+// handed to the haptic thread through a cTripleBuffer, so neither side ever
+// waits for the other.
+//
+// The guidance force is a spring in the plane of the map towards the
+// closest point of the route plus a constant pull along it. The haptic
+// thread tracks the closest segment from tick to tick, so a tick only
+// looks at a few segments.
+//------------------------------------------------------------------------------
+class cRoutePlanner
+{
+public:
+
+    cRoutePlanner(const std::shared_ptr<const cRouteGraph>& a_graph,
+                  const cRouteGuidanceSettings& a_settings = cRouteGuidanceSettings());
+    ~cRoutePlanner();
+
+    // start / stop the planner thread
+    void start();
+    void stop();
+
+    // any thread: plan a route to a_goal (local coordinates of the map), or
+    // drop the route
+    void setGoal(const chai3d::cVector3d& a_goal);
+    void clearGoal();
+
+    // length of the latest route [world units], 0 if there is none, and
+    // the time it took to plan [s]
+    double getRouteLength() const { return (m_routeLength); }
+    double getPlanningTime() const { return (m_planningTime); }
+
+    // number of routes planned so far
+    int getNumRoutes() const { return (m_numRoutes); }
+
+    // haptic thread: a_proxy is the proxy in local coordinates of the map.
+    // the guidance force, in the same frame, is then available from
+    // getForce().
+    void update(const chai3d::cVector3d& a_proxy);
+
+    // guidance force of the last update
+    const chai3d::cVector3d& getForce() const { return (m_force); }
+
+private:
+
+    struct cRoute
+    {
+        // points from the start to the goal, x and y interleaved, and the
+        // length of the route from each point to the goal
+        std::vector<float> m_points;
+        std::vector<float> m_remaining;
+    };
+
+    static uint64_t packPosition(float a_x, float a_y);
+    static void unpackPosition(uint64_t a_packed, float& a_x, float& a_y);
+
+    void run();
+
+    // closest point to (a_x, a_y) on segments [a_first, a_last) of a route:
+    // returns its squared distance, the segment and the position along it
+    static float findClosest(const cRoute& a_route, int a_first, int a_last, float a_x, float a_y,
+                             int& a_segment, float& a_t);
+
+    // plan from the last published proxy position and publish the route.
+    // unless a_goalChanged, nothing is done if neither end moved to another
+    // vertex.
+    void plan(cRouteSearch& a_search, const chai3d::cVector3d& a_goal, bool a_hasGoal, bool a_goalChanged);
+
+    std::shared_ptr<const cRouteGraph> m_graph;
+    cRouteGuidanceSettings m_settings;
+
+    // goal, guarded by m_mutex
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    chai3d::cVector3d m_goal;
+    bool m_hasGoal;
+    bool m_goalChanged;
+
+    // planner thread
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::atomic<double> m_routeLength;
+    std::atomic<double> m_planningTime;
+    std::atomic<int> m_numRoutes;
+    std::vector<int> m_vertices;
+
+    // routes, written by the planner thread and read by the haptic thread
+    cTripleBuffer<cRoute> m_routes;
+
+    // written by the haptic thread: proxy position and whether it is off
+    // the route
+    std::atomic<uint64_t> m_position;
+    std::atomic<bool> m_offRoute;
+
+    // planner thread: ends of the latest route
+    int m_lastFrom;
+    int m_lastTo;
+
+    // haptic thread state
+    int m_segment;
+    bool m_searchAll;
+    chai3d::cVector3d m_force;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,252 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CSessionRecorder.h"
+#include "CHapticScheduler.h"
+//------------------------------------------------------------------------------
+#include <chrono>
+#include <cstring>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+namespace
+{
+    // the writer thread drains the buffer this often
+    const int C_DRAIN_PERIOD_MS = 20;
+
+    //--------------------------------------------------------------------------
+    // LOG FILE LAYOUT
+    //--------------------------------------------------------------------------
+
+    const char C_MAGIC[8] = { 'H', 'M', 'A', 'P', 'R', 'E', 'C', 'D' };
+    const uint32_t C_VERSION = 1;
+
+    struct cSessionFileHeader
+    {
+        char m_magic[8];
+        uint32_t m_version;
+        uint32_t m_headerSize;
+        uint32_t m_sampleSize;
+        uint32_t m_reserved;
+        double m_rate;
+    };
+
+    //--------------------------------------------------------------------------
+
+    inline void store(float* a_out, const cVector3d& a_v)
+    {
+        a_out[0] = (float)a_v(0);
+        a_out[1] = (float)a_v(1);
+        a_out[2] = (float)a_v(2);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cSessionRecorder::cSessionRecorder(size_t a_capacity) :
+    m_head(0),
+    m_tailCache(0),
+    m_tick(0),
+    m_startTime(0),
+    m_tail(0),
+    m_recording(false),
+    m_numWritten(0),
+    m_numDropped(0)
+{
+    size_t capacity = 1;
+    while (capacity < a_capacity)
+    {
+        capacity *= 2;
+    }
+    m_samples.resize(capacity);
+    m_mask = capacity - 1;
+}
+
+//------------------------------------------------------------------------------
+
+cSessionRecorder::~cSessionRecorder()
+{
+    stop();
+}
+
+//------------------------------------------------------------------------------
+
+bool cSessionRecorder::start(const string& a_filename, double a_rate)
+{
+    stop();
+
+    m_out.open(a_filename.c_str(), ios::binary | ios::trunc);
+    if (!m_out)
+    {
+        cout << "Error - failed to create session log " << a_filename << endl;
+        return (false);
+    }
+
+    cSessionFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, C_MAGIC, sizeof(C_MAGIC));
+    header.m_version = C_VERSION;
+    header.m_headerSize = sizeof(cSessionFileHeader);
+    header.m_sampleSize = sizeof(cSessionSample);
+    header.m_rate = a_rate;
+    m_out.write((const char*)&header, sizeof(header));
+
+    m_head.store(0, memory_order_relaxed);
+    m_tail.store(0, memory_order_relaxed);
+    m_tailCache = 0;
+    m_tick = 0;
+    m_startTime = cHapticScheduler::now();
+    m_numWritten.store(0, memory_order_relaxed);
+    m_numDropped.store(0, memory_order_relaxed);
+    m_recording.store(true, memory_order_release);
+    m_thread = thread(&cSessionRecorder::run, this);
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void cSessionRecorder::stop()
+{
+    if (!m_recording.exchange(false))
+    {
+        return;
+    }
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    drain();
+    m_out.close();
+}
+
+//------------------------------------------------------------------------------
+
+bool cSessionRecorder::record(cToolCursor* a_tool, const cVector3d& a_proxy, const cVector3d& a_force, int a_feature)
+{
+    if (!m_recording.load(memory_order_relaxed))
+    {
+        return (false);
+    }
+
+    // room left: the writer's position is read again only when the buffer
+    // looks full
+    uint64_t head = m_head.load(memory_order_relaxed);
+    uint32_t tick = m_tick++;
+    if (head - m_tailCache > m_mask)
+    {
+        m_tailCache = m_tail.load(memory_order_acquire);
+        if (head - m_tailCache > m_mask)
+        {
+            m_numDropped.store(m_numDropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            return (false);
+        }
+    }
+
+    cSessionSample& sample = m_samples[head & m_mask];
+    sample.m_tick = tick;
+    sample.m_time = (uint32_t)((cHapticScheduler::now() - m_startTime) / 1000);
+
+    cQuaternion rot;
+    rot.fromRotMat(a_tool->getDeviceLocalRot());
+    store(sample.m_devicePos, a_tool->getDeviceLocalPos() / a_tool->getWorkspaceScaleFactor());
+    sample.m_deviceRot[0] = (float)rot.w;
+    sample.m_deviceRot[1] = (float)rot.x;
+    sample.m_deviceRot[2] = (float)rot.y;
+    sample.m_deviceRot[3] = (float)rot.z;
+    store(sample.m_proxyPos, a_proxy);
+    store(sample.m_toolForce, a_tool->getDeviceGlobalForce());
+    store(sample.m_force, a_force);
+
+    cHapticPoint* point = a_tool->m_hapticPoint;
+    int numContacts = point->getNumCollisionEvents();
+    sample.m_numContacts = numContacts;
+    sample.m_triangles[0] = (numContacts > 0) ? point->getCollisionEvent(0)->m_index : -1;
+    sample.m_triangles[1] = (numContacts > 1) ? point->getCollisionEvent(1)->m_index : -1;
+    sample.m_feature = a_feature;
+
+    m_head.store(head + 1, memory_order_release);
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void cSessionRecorder::run()
+{
+    while (m_recording.load(memory_order_acquire))
+    {
+        this_thread::sleep_for(chrono::milliseconds(C_DRAIN_PERIOD_MS));
+        drain();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cSessionRecorder::drain()
+{
+    uint64_t tail = m_tail.load(memory_order_relaxed);
+    uint64_t head = m_head.load(memory_order_acquire);
+    if (head == tail)
+    {
+        return;
+    }
+
+    // at most two runs: up to the end of the buffer, then from its start
+    while (tail < head)
+    {
+        size_t first = (size_t)(tail & m_mask);
+        size_t count = (size_t)min<uint64_t>(head - tail, m_samples.size() - first);
+        m_out.write((const char*)&m_samples[first], count * sizeof(cSessionSample));
+        tail += count;
+    }
+    m_out.flush();
+
+    m_numWritten.store(head, memory_order_relaxed);
+    m_tail.store(head, memory_order_release);
+}
+
+//------------------------------------------------------------------------------
+
+bool cLoadSessionLog(const string& a_filename, double& a_rate, vector<cSessionSample>& a_samples)
+{
+    ifstream in(a_filename.c_str(), ios::binary);
+    if (!in)
+    {
+        return (false);
+    }
+    in.seekg(0, ios::end);
+    uint64_t fileSize = (uint64_t)in.tellg();
+    in.seekg(0, ios::beg);
+
+    cSessionFileHeader header;
+    if (!in.read((char*)&header, sizeof(header)) ||
+        (memcmp(header.m_magic, C_MAGIC, sizeof(C_MAGIC)) != 0) ||
+        (header.m_version != C_VERSION) ||
+        (header.m_headerSize != sizeof(cSessionFileHeader)) ||
+        (header.m_sampleSize != sizeof(cSessionSample)) ||
+        !(header.m_rate > 0.0))
+    {
+        cout << "Error - " << a_filename << " is not a session log of this version" << endl;
+        return (false);
+    }
+
+    size_t numSamples = (size_t)((fileSize - sizeof(cSessionFileHeader)) / sizeof(cSessionSample));
+    a_samples.resize(numSamples);
+    if ((numSamples > 0) && !in.read((char*)&a_samples[0], numSamples * sizeof(cSessionSample)))
+    {
+        a_samples.clear();
+        return (false);
+    }
+    a_rate = header.m_rate;
+    return (true);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,138 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CSessionRecorderH
+#define CSessionRecorderH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+
+// one haptic tick as stored in a session log. floats only, so that a log is
+// 88 bytes per tick and can be read back with a single read().
+struct cSessionSample
+{
+    // tick since the recording started, and when it was recorded [us]
+    uint32_t m_tick;
+    uint32_t m_time;
+
+    // device position (device frame, as the device reports it, i.e. what a
+    // cSimulatedHapticDevice replays) and rotation (quaternion w, x, y, z)
+    float m_devicePos[3];
+    float m_deviceRot[4];
+
+    // proxy position (global coordinates)
+    float m_proxyPos[3];
+
+    // force of the tool alone (getDeviceGlobalForce()) and force sent to the
+    // device with the textures, cues and guidance added [N]
+    float m_toolForce[3];
+    float m_force[3];
+
+    // number of contacts of the proxy, the triangles of the first two in
+    // their mesh (-1 = none) and the feature touched (-1 = none)
+    int32_t m_numContacts;
+    int32_t m_triangles[2];
+    int32_t m_feature;
+};
+
+//------------------------------------------------------------------------------
+// Records what the haptic thread renders, for post-mortem analysis and
+// replay of a session.
+//
+// record() is called once per tick by the haptic thread. It writes the
+// sample straight into a single-producer single-consumer ring buffer and
+// publishes it with one release store: no lock, no allocation, no system
+// call. A writer thread drains the buffer to the log a few dozen times a
+// second and flushes it, so a crash loses at most the last drain period. If
+// the writer falls behind, samples are dropped and counted rather than
+// making the haptic thread wait.
+//
+// The log is a small header followed by the samples back to back; see
+// cLoadSessionLog().
+//------------------------------------------------------------------------------
+class cSessionRecorder
+{
+public:
+
+    // a_capacity: samples buffered between the haptic and the writer thread,
+    // rounded up to a power of two
+    cSessionRecorder(size_t a_capacity = 1 << 14);
+    ~cSessionRecorder();
+
+    // open a_filename and start the writer thread. a_rate is the servo rate
+    // [Hz], stored in the header for replay.
+    bool start(const std::string& a_filename, double a_rate);
+
+    // write what is left in the buffer and close the log. the haptic thread
+    // must no longer call record().
+    void stop();
+
+    bool isRecording() const { return (m_recording.load(std::memory_order_relaxed)); }
+
+    // haptic thread: record the tick that just sent a_force to the device of
+    // a_tool, with a_proxy as proxy (global coordinates) and a_feature as the
+    // feature touched. returns false if the sample was dropped.
+    bool record(chai3d::cToolCursor* a_tool, const chai3d::cVector3d& a_proxy,
+                const chai3d::cVector3d& a_force, int a_feature);
+
+    // samples written to the log so far
+    uint64_t getNumWritten() const { return (m_numWritten.load(std::memory_order_relaxed)); }
+
+    // samples dropped because the buffer was full
+    uint64_t getNumDropped() const { return (m_numDropped.load(std::memory_order_relaxed)); }
+
+protected:
+
+    // writer thread: drain the buffer every C_DRAIN_PERIOD_MS
+    void run();
+
+    // write the samples published so far
+    void drain();
+
+    // ring buffer; sample i lives in m_samples[i & m_mask]
+    std::vector<cSessionSample> m_samples;
+    uint64_t m_mask;
+
+    // haptic thread state, on cache lines of its own
+    char m_padding0[64];
+    std::atomic<uint64_t> m_head;
+    uint64_t m_tailCache;
+    uint32_t m_tick;
+    int64_t m_startTime;
+
+    // writer thread state
+    char m_padding1[64];
+    std::atomic<uint64_t> m_tail;
+    char m_padding2[64];
+
+    std::atomic<bool> m_recording;
+    std::atomic<uint64_t> m_numWritten;
+    std::atomic<uint64_t> m_numDropped;
+    std::ofstream m_out;
+    std::thread m_thread;
+};
+
+//------------------------------------------------------------------------------
+
+// read a log written by cSessionRecorder. a_rate is the servo rate it was
+// recorded at [Hz]. a sample cut short at the end of the file is ignored.
+bool cLoadSessionLog(const std::string& a_filename, double& a_rate, std::vector<cSessionSample>& a_samples);
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,117 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CSimulatedHapticDevice.h"
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+cSimulatedHapticDevice::cSimulatedHapticDevice(const cProbeTrajectory* a_trajectory) :
+    cGenericHapticDevice(0),
+    m_trajectory(a_trajectory),
+    m_index(0),
+    m_force(0.0, 0.0, 0.0)
+{
+    m_specifications.m_manufacturerName              = "HapMap";
+    m_specifications.m_modelName                     = "simulated";
+    m_specifications.m_maxLinearForce                = 8.0;     // [N]
+    m_specifications.m_maxAngularTorque              = 0.0;     // [N*m]
+    m_specifications.m_maxGripperForce               = 0.0;     // [N]
+    m_specifications.m_maxLinearStiffness            = 3000.0;  // [N/m]
+    m_specifications.m_maxAngularStiffness           = 0.0;     // [N*m/Rad]
+    m_specifications.m_maxGripperLinearStiffness     = 0.0;     // [N*m]
+    m_specifications.m_maxLinearDamping              = 20.0;    // [N/(m/s)]
+    m_specifications.m_maxAngularDamping             = 0.0;     // [N*m/(Rad/s)]
+    m_specifications.m_maxGripperAngularDamping      = 0.0;     // [N*m/(Rad/s)]
+    m_specifications.m_workspaceRadius               = 0.06;    // [m]
+    m_specifications.m_sensedPosition                = true;
+    m_specifications.m_sensedRotation                = false;
+    m_specifications.m_sensedGripper                 = false;
+    m_specifications.m_actuatedPosition              = true;
+    m_specifications.m_actuatedRotation              = false;
+    m_specifications.m_actuatedGripper               = false;
+    m_specifications.m_leftHand                      = true;
+    m_specifications.m_rightHand                     = true;
+
+    m_deviceAvailable = true;
+    m_deviceReady = false;
+}
+
+//------------------------------------------------------------------------------
+
+bool cSimulatedHapticDevice::open()
+{
+    m_deviceReady = true;
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cSimulatedHapticDevice::close()
+{
+    m_deviceReady = false;
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cSimulatedHapticDevice::calibrate(bool /*a_forceCalibration*/)
+{
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cSimulatedHapticDevice::getPosition(cVector3d& a_position)
+{
+    if ((m_trajectory == NULL) || (m_trajectory->size() == 0))
+    {
+        a_position.zero();
+        return (true);
+    }
+
+    a_position = m_trajectory->getPosition(m_index);
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cSimulatedHapticDevice::getRotation(cMatrix3d& a_rotation)
+{
+    a_rotation.identity();
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cSimulatedHapticDevice::getGripperAngleRad(double& a_angle)
+{
+    a_angle = 0.0;
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cSimulatedHapticDevice::getUserSwitches(unsigned int& a_userSwitches)
+{
+    a_userSwitches = 0;
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cSimulatedHapticDevice::setForceAndTorqueAndGripperForce(const cVector3d& a_force,
+                                                              const cVector3d& /*a_torque*/,
+                                                              double /*a_gripperForce*/)
+{
+    m_force = a_force;
+    return (true);
+}
@@ -0,0 +1,76 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CSimulatedHapticDeviceH
+#define CSimulatedHapticDeviceH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CProbeTrajectory.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// A haptic device that replays a probe trajectory instead of reading real
+// hardware. Each call to step() advances to the next sample; the forces sent
+// to the device are kept so they can be inspected. The specifications mimic
+// a small desktop device (Novint Falcon class).
+//------------------------------------------------------------------------------
+class cSimulatedHapticDevice : public chai3d::cGenericHapticDevice
+{
+public:
+
+    cSimulatedHapticDevice(const cProbeTrajectory* a_trajectory = NULL);
+    virtual ~cSimulatedHapticDevice() {}
+
+    static std::shared_ptr<cSimulatedHapticDevice> create(const cProbeTrajectory* a_trajectory = NULL)
+    {
+        return (std::make_shared<cSimulatedHapticDevice>(a_trajectory));
+    }
+
+    // cGenericHapticDevice interface
+    virtual bool open();
+    virtual bool close();
+    virtual bool calibrate(bool a_forceCalibration = false);
+    virtual bool getPosition(chai3d::cVector3d& a_position);
+    virtual bool getRotation(chai3d::cMatrix3d& a_rotation);
+    virtual bool getGripperAngleRad(double& a_angle);
+    virtual bool getUserSwitches(unsigned int& a_userSwitches);
+    virtual bool setForceAndTorqueAndGripperForce(const chai3d::cVector3d& a_force,
+                                                  const chai3d::cVector3d& a_torque,
+                                                  double a_gripperForce);
+
+    // set the trajectory to replay and rewind to its first sample
+    void setTrajectory(const cProbeTrajectory* a_trajectory) { m_trajectory = a_trajectory; m_index = 0; }
+
+    // advance to the next trajectory sample
+    void step() { m_index++; }
+
+    // index of the current sample
+    size_t getIndex() const { return (m_index); }
+
+    // last force sent by the application [N]
+    const chai3d::cVector3d& getLastForce() const { return (m_force); }
+
+protected:
+
+    // trajectory being replayed (not owned)
+    const cProbeTrajectory* m_trajectory;
+
+    // current sample
+    size_t m_index;
+
+    // last commanded force
+    chai3d::cVector3d m_force;
+};
+
+typedef std::shared_ptr<cSimulatedHapticDevice> cSimulatedHapticDevicePtr;
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,213 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CStageProfiler.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+namespace
+{
+    // time spent measuring the counter frequency
+    const int C_CALIBRATION_MS = 20;
+
+    double measureFrequency()
+    {
+#if defined(C_CYCLE_CLOCK_TSC)
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        uint64_t cycles = cCycleClock::now();
+        chrono::steady_clock::time_point end;
+        do
+        {
+            end = chrono::steady_clock::now();
+        }
+        while (end - start < chrono::milliseconds(C_CALIBRATION_MS));
+        cycles = cCycleClock::now() - cycles;
+        return ((double)cycles / chrono::duration<double>(end - start).count());
+#else
+        return (1e9);
+#endif
+    }
+}
+
+//------------------------------------------------------------------------------
+
+double cCycleClock::getFrequency()
+{
+    static const double frequency = measureFrequency();
+    return (frequency);
+}
+
+//------------------------------------------------------------------------------
+
+uint64_t cCycleClock::nowFallback()
+{
+    return ((uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//------------------------------------------------------------------------------
+
+cHdrHistogram::cHdrHistogram() :
+    m_counts(new atomic<uint64_t>[C_NUM_BUCKETS])
+{
+    reset();
+}
+
+//------------------------------------------------------------------------------
+
+void cHdrHistogram::reset()
+{
+    for (int i=0; i<C_NUM_BUCKETS; i++)
+    {
+        m_counts[i].store(0, memory_order_relaxed);
+    }
+    m_count.store(0, memory_order_relaxed);
+    m_sum.store(0, memory_order_relaxed);
+    m_max.store(0, memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+
+double cHdrHistogram::getMean() const
+{
+    uint64_t count = getCount();
+    return ((count > 0) ? (double)m_sum.load(memory_order_relaxed) / (double)count : 0.0);
+}
+
+//------------------------------------------------------------------------------
+
+uint64_t cHdrHistogram::getPercentile(double a_percent) const
+{
+    // the writer may be ahead of the total read here; the bucket counts are
+    // summed first so that the rank is always reached
+    uint64_t total = 0;
+    for (int i=0; i<C_NUM_BUCKETS; i++)
+    {
+        total += m_counts[i].load(memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+        return (0);
+    }
+
+    // nearest-rank percentile
+    uint64_t rank = (uint64_t)ceil(a_percent / 100.0 * (double)total);
+    rank = max<uint64_t>(1, min(rank, total));
+    uint64_t count = 0;
+    for (int i=0; i<C_NUM_BUCKETS; i++)
+    {
+        count += m_counts[i].load(memory_order_relaxed);
+        if (count >= rank)
+        {
+            return (min(getUpperBound(i) - 1, getMax()));
+        }
+    }
+    return (getMax());
+}
+
+//------------------------------------------------------------------------------
+
+uint64_t cHdrHistogram::getLowerBound(int a_bucket)
+{
+    if (a_bucket < (2 << C_SUB_BITS))
+    {
+        return ((uint64_t)a_bucket);
+    }
+    int shift = (a_bucket >> C_SUB_BITS) - 1;
+    uint64_t top = (uint64_t)(a_bucket - (shift << C_SUB_BITS));
+    return (top << shift);
+}
+
+//------------------------------------------------------------------------------
+
+int cStageProfiler::addStage(const string& a_name)
+{
+    unique_ptr<cStage> stage(new cStage());
+    stage->m_name = a_name;
+    m_stages.push_back(move(stage));
+    return ((int)m_stages.size() - 1);
+}
+
+//------------------------------------------------------------------------------
+
+double cStageProfiler::getPercentile(int a_stage, double a_percent) const
+{
+    return ((double)getHistogram(a_stage).getPercentile(a_percent) / cCycleClock::getFrequency());
+}
+
+//------------------------------------------------------------------------------
+
+double cStageProfiler::getMax(int a_stage) const
+{
+    return ((double)getHistogram(a_stage).getMax() / cCycleClock::getFrequency());
+}
+
+//------------------------------------------------------------------------------
+
+void cStageProfiler::reset()
+{
+    for (size_t i=0; i<m_stages.size(); i++)
+    {
+        m_stages[i]->m_histogram.reset();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cStageProfiler::writeReport(ostream& a_out) const
+{
+    double scale = 1e6 / cCycleClock::getFrequency();
+
+    a_out << "# " << m_name << endl;
+    a_out << left << setw(28) << "stage" << right
+          << setw(12) << "count"
+          << setw(12) << "mean [us]"
+          << setw(12) << "p50 [us]"
+          << setw(12) << "p90 [us]"
+          << setw(12) << "p99 [us]"
+          << setw(12) << "p99.9 [us]"
+          << setw(12) << "max [us]" << endl;
+    for (size_t i=0; i<m_stages.size(); i++)
+    {
+        const cHdrHistogram& histogram = m_stages[i]->m_histogram;
+        a_out << left << setw(28) << m_stages[i]->m_name << right << fixed << setprecision(2)
+              << setw(12) << histogram.getCount()
+              << setw(12) << scale * histogram.getMean()
+              << setw(12) << scale * histogram.getPercentile(50.0)
+              << setw(12) << scale * histogram.getPercentile(90.0)
+              << setw(12) << scale * histogram.getPercentile(99.0)
+              << setw(12) << scale * histogram.getPercentile(99.9)
+              << setw(12) << scale * histogram.getMax() << endl;
+    }
+
+    a_out << endl << "stage,lower_us,upper_us,count" << endl;
+    a_out << setprecision(4);
+    for (size_t i=0; i<m_stages.size(); i++)
+    {
+        const cHdrHistogram& histogram = m_stages[i]->m_histogram;
+        for (int k=0; k<cHdrHistogram::C_NUM_BUCKETS; k++)
+        {
+            uint64_t count = histogram.getBucketCount(k);
+            if (count > 0)
+            {
+                a_out << m_stages[i]->m_name << "," << scale * cHdrHistogram::getLowerBound(k) << ","
+                      << scale * cHdrHistogram::getUpperBound(k) << "," << count << endl;
+            }
+        }
+    }
+    a_out << endl;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,206 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CStageProfilerH
+#define CStageProfilerH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define C_CYCLE_CLOCK_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Cheapest timestamp of the platform: the time stamp counter on x86 (a few
+// nanoseconds to read, constant rate on any CPU of the last decade), a
+// monotonic clock in nanoseconds elsewhere.
+//------------------------------------------------------------------------------
+class cCycleClock
+{
+public:
+
+    // current count
+    static inline uint64_t now()
+    {
+#if defined(C_CYCLE_CLOCK_TSC)
+        return (__rdtsc());
+#else
+        return (nowFallback());
+#endif
+    }
+
+    // counts per second, measured against the monotonic clock on first use
+    static double getFrequency();
+
+protected:
+
+    static uint64_t nowFallback();
+};
+
+//------------------------------------------------------------------------------
+// Histogram of durations with a fixed relative precision (HDR histogram):
+// values below 64 have a bucket each, larger ones fall into 32 buckets per
+// power of two, so every bucket is at most 1/32 wide relative to its value.
+// All buckets are preallocated.
+//
+// record() is meant for a single writer thread and never blocks; any thread
+// may read the percentiles at the same time and sees a recent, possibly
+// slightly torn, state.
+//------------------------------------------------------------------------------
+class cHdrHistogram
+{
+public:
+
+    // values up to 2^C_MAX_BITS are told apart; larger ones land in the last
+    // bucket
+    static const int C_SUB_BITS = 5;
+    static const int C_MAX_BITS = 40;
+    static const int C_NUM_BUCKETS = (C_MAX_BITS - C_SUB_BITS + 1) << C_SUB_BITS;
+
+    cHdrHistogram();
+
+    // writer thread: add a value
+    inline void record(uint64_t a_value)
+    {
+        int bucket = getBucket(a_value);
+        m_counts[bucket].store(m_counts[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_sum.store(m_sum.load(std::memory_order_relaxed) + a_value, std::memory_order_relaxed);
+        if (a_value > m_max.load(std::memory_order_relaxed))
+        {
+            m_max.store(a_value, std::memory_order_relaxed);
+        }
+    }
+
+    // clear all counts
+    void reset();
+
+    // number of values, their mean and their largest one
+    uint64_t getCount() const { return (m_count.load(std::memory_order_relaxed)); }
+    double getMean() const;
+    uint64_t getMax() const { return (m_max.load(std::memory_order_relaxed)); }
+
+    // a_percent-th percentile, e.g. 99.9: the upper end of the bucket
+    // holding it, but no more than the largest value
+    uint64_t getPercentile(double a_percent) const;
+
+    // bucket a_value falls into, and the values covered by a bucket
+    // [lower, upper)
+    static inline int getBucket(uint64_t a_value)
+    {
+        if (a_value >= ((uint64_t)1 << C_MAX_BITS))
+        {
+            return (C_NUM_BUCKETS - 1);
+        }
+        int msb = 0;
+        for (uint64_t v = a_value >> (C_SUB_BITS + 1); v != 0; v >>= 1)
+        {
+            msb++;
+        }
+        return ((msb << C_SUB_BITS) + (int)(a_value >> msb));
+    }
+    static uint64_t getLowerBound(int a_bucket);
+    static uint64_t getUpperBound(int a_bucket) { return (getLowerBound(a_bucket + 1)); }
+
+    // count of one bucket
+    uint64_t getBucketCount(int a_bucket) const { return (m_counts[a_bucket].load(std::memory_order_relaxed)); }
+
+protected:
+
+    std::unique_ptr<std::atomic<uint64_t>[]> m_counts;
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+//------------------------------------------------------------------------------
+// Time spent in each stage of a loop, one cHdrHistogram per stage, in
+// cCycleClock counts. Stages are added before the loop starts; the loop
+// thread then times them with cScopedStageTimer, and the report functions
+// may be called from any thread.
+//------------------------------------------------------------------------------
+class cStageProfiler
+{
+public:
+
+    cStageProfiler(const std::string& a_name = "") : m_name(a_name) {}
+
+    // name of the loop, shown in reports
+    const std::string& getName() const { return (m_name); }
+
+    // add a stage and return its number
+    int addStage(const std::string& a_name);
+
+    int getNumStages() const { return ((int)m_stages.size()); }
+    const std::string& getStageName(int a_stage) const { return (m_stages[a_stage]->m_name); }
+    const cHdrHistogram& getHistogram(int a_stage) const { return (m_stages[a_stage]->m_histogram); }
+
+    // loop thread: add a duration to a stage [cCycleClock counts]
+    inline void record(int a_stage, uint64_t a_duration) { m_stages[a_stage]->m_histogram.record(a_duration); }
+
+    // percentile and largest duration of a stage [s]
+    double getPercentile(int a_stage, double a_percent) const;
+    double getMax(int a_stage) const;
+
+    // clear all stages
+    void reset();
+
+    // table of count, mean, p50, p90, p99, p99.9 and max per stage [us],
+    // followed by the buckets of every stage as "stage,lower_us,upper_us,count"
+    // lines for plotting
+    void writeReport(std::ostream& a_out) const;
+
+protected:
+
+    struct cStage
+    {
+        std::string m_name;
+        cHdrHistogram m_histogram;
+    };
+
+    std::string m_name;
+    std::vector<std::unique_ptr<cStage> > m_stages;
+};
+
+//------------------------------------------------------------------------------
+// Times the scope it lives in into one stage of a cStageProfiler.
+//------------------------------------------------------------------------------
+class cScopedStageTimer
+{
+public:
+
+    cScopedStageTimer(cStageProfiler& a_profiler, int a_stage) :
+        m_profiler(a_profiler),
+        m_stage(a_stage),
+        m_start(cCycleClock::now()) {}
+
+    ~cScopedStageTimer() { m_profiler.record(m_stage, cCycleClock::now() - m_start); }
+
+private:
+
+    cStageProfiler& m_profiler;
+    int m_stage;
+    uint64_t m_start;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
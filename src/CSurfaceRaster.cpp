@@ -0,0 +1,146 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CSurfaceRaster.h"
+#include "CWorkerPool.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+static void appendMesh(cMesh* a_mesh, vector<cRasterTriangle>& a_triangles)
+{
+    cVector3d pos = a_mesh->getGlobalPos();
+    cMatrix3d rot = a_mesh->getGlobalRot();
+    for (unsigned int i=0; i<a_mesh->getNumTriangles(); i++)
+    {
+        if (!a_mesh->m_triangles->getAllocated(i))
+        {
+            continue;
+        }
+        unsigned int vertices[3];
+        vertices[0] = a_mesh->m_triangles->getVertexIndex0(i);
+        vertices[1] = a_mesh->m_triangles->getVertexIndex1(i);
+        vertices[2] = a_mesh->m_triangles->getVertexIndex2(i);
+
+        cRasterTriangle triangle;
+        for (int k=0; k<3; k++)
+        {
+            cVector3d vertex = pos + rot * a_mesh->m_vertices->getLocalPos(vertices[k]);
+            triangle.m_x[k] = vertex(0);
+            triangle.m_y[k] = vertex(1);
+            triangle.m_z[k] = vertex(2);
+        }
+        a_triangles.push_back(triangle);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cAppendRasterTriangles(const vector<cGenericObject*>& a_objects, vector<cRasterTriangle>& a_triangles)
+{
+    for (size_t i=0; i<a_objects.size(); i++)
+    {
+        cMultiMesh* multiMesh = dynamic_cast<cMultiMesh*>(a_objects[i]);
+        cMesh* mesh = dynamic_cast<cMesh*>(a_objects[i]);
+        if (multiMesh != NULL)
+        {
+            for (unsigned int k=0; k<multiMesh->getNumMeshes(); k++)
+            {
+                appendMesh(multiMesh->getMesh(k), a_triangles);
+            }
+        }
+        else if (mesh != NULL)
+        {
+            appendMesh(mesh, a_triangles);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cGetRasterBounds(const vector<cRasterTriangle>& a_triangles,
+                      double& a_minX, double& a_minY, double& a_maxX, double& a_maxY)
+{
+    a_minX = a_minY = DBL_MAX;
+    a_maxX = a_maxY = -DBL_MAX;
+    for (size_t i=0; i<a_triangles.size(); i++)
+    {
+        for (int k=0; k<3; k++)
+        {
+            a_minX = cMin(a_minX, a_triangles[i].m_x[k]);
+            a_maxX = cMax(a_maxX, a_triangles[i].m_x[k]);
+            a_minY = cMin(a_minY, a_triangles[i].m_y[k]);
+            a_maxY = cMax(a_maxY, a_triangles[i].m_y[k]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cRasterizeSurface(const vector<cRasterTriangle>& a_triangles,
+                       double a_originX, double a_originY, double a_cellSize,
+                       int a_width, int a_height, cWorkerPool& a_pool,
+                       vector<float>& a_surface)
+{
+    // the grid is cut into bands of rows so that threads never write the
+    // same cell
+    a_surface.assign((size_t)a_width * a_height, -FLT_MAX);
+    size_t numBands = 4 * (size_t)a_pool.getNumThreads();
+    int bandRows = (int)((a_height + numBands - 1) / numBands);
+    a_pool.parallelFor(numBands, [&](size_t a_band)
+    {
+        int rowBegin = (int)a_band * bandRows;
+        int rowEnd = min(a_height, rowBegin + bandRows);
+        for (size_t i=0; i<a_triangles.size(); i++)
+        {
+            const cRasterTriangle& t = a_triangles[i];
+            double area = (t.m_x[1] - t.m_x[0]) * (t.m_y[2] - t.m_y[0]) - (t.m_x[2] - t.m_x[0]) * (t.m_y[1] - t.m_y[0]);
+            if (fabs(area) < 1e-18)
+            {
+                // vertical faces are covered by the roofs and the ground
+                continue;
+            }
+
+            double triMinX = cMin(t.m_x[0], cMin(t.m_x[1], t.m_x[2]));
+            double triMaxX = cMax(t.m_x[0], cMax(t.m_x[1], t.m_x[2]));
+            double triMinY = cMin(t.m_y[0], cMin(t.m_y[1], t.m_y[2]));
+            double triMaxY = cMax(t.m_y[0], cMax(t.m_y[1], t.m_y[2]));
+            int x0 = max(0, (int)ceil((triMinX - a_originX) / a_cellSize - 0.5));
+            int x1 = min(a_width - 1, (int)floor((triMaxX - a_originX) / a_cellSize - 0.5));
+            int y0 = max(rowBegin, (int)ceil((triMinY - a_originY) / a_cellSize - 0.5));
+            int y1 = min(rowEnd - 1, (int)floor((triMaxY - a_originY) / a_cellSize - 0.5));
+
+            for (int y=y0; y<=y1; y++)
+            {
+                double py = a_originY + (y + 0.5) * a_cellSize;
+                for (int x=x0; x<=x1; x++)
+                {
+                    double px = a_originX + (x + 0.5) * a_cellSize;
+                    double w0 = ((t.m_x[1] - px) * (t.m_y[2] - py) - (t.m_x[2] - px) * (t.m_y[1] - py)) / area;
+                    double w1 = ((t.m_x[2] - px) * (t.m_y[0] - py) - (t.m_x[0] - px) * (t.m_y[2] - py)) / area;
+                    double w2 = 1.0 - w0 - w1;
+                    if ((w0 < -1e-9) || (w1 < -1e-9) || (w2 < -1e-9))
+                    {
+                        continue;
+                    }
+                    float z = (float)(w0 * t.m_z[0] + w1 * t.m_z[1] + w2 * t.m_z[2]);
+                    float& cell = a_surface[(size_t)y * a_width + x];
+                    cell = max(cell, z);
+                }
+            }
+        }
+    });
+}
+
+//------------------------------------------------------------------------------
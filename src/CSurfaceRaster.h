@@ -0,0 +1,53 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CSurfaceRasterH
+#define CSurfaceRasterH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <vector>
+//------------------------------------------------------------------------------
+class cWorkerPool;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Rasterization of static geometry seen from above, shared by the fields
+// baked from the map (height field, distance field).
+//------------------------------------------------------------------------------
+
+// triangle projected for rasterization, in global coordinates
+struct cRasterTriangle
+{
+    double m_x[3];
+    double m_y[3];
+    double m_z[3];
+};
+
+// append the triangles of a_objects (cMesh or cMultiMesh, global frames up to
+// date) to a_triangles
+void cAppendRasterTriangles(const std::vector<chai3d::cGenericObject*>& a_objects,
+                            std::vector<cRasterTriangle>& a_triangles);
+
+// bounding box of a_triangles in the xy plane
+void cGetRasterBounds(const std::vector<cRasterTriangle>& a_triangles,
+                      double& a_minX, double& a_minY, double& a_maxX, double& a_maxY);
+
+// highest surface over the centre of each cell of an a_width x a_height grid,
+// row by row, -FLT_MAX where there is none. cell (x, y) is centred at
+// origin + ((x + 0.5) * cell, (y + 0.5) * cell). vertical faces are skipped.
+void cRasterizeSurface(const std::vector<cRasterTriangle>& a_triangles,
+                       double a_originX, double a_originY, double a_cellSize,
+                       int a_width, int a_height, cWorkerPool& a_pool,
+                       std::vector<float>& a_surface);
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
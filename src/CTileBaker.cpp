@@ -0,0 +1,572 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CTileBaker.h"
+#include "CWorkerPool.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// VERTEX CLUSTERING
+//------------------------------------------------------------------------------
+
+namespace
+{
+    // grid cell of a vertex, plus a normal bucket for visual meshes so that
+    // flat shaded faces keep their own vertices
+    struct cClusterKey
+    {
+        int32_t m_cell[3];
+        int32_t m_normal;
+
+        bool operator==(const cClusterKey& a_key) const
+        {
+            return ((m_cell[0] == a_key.m_cell[0]) && (m_cell[1] == a_key.m_cell[1]) &&
+                    (m_cell[2] == a_key.m_cell[2]) && (m_normal == a_key.m_normal));
+        }
+
+        bool sameCell(const cClusterKey& a_key) const
+        {
+            return ((m_cell[0] == a_key.m_cell[0]) && (m_cell[1] == a_key.m_cell[1]) &&
+                    (m_cell[2] == a_key.m_cell[2]));
+        }
+    };
+
+    struct cClusterKeyHash
+    {
+        size_t operator()(const cClusterKey& a_key) const
+        {
+            uint64_t hash = 1469598103934665603ULL;
+            for (int i=0; i<3; i++)
+            {
+                hash = (hash ^ (uint32_t)a_key.m_cell[i]) * 1099511628211ULL;
+            }
+            hash = (hash ^ (uint32_t)a_key.m_normal) * 1099511628211ULL;
+            return ((size_t)hash);
+        }
+    };
+
+    //--------------------------------------------------------------------------
+
+    // merges the vertices of a triangle soup that fall into the same cell of
+    // a global grid. with a cell size of 0, only identical vertices merge.
+    class cClusterer
+    {
+    public:
+
+        cClusterer(double a_cell, bool a_splitNormals) :
+            m_cell(a_cell),
+            m_splitNormals(a_splitNormals) {}
+
+        // output vertex of a source vertex
+        uint32_t add(const float* a_pos, const float* a_normal, const uint8_t* a_color)
+        {
+            cClusterKey key;
+            float pos[3];
+            for (int k=0; k<3; k++)
+            {
+                if (m_cell > 0.0)
+                {
+                    key.m_cell[k] = (int32_t)floor(a_pos[k] / m_cell + 0.5);
+                    pos[k] = (float)(key.m_cell[k] * m_cell);
+                }
+                else
+                {
+                    memcpy(&key.m_cell[k], &a_pos[k], sizeof(float));
+                    pos[k] = a_pos[k];
+                }
+            }
+            key.m_normal = 0;
+            if (m_splitNormals)
+            {
+                for (int k=0; k<3; k++)
+                {
+                    key.m_normal = 5 * key.m_normal + (int32_t)floor(2.0f * a_normal[k] + 0.5f) + 2;
+                }
+            }
+
+            pair<unordered_map<cClusterKey, uint32_t, cClusterKeyHash>::iterator, bool> result =
+                m_index.insert(make_pair(key, (uint32_t)m_keys.size()));
+            uint32_t index = result.first->second;
+            if (result.second)
+            {
+                cVertex vertex;
+                memset(&vertex, 0, sizeof(vertex));
+                memcpy(vertex.m_pos, pos, sizeof(pos));
+                m_vertices.push_back(vertex);
+                m_keys.push_back(key);
+            }
+
+            cVertex& vertex = m_vertices[index];
+            for (int k=0; k<3; k++)
+            {
+                vertex.m_normal[k] += a_normal[k];
+            }
+            for (int k=0; k<4; k++)
+            {
+                vertex.m_color[k] += a_color[k];
+            }
+            vertex.m_count++;
+            return (index);
+        }
+
+        // true if two output vertices lie in the same cell
+        bool sameCell(uint32_t a_vertex0, uint32_t a_vertex1) const
+        {
+            return (m_keys[a_vertex0].sameCell(m_keys[a_vertex1]));
+        }
+
+        size_t getNumVertices() const { return (m_vertices.size()); }
+        const float* getPos(uint32_t a_vertex) const { return (m_vertices[a_vertex].m_pos); }
+
+        // averaged attributes of an output vertex
+        void getVertex(uint32_t a_vertex, cTileVertex& a_result) const
+        {
+            const cVertex& vertex = m_vertices[a_vertex];
+            float length = sqrt(vertex.m_normal[0] * vertex.m_normal[0] +
+                                vertex.m_normal[1] * vertex.m_normal[1] +
+                                vertex.m_normal[2] * vertex.m_normal[2]);
+            for (int k=0; k<3; k++)
+            {
+                a_result.m_pos[k] = vertex.m_pos[k];
+                a_result.m_normal[k] = (length > 0.0f) ? vertex.m_normal[k] / length : ((k == 2) ? 1.0f : 0.0f);
+            }
+            for (int k=0; k<4; k++)
+            {
+                a_result.m_color[k] = (uint8_t)((vertex.m_color[k] + vertex.m_count / 2) / vertex.m_count);
+            }
+        }
+
+    private:
+
+        struct cVertex
+        {
+            float m_pos[3];
+            float m_normal[3];
+            uint32_t m_color[4];
+            uint32_t m_count;
+        };
+
+        double m_cell;
+        bool m_splitNormals;
+        unordered_map<cClusterKey, uint32_t, cClusterKeyHash> m_index;
+        vector<cClusterKey> m_keys;
+        vector<cVertex> m_vertices;
+    };
+
+    //--------------------------------------------------------------------------
+
+    // triangle in a clustered mesh, with its corners sorted for duplicate
+    // detection
+    struct cClusteredTriangle
+    {
+        uint32_t m_sorted[3];
+        uint32_t m_vertices[3];
+
+        bool operator<(const cClusteredTriangle& a_triangle) const
+        {
+            for (int k=0; k<3; k++)
+            {
+                if (m_sorted[k] != a_triangle.m_sorted[k])
+                {
+                    return (m_sorted[k] < a_triangle.m_sorted[k]);
+                }
+            }
+            return (false);
+        }
+
+        bool operator==(const cClusteredTriangle& a_triangle) const
+        {
+            return ((m_sorted[0] == a_triangle.m_sorted[0]) && (m_sorted[1] == a_triangle.m_sorted[1]) &&
+                    (m_sorted[2] == a_triangle.m_sorted[2]));
+        }
+    };
+
+    // cluster the triangles a_triangles of a_source (any type with m_pos,
+    // m_normal and m_color) and append the surviving, distinct triangles to
+    // a_indices
+    template <class T>
+    void clusterTriangles(cClusterer& a_clusterer, const T* a_source,
+                          const uint32_t* a_triangles, size_t a_numTriangles,
+                          vector<uint32_t>& a_indices)
+    {
+        vector<cClusteredTriangle> triangles;
+        triangles.reserve(a_numTriangles);
+        for (size_t i=0; i<a_numTriangles; i++)
+        {
+            const T& source = a_source[a_triangles[i]];
+            cClusteredTriangle triangle;
+            for (int k=0; k<3; k++)
+            {
+                triangle.m_vertices[k] = a_clusterer.add(source.m_pos[k], source.m_normal[k], source.m_color);
+            }
+            if (a_clusterer.sameCell(triangle.m_vertices[0], triangle.m_vertices[1]) ||
+                a_clusterer.sameCell(triangle.m_vertices[1], triangle.m_vertices[2]) ||
+                a_clusterer.sameCell(triangle.m_vertices[2], triangle.m_vertices[0]))
+            {
+                continue;
+            }
+            memcpy(triangle.m_sorted, triangle.m_vertices, sizeof(triangle.m_sorted));
+            sort(triangle.m_sorted, triangle.m_sorted + 3);
+            triangles.push_back(triangle);
+        }
+
+        // keep the first of each set of duplicates, in input order
+        stable_sort(triangles.begin(), triangles.end());
+        triangles.erase(unique(triangles.begin(), triangles.end()), triangles.end());
+        a_indices.reserve(3 * triangles.size());
+        for (size_t i=0; i<triangles.size(); i++)
+        {
+            a_indices.insert(a_indices.end(), triangles[i].m_vertices, triangles[i].m_vertices + 3);
+        }
+    }
+
+    //--------------------------------------------------------------------------
+
+    // triangles of a level, sorted by tile
+    struct cTileItem
+    {
+        int32_t m_y;
+        int32_t m_x;
+        uint32_t m_triangle;
+
+        bool operator<(const cTileItem& a_item) const
+        {
+            if (m_y != a_item.m_y) return (m_y < a_item.m_y);
+            if (m_x != a_item.m_x) return (m_x < a_item.m_x);
+            return (m_triangle < a_item.m_triangle);
+        }
+    };
+
+    struct cTileRange
+    {
+        int32_t m_y;
+        int32_t m_x;
+        size_t m_begin;
+        size_t m_end;
+
+        bool operator<(const cTileRange& a_range) const
+        {
+            if (m_y != a_range.m_y) return (m_y < a_range.m_y);
+            return (m_x < a_range.m_x);
+        }
+    };
+}
+
+
+//------------------------------------------------------------------------------
+// BAKER
+//------------------------------------------------------------------------------
+
+cTileBaker::cTileBaker(const cTileBakerSettings& a_settings) :
+    m_settings(a_settings),
+    m_boundaryMin(0.0, 0.0, 0.0),
+    m_boundaryMax(0.0, 0.0, 0.0),
+    m_numTiles(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void cTileBaker::addMultiMesh(cMultiMesh* a_object)
+{
+    for (unsigned int i=0; i<a_object->getNumMeshes(); i++)
+    {
+        cMesh* mesh = a_object->getMesh(i);
+        cVector3d meshPos = mesh->getLocalPos();
+        cMatrix3d meshRot = mesh->getLocalRot();
+
+        const cColorf& diffuse = mesh->m_material->m_diffuse;
+        uint8_t color[4];
+        color[0] = (uint8_t)cClamp(255.0f * diffuse.getR() + 0.5f, 0.0f, 255.0f);
+        color[1] = (uint8_t)cClamp(255.0f * diffuse.getG() + 0.5f, 0.0f, 255.0f);
+        color[2] = (uint8_t)cClamp(255.0f * diffuse.getB() + 0.5f, 0.0f, 255.0f);
+        color[3] = (uint8_t)cClamp(255.0f * diffuse.getA() + 0.5f, 0.0f, 255.0f);
+
+        for (unsigned int k=0; k<mesh->getNumTriangles(); k++)
+        {
+            if (!mesh->m_triangles->getAllocated(k))
+            {
+                continue;
+            }
+
+            cSourceTriangle triangle;
+            unsigned int vertices[3];
+            vertices[0] = mesh->m_triangles->getVertexIndex0(k);
+            vertices[1] = mesh->m_triangles->getVertexIndex1(k);
+            vertices[2] = mesh->m_triangles->getVertexIndex2(k);
+            for (int j=0; j<3; j++)
+            {
+                cVector3d pos = meshPos + meshRot * mesh->m_vertices->getLocalPos(vertices[j]);
+                cVector3d normal = meshRot * mesh->m_vertices->getNormal(vertices[j]);
+                for (int c=0; c<3; c++)
+                {
+                    triangle.m_pos[j][c] = (float)pos(c);
+                    triangle.m_normal[j][c] = (float)normal(c);
+                }
+
+                if (m_triangles.empty() && (j == 0))
+                {
+                    m_boundaryMin = m_boundaryMax = pos;
+                }
+                for (int c=0; c<3; c++)
+                {
+                    m_boundaryMin(c) = cMin(m_boundaryMin(c), pos(c));
+                    m_boundaryMax(c) = cMax(m_boundaryMax(c), pos(c));
+                }
+            }
+            memcpy(triangle.m_color, color, sizeof(color));
+            m_triangles.push_back(triangle);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cTileBaker::addLabel(const string& a_name, const cVector3d& a_pos)
+{
+    cTileLabel label;
+    label.m_name = a_name;
+    label.m_pos = a_pos;
+    m_labels.push_back(label);
+}
+
+//------------------------------------------------------------------------------
+
+size_t cTileBaker::getNumVisualTriangles(unsigned int a_level) const
+{
+    return ((a_level < m_numVisualTriangles.size()) ? m_numVisualTriangles[a_level] : 0);
+}
+
+//------------------------------------------------------------------------------
+
+size_t cTileBaker::getNumHapticTriangles(unsigned int a_level) const
+{
+    return ((a_level < m_numHapticTriangles.size()) ? m_numHapticTriangles[a_level] : 0);
+}
+
+//------------------------------------------------------------------------------
+
+void cTileBaker::getTile(const float* a_pos, unsigned int a_level, int& a_x, int& a_y) const
+{
+    double size = ldexp(m_settings.m_tileSize, (int)a_level);
+    a_x = (int)floor(a_pos[0] / size);
+    a_y = (int)floor(a_pos[1] / size);
+}
+
+//------------------------------------------------------------------------------
+
+bool cTileBaker::bake(const string& a_filename, cWorkerPool& a_pool)
+{
+    m_numTiles = 0;
+    m_numVisualTriangles.assign(m_settings.m_numLevels, 0);
+    m_numHapticTriangles.assign(m_settings.m_numLevels, 0);
+
+    if ((m_settings.m_tileSize <= 0.0) || (m_settings.m_numLevels == 0))
+    {
+        cout << "Error - tile size and number of levels must be positive" << endl;
+        return (false);
+    }
+
+    cTileFileWriter writer;
+    if (!writer.open(a_filename, m_settings.m_numLevels, m_settings.m_tileSize, m_settings.m_toolRadius))
+    {
+        cout << "Error - could not write " << a_filename << endl;
+        return (false);
+    }
+
+    vector<cTileItem> items(m_triangles.size());
+    vector<cTileRange> ranges;
+    vector<cTileData> batch;
+    for (unsigned int level=0; level<m_settings.m_numLevels; level++)
+    {
+        // sort the triangles by the tile of their centroid
+        for (size_t i=0; i<m_triangles.size(); i++)
+        {
+            const cSourceTriangle& triangle = m_triangles[i];
+            float centroid[3];
+            for (int k=0; k<3; k++)
+            {
+                centroid[k] = (triangle.m_pos[0][k] + triangle.m_pos[1][k] + triangle.m_pos[2][k]) / 3.0f;
+            }
+            getTile(centroid, level, items[i].m_x, items[i].m_y);
+            items[i].m_triangle = (uint32_t)i;
+        }
+        sort(items.begin(), items.end());
+
+        ranges.clear();
+        for (size_t i=0; i<items.size(); i++)
+        {
+            if (ranges.empty() || (ranges.back().m_x != items[i].m_x) || (ranges.back().m_y != items[i].m_y))
+            {
+                cTileRange range;
+                range.m_x = items[i].m_x;
+                range.m_y = items[i].m_y;
+                range.m_begin = i;
+                ranges.push_back(range);
+            }
+            ranges.back().m_end = i + 1;
+        }
+
+        // tiles that only hold labels
+        for (size_t i=0; i<m_labels.size(); i++)
+        {
+            float pos[3] = { (float)m_labels[i].m_pos(0), (float)m_labels[i].m_pos(1), (float)m_labels[i].m_pos(2) };
+            cTileRange range;
+            getTile(pos, level, range.m_x, range.m_y);
+            range.m_begin = range.m_end = 0;
+            vector<cTileRange>::iterator it = lower_bound(ranges.begin(), ranges.end(), range);
+            if ((it == ranges.end()) || (range < *it))
+            {
+                ranges.insert(it, range);
+            }
+        }
+
+        // bake the tiles in parallel, a batch at a time, and write them in order
+        size_t batchSize = 4 * (size_t)a_pool.getNumThreads();
+        for (size_t first=0; first<ranges.size(); first+=batchSize)
+        {
+            size_t count = min(batchSize, ranges.size() - first);
+            batch.resize(count);
+            a_pool.parallelFor(count, [&](size_t i)
+            {
+                const cTileRange& range = ranges[first + i];
+                vector<uint32_t> triangles(range.m_end - range.m_begin);
+                for (size_t k=0; k<triangles.size(); k++)
+                {
+                    triangles[k] = items[range.m_begin + k].m_triangle;
+                }
+                bakeTile(level, range.m_x, range.m_y,
+                         triangles.empty() ? NULL : &triangles[0], triangles.size(), batch[i]);
+            });
+
+            for (size_t i=0; i<count; i++)
+            {
+                if (!writer.addTile(batch[i]))
+                {
+                    cout << "Error - could not write " << a_filename << endl;
+                    return (false);
+                }
+                m_numVisualTriangles[level] += batch[i].m_visualTriangles.size() / 3;
+                m_numHapticTriangles[level] += batch[i].m_hapticTriangles.size() / 3;
+                m_numTiles++;
+            }
+        }
+    }
+
+    if (!writer.close(m_boundaryMin, m_boundaryMax))
+    {
+        cout << "Error - could not write " << a_filename << endl;
+        return (false);
+    }
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void cTileBaker::bakeTile(unsigned int a_level, int a_x, int a_y,
+                          const uint32_t* a_triangles, size_t a_numTriangles,
+                          cTileData& a_tile) const
+{
+    a_tile = cTileData();
+    a_tile.m_level = (int)a_level;
+    a_tile.m_x = a_x;
+    a_tile.m_y = a_y;
+    a_tile.m_rootIndex = -1;
+    a_tile.m_maxDepth = 0;
+
+    const cSourceTriangle* source = m_triangles.empty() ? NULL : &m_triangles[0];
+    double visualCell = ldexp(m_settings.m_visualCell, (int)a_level);
+    double hapticCell = ldexp(m_settings.m_hapticCell, (int)a_level);
+
+    // visual mesh: flat shaded faces keep their normals
+    cClusterer visual(visualCell, true);
+    clusterTriangles(visual, source, a_triangles, a_numTriangles, a_tile.m_visualTriangles);
+    a_tile.m_visualVertices.resize(visual.getNumVertices());
+    for (size_t i=0; i<a_tile.m_visualVertices.size(); i++)
+    {
+        visual.getVertex((uint32_t)i, a_tile.m_visualVertices[i]);
+    }
+
+    // haptic proxy: one vertex per cell, so the surface is closed
+    cClusterer haptic(hapticCell, false);
+    clusterTriangles(haptic, source, a_triangles, a_numTriangles, a_tile.m_hapticTriangles);
+    a_tile.m_hapticVertices.resize(3 * haptic.getNumVertices());
+    for (size_t i=0; i<haptic.getNumVertices(); i++)
+    {
+        memcpy(&a_tile.m_hapticVertices[3*i], haptic.getPos((uint32_t)i), 3 * sizeof(float));
+    }
+
+    // edges of the visual mesh, as computed when the map is loaded
+    if (!a_tile.m_visualTriangles.empty())
+    {
+        cMesh* mesh = new cMesh();
+        for (size_t i=0; i<a_tile.m_visualVertices.size(); i++)
+        {
+            const cTileVertex& v = a_tile.m_visualVertices[i];
+            mesh->newVertex(cVector3d(v.m_pos[0], v.m_pos[1], v.m_pos[2]),
+                            cVector3d(v.m_normal[0], v.m_normal[1], v.m_normal[2]));
+        }
+        for (size_t i=0; i<a_tile.m_visualTriangles.size(); i+=3)
+        {
+            mesh->newTriangle(a_tile.m_visualTriangles[i], a_tile.m_visualTriangles[i+1], a_tile.m_visualTriangles[i+2]);
+        }
+        mesh->computeAllEdges(m_settings.m_edgeAngle);
+        a_tile.m_visualEdges.resize(2 * mesh->m_edges.size());
+        for (size_t i=0; i<mesh->m_edges.size(); i++)
+        {
+            a_tile.m_visualEdges[2*i]   = (uint32_t)mesh->m_edges[i].m_vertex0;
+            a_tile.m_visualEdges[2*i+1] = (uint32_t)mesh->m_edges[i].m_vertex1;
+        }
+        delete mesh;
+    }
+
+    // collision tree of the haptic proxy, built from the stored (float)
+    // vertices so that it matches the mesh restored at load time
+    if (!a_tile.m_hapticTriangles.empty())
+    {
+        cMesh* mesh = new cMesh();
+        for (size_t i=0; i<haptic.getNumVertices(); i++)
+        {
+            mesh->newVertex(a_tile.m_hapticVertices[3*i], a_tile.m_hapticVertices[3*i+1], a_tile.m_hapticVertices[3*i+2]);
+        }
+        for (size_t i=0; i<a_tile.m_hapticTriangles.size(); i+=3)
+        {
+            mesh->newTriangle(a_tile.m_hapticTriangles[i], a_tile.m_hapticTriangles[i+1], a_tile.m_hapticTriangles[i+2]);
+        }
+        cPersistentCollisionAABB* detector = cPersistentCollisionAABB::create(mesh, m_settings.m_toolRadius);
+        a_tile.m_nodes.resize(detector->getNumNodeRecords());
+        for (size_t i=0; i<a_tile.m_nodes.size(); i++)
+        {
+            detector->getNodeRecord((int)i, a_tile.m_nodes[i]);
+        }
+        a_tile.m_rootIndex = detector->getRootIndex();
+        a_tile.m_maxDepth = detector->getMaxDepth();
+        delete mesh;
+    }
+
+    // labels anchored in this tile
+    for (size_t i=0; i<m_labels.size(); i++)
+    {
+        float pos[3] = { (float)m_labels[i].m_pos(0), (float)m_labels[i].m_pos(1), (float)m_labels[i].m_pos(2) };
+        int x, y;
+        getTile(pos, a_level, x, y);
+        if ((x == a_x) && (y == a_y))
+        {
+            a_tile.m_labels.push_back(m_labels[i]);
+        }
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CTileBakerH
+#define CTileBakerH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CTileFile.h"
+//------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+class cWorkerPool;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Settings of a baked tile pyramid. Lengths are in world units (local map
+// coordinates).
+//------------------------------------------------------------------------------
+struct cTileBakerSettings
+{
+    cTileBakerSettings() :
+        m_tileSize(0.05),
+        m_numLevels(4),
+        m_visualCell(0.0005),
+        m_hapticCell(0.00025),
+        m_toolRadius(0.005),
+        m_edgeAngle(0.0) {}
+
+    // edge length of the level 0 tiles
+    double m_tileSize;
+
+    // number of levels; each level doubles the tile size
+    unsigned int m_numLevels;
+
+    // vertex clustering grid of the visual and haptic meshes at level 0,
+    // doubled at each level (0 = no decimation)
+    double m_visualCell;
+    double m_hapticCell;
+
+    // radius of the tool the collision trees are built for
+    double m_toolRadius;
+
+    // angle passed to computeAllEdges() for the visual meshes
+    double m_edgeAngle;
+};
+
+//------------------------------------------------------------------------------
+// Cuts map geometry into a tile pyramid and writes it as a cTileFile.
+//
+// Triangles are assigned to the tile containing their centroid. Each tile
+// is decimated by vertex clustering: vertices are snapped to a global grid
+// and triangles that collapse are dropped. Because the grid does not depend
+// on the tile, neighbouring tiles stay watertight. Tiles are baked in
+// parallel and written in a fixed order, so a bake is reproducible.
+//------------------------------------------------------------------------------
+class cTileBaker
+{
+public:
+
+    cTileBaker(const cTileBakerSettings& a_settings = cTileBakerSettings());
+
+    // add the triangles of all meshes of a_object, in local coordinates of
+    // a_object. vertex colors are taken from the mesh materials.
+    void addMultiMesh(chai3d::cMultiMesh* a_object);
+
+    // add a name shown at a_pos
+    void addLabel(const std::string& a_name, const chai3d::cVector3d& a_pos);
+
+    // bake all levels into a_filename
+    bool bake(const std::string& a_filename, cWorkerPool& a_pool);
+
+    // input size
+    size_t getNumTriangles() const { return (m_triangles.size()); }
+    size_t getNumLabels() const { return (m_labels.size()); }
+
+    // output statistics of the last bake
+    size_t getNumTiles() const { return (m_numTiles); }
+    size_t getNumVisualTriangles(unsigned int a_level) const;
+    size_t getNumHapticTriangles(unsigned int a_level) const;
+
+private:
+
+    struct cSourceTriangle
+    {
+        float m_pos[3][3];
+        float m_normal[3][3];
+        uint8_t m_color[4];
+    };
+
+    // tile of a position at a level
+    void getTile(const float* a_pos, unsigned int a_level, int& a_x, int& a_y) const;
+
+    // build tile (a_x, a_y) of a_level from a_triangles
+    void bakeTile(unsigned int a_level, int a_x, int a_y,
+                  const uint32_t* a_triangles, size_t a_numTriangles,
+                  cTileData& a_tile) const;
+
+    cTileBakerSettings m_settings;
+    std::vector<cSourceTriangle> m_triangles;
+    std::vector<cTileLabel> m_labels;
+    chai3d::cVector3d m_boundaryMin;
+    chai3d::cVector3d m_boundaryMax;
+
+    size_t m_numTiles;
+    std::vector<size_t> m_numVisualTriangles;
+    std::vector<size_t> m_numHapticTriangles;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,546 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CTileFile.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// FILE LAYOUT
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const char C_MAGIC[8] = { 'H', 'M', 'A', 'P', 'T', 'I', 'L', 'E' };
+
+    struct cFileHeader
+    {
+        char m_magic[8];
+        uint32_t m_version;
+        uint32_t m_headerSize;
+        uint64_t m_fileSize;
+        uint64_t m_directoryOffset;
+        uint64_t m_numTiles;
+        uint32_t m_numLevels;
+        uint32_t m_entrySize;
+        double m_tileSize;
+        double m_toolRadius;
+        double m_boundaryMin[3];
+        double m_boundaryMax[3];
+    };
+
+    struct cLabelRecord
+    {
+        float m_pos[3];
+        uint32_t m_nameOffset;
+        uint32_t m_nameLength;
+        uint32_t m_reserved;
+    };
+
+    // offsets of the sections of a tile, relative to its start
+    struct cTileSections
+    {
+        size_t m_visualVertices;
+        size_t m_visualTriangles;
+        size_t m_visualEdges;
+        size_t m_hapticVertices;
+        size_t m_hapticTriangles;
+        size_t m_nodes;
+        size_t m_labels;
+        size_t m_names;
+        size_t m_size;
+    };
+
+    // every section starts on an 8 byte boundary
+    inline size_t align8(size_t a_size) { return ((a_size + 7) & ~(size_t)7); }
+
+    void getSections(const cTileEntry& a_entry, cTileSections& a_sections)
+    {
+        size_t offset = 0;
+        a_sections.m_visualVertices = offset;
+        offset += align8((size_t)a_entry.m_numVisualVertices * sizeof(cTileVertex));
+        a_sections.m_visualTriangles = offset;
+        offset += align8((size_t)a_entry.m_numVisualTriangles * 3 * sizeof(uint32_t));
+        a_sections.m_visualEdges = offset;
+        offset += align8((size_t)a_entry.m_numVisualEdges * 2 * sizeof(uint32_t));
+        a_sections.m_hapticVertices = offset;
+        offset += align8((size_t)a_entry.m_numHapticVertices * 3 * sizeof(float));
+        a_sections.m_hapticTriangles = offset;
+        offset += align8((size_t)a_entry.m_numHapticTriangles * 3 * sizeof(uint32_t));
+        a_sections.m_nodes = offset;
+        offset += align8((size_t)a_entry.m_numNodes * sizeof(cAABBNodeRecord));
+        a_sections.m_labels = offset;
+        offset += align8((size_t)a_entry.m_numLabels * sizeof(cLabelRecord));
+        a_sections.m_names = offset;
+        offset += align8(a_entry.m_namesSize);
+        a_sections.m_size = offset;
+    }
+
+    // directory order: level, then y, then x
+    bool entryLess(const cTileEntry& a_entry0, const cTileEntry& a_entry1)
+    {
+        if (a_entry0.m_level != a_entry1.m_level) return (a_entry0.m_level < a_entry1.m_level);
+        if (a_entry0.m_y != a_entry1.m_y) return (a_entry0.m_y < a_entry1.m_y);
+        return (a_entry0.m_x < a_entry1.m_x);
+    }
+
+    bool indicesValid(const uint32_t* a_indices, size_t a_count, uint32_t a_limit)
+    {
+        for (size_t i=0; i<a_count; i++)
+        {
+            if (a_indices[i] >= a_limit)
+            {
+                return (false);
+            }
+        }
+        return (true);
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// READER
+//------------------------------------------------------------------------------
+
+cTileFile::cTileFile() :
+    m_directory(NULL),
+    m_numTiles(0),
+    m_numLevels(0),
+    m_tileSize(0.0),
+    m_toolRadius(0.0),
+    m_boundaryMin(0.0, 0.0, 0.0),
+    m_boundaryMax(0.0, 0.0, 0.0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+bool cTileFile::open(const string& a_filename)
+{
+    close();
+    if (!m_file.open(a_filename))
+    {
+        return (false);
+    }
+
+    const unsigned char* data = m_file.data();
+    size_t size = m_file.size();
+    const cFileHeader* header = (const cFileHeader*)data;
+    if ((size < sizeof(cFileHeader)) ||
+        (memcmp(header->m_magic, C_MAGIC, sizeof(C_MAGIC)) != 0) ||
+        (header->m_version != C_VERSION) ||
+        (header->m_headerSize != sizeof(cFileHeader)) ||
+        (header->m_entrySize != sizeof(cTileEntry)) ||
+        (header->m_fileSize != size) ||
+        (header->m_numLevels == 0) || (header->m_numLevels > 30) ||
+        (header->m_tileSize <= 0.0) ||
+        (header->m_directoryOffset % 8 != 0) ||
+        (header->m_directoryOffset > size) ||
+        (header->m_numTiles > (size - header->m_directoryOffset) / sizeof(cTileEntry)))
+    {
+        m_file.close();
+        return (false);
+    }
+
+    // every tile must lie between the header and the directory, and the
+    // directory must be sorted for findTile()
+    const cTileEntry* directory = (const cTileEntry*)(data + header->m_directoryOffset);
+    for (uint64_t i=0; i<header->m_numTiles; i++)
+    {
+        const cTileEntry& entry = directory[i];
+        cTileSections sections;
+        getSections(entry, sections);
+        if ((entry.m_level < 0) || (entry.m_level >= (int)header->m_numLevels) ||
+            (entry.m_size != sections.m_size) ||
+            (entry.m_offset % 8 != 0) ||
+            (entry.m_offset < sizeof(cFileHeader)) ||
+            (entry.m_offset > header->m_directoryOffset) ||
+            (entry.m_size > header->m_directoryOffset - entry.m_offset) ||
+            ((i > 0) && !entryLess(directory[i-1], entry)))
+        {
+            m_file.close();
+            return (false);
+        }
+    }
+
+    m_directory = directory;
+    m_numTiles = (size_t)header->m_numTiles;
+    m_numLevels = header->m_numLevels;
+    m_tileSize = header->m_tileSize;
+    m_toolRadius = header->m_toolRadius;
+    m_boundaryMin.set(header->m_boundaryMin[0], header->m_boundaryMin[1], header->m_boundaryMin[2]);
+    m_boundaryMax.set(header->m_boundaryMax[0], header->m_boundaryMax[1], header->m_boundaryMax[2]);
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void cTileFile::close()
+{
+    m_file.close();
+    m_directory = NULL;
+    m_numTiles = 0;
+    m_numLevels = 0;
+}
+
+//------------------------------------------------------------------------------
+
+double cTileFile::getTileSize(unsigned int a_level) const
+{
+    return (ldexp(m_tileSize, (int)a_level));
+}
+
+//------------------------------------------------------------------------------
+
+void cTileFile::getTileRange(unsigned int a_level, int& a_minX, int& a_minY, int& a_maxX, int& a_maxY) const
+{
+    a_minX = a_minY = a_maxX = a_maxY = 0;
+    bool first = true;
+    for (size_t i=0; i<m_numTiles; i++)
+    {
+        const cTileEntry& entry = m_directory[i];
+        if (entry.m_level != (int)a_level)
+        {
+            continue;
+        }
+        if (first || (entry.m_x < a_minX)) a_minX = entry.m_x;
+        if (first || (entry.m_x > a_maxX)) a_maxX = entry.m_x;
+        if (first || (entry.m_y < a_minY)) a_minY = entry.m_y;
+        if (first || (entry.m_y > a_maxY)) a_maxY = entry.m_y;
+        first = false;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+const cTileEntry* cTileFile::findTile(unsigned int a_level, int a_x, int a_y) const
+{
+    cTileEntry key;
+    memset(&key, 0, sizeof(key));
+    key.m_level = (int32_t)a_level;
+    key.m_x = a_x;
+    key.m_y = a_y;
+
+    const cTileEntry* end = m_directory + m_numTiles;
+    const cTileEntry* entry = lower_bound(m_directory, end, key, entryLess);
+    if ((entry == end) || entryLess(key, *entry))
+    {
+        return (NULL);
+    }
+    return (entry);
+}
+
+//------------------------------------------------------------------------------
+
+cMultiMesh* cTileFile::createTile(const cTileEntry& a_entry, double a_toolRadius) const
+{
+    cTileSections sections;
+    getSections(a_entry, sections);
+    const unsigned char* data = m_file.data() + a_entry.m_offset;
+
+    const cTileVertex* visualVertices = (const cTileVertex*)(data + sections.m_visualVertices);
+    const uint32_t* visualTriangles = (const uint32_t*)(data + sections.m_visualTriangles);
+    const uint32_t* visualEdges = (const uint32_t*)(data + sections.m_visualEdges);
+    const float* hapticVertices = (const float*)(data + sections.m_hapticVertices);
+    const uint32_t* hapticTriangles = (const uint32_t*)(data + sections.m_hapticTriangles);
+    const cAABBNodeRecord* nodes = (const cAABBNodeRecord*)(data + sections.m_nodes);
+
+    // validate the indices before touching any mesh
+    bool valid =
+        indicesValid(visualTriangles, 3 * (size_t)a_entry.m_numVisualTriangles, a_entry.m_numVisualVertices) &&
+        indicesValid(visualEdges, 2 * (size_t)a_entry.m_numVisualEdges, a_entry.m_numVisualVertices) &&
+        indicesValid(hapticTriangles, 3 * (size_t)a_entry.m_numHapticTriangles, a_entry.m_numHapticVertices) &&
+        (a_entry.m_rootIndex >= -1) && (a_entry.m_rootIndex < (int32_t)a_entry.m_numNodes);
+
+    // leaves refer to a triangle instead of a subtree
+    for (uint32_t i=0; valid && (i<a_entry.m_numNodes); i++)
+    {
+        const cAABBNodeRecord& node = nodes[i];
+        if (node.m_nodeType == (int32_t)C_AABB_NODE_LEAF)
+        {
+            valid = (node.m_leftSubTree >= -1) && (node.m_leftSubTree < (int32_t)a_entry.m_numHapticTriangles);
+        }
+        else
+        {
+            valid = ((node.m_nodeType == (int32_t)C_AABB_NODE_INTERNAL) ||
+                     (node.m_nodeType == (int32_t)C_AABB_NOT_DEFINED)) &&
+                    (node.m_leftSubTree >= -1) && (node.m_leftSubTree < (int32_t)a_entry.m_numNodes) &&
+                    (node.m_rightSubTree >= -1) && (node.m_rightSubTree < (int32_t)a_entry.m_numNodes);
+        }
+    }
+    if (!valid)
+    {
+        cout << "Error - corrupt tile " << a_entry.m_x << ", " << a_entry.m_y
+             << " (level " << a_entry.m_level << ")" << endl;
+        return (NULL);
+    }
+
+    cMultiMesh* tile = new cMultiMesh();
+
+    // visual mesh
+    cMesh* visual = tile->newMesh();
+    visual->m_name = "visual";
+    for (uint32_t i=0; i<a_entry.m_numVisualVertices; i++)
+    {
+        const cTileVertex& v = visualVertices[i];
+        visual->newVertex(cVector3d(v.m_pos[0], v.m_pos[1], v.m_pos[2]),
+                          cVector3d(v.m_normal[0], v.m_normal[1], v.m_normal[2]),
+                          cVector3d(0.0, 0.0, 0.0),
+                          cColorf(v.m_color[0] / 255.0f, v.m_color[1] / 255.0f,
+                                  v.m_color[2] / 255.0f, v.m_color[3] / 255.0f));
+    }
+    for (uint32_t i=0; i<a_entry.m_numVisualTriangles; i++)
+    {
+        visual->newTriangle(visualTriangles[3*i], visualTriangles[3*i+1], visualTriangles[3*i+2]);
+    }
+    visual->m_edges.reserve(a_entry.m_numVisualEdges);
+    for (uint32_t i=0; i<a_entry.m_numVisualEdges; i++)
+    {
+        visual->m_edges.push_back(cEdge(visual, (int)visualEdges[2*i], (int)visualEdges[2*i+1]));
+    }
+    visual->setUseVertexColors(true);
+    visual->setHapticEnabled(false);
+
+    // haptic proxy mesh
+    cMesh* haptic = tile->newMesh();
+    haptic->m_name = "haptic";
+    for (uint32_t i=0; i<a_entry.m_numHapticVertices; i++)
+    {
+        haptic->newVertex(hapticVertices[3*i], hapticVertices[3*i+1], hapticVertices[3*i+2]);
+    }
+    for (uint32_t i=0; i<a_entry.m_numHapticTriangles; i++)
+    {
+        haptic->newTriangle(hapticTriangles[3*i], hapticTriangles[3*i+1], hapticTriangles[3*i+2]);
+    }
+    if ((a_toolRadius == m_toolRadius) && (a_entry.m_numNodes > 0))
+    {
+        cPersistentCollisionAABB* detector = new cPersistentCollisionAABB();
+        detector->restore(haptic->m_triangles, a_toolRadius, a_entry.m_rootIndex,
+                          a_entry.m_maxDepth, nodes, (int)a_entry.m_numNodes);
+        haptic->setCollisionDetector(detector);
+    }
+    else
+    {
+        cPersistentCollisionAABB::create(haptic, a_toolRadius);
+    }
+    haptic->setShowEnabled(false);
+
+    return (tile);
+}
+
+//------------------------------------------------------------------------------
+
+void cTileFile::getLabels(const cTileEntry& a_entry, vector<cTileLabel>& a_labels) const
+{
+    cTileSections sections;
+    getSections(a_entry, sections);
+    const unsigned char* data = m_file.data() + a_entry.m_offset;
+    const cLabelRecord* records = (const cLabelRecord*)(data + sections.m_labels);
+    const char* names = (const char*)(data + sections.m_names);
+
+    for (uint32_t i=0; i<a_entry.m_numLabels; i++)
+    {
+        const cLabelRecord& record = records[i];
+        if ((record.m_nameOffset > a_entry.m_namesSize) ||
+            (record.m_nameLength > a_entry.m_namesSize - record.m_nameOffset))
+        {
+            continue;
+        }
+        cTileLabel label;
+        label.m_name.assign(names + record.m_nameOffset, record.m_nameLength);
+        label.m_pos.set(record.m_pos[0], record.m_pos[1], record.m_pos[2]);
+        a_labels.push_back(label);
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// WRITER
+//------------------------------------------------------------------------------
+
+cTileFileWriter::cTileFileWriter() :
+    m_offset(0),
+    m_numLevels(0),
+    m_tileSize(0.0),
+    m_toolRadius(0.0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+cTileFileWriter::~cTileFileWriter()
+{
+    // abandoned before close()
+    if (m_out.is_open())
+    {
+        m_out.close();
+        remove(m_tempFilename.c_str());
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool cTileFileWriter::open(const string& a_filename, unsigned int a_numLevels,
+                           double a_tileSize, double a_toolRadius)
+{
+    m_filename = a_filename;
+    m_tempFilename = a_filename + ".tmp";
+    m_numLevels = a_numLevels;
+    m_tileSize = a_tileSize;
+    m_toolRadius = a_toolRadius;
+    m_directory.clear();
+    m_offset = 0;
+
+    m_out.open(m_tempFilename.c_str(), ios::binary | ios::trunc);
+    if (!m_out)
+    {
+        return (false);
+    }
+
+    // the header is written again by close()
+    cFileHeader header;
+    memset(&header, 0, sizeof(header));
+    writePadded(&header, sizeof(header));
+    return (bool)m_out;
+}
+
+//------------------------------------------------------------------------------
+
+void cTileFileWriter::writePadded(const void* a_data, size_t a_bytes)
+{
+    static const char zeros[8] = { 0 };
+    if (a_bytes > 0)
+    {
+        m_out.write((const char*)a_data, a_bytes);
+    }
+    m_out.write(zeros, align8(a_bytes) - a_bytes);
+    m_offset += align8(a_bytes);
+}
+
+//------------------------------------------------------------------------------
+
+bool cTileFileWriter::addTile(const cTileData& a_tile)
+{
+    cTileEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.m_level = a_tile.m_level;
+    entry.m_x = a_tile.m_x;
+    entry.m_y = a_tile.m_y;
+    entry.m_offset = m_offset;
+    entry.m_numVisualVertices = (uint32_t)a_tile.m_visualVertices.size();
+    entry.m_numVisualTriangles = (uint32_t)(a_tile.m_visualTriangles.size() / 3);
+    entry.m_numVisualEdges = (uint32_t)(a_tile.m_visualEdges.size() / 2);
+    entry.m_numHapticVertices = (uint32_t)(a_tile.m_hapticVertices.size() / 3);
+    entry.m_numHapticTriangles = (uint32_t)(a_tile.m_hapticTriangles.size() / 3);
+    entry.m_numNodes = (uint32_t)a_tile.m_nodes.size();
+    entry.m_rootIndex = a_tile.m_rootIndex;
+    entry.m_maxDepth = a_tile.m_maxDepth;
+    entry.m_numLabels = (uint32_t)a_tile.m_labels.size();
+
+    // labels and their names
+    vector<cLabelRecord> labels(a_tile.m_labels.size());
+    string names;
+    for (size_t i=0; i<labels.size(); i++)
+    {
+        const cTileLabel& label = a_tile.m_labels[i];
+        memset(&labels[i], 0, sizeof(cLabelRecord));
+        for (int k=0; k<3; k++)
+        {
+            labels[i].m_pos[k] = (float)label.m_pos(k);
+        }
+        labels[i].m_nameOffset = (uint32_t)names.size();
+        labels[i].m_nameLength = (uint32_t)label.m_name.size();
+        names += label.m_name;
+    }
+    entry.m_namesSize = (uint32_t)names.size();
+
+    // bounds of both meshes
+    for (int k=0; k<3; k++)
+    {
+        entry.m_boundaryMin[k] = HUGE_VALF;
+        entry.m_boundaryMax[k] = -HUGE_VALF;
+    }
+    for (size_t i=0; i<a_tile.m_visualVertices.size(); i++)
+    {
+        for (int k=0; k<3; k++)
+        {
+            entry.m_boundaryMin[k] = min(entry.m_boundaryMin[k], a_tile.m_visualVertices[i].m_pos[k]);
+            entry.m_boundaryMax[k] = max(entry.m_boundaryMax[k], a_tile.m_visualVertices[i].m_pos[k]);
+        }
+    }
+    for (size_t i=0; i<a_tile.m_hapticVertices.size(); i++)
+    {
+        int k = (int)(i % 3);
+        entry.m_boundaryMin[k] = min(entry.m_boundaryMin[k], a_tile.m_hapticVertices[i]);
+        entry.m_boundaryMax[k] = max(entry.m_boundaryMax[k], a_tile.m_hapticVertices[i]);
+    }
+
+    writePadded(a_tile.m_visualVertices.empty() ? NULL : &a_tile.m_visualVertices[0],
+                a_tile.m_visualVertices.size() * sizeof(cTileVertex));
+    writePadded(a_tile.m_visualTriangles.empty() ? NULL : &a_tile.m_visualTriangles[0],
+                a_tile.m_visualTriangles.size() * sizeof(uint32_t));
+    writePadded(a_tile.m_visualEdges.empty() ? NULL : &a_tile.m_visualEdges[0],
+                a_tile.m_visualEdges.size() * sizeof(uint32_t));
+    writePadded(a_tile.m_hapticVertices.empty() ? NULL : &a_tile.m_hapticVertices[0],
+                a_tile.m_hapticVertices.size() * sizeof(float));
+    writePadded(a_tile.m_hapticTriangles.empty() ? NULL : &a_tile.m_hapticTriangles[0],
+                a_tile.m_hapticTriangles.size() * sizeof(uint32_t));
+    writePadded(a_tile.m_nodes.empty() ? NULL : &a_tile.m_nodes[0],
+                a_tile.m_nodes.size() * sizeof(cAABBNodeRecord));
+    writePadded(labels.empty() ? NULL : &labels[0], labels.size() * sizeof(cLabelRecord));
+    writePadded(names.data(), names.size());
+
+    entry.m_size = m_offset - entry.m_offset;
+    m_directory.push_back(entry);
+    return (bool)m_out;
+}
+
+//------------------------------------------------------------------------------
+
+bool cTileFileWriter::close(const cVector3d& a_boundaryMin, const cVector3d& a_boundaryMax)
+{
+    sort(m_directory.begin(), m_directory.end(), entryLess);
+
+    cFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, C_MAGIC, sizeof(C_MAGIC));
+    header.m_version = cTileFile::C_VERSION;
+    header.m_headerSize = sizeof(cFileHeader);
+    header.m_directoryOffset = m_offset;
+    header.m_numTiles = m_directory.size();
+    header.m_numLevels = m_numLevels;
+    header.m_entrySize = sizeof(cTileEntry);
+    header.m_tileSize = m_tileSize;
+    header.m_toolRadius = m_toolRadius;
+    for (int k=0; k<3; k++)
+    {
+        header.m_boundaryMin[k] = a_boundaryMin(k);
+        header.m_boundaryMax[k] = a_boundaryMax(k);
+    }
+
+    writePadded(m_directory.empty() ? NULL : &m_directory[0], m_directory.size() * sizeof(cTileEntry));
+    header.m_fileSize = m_offset;
+    m_out.seekp(0);
+    m_out.write((const char*)&header, sizeof(header));
+    m_out.close();
+
+    if (!m_out || (rename(m_tempFilename.c_str(), m_filename.c_str()) != 0))
+    {
+        remove(m_tempFilename.c_str());
+        return (false);
+    }
+    return (true);
+}
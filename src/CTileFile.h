@@ -0,0 +1,196 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CTileFileH
+#define CTileFileH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CMappedFile.h"
+#include "CPersistentCollisionAABB.h"
+#include "CTileSource.h"
+//------------------------------------------------------------------------------
+#include <fstream>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Vertex of a visual tile mesh as stored in the file.
+//------------------------------------------------------------------------------
+struct cTileVertex
+{
+    float m_pos[3];
+    float m_normal[3];
+    uint8_t m_color[4];
+};
+
+//------------------------------------------------------------------------------
+// One baked tile in memory, as produced by cTileBaker.
+//------------------------------------------------------------------------------
+struct cTileData
+{
+    int m_level;
+    int m_x;
+    int m_y;
+
+    // decimated mesh that is displayed (vertex colors, edges for display)
+    std::vector<cTileVertex> m_visualVertices;
+    std::vector<uint32_t> m_visualTriangles;
+    std::vector<uint32_t> m_visualEdges;
+
+    // mesh the tool collides with (x, y, z per vertex) and its AABB tree
+    std::vector<float> m_hapticVertices;
+    std::vector<uint32_t> m_hapticTriangles;
+    std::vector<cAABBNodeRecord> m_nodes;
+    int m_rootIndex;
+    int m_maxDepth;
+
+    // names anchored in this tile
+    std::vector<cTileLabel> m_labels;
+};
+
+//------------------------------------------------------------------------------
+// Directory entry of a tile in a tile file.
+//------------------------------------------------------------------------------
+struct cTileEntry
+{
+    int32_t m_level;
+    int32_t m_x;
+    int32_t m_y;
+    uint32_t m_numLabels;
+    uint64_t m_offset;
+    uint64_t m_size;
+    uint32_t m_numVisualVertices;
+    uint32_t m_numVisualTriangles;
+    uint32_t m_numVisualEdges;
+    uint32_t m_numHapticVertices;
+    uint32_t m_numHapticTriangles;
+    uint32_t m_numNodes;
+    int32_t m_rootIndex;
+    int32_t m_maxDepth;
+    uint32_t m_namesSize;
+    uint32_t m_reserved;
+    float m_boundaryMin[3];
+    float m_boundaryMax[3];
+};
+
+//------------------------------------------------------------------------------
+// Pyramid of prebaked map tiles (.hmtiles), written by hapmap_bake.
+//
+// Level 0 holds tiles of getTileSize(0); every level above doubles the tile
+// size and the decimation grid. A tile holds a visual mesh, a haptic proxy
+// mesh with its AABB tree (built for getToolRadius()) and label anchors.
+//
+// The file is mapped into memory: a header, the tile data (every section
+// 8 byte aligned) and a directory sorted by level, y and x, so a tile is
+// found by binary search and copied straight into CHAI3D meshes. Like the
+// mesh cache, the format uses native byte order.
+//------------------------------------------------------------------------------
+class cTileFile
+{
+public:
+
+    // current format version; bump when the layout changes
+    static const unsigned int C_VERSION = 1;
+
+    cTileFile();
+
+    // map a tile file. returns false if it is missing or not a valid file of
+    // this version.
+    bool open(const std::string& a_filename);
+
+    // unmap the file
+    void close();
+
+    // pyramid layout
+    unsigned int getNumLevels() const { return (m_numLevels); }
+    size_t getNumTiles() const { return (m_numTiles); }
+    double getTileSize(unsigned int a_level = 0) const;
+    double getToolRadius() const { return (m_toolRadius); }
+    const chai3d::cVector3d& getBoundaryMin() const { return (m_boundaryMin); }
+    const chai3d::cVector3d& getBoundaryMax() const { return (m_boundaryMax); }
+
+    // tiles of a level that hold geometry (inclusive)
+    void getTileRange(unsigned int a_level, int& a_minX, int& a_minY, int& a_maxX, int& a_maxY) const;
+
+    // directory entry of a tile, or NULL if the tile is empty
+    const cTileEntry* findTile(unsigned int a_level, int a_x, int a_y) const;
+    const cTileEntry* getTile(size_t a_index) const { return (m_directory + a_index); }
+
+    // create the meshes of a tile: a visual mesh (haptics disabled) and a
+    // hidden haptic mesh with edges and collision tree. the stored tree is
+    // used if it was built for a_toolRadius. returns NULL if the tile data
+    // is corrupt.
+    chai3d::cMultiMesh* createTile(const cTileEntry& a_entry, double a_toolRadius) const;
+
+    // label anchors of a tile
+    void getLabels(const cTileEntry& a_entry, std::vector<cTileLabel>& a_labels) const;
+
+private:
+
+    cTileFile(const cTileFile&);
+    cTileFile& operator=(const cTileFile&);
+
+    cMappedFile m_file;
+    const cTileEntry* m_directory;
+    size_t m_numTiles;
+    unsigned int m_numLevels;
+    double m_tileSize;
+    double m_toolRadius;
+    chai3d::cVector3d m_boundaryMin;
+    chai3d::cVector3d m_boundaryMax;
+};
+
+//------------------------------------------------------------------------------
+// Writes a tile file. Tiles can be added in any order; the directory is
+// sorted and written by close(). The file is written under a temporary name
+// and renamed when complete, so a reader never sees a partial pyramid.
+//------------------------------------------------------------------------------
+class cTileFileWriter
+{
+public:
+
+    cTileFileWriter();
+    ~cTileFileWriter();
+
+    // start a file for tiles of size a_tileSize at level 0 and collision
+    // trees built for a_toolRadius
+    bool open(const std::string& a_filename, unsigned int a_numLevels,
+              double a_tileSize, double a_toolRadius);
+
+    // append a tile
+    bool addTile(const cTileData& a_tile);
+
+    // write the directory and the header and move the file in place
+    bool close(const chai3d::cVector3d& a_boundaryMin, const chai3d::cVector3d& a_boundaryMax);
+
+    // size of the data written so far [bytes]
+    uint64_t getSize() const { return (m_offset); }
+
+private:
+
+    cTileFileWriter(const cTileFileWriter&);
+    cTileFileWriter& operator=(const cTileFileWriter&);
+
+    void writePadded(const void* a_data, size_t a_bytes);
+
+    std::ofstream m_out;
+    std::string m_filename;
+    std::string m_tempFilename;
+    std::vector<cTileEntry> m_directory;
+    uint64_t m_offset;
+    unsigned int m_numLevels;
+    double m_tileSize;
+    double m_toolRadius;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,375 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CTileManager.h"
+#include "CPersistentCollisionAABB.h"
+//------------------------------------------------------------------------------
+#include <chrono>
+#include <cmath>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+cTileManager::cTileManager(cGenericObject* a_map, cTileSource* a_source,
+                           const cTileManagerSettings& a_settings) :
+    m_map(a_map),
+    m_source(a_source),
+    m_settings(a_settings),
+    m_center(0),
+    m_running(false),
+    m_numResident(0),
+    m_numLoaded(0),
+    m_numEvicted(0),
+    m_maxLoadTime(0.0)
+{
+    m_source->getTileRange(m_minX, m_minY, m_maxX, m_maxY);
+
+    // global frame of the map, from its chain of local transforms (global
+    // positions may not have been computed yet)
+    cTransform transform = m_map->getLocalTransform();
+    for (cGenericObject* parent = m_map->getParent(); parent != NULL; parent = parent->getParent())
+    {
+        transform = parent->getLocalTransform() * transform;
+    }
+    m_mapPos = transform.getLocalPos();
+    m_mapRot = transform.getLocalRot();
+
+    // enough slots for the prefetch square, the eviction ring around it and
+    // a few tiles held in contact
+    int side = 2 * (m_settings.m_prefetchRadius + 1) + 1;
+    size_t numSlots = (size_t)(side * side + side);
+
+    cSlot slot;
+    slot.m_used = false;
+    slot.m_x = slot.m_y = 0;
+    slot.m_tile = NULL;
+    slot.m_fade = 1.0;
+    m_slots.assign(numSlots, slot);
+
+    m_ready.reserve(numSlots);
+    m_evicted.setCapacity(2 * numSlots);
+    m_garbage.setCapacity(2 * numSlots);
+    m_incoming.reserve(numSlots);
+}
+
+//------------------------------------------------------------------------------
+
+cTileManager::~cTileManager()
+{
+    stop();
+
+    // attached tiles belong to the map; the others are deleted here
+    for (size_t i=0; i<m_ready.size(); i++) delete m_ready[i].m_tile;
+    for (size_t i=0; i<m_incoming.size(); i++) delete m_incoming[i].m_tile;
+    collectGarbage();
+}
+
+//------------------------------------------------------------------------------
+
+void cTileManager::getTile(const cVector3d& a_globalPos, int& a_x, int& a_y) const
+{
+    cVector3d local = m_mapRot.trans() * (a_globalPos - m_mapPos);
+    double size = m_source->getTileSize();
+    a_x = (int)floor(local(0) / size);
+    a_y = (int)floor(local(1) / size);
+}
+
+//------------------------------------------------------------------------------
+
+cMultiMesh* cTileManager::loadTile(int a_x, int a_y)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    cMultiMesh* tile = m_source->loadTile(a_x, a_y);
+    if (tile == NULL)
+    {
+        return (NULL);
+    }
+
+    // same preparation as a map loaded in one piece (see cCreateCampusScene),
+    // unless the tiles were baked with it
+    if (!m_source->isPreprocessed())
+    {
+        tile->computeAllEdges(0);
+        for (unsigned int i=0; i<tile->getNumMeshes(); i++)
+        {
+            cPersistentCollisionAABB::create(tile->getMesh(i), m_settings.m_toolRadius);
+        }
+    }
+    tile->setUseCulling(false);
+    tile->computeBoundaryBox(true);
+    tile->setShowBoundaryBox(false);
+
+    cColorf colorEdges;
+    colorEdges.setBlack();
+    tile->setEdgeProperties(1, colorEdges);
+    cColorf colorNormals;
+    colorNormals.setOrangeTomato();
+    tile->setNormalsProperties(0.01, colorNormals);
+
+    tile->setShowTriangles(m_settings.m_showTriangles);
+    tile->setShowEdges(m_settings.m_showEdges);
+    tile->setShowNormals(m_settings.m_showNormals);
+
+    // starts soft, see update()
+    tile->setStiffness(0.0);
+
+    // the map does not move, so the global frames can be set up here
+    tile->computeGlobalPositions(true, m_mapPos, m_mapRot);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (seconds > m_maxLoadTime)
+    {
+        m_maxLoadTime = seconds;
+    }
+    m_numLoaded++;
+    return (tile);
+}
+
+//------------------------------------------------------------------------------
+
+bool cTileManager::findMissingTile(int64_t a_center, int& a_x, int& a_y) const
+{
+    int cx = keyX(a_center);
+    int cy = keyY(a_center);
+    for (int r=0; r<=m_settings.m_prefetchRadius; r++)
+    {
+        for (int x=cx-r; x<=cx+r; x++)
+        {
+            for (int y=cy-r; y<=cy+r; y++)
+            {
+                // ring r only
+                if ((abs(x - cx) != r) && (abs(y - cy) != r))
+                {
+                    continue;
+                }
+                if ((x < m_minX) || (x > m_maxX) || (y < m_minY) || (y > m_maxY))
+                {
+                    continue;
+                }
+                int64_t key = packKey(x, y);
+                if ((m_known.count(key) == 0) && (m_empty.count(key) == 0))
+                {
+                    a_x = x;
+                    a_y = y;
+                    return (true);
+                }
+            }
+        }
+    }
+    return (false);
+}
+
+//------------------------------------------------------------------------------
+
+void cTileManager::preload(const cVector3d& a_globalPos)
+{
+    int cx, cy;
+    getTile(a_globalPos, cx, cy);
+    m_center = packKey(cx, cy);
+
+    lock_guard<mutex> lock(m_sceneMutex);
+    size_t next = 0;
+    int x, y;
+    while ((next < m_slots.size()) && findMissingTile(m_center, x, y))
+    {
+        cMultiMesh* tile = loadTile(x, y);
+        if (tile == NULL)
+        {
+            m_empty.insert(packKey(x, y));
+            continue;
+        }
+        m_known.insert(packKey(x, y));
+
+        cSlot& slot = m_slots[next++];
+        slot.m_used = true;
+        slot.m_x = x;
+        slot.m_y = y;
+        slot.m_tile = tile;
+        slot.m_fade = 1.0;
+        tile->setStiffness(m_settings.m_stiffness);
+        m_map->addChild(tile);
+        m_numResident++;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cTileManager::start()
+{
+    if (m_running)
+    {
+        return;
+    }
+    m_running = true;
+    m_thread = thread(&cTileManager::run, this);
+}
+
+//------------------------------------------------------------------------------
+
+void cTileManager::stop()
+{
+    if (!m_running)
+    {
+        return;
+    }
+    m_running = false;
+    m_thread.join();
+}
+
+//------------------------------------------------------------------------------
+
+void cTileManager::run()
+{
+    while (m_running)
+    {
+        // forget tiles the haptic thread has evicted
+        int64_t key;
+        while (m_evicted.pop(key))
+        {
+            m_known.erase(key);
+        }
+
+        // load the nearest missing tile, unless all slots are spoken for
+        int x, y;
+        if ((m_known.size() >= m_slots.size()) || !findMissingTile(m_center, x, y))
+        {
+            this_thread::sleep_for(chrono::milliseconds(5));
+            continue;
+        }
+
+        cMultiMesh* tile = loadTile(x, y);
+        if (tile == NULL)
+        {
+            m_empty.insert(packKey(x, y));
+            continue;
+        }
+        m_known.insert(packKey(x, y));
+
+        cLoadedTile loaded;
+        loaded.m_x = x;
+        loaded.m_y = y;
+        loaded.m_tile = tile;
+        lock_guard<mutex> lock(m_queueMutex);
+        m_ready.push_back(loaded);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cTileManager::update(const cVector3d& a_proxyGlobalPos, cHapticPoint* a_point, double a_dt)
+{
+    int cx, cy;
+    getTile(a_proxyGlobalPos, cx, cy);
+    m_center.store(packKey(cx, cy), memory_order_relaxed);
+
+    // take over the tiles the loader has finished
+    if (m_queueMutex.try_lock())
+    {
+        while (!m_ready.empty() && (m_incoming.size() < m_incoming.capacity()))
+        {
+            m_incoming.push_back(m_ready.back());
+            m_ready.pop_back();
+        }
+        m_queueMutex.unlock();
+    }
+
+    // tiles to evict: outside the prefetch square plus one ring, and not
+    // touched by the tool
+    int evictRadius = m_settings.m_prefetchRadius + 1;
+    bool evict = false;
+    for (size_t i=0; i<m_slots.size(); i++)
+    {
+        const cSlot& slot = m_slots[i];
+        if (slot.m_used && ((abs(slot.m_x - cx) > evictRadius) || (abs(slot.m_y - cy) > evictRadius)))
+        {
+            evict = true;
+        }
+    }
+
+    // attach and detach while the graphics thread is not rendering
+    if ((!m_incoming.empty() || evict) && m_sceneMutex.try_lock())
+    {
+        size_t next = 0;
+        for (size_t i=0; (i<m_slots.size()) && (next<m_incoming.size()); i++)
+        {
+            cSlot& slot = m_slots[i];
+            if (slot.m_used)
+            {
+                continue;
+            }
+            slot.m_used = true;
+            slot.m_x = m_incoming[next].m_x;
+            slot.m_y = m_incoming[next].m_y;
+            slot.m_tile = m_incoming[next].m_tile;
+            slot.m_fade = 0.0;
+            m_map->addChild(slot.m_tile);
+            m_numResident++;
+            next++;
+        }
+        m_incoming.erase(m_incoming.begin(), m_incoming.begin() + next);
+
+        // a tile is only evicted if both queues have room; otherwise it
+        // stays until the loader or the graphics thread catches up
+        for (size_t i=0; (i<m_slots.size()) && evict; i++)
+        {
+            cSlot& slot = m_slots[i];
+            if (!slot.m_used ||
+                ((abs(slot.m_x - cx) <= evictRadius) && (abs(slot.m_y - cy) <= evictRadius)) ||
+                m_evicted.isFull() || m_garbage.isFull())
+            {
+                continue;
+            }
+
+            bool contact = false;
+            for (unsigned int k=0; (k<slot.m_tile->getNumMeshes()) && (a_point != NULL); k++)
+            {
+                contact = contact || a_point->isInContact(slot.m_tile->getMesh(k));
+            }
+            if (contact)
+            {
+                continue;
+            }
+
+            m_map->removeChild(slot.m_tile);
+            m_evicted.push(packKey(slot.m_x, slot.m_y));
+            m_garbage.push(slot.m_tile);
+            slot.m_used = false;
+            slot.m_tile = NULL;
+            m_numResident--;
+            m_numEvicted++;
+        }
+
+        m_sceneMutex.unlock();
+    }
+
+    // ramp up the stiffness of new tiles
+    for (size_t i=0; i<m_slots.size(); i++)
+    {
+        cSlot& slot = m_slots[i];
+        if (slot.m_used && (slot.m_fade < 1.0))
+        {
+            slot.m_fade = (m_settings.m_fadeTime > 0.0) ? cMin(1.0, slot.m_fade + a_dt / m_settings.m_fadeTime) : 1.0;
+            slot.m_tile->setStiffness(slot.m_fade * m_settings.m_stiffness);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cTileManager::collectGarbage()
+{
+    cMultiMesh* tile;
+    while (m_garbage.pop(tile))
+    {
+        delete tile;
+    }
+}
@@ -0,0 +1,221 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CTileManagerH
+#define CTileManagerH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CTileSource.h"
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+
+struct cTileManagerSettings
+{
+    cTileManagerSettings() :
+        m_prefetchRadius(2),
+        m_fadeTime(0.2),
+        m_toolRadius(0.005),
+        m_stiffness(0.0),
+        m_showEdges(true),
+        m_showTriangles(true),
+        m_showNormals(false) {}
+
+    // tiles within this many tiles of the proxy are loaded (Chebyshev
+    // distance); tiles are evicted one tile further out
+    int m_prefetchRadius;
+
+    // time over which the stiffness of a new tile ramps up [s]
+    double m_fadeTime;
+
+    // collision detector and material of the tiles
+    double m_toolRadius;
+    double m_stiffness;
+
+    // display options
+    bool m_showEdges;
+    bool m_showTriangles;
+    bool m_showNormals;
+};
+
+//------------------------------------------------------------------------------
+// Keeps the tiles around the tool proxy resident as children of a map
+// object. A loader thread creates tiles (geometry, edges, collision tree,
+// global frames) off the scene graph; the haptic thread attaches and detaches
+// them, and the graphics thread deletes evicted tiles.
+//
+// The haptic thread never blocks: it only uses try_lock, and postpones a
+// swap to the next tick if a lock is taken. New tiles ramp up their
+// stiffness over m_fadeTime, and a tile the tool is in contact with is never
+// evicted, so swaps do not cause force steps.
+//
+// The graphics thread must hold getSceneMutex() while rendering the world.
+//------------------------------------------------------------------------------
+class cTileManager
+{
+public:
+
+    // a_map is the (static) parent of the tiles; tile coordinates are local
+    // coordinates of a_map
+    cTileManager(chai3d::cGenericObject* a_map, cTileSource* a_source,
+                 const cTileManagerSettings& a_settings = cTileManagerSettings());
+    ~cTileManager();
+
+    // load the tiles around a_globalPos synchronously and attach them. call
+    // before the haptic thread starts.
+    void preload(const chai3d::cVector3d& a_globalPos);
+
+    // start / stop the loader thread
+    void start();
+    void stop();
+
+    // haptic thread, once per tick: publish the proxy position, attach
+    // loaded tiles, evict far tiles and ramp stiffness. a_point is used to
+    // keep tiles in contact.
+    void update(const chai3d::cVector3d& a_proxyGlobalPos, chai3d::cHapticPoint* a_point, double a_dt);
+
+    // graphics thread: delete evicted tiles
+    void collectGarbage();
+
+    // held by the graphics thread while rendering
+    std::mutex& getSceneMutex() { return (m_sceneMutex); }
+
+    // statistics
+    int getNumResident() const { return (m_numResident); }
+    int getNumLoaded() const { return (m_numLoaded); }
+    int getNumEvicted() const { return (m_numEvicted); }
+    double getMaxLoadTime() const { return (m_maxLoadTime); }
+
+private:
+
+    struct cLoadedTile
+    {
+        int m_x;
+        int m_y;
+        chai3d::cMultiMesh* m_tile;
+    };
+
+    struct cSlot
+    {
+        bool m_used;
+        int m_x;
+        int m_y;
+        chai3d::cMultiMesh* m_tile;
+        double m_fade;
+    };
+
+    // fixed-capacity queue from the haptic thread to one other thread,
+    // without locks or allocations once its capacity is set
+    template <typename T>
+    class cRing
+    {
+    public:
+
+        cRing() : m_head(0), m_tail(0) {}
+
+        void setCapacity(size_t a_capacity) { m_items.resize(a_capacity); }
+
+        // haptic thread
+        bool isFull() const
+        {
+            return (m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire) >= m_items.size());
+        }
+        void push(const T& a_item)
+        {
+            uint64_t head = m_head.load(std::memory_order_relaxed);
+            m_items[head % m_items.size()] = a_item;
+            m_head.store(head + 1, std::memory_order_release);
+        }
+
+        // other thread: the oldest item, false if there is none
+        bool pop(T& a_item)
+        {
+            uint64_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head.load(std::memory_order_acquire))
+            {
+                return (false);
+            }
+            a_item = m_items[tail % m_items.size()];
+            m_tail.store(tail + 1, std::memory_order_release);
+            return (true);
+        }
+
+    private:
+
+        std::vector<T> m_items;
+        std::atomic<uint64_t> m_head;
+        std::atomic<uint64_t> m_tail;
+    };
+
+    static int64_t packKey(int a_x, int a_y) { return (((int64_t)a_x << 32) | (uint32_t)a_y); }
+    static int keyX(int64_t a_key) { return ((int)(a_key >> 32)); }
+    static int keyY(int64_t a_key) { return ((int)(uint32_t)a_key); }
+
+    // tile containing a global position
+    void getTile(const chai3d::cVector3d& a_globalPos, int& a_x, int& a_y) const;
+
+    // create a tile ready to be attached (loader thread)
+    chai3d::cMultiMesh* loadTile(int a_x, int a_y);
+
+    // the next wanted tile that is not loaded yet, nearest first
+    bool findMissingTile(int64_t a_center, int& a_x, int& a_y) const;
+
+    void run();
+
+    chai3d::cGenericObject* m_map;
+    cTileSource* m_source;
+    cTileManagerSettings m_settings;
+    int m_minX, m_minY, m_maxX, m_maxY;
+
+    // frame of the map, fixed while tiles are resident
+    chai3d::cVector3d m_mapPos;
+    chai3d::cMatrix3d m_mapRot;
+
+    // proxy tile, written by the haptic thread
+    std::atomic<int64_t> m_center;
+
+    // loader thread state: tiles loaded (attached or on their way) and empty
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::set<int64_t> m_known;
+    std::set<int64_t> m_empty;
+
+    // loaded tiles, guarded by m_queueMutex
+    std::mutex m_queueMutex;
+    std::vector<cLoadedTile> m_ready;
+
+    // evicted tiles: their keys to the loader thread, the tiles to the
+    // graphics thread
+    cRing<int64_t> m_evicted;
+    cRing<chai3d::cMultiMesh*> m_garbage;
+
+    // haptic thread state. all arrays are allocated up front.
+    std::vector<cSlot> m_slots;
+    std::vector<cLoadedTile> m_incoming;
+
+    // held while the scene graph is rendered or changed
+    std::mutex m_sceneMutex;
+
+    // statistics
+    std::atomic<int> m_numResident;
+    std::atomic<int> m_numLoaded;
+    std::atomic<int> m_numEvicted;
+    std::atomic<double> m_maxLoadTime;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,58 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CTileSourceH
+#define CTileSourceH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// A name placed on the map, in local map coordinates.
+//------------------------------------------------------------------------------
+struct cTileLabel
+{
+    std::string m_name;
+    chai3d::cVector3d m_pos;
+};
+
+//------------------------------------------------------------------------------
+// Provides the geometry of a map cut into square tiles. Tile (x, y) covers
+// [x, x+1) * size by [y, y+1) * size in local coordinates of the map.
+//------------------------------------------------------------------------------
+class cTileSource
+{
+public:
+
+    virtual ~cTileSource() {}
+
+    // edge length of a tile in local map coordinates
+    virtual double getTileSize() const = 0;
+
+    // tiles that may hold geometry (inclusive)
+    virtual void getTileRange(int& a_minX, int& a_minY, int& a_maxX, int& a_maxY) const = 0;
+
+    // true if loaded tiles already carry their edges and collision trees
+    virtual bool isPreprocessed() const { return (false); }
+
+    // names on the whole map, loaded or not
+    virtual void getLabels(std::vector<cTileLabel>& /*a_labels*/) const {}
+
+    // create the geometry of tile (x, y), or return NULL if it is empty.
+    // called on the tile loader thread: must not touch the world.
+    virtual chai3d::cMultiMesh* loadTile(int a_x, int a_y) = 0;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
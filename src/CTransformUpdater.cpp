@@ -0,0 +1,173 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CTransformUpdater.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+cTransformUpdater::cTransformUpdater(cGenericObject* a_root) :
+    m_root(a_root),
+    m_fullUpdate(true),
+    m_numUpdated(0)
+{
+    // room for the nodes flagged between two ticks, so that markDirty() and
+    // update() do not allocate in steady state
+    m_pending.reserve(64);
+    m_pendingSwap.reserve(64);
+}
+
+//------------------------------------------------------------------------------
+
+int cTransformUpdater::getDepth(cGenericObject* a_node)
+{
+    int depth = 0;
+    while ((a_node != NULL) && (a_node->getParent() != NULL))
+    {
+        a_node = a_node->getParent();
+        depth++;
+    }
+    return (depth);
+}
+
+//------------------------------------------------------------------------------
+
+void cTransformUpdater::addDynamicNode(cGenericObject* a_node, bool a_alwaysUpdate)
+{
+    cDynamicNode node;
+    node.m_node = a_node;
+    node.m_localPos = a_node->getLocalPos();
+    node.m_localRot = a_node->getLocalRot();
+    node.m_alwaysUpdate = a_alwaysUpdate;
+    node.m_depth = getDepth(a_node);
+
+    // keep parents ahead of their children
+    vector<cDynamicNode>::iterator it = m_dynamicNodes.begin();
+    while ((it != m_dynamicNodes.end()) && (it->m_depth <= node.m_depth))
+    {
+        ++it;
+    }
+    m_dynamicNodes.insert(it, node);
+
+    markDirty(a_node);
+}
+
+//------------------------------------------------------------------------------
+
+void cTransformUpdater::removeDynamicNode(cGenericObject* a_node)
+{
+    for (size_t i=0; i<m_dynamicNodes.size(); i++)
+    {
+        if (m_dynamicNodes[i].m_node == a_node)
+        {
+            m_dynamicNodes.erase(m_dynamicNodes.begin() + i);
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cTransformUpdater::markDirty(cGenericObject* a_node)
+{
+    lock_guard<mutex> lock(m_pendingMutex);
+    m_pending.push_back(a_node);
+}
+
+//------------------------------------------------------------------------------
+
+void cTransformUpdater::invalidateAll()
+{
+    lock_guard<mutex> lock(m_pendingMutex);
+    m_pending.push_back(m_root);
+}
+
+//------------------------------------------------------------------------------
+
+void cTransformUpdater::updateSubtree(cGenericObject* a_node)
+{
+    cGenericObject* parent = a_node->getParent();
+    if (parent == NULL)
+    {
+        a_node->computeGlobalPositions(true);
+    }
+    else
+    {
+        a_node->computeGlobalPositions(true, parent->getGlobalPos(), parent->getGlobalRot());
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cTransformUpdater::update()
+{
+    m_numUpdated = 0;
+
+    // collect nodes flagged since the last tick. if another thread is busy
+    // flagging nodes right now, pick them up next tick rather than waiting.
+    unique_lock<mutex> lock(m_pendingMutex, try_to_lock);
+    if (lock.owns_lock())
+    {
+        m_pendingSwap.swap(m_pending);
+        lock.unlock();
+    }
+
+    for (size_t i=0; i<m_pendingSwap.size(); i++)
+    {
+        if (m_pendingSwap[i] == m_root)
+        {
+            m_fullUpdate = true;
+        }
+    }
+
+    if (m_fullUpdate)
+    {
+        m_root->computeGlobalPositions(true);
+        m_fullUpdate = false;
+        m_pendingSwap.clear();
+        m_numUpdated = 1;
+
+        for (size_t i=0; i<m_dynamicNodes.size(); i++)
+        {
+            m_dynamicNodes[i].m_localPos = m_dynamicNodes[i].m_node->getLocalPos();
+            m_dynamicNodes[i].m_localRot = m_dynamicNodes[i].m_node->getLocalRot();
+        }
+        return;
+    }
+
+    // explicitly flagged subtrees
+    for (size_t i=0; i<m_pendingSwap.size(); i++)
+    {
+        updateSubtree(m_pendingSwap[i]);
+        m_numUpdated++;
+    }
+    m_pendingSwap.clear();
+
+    // dynamic nodes whose local frame moved since the last tick
+    for (size_t i=0; i<m_dynamicNodes.size(); i++)
+    {
+        cDynamicNode& node = m_dynamicNodes[i];
+        cVector3d localPos = node.m_node->getLocalPos();
+        cMatrix3d localRot = node.m_node->getLocalRot();
+
+        if (node.m_alwaysUpdate ||
+            !localPos.equals(node.m_localPos) ||
+            !localRot.equals(node.m_localRot))
+        {
+            updateSubtree(node.m_node);
+            node.m_localPos = localPos;
+            node.m_localRot = localRot;
+            m_numUpdated++;
+        }
+    }
+}
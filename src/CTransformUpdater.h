@@ -0,0 +1,91 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CTransformUpdaterH
+#define CTransformUpdaterH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <mutex>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Incremental replacement for cWorld::computeGlobalPositions(true).
+//
+// The first update() walks the whole scene graph once. After that only the
+// subtrees of registered dynamic nodes whose local frame changed, and of
+// nodes explicitly flagged with markDirty(), are recomputed. Code that moves
+// an otherwise static object, or attaches new children to the graph, must
+// call markDirty() on it (or invalidateAll()).
+//------------------------------------------------------------------------------
+class cTransformUpdater
+{
+public:
+
+    cTransformUpdater(chai3d::cGenericObject* a_root);
+
+    // register a node whose local frame may change at runtime. if
+    // a_alwaysUpdate is set, its subtree is recomputed on every update().
+    void addDynamicNode(chai3d::cGenericObject* a_node, bool a_alwaysUpdate = false);
+
+    // unregister a dynamic node
+    void removeDynamicNode(chai3d::cGenericObject* a_node);
+
+    // flag the subtree of a_node for recomputation. may be called from any thread.
+    void markDirty(chai3d::cGenericObject* a_node);
+
+    // request a full walk of the scene graph on the next update
+    void invalidateAll();
+
+    // bring global frames up to date. never blocks.
+    void update();
+
+    // number of subtrees recomputed by the last update
+    int getNumUpdatedSubtrees() const { return (m_numUpdated); }
+
+protected:
+
+    struct cDynamicNode
+    {
+        chai3d::cGenericObject* m_node;
+        chai3d::cVector3d m_localPos;
+        chai3d::cMatrix3d m_localRot;
+        bool m_alwaysUpdate;
+        int m_depth;
+    };
+
+    // recompute global frames of a_node and its children
+    static void updateSubtree(chai3d::cGenericObject* a_node);
+
+    // depth of a node below the root
+    static int getDepth(chai3d::cGenericObject* a_node);
+
+    // root of the scene graph
+    chai3d::cGenericObject* m_root;
+
+    // nodes checked on every update, sorted parents first
+    std::vector<cDynamicNode> m_dynamicNodes;
+
+    // nodes flagged by markDirty()
+    std::vector<chai3d::cGenericObject*> m_pending;
+    std::vector<chai3d::cGenericObject*> m_pendingSwap;
+    std::mutex m_pendingMutex;
+
+    // full walk requested
+    bool m_fullUpdate;
+
+    // statistics
+    int m_numUpdated;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,79 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CTripleBufferH
+#define CTripleBufferH
+//------------------------------------------------------------------------------
+#include <atomic>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Hands the newest value of a T from one writer thread to one reader thread
+// without locks or waiting on either side.
+//
+// The writer fills getWriteBuffer() and publish()es it; the reader calls
+// update() and reads getReadBuffer(). The three slots are owned by the
+// writer, the reader and the middle respectively, and a publish or an
+// update swaps its own slot with the middle one, so each side always has a
+// whole value of its own: the reader never sees a value being written, and
+// skips the ones it was too slow to read.
+//------------------------------------------------------------------------------
+template <typename T>
+class cTripleBuffer
+{
+public:
+
+    cTripleBuffer() :
+        m_latest(1),
+        m_writeSlot(2),
+        m_readSlot(0) {}
+
+    // writer: the value to fill in, then publish
+    T& getWriteBuffer() { return (m_slots[m_writeSlot]); }
+
+    // writer: make the write buffer the newest value. the next write buffer
+    // holds an older value, not a copy of this one.
+    void publish()
+    {
+        m_writeSlot = m_latest.exchange(m_writeSlot | C_FRESH, std::memory_order_acq_rel) & C_SLOT_MASK;
+    }
+
+    // reader: take over the newest value, if one was published since the
+    // last update. returns true if the read buffer changed.
+    bool update()
+    {
+        if (!(m_latest.load(std::memory_order_acquire) & C_FRESH))
+        {
+            return (false);
+        }
+        m_readSlot = m_latest.exchange(m_readSlot, std::memory_order_acq_rel) & C_SLOT_MASK;
+        return (true);
+    }
+
+    // reader: the value taken over by the last update
+    const T& getReadBuffer() const { return (m_slots[m_readSlot]); }
+
+protected:
+
+    // slot indices and the fresh flag share one atomic word
+    static const int C_SLOT_MASK = 3;
+    static const int C_FRESH = 4;
+
+    T m_slots[3];
+
+    // middle slot and fresh flag; the slots of the writer and the reader
+    std::atomic<int> m_latest;
+    int m_writeSlot;
+    int m_readSlot;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,159 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CWorkerPool.h"
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+cWorkerPool::cWorkerPool(unsigned int a_numThreads)
+{
+    m_task = NULL;
+    m_count = 0;
+    m_next = 0;
+    m_numDone = 0;
+    m_generation = 0;
+    m_numActive = 0;
+    m_stop = false;
+
+    if (a_numThreads == 0)
+    {
+        a_numThreads = thread::hardware_concurrency();
+    }
+    for (unsigned int i=1; i<a_numThreads; i++)
+    {
+        m_threads.push_back(thread(&cWorkerPool::run, this));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cWorkerPool::~cWorkerPool()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start.notify_all();
+    for (size_t i=0; i<m_threads.size(); i++)
+    {
+        m_threads[i].join();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cWorkerPool& cWorkerPool::getDefault()
+{
+    static cWorkerPool pool;
+    return (pool);
+}
+
+//------------------------------------------------------------------------------
+
+void cWorkerPool::work(const function<void(size_t)>* a_task, size_t a_count)
+{
+    size_t done = 0;
+    while (true)
+    {
+        size_t i = m_next.fetch_add(1);
+        if (i >= a_count)
+        {
+            break;
+        }
+        (*a_task)(i);
+        done++;
+    }
+
+    lock_guard<mutex> lock(m_mutex);
+    m_numDone += done;
+    if (m_numDone == a_count)
+    {
+        m_finished.notify_all();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cWorkerPool::run()
+{
+    unsigned int generation = 0;
+    while (true)
+    {
+        // take a copy of the job, so the caller can set up the next one
+        // while this thread is still finishing
+        const function<void(size_t)>* task;
+        size_t count;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_start.wait(lock, [&]() { return (m_stop || (m_generation != generation)); });
+            if (m_stop)
+            {
+                return;
+            }
+            generation = m_generation;
+            task = m_task;
+            count = m_count;
+            if (task == NULL)
+            {
+                continue;
+            }
+            m_numActive++;
+        }
+
+        work(task, count);
+
+        lock_guard<mutex> lock(m_mutex);
+        m_numActive--;
+        if (m_numActive == 0)
+        {
+            m_finished.notify_all();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cWorkerPool::parallelFor(size_t a_count, const function<void(size_t)>& a_task)
+{
+    if (a_count == 0)
+    {
+        return;
+    }
+
+    lock_guard<mutex> call(m_callMutex);
+
+    // small jobs or no workers: run on the caller
+    if (m_threads.empty() || (a_count == 1))
+    {
+        for (size_t i=0; i<a_count; i++)
+        {
+            a_task(i);
+        }
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_task = &a_task;
+        m_count = a_count;
+        m_next = 0;
+        m_numDone = 0;
+        m_generation++;
+    }
+    m_start.notify_all();
+
+    work(&a_task, a_count);
+
+    // wait until all items are done and no worker still looks at the job
+    unique_lock<mutex> lock(m_mutex);
+    m_finished.wait(lock, [&]() { return ((m_numDone == m_count) && (m_numActive == 0)); });
+    m_task = NULL;
+}
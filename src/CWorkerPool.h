@@ -0,0 +1,74 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CWorkerPoolH
+#define CWorkerPoolH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Fixed set of worker threads for data-parallel loading work (file decoding,
+// preprocessing). Not meant for the haptic thread: parallelFor() blocks
+// until all items are done.
+//------------------------------------------------------------------------------
+class cWorkerPool
+{
+public:
+
+    // a_numThreads threads in total including the caller; 0 = one per core
+    cWorkerPool(unsigned int a_numThreads = 0);
+    ~cWorkerPool();
+
+    // number of threads that work on a parallelFor(), including the caller
+    unsigned int getNumThreads() const { return ((unsigned int)m_threads.size() + 1); }
+
+    // call a_task(i) for i in [0, a_count) on all threads and wait for the
+    // result. calls from several threads are serialized; a task must not
+    // call parallelFor() on the same pool.
+    void parallelFor(size_t a_count, const std::function<void(size_t)>& a_task);
+
+    // pool shared by the loaders
+    static cWorkerPool& getDefault();
+
+private:
+
+    cWorkerPool(const cWorkerPool&);
+    cWorkerPool& operator=(const cWorkerPool&);
+
+    void run();
+    void work(const std::function<void(size_t)>* a_task, size_t a_count);
+
+    std::vector<std::thread> m_threads;
+
+    // serializes parallelFor() callers
+    std::mutex m_callMutex;
+
+    // current job
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_finished;
+    const std::function<void(size_t)>* m_task;
+    size_t m_count;
+    std::atomic<size_t> m_next;
+    size_t m_numDone;
+    unsigned int m_generation;
+    unsigned int m_numActive;
+    bool m_stop;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,332 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "CXmlStreamReader.h"
+//------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+bool cXmlAttribute::is(const char* a_name) const
+{
+    return ((strncmp(m_name, a_name, m_nameLength) == 0) && (a_name[m_nameLength] == '\0'));
+}
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    inline bool isSpace(char a_c)
+    {
+        return ((a_c == ' ') || (a_c == '\t') || (a_c == '\n') || (a_c == '\r'));
+    }
+
+    //--------------------------------------------------------------------------
+
+    // find a_pattern in [a_begin, a_end), or NULL
+    const char* find(const char* a_begin, const char* a_end, const char* a_pattern)
+    {
+        size_t length = strlen(a_pattern);
+        while (a_end - a_begin >= (ptrdiff_t)length)
+        {
+            const char* c = (const char*)memchr(a_begin, a_pattern[0], a_end - a_begin);
+            if ((c == NULL) || (a_end - c < (ptrdiff_t)length))
+            {
+                return (NULL);
+            }
+            if (memcmp(c, a_pattern, length) == 0)
+            {
+                return (c);
+            }
+            a_begin = c + 1;
+        }
+        return (NULL);
+    }
+
+    //--------------------------------------------------------------------------
+
+    void appendUtf8(unsigned long a_code, string& a_result)
+    {
+        if (a_code < 0x80)
+        {
+            a_result += (char)a_code;
+        }
+        else if (a_code < 0x800)
+        {
+            a_result += (char)(0xC0 | (a_code >> 6));
+            a_result += (char)(0x80 | (a_code & 0x3F));
+        }
+        else if (a_code < 0x10000)
+        {
+            a_result += (char)(0xE0 | (a_code >> 12));
+            a_result += (char)(0x80 | ((a_code >> 6) & 0x3F));
+            a_result += (char)(0x80 | (a_code & 0x3F));
+        }
+        else
+        {
+            a_result += (char)(0xF0 | (a_code >> 18));
+            a_result += (char)(0x80 | ((a_code >> 12) & 0x3F));
+            a_result += (char)(0x80 | ((a_code >> 6) & 0x3F));
+            a_result += (char)(0x80 | (a_code & 0x3F));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void cXmlStreamReader::decode(const char* a_value, size_t a_length, string& a_result)
+{
+    a_result.clear();
+    const char* end = a_value + a_length;
+    const char* c = a_value;
+    while (c < end)
+    {
+        const char* amp = (const char*)memchr(c, '&', end - c);
+        if (amp == NULL)
+        {
+            a_result.append(c, end);
+            break;
+        }
+        a_result.append(c, amp);
+
+        const char* semicolon = (const char*)memchr(amp, ';', end - amp);
+        if (semicolon == NULL)
+        {
+            a_result.append(amp, end);
+            break;
+        }
+
+        const char* entity = amp + 1;
+        size_t length = semicolon - entity;
+        if ((length == 3) && (strncmp(entity, "amp", 3) == 0))       a_result += '&';
+        else if ((length == 2) && (strncmp(entity, "lt", 2) == 0))   a_result += '<';
+        else if ((length == 2) && (strncmp(entity, "gt", 2) == 0))   a_result += '>';
+        else if ((length == 4) && (strncmp(entity, "quot", 4) == 0)) a_result += '"';
+        else if ((length == 4) && (strncmp(entity, "apos", 4) == 0)) a_result += '\'';
+        else if ((length > 1) && (entity[0] == '#'))
+        {
+            // numeric character reference, re-encoded as UTF-8
+            unsigned long code = (entity[1] == 'x') ? strtoul(entity + 2, NULL, 16)
+                                                    : strtoul(entity + 1, NULL, 10);
+            appendUtf8(code, a_result);
+        }
+        else
+        {
+            a_result.append(amp, semicolon + 1);
+        }
+        c = semicolon + 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+cXmlStreamReader::cXmlStreamReader()
+{
+    m_chunkSize = 256 * 1024;
+    m_bytesRead = 0;
+}
+
+//------------------------------------------------------------------------------
+
+const char* cXmlStreamReader::parseTag(const char* a_begin, const char* a_end, cXmlHandler& a_handler)
+{
+    const char* c = a_begin;
+
+    // closing tag
+    if ((c < a_end) && (*c == '/'))
+    {
+        c++;
+        const char* name = c;
+        while ((c < a_end) && (*c != '>') && !isSpace(*c)) c++;
+        const char* nameEnd = c;
+        c = (const char*)memchr(c, '>', a_end - c);
+        if (c == NULL)
+        {
+            return (NULL);
+        }
+        a_handler.endElement(name, nameEnd - name);
+        return (c + 1);
+    }
+
+    // element name
+    const char* name = c;
+    while ((c < a_end) && (*c != '/') && (*c != '>') && !isSpace(*c)) c++;
+    size_t nameLength = c - name;
+
+    // attributes. values may contain '>', so the tag only ends outside quotes.
+    m_attributes.clear();
+    bool selfClosing = false;
+    while (true)
+    {
+        while ((c < a_end) && isSpace(*c)) c++;
+        if (c >= a_end)
+        {
+            return (NULL);
+        }
+        if (*c == '>')
+        {
+            c++;
+            break;
+        }
+        if (*c == '/')
+        {
+            selfClosing = true;
+            c++;
+            continue;
+        }
+
+        cXmlAttribute attribute;
+        attribute.m_name = c;
+        while ((c < a_end) && (*c != '=') && (*c != '>') && !isSpace(*c)) c++;
+        attribute.m_nameLength = c - attribute.m_name;
+        while ((c < a_end) && (*c != '"') && (*c != '\'') && (*c != '>')) c++;
+        if (c >= a_end)
+        {
+            return (NULL);
+        }
+        if (*c == '>')
+        {
+            // attribute without value; not valid XML, ignore it
+            continue;
+        }
+        char quote = *c++;
+        const char* close = (const char*)memchr(c, quote, a_end - c);
+        if (close == NULL)
+        {
+            return (NULL);
+        }
+        attribute.m_value = c;
+        attribute.m_valueLength = close - c;
+        c = close + 1;
+        m_attributes.push_back(attribute);
+    }
+
+    a_handler.startElement(name, nameLength,
+                           m_attributes.empty() ? NULL : &m_attributes[0], m_attributes.size());
+    if (selfClosing)
+    {
+        a_handler.endElement(name, nameLength);
+    }
+    return (c);
+}
+
+//------------------------------------------------------------------------------
+
+bool cXmlStreamReader::read(const string& a_filename, cXmlHandler& a_handler)
+{
+    m_bytesRead = 0;
+
+    FILE* file = fopen(a_filename.c_str(), "rb");
+    if (file == NULL)
+    {
+        return (false);
+    }
+
+    m_buffer.resize(m_chunkSize);
+    size_t begin = 0;
+    size_t filled = 0;
+    bool eof = false;
+    bool complete = true;
+
+    while (true)
+    {
+        // move the unparsed tail to the front and refill. a single tag larger
+        // than the buffer grows it.
+        if (!eof)
+        {
+            if (begin > 0)
+            {
+                memmove(&m_buffer[0], &m_buffer[begin], filled - begin);
+                filled -= begin;
+                begin = 0;
+            }
+            if (filled == m_buffer.size())
+            {
+                m_buffer.resize(2 * m_buffer.size());
+            }
+            size_t count = fread(&m_buffer[filled], 1, m_buffer.size() - filled, file);
+            filled += count;
+            m_bytesRead += count;
+            eof = (count == 0);
+        }
+
+        const char* data = &m_buffer[0];
+        const char* end = data + filled;
+        const char* c = data + begin;
+        bool needMore = false;
+
+        while (c < end)
+        {
+            const char* open = (const char*)memchr(c, '<', end - c);
+            if (open == NULL)
+            {
+                // text content
+                c = end;
+                break;
+            }
+
+            const char* next = NULL;
+            if (open + 1 >= end)
+            {
+                next = NULL;
+            }
+            else if (open[1] == '!')
+            {
+                // comments, CDATA, doctype
+                if ((end - open >= 4) && (strncmp(open, "<!--", 4) == 0))
+                {
+                    next = find(open + 4, end, "-->");
+                    if (next != NULL) next += 3;
+                }
+                else if ((end - open >= 9) && (strncmp(open, "<![CDATA[", 9) == 0))
+                {
+                    next = find(open + 9, end, "]]>");
+                    if (next != NULL) next += 3;
+                }
+                else if (end - open >= 9)
+                {
+                    next = (const char*)memchr(open, '>', end - open);
+                    if (next != NULL) next += 1;
+                }
+            }
+            else if (open[1] == '?')
+            {
+                next = find(open + 2, end, "?>");
+                if (next != NULL) next += 2;
+            }
+            else
+            {
+                next = parseTag(open + 1, end, a_handler);
+            }
+
+            if (next == NULL)
+            {
+                // the tag continues in the next chunk
+                c = open;
+                needMore = true;
+                break;
+            }
+            c = next;
+        }
+
+        begin = c - data;
+        if (eof)
+        {
+            complete = !needMore;
+            break;
+        }
+    }
+
+    fclose(file);
+    return (complete);
+}
@@ -0,0 +1,90 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#ifndef CXmlStreamReaderH
+#define CXmlStreamReaderH
+//------------------------------------------------------------------------------
+#include <cstddef>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Attribute of an XML element. Name and value point into the reader's buffer
+// and are only valid during the callback; the value is not entity-decoded.
+//------------------------------------------------------------------------------
+struct cXmlAttribute
+{
+    const char* m_name;
+    size_t m_nameLength;
+    const char* m_value;
+    size_t m_valueLength;
+
+    // true if the attribute is called a_name
+    bool is(const char* a_name) const;
+};
+
+//------------------------------------------------------------------------------
+// Receives the elements of a document from cXmlStreamReader.
+//------------------------------------------------------------------------------
+class cXmlHandler
+{
+public:
+
+    virtual ~cXmlHandler() {}
+
+    // opening tag. self-closing tags are followed by endElement().
+    virtual void startElement(const char* a_name, size_t a_nameLength,
+                              const cXmlAttribute* a_attributes, size_t a_numAttributes) = 0;
+
+    // closing tag
+    virtual void endElement(const char* a_name, size_t a_nameLength) = 0;
+};
+
+//------------------------------------------------------------------------------
+// Event-based XML reader. The file is read in fixed-size chunks, so memory
+// use does not depend on the size of the document. Only elements and
+// attributes are reported; text content, comments, declarations and CDATA
+// are skipped, which is all OSM files need.
+//------------------------------------------------------------------------------
+class cXmlStreamReader
+{
+public:
+
+    cXmlStreamReader();
+
+    // read a file and pass its elements to a_handler. returns false if the
+    // file cannot be opened or ends inside a tag.
+    bool read(const std::string& a_filename, cXmlHandler& a_handler);
+
+    // size of the read buffer. it grows if a single tag is larger.
+    void setChunkSize(size_t a_size) { m_chunkSize = a_size; }
+
+    // bytes consumed by the last read()
+    size_t getBytesRead() const { return (m_bytesRead); }
+
+    // decode the XML entities in an attribute value into a_result
+    static void decode(const char* a_value, size_t a_length, std::string& a_result);
+
+protected:
+
+    // parse the tag starting after '<' at a_begin. returns the position after
+    // the closing '>', or NULL if the tag is not complete in the buffer.
+    const char* parseTag(const char* a_begin, const char* a_end, cXmlHandler& a_handler);
+
+    size_t m_chunkSize;
+    size_t m_bytesRead;
+    std::vector<char> m_buffer;
+    std::vector<cXmlAttribute> m_attributes;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
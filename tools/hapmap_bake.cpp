@@ -0,0 +1,254 @@
+/*
+ *
+ *    DH2660 Haptic Programming Spring 2017
+ *    HapMap - Group 5 (Thea, Linnéa, Kirsten)
+ *
+ *    Offline baker: turns an OSM extract or an OBJ mesh into a tile pyramid
+ *    (.hmtiles) that the application streams without building geometry or
+ *    collision trees at runtime.
+ *
+ *    Distribution license: BSD (see main.cpp)
+ *
+ */
+
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include "COsmMap.h"
+#include "COsmMeshBuilder.h"
+#include "CTileBaker.h"
+#include "CWorkerPool.h"
+//------------------------------------------------------------------------------
+#include <chrono>
+#include <cstdlib>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// SETTINGS
+//------------------------------------------------------------------------------
+
+struct cBakeSettings
+{
+    cBakeSettings() :
+        m_numThreads(0) {}
+
+    // .osm, .osm.pbf or .obj input, and the tile file to write
+    string m_input;
+    string m_output;
+
+    // pyramid layout and decimation
+    cTileBakerSettings m_baker;
+
+    // geometry of OSM input
+    cOsmMeshSettings m_osm;
+
+    // worker threads (0 = one per core)
+    unsigned int m_numThreads;
+};
+
+//------------------------------------------------------------------------------
+
+static void printUsage()
+{
+    cout << "usage: hapmap_bake [options] <input> <output.hmtiles>" << endl << endl;
+    cout << "  <input> is an OSM extract (.osm, .osm.pbf) or a mesh (.obj)" << endl << endl;
+    cout << "  --tile-size <s>      level 0 tile size in world units (default 0.05)" << endl;
+    cout << "  --levels <n>         pyramid levels, each doubling the tile size (default 4)" << endl;
+    cout << "  --visual-cell <s>    visual decimation grid at level 0 (default 0.0005, 0 = none)" << endl;
+    cout << "  --haptic-cell <s>    haptic proxy decimation grid at level 0 (default 0.00025, 0 = none)" << endl;
+    cout << "  --tool-radius <r>    tool radius of the collision trees (default 0.005)" << endl;
+    cout << "  --threads <n>        worker threads (default: one per core)" << endl;
+    cout << "  --map-size <s>       OSM: size of the extract in world units (default 0.6)" << endl;
+    cout << "  --scale <s>          OSM: world units per metre (overrides --map-size)" << endl;
+    cout << "  --rotation <deg>     OSM: rotation of the map about the vertical axis" << endl;
+}
+
+//------------------------------------------------------------------------------
+
+static bool parseArguments(int argc, char* argv[], cBakeSettings& a_settings)
+{
+    vector<string> files;
+    for (int i=1; i<argc; i++)
+    {
+        string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if ((arg == "--help") || (arg == "-h"))
+        {
+            return (false);
+        }
+        else if ((arg == "--tile-size") && hasValue)    { a_settings.m_baker.m_tileSize = atof(argv[++i]); }
+        else if ((arg == "--levels") && hasValue)       { a_settings.m_baker.m_numLevels = (unsigned int)atoi(argv[++i]); }
+        else if ((arg == "--visual-cell") && hasValue)  { a_settings.m_baker.m_visualCell = atof(argv[++i]); }
+        else if ((arg == "--haptic-cell") && hasValue)  { a_settings.m_baker.m_hapticCell = atof(argv[++i]); }
+        else if ((arg == "--tool-radius") && hasValue)  { a_settings.m_baker.m_toolRadius = atof(argv[++i]); }
+        else if ((arg == "--threads") && hasValue)      { a_settings.m_numThreads = (unsigned int)atoi(argv[++i]); }
+        else if ((arg == "--map-size") && hasValue)     { a_settings.m_osm.m_mapSize = atof(argv[++i]); }
+        else if ((arg == "--scale") && hasValue)        { a_settings.m_osm.m_scale = atof(argv[++i]); }
+        else if ((arg == "--rotation") && hasValue)     { a_settings.m_osm.m_rotationDeg = atof(argv[++i]); }
+        else if ((arg.size() > 1) && (arg[0] == '-'))
+        {
+            cout << "Error - unknown option: " << arg << endl;
+            return (false);
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.size() != 2)
+    {
+        return (false);
+    }
+    a_settings.m_input = files[0];
+    a_settings.m_output = files[1];
+
+    if ((a_settings.m_baker.m_tileSize <= 0.0) || (a_settings.m_baker.m_numLevels == 0) ||
+        (a_settings.m_baker.m_numLevels > 16) || (a_settings.m_baker.m_visualCell < 0.0) ||
+        (a_settings.m_baker.m_hapticCell < 0.0) || (a_settings.m_baker.m_toolRadius <= 0.0))
+    {
+        cout << "Error - tile size, levels (1-16) and tool radius must be positive" << endl;
+        return (false);
+    }
+
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+static inline double bakeTime()
+{
+    return (chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//------------------------------------------------------------------------------
+
+static bool hasSuffix(const string& a_string, const string& a_suffix)
+{
+    return ((a_string.size() >= a_suffix.size()) &&
+            (a_string.compare(a_string.size() - a_suffix.size(), a_suffix.size(), a_suffix) == 0));
+}
+
+//------------------------------------------------------------------------------
+// INPUT
+//------------------------------------------------------------------------------
+
+// build the OSM geometry and label the named buildings on their roofs
+static bool loadOsm(const cBakeSettings& a_settings, cMultiMesh* a_object, cTileBaker& a_baker)
+{
+    cOsmMap map;
+    if (!map.loadFromFile(a_settings.m_input))
+    {
+        return (false);
+    }
+
+    cOsmMeshBuilder builder(map, a_settings.m_osm);
+    if (!builder.build(a_object))
+    {
+        cout << "Error - " << a_settings.m_input << " holds no buildings or paths" << endl;
+        return (false);
+    }
+    a_baker.addMultiMesh(a_object);
+
+    vector<cOsmBuilding> buildings;
+    builder.extractBuildings(buildings);
+    for (size_t i=0; i<buildings.size(); i++)
+    {
+        const cOsmBuilding& building = buildings[i];
+        if (!building.m_name.empty())
+        {
+            a_baker.addLabel(building.m_name, builder.getLabelAnchor(building));
+        }
+    }
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+// load a mesh and label its named parts on top of their bounding boxes
+static bool loadMesh(const cBakeSettings& a_settings, cMultiMesh* a_object, cTileBaker& a_baker)
+{
+    if (!a_object->loadFromFile(a_settings.m_input))
+    {
+        cout << "Error - could not load " << a_settings.m_input << endl;
+        return (false);
+    }
+    a_baker.addMultiMesh(a_object);
+
+    for (unsigned int i=0; i<a_object->getNumMeshes(); i++)
+    {
+        cMesh* mesh = a_object->getMesh(i);
+        if (mesh->m_name.empty() || (mesh->getNumVertices() == 0))
+        {
+            continue;
+        }
+        cVector3d min = mesh->m_vertices->getLocalPos(0);
+        cVector3d max = min;
+        for (unsigned int k=1; k<mesh->getNumVertices(); k++)
+        {
+            cVector3d pos = mesh->m_vertices->getLocalPos(k);
+            for (int c=0; c<3; c++)
+            {
+                min(c) = cMin(min(c), pos(c));
+                max(c) = cMax(max(c), pos(c));
+            }
+        }
+        cVector3d anchor(0.5 * (min(0) + max(0)), 0.5 * (min(1) + max(1)), max(2));
+        a_baker.addLabel(mesh->m_name, mesh->getLocalPos() + mesh->getLocalRot() * anchor);
+    }
+    return (true);
+}
+
+
+//------------------------------------------------------------------------------
+// MAIN
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    cBakeSettings settings;
+    if (!parseArguments(argc, argv, settings))
+    {
+        printUsage();
+        return (1);
+    }
+
+    cWorkerPool pool(settings.m_numThreads);
+    cTileBaker baker(settings.m_baker);
+
+    // input geometry
+    double start = bakeTime();
+    cMultiMesh* object = new cMultiMesh();
+    bool loaded = hasSuffix(settings.m_input, ".obj") ? loadMesh(settings, object, baker)
+                                                      : loadOsm(settings, object, baker);
+    delete object;
+    if (!loaded)
+    {
+        return (1);
+    }
+    double loadEnd = bakeTime();
+    cout << "input: " << baker.getNumTriangles() << " triangles, " << baker.getNumLabels()
+         << " labels in " << cStr(loadEnd - start, 2) << " s" << endl;
+
+    // pyramid
+    if (!baker.bake(settings.m_output, pool))
+    {
+        return (1);
+    }
+    double bakeEnd = bakeTime();
+
+    for (unsigned int level=0; level<settings.m_baker.m_numLevels; level++)
+    {
+        cout << "level " << level << ": tile size " << ldexp(settings.m_baker.m_tileSize, (int)level)
+             << ", " << baker.getNumVisualTriangles(level) << " visual / "
+             << baker.getNumHapticTriangles(level) << " haptic triangles" << endl;
+    }
+    cout << "baked " << baker.getNumTiles() << " tiles on " << pool.getNumThreads() << " threads in "
+         << cStr(bakeEnd - loadEnd, 2) << " s -> " << settings.m_output << endl;
+
+    return (0);
+}